@@ -58,6 +58,24 @@ cast_strategy = {
 
 
 exclude_ops = ["CopyInp", "CastDtype"]
+# in-place ops whose tensor arguments are combined element by element, their dtype
+# conversion can run tile by tile instead of on whole temporaries. Each maps to the
+# tensors it writes, the only ones cast back, the optimizers take their grad as a
+# non-const handle but only read it.
+elementwise_inp_ops = {
+    "AddInp": ["input"],
+    "SubInp": ["input"],
+    "MulInp": ["input"],
+    "DivInp": ["input"],
+    "Sgd": ["w", "buf"],
+    "Adam": ["input", "exp_avg", "exp_avg_sq", "max_exp_avg_sq"],
+    "AdamW": ["input", "exp_avg", "exp_avg_sq", "max_exp_avg_sq"],
+    "Adadelta": ["input", "square_avg", "acc_delta"],
+    "Rmsprop": ["input", "square_avg", "grad_avg", "momentum_buf"],
+}
+# functions declared in functions_ext.h, vendors export these themselves, so the
+# adaptor only wraps the ones a config maps to a composite implementation
+ext_funcs = set()
 inp_config = {
     "BatchNorm": ["running_mean", "running_var"],
     "IndexPut": ["out"],
@@ -218,6 +236,11 @@ def get_functions_support(source_dir: str) -> Tuple[dict, dict]:
         os.path.join(source_dir, "functions.h"), "r", encoding="utf8"
     ) as f:
         content = f.readlines()
+    ext_start = len(content)
+    with open(
+        os.path.join(source_dir, "functions_ext.h"), "r", encoding="utf8"
+    ) as f:
+        content += f.readlines()
     funcs_info = {}
     func_dtypes = []
     param_dtypes = {}
@@ -280,6 +303,8 @@ def get_functions_support(source_dir: str) -> Tuple[dict, dict]:
                 funcs_decl[func_name] = func_decl
             if func_name not in funcs_info.keys():
                 funcs_info[func_name] = {}
+            if idx >= ext_start:
+                ext_funcs.add(func_name)
             funcs_info[func_name]["call_args"] = args
             if ins is None:
                 continue
@@ -511,6 +536,128 @@ def memory_format_to_str(memory_format):
     return ", std::vector<diopiMemoryFormat_t>{" + ",".join(formats) + "}"
 
 
+def plan_cache_decl(func: str, tensor: str, cast_method: str, memory_format: list) -> str:
+    # one thread_local plan cache per tensor argument of the generated adaptor, the op name
+    # lets it ask the backend for capabilities the config does not know about
+    formats = memory_format_to_str(memory_format)
+    return 'thread_local ConvertPlanCache<{cast}> {tensor}Plan("{func}"{formats});'.format(
+        cast=cast_method,
+        tensor=tensor,
+        func=func,
+        formats=formats if formats != ", {}" else "",
+    )
+
+
+def autogen_fallback(func: str, func_info: dict, call_args: list) -> str:
+    # host copies of the arguments the vendor kernel was called with, ops returning
+    # tensors through diopiTensorHandle_t* are left to the vendor
+    if "ins" not in func_info:
+        return ""
+    ins_vector = func_info.get("ins_vector", {})
+    host_args = []
+    fallback_args = []
+    for arg, call_arg in zip(func_info["call_args"], call_args):
+        name = arg.split(" ")[-1]
+        host_name = name + "Host"
+        if name in ins_vector:
+            host_args.append(
+                "diopiConstTensorHandle_t* {host} = host.inputs({arg}, {num});".format(
+                    host=host_name, arg=call_arg, num=ins_vector[name]
+                )
+            )
+        elif arg.startswith("diopiConstTensorHandle_t"):
+            host_args.append(
+                "diopiConstTensorHandle_t {host} = host.input({arg});".format(
+                    host=host_name, arg=call_arg
+                )
+            )
+        elif arg.startswith("diopiTensorHandle_t"):
+            host_args.append(
+                "diopiTensorHandle_t {host} = host.output({arg});".format(
+                    host=host_name, arg=call_arg
+                )
+            )
+        else:
+            fallback_args.append(call_arg)
+            continue
+        fallback_args.append(host_name)
+    return OT.fallback_template.substitute(
+        env=dict(
+            func_name=func,
+            op_name=func.lstrip("diopi"),
+            host_args=host_args,
+            call_args=", ".join(fallback_args),
+        )
+    )
+
+
+def autogen_composite(
+    func: str, op_configs: dict, impl_funcs: dict, call_args: list
+) -> str:
+    # an op the vendor implements still runs its composite version when the vendor kernel declines the call
+    if func not in impl_funcs or not op_configs.get(func, {}).get(
+        "supportComposite"
+    ):
+        return ""
+    return OT.composite_template.substitute(
+        env=dict(
+            op_name=func.lstrip("diopi"),
+            call_func=func + "(" + ", ".join(call_args) + ")",
+        )
+    )
+
+
+def force_fallback_cond(func: str, fallback: str, composite: str) -> str:
+    # DIOPI_FALLBACK_OPS can only skip the vendor kernel of ops that have somewhere else to go
+    if not fallback and not composite:
+        return ""
+    return 'forceFallback("{func}") ? diopiNoImplement : '.format(func=func)
+
+
+def need_conversion(
+    func: str, op_configs: dict, func_infos: dict, cast: str, layout: list
+) -> bool:
+    # an op whose tensors have neither a cast nor a layout is a plain call
+    op_config = op_configs.get(func)
+    for tensor in list(func_infos[func]["ins"].keys()) + list(
+        func_infos[func]["outs"].keys()
+    ):
+        tensor_info = op_config["tensor"][tensor] if op_config else None
+        cast_method = tensor_info["cast"] if tensor_info else cast
+        memory_format = tensor_info["layout"] if tensor_info else layout
+        if (cast_method and cast_method != "NoCast") or len(memory_format):
+            return True
+    return False
+
+
+def autogen_chunked(
+    op_name: str, func_info: dict, device: str
+) -> str:
+    if op_name not in elementwise_inp_ops or "ins_vector" in func_info:
+        return ""
+    conditions = []
+    call_args = []
+    for arg in func_info["call_args"]:
+        name = arg.split(" ")[-1]
+        if name in func_info["ins"] or name in func_info["outs"]:
+            call_args.append("tile[{}]".format(len(conditions)))
+            conditions.append(
+                "chunked.add({name}, {name}Plan, {name}Meta, {output})".format(
+                    name=name,
+                    output="true" if name in elementwise_inp_ops[op_name] else "false",
+                )
+            )
+        else:
+            call_args.append(name)
+    return OT.chunked_template.substitute(
+        env=dict(
+            conditions=" && ".join(conditions),
+            device=device,
+            call_func="diopi" + op_name + "(" + ", ".join(call_args) + ")",
+        )
+    )
+
+
 def autogen_op_adaptor(
     op_configs: dict, device: str, func_infos: dict, impl_funcs: dict
 ) -> list:
@@ -529,6 +676,8 @@ def autogen_op_adaptor(
                 device_mapping = "composite"
             else:
                 continue
+        elif func in ext_funcs:
+            continue
         if (
             (
                 func not in op_configs.keys()
@@ -536,10 +685,13 @@ def autogen_op_adaptor(
             )
             or len(list(func_infos[func].keys())) == 1
             or op_name in exclude_ops
+            or not need_conversion(func, op_configs, func_infos, cast, layout)
         ):
             call_args = [
                 arg.split(" ")[-1] for arg in func_infos[func]["call_args"]
             ]
+            fallback = autogen_fallback(func, func_infos[func], call_args)
+            composite = autogen_composite(func, op_configs, impl_funcs, call_args)
             adaptors_code.append(
                 OT.adaptor_template.substitute(
                     env=dict(
@@ -551,8 +703,20 @@ def autogen_op_adaptor(
                         new_input="",
                         cast_input="",
                         cast_output="",
+                        chunked="",
                         func_name=func,
                         call_func=func + "(" + ", ".join(call_args) + ")",
+                        fast_path=OT.direct_call_template.substitute(
+                            env=dict(
+                                device=device
+                                if not device_mapping
+                                else device_mapping,
+                                call_func=func + "(" + ", ".join(call_args) + ")",
+                            )
+                        ),
+                        composite=composite,
+                        fallback=fallback,
+                        force_fallback=force_fallback_cond(func, fallback, composite),
                     )
                 )
             )
@@ -562,6 +726,8 @@ def autogen_op_adaptor(
             cast_ins = []
             cast_outs = []
             new_input = []
+            plan_caches = []
+            conditions = ["!kAdaptorHooks"]
             for tensor in list(func_infos[func]["ins"].keys()) + list(
                 func_infos[func]["outs"].keys()
             ):
@@ -572,7 +738,17 @@ def autogen_op_adaptor(
                 memory_format = (
                     tensor_info["layout"] if tensor_info else layout
                 )
-                format_str = memory_format_to_str(memory_format)
+                plan_caches.append(
+                    plan_cache_decl(
+                        func,
+                        tensor,
+                        cast_method if cast_method else "NoCast",
+                        memory_format,
+                    )
+                )
+                if tensor not in func_infos[func].get("ins_vector", {}):
+                    # filled by the fast path check, reused by the conversions below it
+                    plan_caches.append("ArgMeta {tensor}Meta;".format(tensor=tensor))
                 ins = func_infos[func]["ins"]
                 if tensor in ins:
                     if (
@@ -583,7 +759,7 @@ def autogen_op_adaptor(
                             """\
 std::vector<diopiConstTensorHandle_t> ${newinput}(${num}, diopiConstTensorHandle_t());
 for (int i = 0; i < ${num}; ++i) {
-    castImpl<diopiConstTensorHandle_t${cast}>(ctx, ${input}[i], &${newinput}[i]${memory_format});
+    castImpl<diopiConstTensorHandle_t, ${cast}>(ctx, ${input}[i], &${newinput}[i], ${input}Plan);
 }
 """
                         )
@@ -593,28 +769,35 @@ for (int i = 0; i < ${num}; ++i) {
                                     input=tensor,
                                     newinput="new" + tensor.capitalize(),
                                     num=func_infos[func]["ins_vector"][tensor],
-                                    cast=", " + cast_method
-                                    if cast_method
-                                    else "",
-                                    memory_format=format_str,
+                                    cast=cast_method if cast_method else "NoCast",
                                 )
                             )
                         )
+                        conditions.append(
+                            "isConforming({tensor}, {num}, {tensor}Plan)".format(
+                                tensor=tensor,
+                                num=func_infos[func]["ins_vector"][tensor],
+                            )
+                        )
                     else:
                         new_in = "new" + tensor.capitalize()
                         new_ins.append(new_in)
-                        cast_impl = "castImpl<diopiConstTensorHandle_t{cast}>(ctx, {tensor}, &{new_tensor}{memory_format});".format(
-                            cast=", " + cast_method if cast_method else "",
-                            memory_format=format_str,
+                        cast_impl = "castImpl<diopiConstTensorHandle_t, {cast}>(ctx, {tensor}, &{new_tensor}, {tensor}Plan, {tensor}Meta);".format(
+                            cast=cast_method if cast_method else "NoCast",
                             tensor=tensor,
                             new_tensor=new_in,
                         )
                         cast_ins.append(cast_impl)
+                        conditions.append(
+                            "isConforming({tensor}, {tensor}Plan, {tensor}Meta)".format(tensor=tensor)
+                        )
                 outs = func_infos[func]["outs"]
                 if tensor in outs:
-                    cast_impl = "DiopiTensorWrapper<{cast}> {tensor}Wrapper(ctx, {tensor}{memory_format}, {inp});".format(
+                    conditions.append(
+                        "isConforming({tensor}, {tensor}Plan, {tensor}Meta)".format(tensor=tensor)
+                    )
+                    cast_impl = "DiopiTensorWrapper<{cast}> {tensor}Wrapper(ctx, {tensor}, {tensor}Plan, {tensor}Meta, {inp});".format(
                         cast=cast_method,
-                        memory_format=format_str,
                         tensor=tensor,
                         inp="true"
                         if (
@@ -642,6 +825,8 @@ for (int i = 0; i < ${num}; ++i) {
                 else:
                     new_name = name
                 call_args.append(new_name)
+            fallback = autogen_fallback(func, func_infos[func], call_args)
+            composite = autogen_composite(func, op_configs, impl_funcs, call_args)
             adaptors_code.append(
                 OT.adaptor_template.substitute(
                     env=dict(
@@ -651,8 +836,30 @@ for (int i = 0; i < ${num}; ++i) {
                         new_input=new_input,
                         cast_input=cast_ins,
                         cast_output=cast_outs,
+                        chunked=autogen_chunked(
+                            op_name,
+                            func_infos[func],
+                            device_mapping if device_mapping else device,
+                        ),
                         func_name=func,
                         call_func=func + "(" + ", ".join(call_args) + ")",
+                        fast_path=OT.fast_path_template.substitute(
+                            env=dict(
+                                plan_caches=plan_caches,
+                                conditions=" && ".join(conditions),
+                                device=device_mapping if device_mapping else device,
+                                call_func=func
+                                + "("
+                                + ", ".join(
+                                    arg.split(" ")[-1]
+                                    for arg in func_infos[func]["call_args"]
+                                )
+                                + ")",
+                            )
+                        ),
+                        composite=composite,
+                        fallback=fallback,
+                        force_fallback=force_fallback_cond(func, fallback, composite),
                     )
                 )
             )
@@ -664,7 +871,7 @@ def get_impl_funcs_declaration(
 ) -> dict:
     funcs_decl: dict = {}
     for func in funcs_info.keys():
-        if func in impl_funcs:
+        if func in impl_funcs and func not in ext_funcs:
             funcs_decl[func] = funcs_decl_raw[func]
     return funcs_decl
 
@@ -674,9 +881,7 @@ def get_composite_funcs_declaration(
 ) -> dict:
     composite_funcs_decl: dict = {}
     for func in funcs_info.keys():
-        if func not in impl_funcs and op_configs.get(func, {}).get(
-            "supportComposite"
-        ):
+        if op_configs.get(func, {}).get("supportComposite"):
             composite_funcs_decl[func] = funcs_decl_raw[func]
     return composite_funcs_decl
 
@@ -10,9 +10,12 @@ class OpTemplate(object):
  */
 
 #include "convert.hpp"
+#include "fallback.hpp"
 #include "impl_functions.hpp"
 
 // NOLINTBEGIN
+static const bool kAdaptorHooks = adaptorHooksEnabled();
+
 ${cast_strategy}
 
 ${adaptors}
@@ -23,6 +26,8 @@ ${adaptors}
 
     adaptor_template = CodeTemplate("""\
 extern "C" diopiError_t diopi${op_name}(${attrs}) {
+    ${fast_path}
+    ${chunked}
     TimeElapsed adaptorTimeElapsed("${op_name}_adaptor");
     ${new_input}
     {
@@ -34,11 +39,55 @@ extern "C" diopiError_t diopi${op_name}(${attrs}) {
     diopiError_t ret;
     {
         TimeElapsed opTimeElapsed("${op_name}");
-        ret = ::impl::${device}::${call_func};
+        ret = ${force_fallback}::impl::${device}::${call_func};
     }
+    ${composite}
+    ${fallback}
     return ret;
 }
 
+""")
+
+    fast_path_template = CodeTemplate("""\
+${plan_caches}
+if (${conditions}) {
+    return ::impl::${device}::${call_func};
+}
+""")
+
+    direct_call_template = CodeTemplate("""\
+if (!kAdaptorHooks) {
+    return ::impl::${device}::${call_func};
+}
+""")
+
+    chunked_template = CodeTemplate("""\
+if (!kAdaptorHooks) {
+    ChunkedElementwise chunked(ctx);
+    if (${conditions} && chunked.ready()) {
+        return chunked.run([&](diopiTensorHandle_t* tile) { return ::impl::${device}::${call_func}; });
+    }
+}
+""")
+
+    composite_template = CodeTemplate("""\
+if (shouldFallback(ret)) {
+    TimeElapsed compositeTimeElapsed("${op_name}_composite");
+    ret = ::impl::composite::${call_func};
+}
+""")
+
+    fallback_template = CodeTemplate("""\
+if (shouldFallback(ret)) {
+    static auto fallbackFunc = reinterpret_cast<decltype(&::${func_name})>(fallbackSymbol("${func_name}"));
+    if (fallbackFunc != nullptr) {
+        HostFallback host(ctx, "${op_name}");
+        ${host_args}
+        if (host.ok()) {
+            ret = host.finish(fallbackFunc(${call_args}));
+        }
+    }
+}
 """)
 
     cast_strategy_template = CodeTemplate("""\
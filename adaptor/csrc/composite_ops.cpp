@@ -1,17 +1,294 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <diopi/functions.h>
+
+#include <vector>
+
+#include "convert.hpp"
 #include "impl_functions.hpp"
 
 namespace impl {
 namespace composite {
 
-// This is an example for developing composite ops
-// diopiError_t diopiLinear(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight,
-//                          diopiConstTensorHandle_t bias) {
-//     // Your logic here...
-//     DIOPI_CALL(diopiMatmul(ctx, out, input, weight));
-//     // Your logic here...
-//     DIOPI_CALL(diopiAddInp(ctx, input, bias, {1}));
-//     // Your logic here...
-//     return diopiSuccess;
-// }
+// Composite ops are built from primitive diopi calls, the adaptor routes an op here when the
+// device config marks it with `supportComposite: true` and the vendor does not implement it, or
+// when the vendor kernel reports the call as not implemented. Primitives the vendor lacks make
+// them return diopiNoImplement as well.
+// They avoid a temporary per step: intermediates are required once and reused in place, and
+// views stand in for transposes and reshapes whenever the runtime can provide them.
+
+namespace {
+
+struct TensorInfo {
+    std::vector<int64_t> shape;
+    std::vector<int64_t> stride;
+    diopiDtype_t dtype;
+    diopiDevice_t device = diopi_device;
+
+    explicit TensorInfo(diopiConstTensorHandle_t tensor) {
+        diopiSize_t size;
+        diopiSize_t strideSize;
+        diopiGetTensorShape(tensor, &size);
+        diopiGetTensorStride(tensor, &strideSize);
+        diopiGetTensorDtype(tensor, &dtype);
+        if (diopiGetTensorDevice != nullptr) {
+            diopiGetTensorDevice(tensor, &device);
+        }
+        shape.assign(size.data, size.data + size.len);
+        stride.assign(strideSize.data, strideSize.data + strideSize.len);
+    }
+
+    int64_t numel() const {
+        int64_t numel = 1;
+        for (auto dim : shape) {
+            numel *= dim;
+        }
+        return numel;
+    }
+
+    bool isContiguous() const {
+        int64_t expected = 1;
+        for (int64_t i = static_cast<int64_t>(shape.size()) - 1; i >= 0; --i) {
+            if (shape[i] != 1 && stride[i] != expected) {
+                return false;
+            }
+            expected *= shape[i];
+        }
+        return true;
+    }
+};
+
+inline diopiSize_t toSize(const std::vector<int64_t>& vec) { return diopiSize_t{vec.data(), static_cast<int64_t>(vec.size())}; }
+
+inline diopiScalar_t floatScalar(double value) {
+    diopiScalar_t scalar;
+    scalar.stype = diopi_dtype_float64;
+    scalar.fval = value;
+    return scalar;
+}
+
+inline bool isIntegral(diopiDtype_t dtype) {
+    switch (dtype) {
+        case diopi_dtype_int8:
+        case diopi_dtype_uint8:
+        case diopi_dtype_int16:
+        case diopi_dtype_uint16:
+        case diopi_dtype_int32:
+        case diopi_dtype_uint32:
+        case diopi_dtype_int64:
+        case diopi_dtype_uint64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// a view of tensor with the given geometry, false when the runtime cannot make views
+bool makeView(diopiContextHandle_t ctx, diopiConstTensorHandle_t tensor, const std::vector<int64_t>& shape, const std::vector<int64_t>& stride,
+              diopiTensorHandle_t* view) {
+    if (diopiRequireTensorView == nullptr || diopiGetTensorStorageOffset == nullptr) {
+        return false;
+    }
+    int64_t offset = 0;
+    if (diopiGetTensorStorageOffset(tensor, &offset) != diopiSuccess) {
+        return false;
+    }
+    diopiSize_t size = toSize(shape);
+    diopiSize_t strideSize = toSize(stride);
+    return diopiRequireTensorView(ctx, view, tensor, &size, &strideSize, offset) == diopiSuccess;
+}
+
+// whether the memory a and b address may overlap, true when the runtime cannot tell
+bool mayOverlap(diopiConstTensorHandle_t a, diopiConstTensorHandle_t b) {
+    if (diopiGetTensorElemSize == nullptr) {
+        return true;
+    }
+    auto range = [](diopiConstTensorHandle_t tensor, const char** begin, const char** end) {
+        TensorInfo info(tensor);
+        const void* data = nullptr;
+        int64_t itemsize = 0;
+        diopiGetTensorDataConst(tensor, &data);
+        diopiGetTensorElemSize(tensor, &itemsize);
+        int64_t last = 0;
+        for (size_t i = 0; i < info.shape.size(); ++i) {
+            last += (info.shape[i] - 1) * info.stride[i];
+        }
+        *begin = static_cast<const char*>(data);
+        *end = info.numel() == 0 ? *begin : *begin + (last + 1) * itemsize;
+    };
+    const char *beginA, *endA, *beginB, *endB;
+    range(a, &beginA, &endA);
+    range(b, &beginB, &endB);
+    return beginA < endB && beginB < endA;
+}
+
+// a contiguous tensor seen as a [numel / lastDim, lastDim] matrix
+bool flattenToMatrix(diopiContextHandle_t ctx, diopiConstTensorHandle_t tensor, const TensorInfo& info, diopiTensorHandle_t* matrix) {
+    if (info.shape.empty() || !info.isContiguous()) {
+        return false;
+    }
+    int64_t cols = info.shape.back();
+    int64_t rows = cols == 0 ? 0 : info.numel() / cols;
+    return makeView(ctx, tensor, {rows, cols}, {cols, 1}, matrix);
+}
+
+}  // namespace
+
+diopiError_t diopiLinear(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight,
+                         diopiConstTensorHandle_t bias) {
+    if (diopiMatmul == nullptr || diopiAddmm == nullptr || diopiAddInp == nullptr) {
+        return diopiNoImplement;
+    }
+    TensorInfo weightInfo(weight);
+    if (weightInfo.shape.size() != 2) {
+        return diopiErrorOccurred;
+    }
+    // weight^T is a strided view, it is only materialized when the runtime cannot make views
+    diopiTensorHandle_t weightT = nullptr;
+    if (!makeView(ctx, weight, {weightInfo.shape[1], weightInfo.shape[0]}, {weightInfo.stride[1], weightInfo.stride[0]}, &weightT)) {
+        if (diopiTranspose == nullptr) {
+            return diopiNoImplement;
+        }
+        std::vector<int64_t> shapeT{weightInfo.shape[1], weightInfo.shape[0]};
+        diopiSize_t sizeT = toSize(shapeT);
+        DIOPI_ADAPTOR_CALL(diopiRequireTensor(ctx, &weightT, &sizeT, nullptr, weightInfo.dtype, weightInfo.device));
+        DIOPI_ADAPTOR_CALL(diopiTranspose(ctx, weightT, weight, 0, 1));
+    }
+    if (bias == nullptr) {
+        return diopiMatmul(ctx, out, input, weightT);
+    }
+
+    // the bias is the epilogue of a single addmm whenever input and out can be seen as matrices
+    diopiScalar_t one = floatScalar(1.0);
+    TensorInfo inputInfo(input);
+    if (inputInfo.shape.size() == 2) {
+        return diopiAddmm(ctx, out, bias, input, weightT, &one, &one);
+    }
+    diopiTensorHandle_t input2d = nullptr;
+    diopiTensorHandle_t out2d = nullptr;
+    if (flattenToMatrix(ctx, input, inputInfo, &input2d) && flattenToMatrix(ctx, out, TensorInfo(out), &out2d)) {
+        return diopiAddmm(ctx, out2d, bias, input2d, weightT, &one, &one);
+    }
+    DIOPI_ADAPTOR_CALL(diopiMatmul(ctx, out, input, weightT));
+    return diopiAddInp(ctx, out, bias, &one);
+}
+
+diopiError_t diopiCrossEntropyLoss(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t target,
+                                   diopiConstTensorHandle_t weight, diopiReduction_t reduction, int64_t ignore_index, double label_smoothing) {
+    if (label_smoothing != 0.0) {
+        return diopiNoImplement;
+    }
+    TensorInfo inputInfo(input);
+    TensorInfo targetInfo(target);
+    const int64_t classDim = inputInfo.shape.size() == 1 ? 0 : 1;
+    // class index targets go through diopiNLLLoss, which not every vendor provides, probability targets take no weight
+    const bool classTarget = isIntegral(targetInfo.dtype);
+    if (diopiLogSoftmax == nullptr ||
+        (classTarget ? diopiNLLLoss == nullptr : weight != nullptr || diopiMulInp == nullptr || diopiSum == nullptr || diopiMulInpScalar == nullptr)) {
+        return diopiNoImplement;
+    }
+
+    // one buffer holds the log-probabilities, and for probability targets also their product with the target
+    diopiTensorHandle_t logProb = nullptr;
+    diopiSize_t inputSize = toSize(inputInfo.shape);
+    DIOPI_ADAPTOR_CALL(diopiRequireTensor(ctx, &logProb, &inputSize, nullptr, inputInfo.dtype, inputInfo.device));
+    DIOPI_ADAPTOR_CALL(diopiLogSoftmax(ctx, logProb, input, classDim));
+    if (classTarget) {
+        return diopiNLLLoss(ctx, out, logProb, target, weight, reduction, ignore_index);
+    }
+
+    DIOPI_ADAPTOR_CALL(diopiMulInp(ctx, logProb, target));
+    std::vector<int64_t> dims;
+    if (reduction == ReductionNone) {
+        dims.push_back(classDim);
+    } else {
+        for (int64_t i = 0; i < static_cast<int64_t>(inputInfo.shape.size()); ++i) {
+            dims.push_back(i);
+        }
+    }
+    DIOPI_ADAPTOR_CALL(diopiSum(ctx, out, logProb, toSize(dims)));
+    double scale = -1.0;
+    if (reduction == ReductionMean) {
+        int64_t numClasses = inputInfo.shape[classDim];
+        scale /= numClasses == 0 ? 1 : static_cast<double>(inputInfo.numel() / numClasses);
+    }
+    diopiScalar_t scaleScalar = floatScalar(scale);
+    return diopiMulInpScalar(ctx, out, &scaleScalar);
+}
+
+diopiError_t diopiRMSNorm(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiTensorHandle_t inv_rms, diopiConstTensorHandle_t input,
+                          diopiSize_t normalized_shape, diopiConstTensorHandle_t weight, diopiConstTensorHandle_t bias, double eps) {
+    // the reference implementation does not apply bias either, rather than ignore it the op is left to others
+    if (bias != nullptr) {
+        return diopiNoImplement;
+    }
+    if (diopiMul == nullptr || diopiMean == nullptr || diopiAddInpScalar == nullptr || diopiRsqrtInp == nullptr || diopiMulInp == nullptr ||
+        diopiCopyInp == nullptr) {
+        return diopiNoImplement;
+    }
+    TensorInfo inputInfo(input);
+    const int64_t ndim = static_cast<int64_t>(inputInfo.shape.size());
+    if (normalized_shape.len > ndim) {
+        return diopiErrorOccurred;
+    }
+    std::vector<int64_t> dims;
+    std::vector<int64_t> rmsShape = inputInfo.shape;
+    for (int64_t i = ndim - normalized_shape.len; i < ndim; ++i) {
+        dims.push_back(i);
+        rmsShape[i] = 1;
+    }
+
+    // inv_rms keeps the normalized dims as 1, callers that pass a larger contiguous tensor get its leading elements
+    // filled. Any other geometry with as many elements receives a copy of the result.
+    diopiTensorHandle_t invRms = inv_rms;
+    diopiTensorHandle_t rmsResult = nullptr;
+    TensorInfo rmsInfo(inv_rms);
+    if (rmsInfo.shape != rmsShape) {
+        std::vector<int64_t> rmsStride(rmsShape.size(), 1);
+        for (int64_t i = static_cast<int64_t>(rmsShape.size()) - 2; i >= 0; --i) {
+            rmsStride[i] = rmsStride[i + 1] * rmsShape[i + 1];
+        }
+        int64_t rmsNumel = rmsShape.empty() ? 1 : rmsStride[0] * rmsShape[0];
+        if (!rmsInfo.isContiguous() || rmsInfo.numel() < rmsNumel || !makeView(ctx, inv_rms, rmsShape, rmsStride, &invRms)) {
+            std::vector<int64_t> flatStride(rmsInfo.shape.size(), 1);
+            for (int64_t i = static_cast<int64_t>(flatStride.size()) - 2; i >= 0; --i) {
+                flatStride[i] = flatStride[i + 1] * rmsInfo.shape[i + 1];
+            }
+            diopiSize_t rmsSize = toSize(rmsShape);
+            DIOPI_ADAPTOR_CALL(diopiRequireTensor(ctx, &invRms, &rmsSize, nullptr, inputInfo.dtype, inputInfo.device));
+            // the same elements seen in the geometry of inv_rms, they are copied there once computed
+            if (rmsInfo.numel() != rmsNumel || !makeView(ctx, invRms, rmsInfo.shape, flatStride, &rmsResult)) {
+                return diopiErrorOccurred;
+            }
+        }
+    }
+
+    // out doubles as the buffer of the squares, so no full-size intermediate is required, unless it overlaps input,
+    // which is read again once inv_rms is known
+    diopiTensorHandle_t squares = out;
+    if (mayOverlap(out, input)) {
+        diopiSize_t inputSize = toSize(inputInfo.shape);
+        DIOPI_ADAPTOR_CALL(diopiRequireTensor(ctx, &squares, &inputSize, nullptr, inputInfo.dtype, inputInfo.device));
+    }
+    diopiScalar_t one = floatScalar(1.0);
+    diopiScalar_t epsScalar = floatScalar(eps);
+    DIOPI_ADAPTOR_CALL(diopiMul(ctx, squares, input, input));
+    DIOPI_ADAPTOR_CALL(diopiMean(ctx, invRms, squares, toSize(dims)));
+    DIOPI_ADAPTOR_CALL(diopiAddInpScalar(ctx, invRms, &epsScalar, &one));
+    DIOPI_ADAPTOR_CALL(diopiRsqrtInp(ctx, invRms));
+    DIOPI_ADAPTOR_CALL(diopiMul(ctx, out, input, invRms));
+    if (weight != nullptr) {
+        DIOPI_ADAPTOR_CALL(diopiMulInp(ctx, out, weight));
+    }
+    if (rmsResult != nullptr) {
+        DIOPI_ADAPTOR_CALL(diopiCopyInp(ctx, rmsResult, inv_rms));
+    }
+    return diopiSuccess;
+}
+
 }  // namespace composite
-}  // namespace impl
\ No newline at end of file
+}  // namespace impl
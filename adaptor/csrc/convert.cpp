@@ -1,5 +1,10 @@
 #include "convert.hpp"
 
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <unordered_map>
+
 std::vector<int64_t> calcStrides(diopiSize_t size, diopiMemoryFormat_t format) {
     size_t ndims = size.len;
     std::vector<int64_t> strides(ndims);
@@ -55,6 +60,24 @@ std::vector<diopiMemoryFormat_t> obtainTargetMemoryFormats(size_t shapeLen, std:
     return supportMemoryFormats;
 }
 
+const diopiOpCapabilities_t *opCapabilities(const char *opName) {
+    if (opName == nullptr || diopiGetOpCapabilities == nullptr) {
+        return nullptr;
+    }
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::unique_ptr<diopiOpCapabilities_t>> capabilities;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = capabilities.find(opName);
+    if (it == capabilities.end()) {
+        std::unique_ptr<diopiOpCapabilities_t> caps(new diopiOpCapabilities_t());
+        if (diopiGetOpCapabilities(opName, caps.get()) != diopiSuccess) {
+            caps.reset();
+        }
+        it = capabilities.emplace(opName, std::move(caps)).first;
+    }
+    return it->second.get();
+}
+
 bool isLikeChannelsLast(diopiConstTensorHandle_t tensor, bool checkContiguous, diopiMemoryFormat_t format) {
     diopiSize_t shape, stride;
     diopiGetTensorShape(tensor, &shape);
@@ -207,6 +230,306 @@ const char *getDiopiErrorStr(diopiError_t err) {
 }
 #undef DIOPI_ERROR_TO_STR
 
+namespace {
+
+// Durations are bucketed log-linearly: values below kSubBuckets ns get a bucket each,
+// larger ones get kSubBuckets buckets per power of two (~6% relative error).
+constexpr int kSubBits = 4;
+constexpr uint64_t kSubBuckets = 1u << kSubBits;
+constexpr int kMaxExp = 40;
+constexpr size_t kNumBuckets = kSubBuckets + (kMaxExp - kSubBits + 1) * kSubBuckets;
+
+size_t bucketOf(uint64_t ns) {
+    if (ns < kSubBuckets) {
+        return ns;
+    }
+    int exp = 63 - __builtin_clzll(ns);
+    if (exp > kMaxExp) {
+        return kNumBuckets - 1;
+    }
+    return kSubBuckets + (exp - kSubBits) * kSubBuckets + ((ns >> (exp - kSubBits)) & (kSubBuckets - 1));
+}
+
+double bucketMidNs(size_t idx) {
+    if (idx < kSubBuckets) {
+        return static_cast<double>(idx);
+    }
+    int exp = static_cast<int>((idx - kSubBuckets) / kSubBuckets) + kSubBits;
+    uint64_t sub = (idx - kSubBuckets) % kSubBuckets;
+    uint64_t width = 1ull << (exp - kSubBits);
+    return static_cast<double>((1ull << exp) + sub * width) + width / 2.0;
+}
+
+struct RawEvent {
+    const char *name;
+    int64_t startNs;
+    int64_t durationNs;
+};
+
+struct OpSummary {
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(kNumBuckets, 0);
+
+    double percentileNs(double q) const {
+        uint64_t rank = static_cast<uint64_t>(q * count + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kNumBuckets; ++i) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return std::min(bucketMidNs(i), static_cast<double>(maxNs));
+            }
+        }
+        return static_cast<double>(maxNs);
+    }
+};
+
+}  // namespace
+
+// Only the owning thread writes a ThreadBuffer. The counters are atomics so that a
+// dump or reset from another thread reads consistent values; the owner never locks
+// except the first time it sees a new scope name.
+struct TimeElapsedRecord::ThreadBuffer {
+    struct OpStats {
+        explicit OpStats(const char *opName) : name(opName) {
+            for (auto &bucket : buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        const char *name;
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> maxNs{0};
+        std::atomic<uint64_t> buckets[kNumBuckets];
+    };
+
+    static constexpr size_t kChunkEvents = 4096;
+    static constexpr size_t kMaxChunks = 1024;
+
+    ThreadBuffer() {
+        for (auto &chunk : chunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    ~ThreadBuffer() {
+        for (auto &chunk : chunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    OpStats &stats(const char *name) {
+        auto iter = index.find(name);
+        if (iter != index.end()) {
+            return *iter->second;
+        }
+        std::lock_guard<std::mutex> lock(opsMutex);
+        ops.emplace_back(new OpStats(name));
+        index.emplace(name, ops.back().get());
+        return *ops.back();
+    }
+
+    void append(const char *name, int64_t startNs, int64_t durationNs) {
+        size_t pos = numEvents.load(std::memory_order_relaxed);
+        size_t chunkIdx = pos / kChunkEvents;
+        if (chunkIdx >= kMaxChunks) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        RawEvent *chunk = chunks[chunkIdx].load(std::memory_order_relaxed);
+        if (chunk == nullptr) {
+            chunk = new RawEvent[kChunkEvents];
+            chunks[chunkIdx].store(chunk, std::memory_order_release);
+        }
+        chunk[pos % kChunkEvents] = RawEvent{name, startNs, durationNs};
+        numEvents.store(pos + 1, std::memory_order_release);
+    }
+
+    std::unordered_map<const char *, OpStats *> index;  // owner thread only
+    std::mutex opsMutex;
+    std::vector<std::unique_ptr<OpStats>> ops;
+    std::atomic<RawEvent *> chunks[kMaxChunks];
+    std::atomic<size_t> numEvents{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+TimeElapsedRecord::Mode TimeElapsedRecord::modeFromEnv() {
+    const char *enableEnvVar = getenv("DIOPI_ENABLE_TIMING");
+    if (enableEnvVar && strcmp(enableEnvVar, "OFF") != 0 && strcmp(enableEnvVar, "0") != 0) {
+        return strcmp(enableEnvVar, "RAW") == 0 ? Mode::Raw : Mode::Histogram;
+    }
+    return Mode::Off;
+}
+
+TimeElapsedRecord::TimeElapsedRecord(const char *fileName) : mode_(modeFromEnv()) {
+    const char *fileEnvVar = getenv("DIOPI_TIMING_FILE");
+    fileName_ = fileEnvVar && fileEnvVar[0] != '\0' ? fileEnvVar : fileName;
+}
+
+TimeElapsedRecord::~TimeElapsedRecord() {
+    if (isEnableTiming()) {
+        dump(nullptr);
+        mode_ = Mode::Off;
+    }
+}
+
+TimeElapsedRecord::ThreadBuffer &TimeElapsedRecord::localBuffer() {
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer == nullptr) {
+        // Buffers are owned by the record rather than the thread so that the data
+        // of threads that already exited still shows up in the report.
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        buffers_.emplace_back(new ThreadBuffer());
+        buffer = buffers_.back().get();
+    }
+    return *buffer;
+}
+
+void TimeElapsedRecord::record(const char *name, int64_t startNs, int64_t durationNs) {
+    ThreadBuffer &buffer = localBuffer();
+    uint64_t duration = durationNs > 0 ? static_cast<uint64_t>(durationNs) : 0;
+    ThreadBuffer::OpStats &stats = buffer.stats(name);
+    stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.totalNs.fetch_add(duration, std::memory_order_relaxed);
+    if (duration > stats.maxNs.load(std::memory_order_relaxed)) {
+        stats.maxNs.store(duration, std::memory_order_relaxed);
+    }
+    stats.buckets[bucketOf(duration)].fetch_add(1, std::memory_order_relaxed);
+    if (mode_ == Mode::Raw) {
+        buffer.append(name, startNs, durationNs);
+    }
+}
+
+bool TimeElapsedRecord::dump(const char *fileName) {
+    std::ofstream stream(fileName ? fileName : fileName_.c_str(), std::ios::out | std::ios::trunc);
+    if (!stream) {
+        return false;
+    }
+
+    // Pointers of the same scope name differ across translation units, so merge by string.
+    std::map<std::string, OpSummary> summaries;
+    std::vector<RawEvent> events;
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        for (auto &buffer : buffers_) {
+            {
+                std::lock_guard<std::mutex> opsLock(buffer->opsMutex);
+                for (auto &stats : buffer->ops) {
+                    OpSummary &summary = summaries[stats->name];
+                    summary.count += stats->count.load(std::memory_order_relaxed);
+                    summary.totalNs += stats->totalNs.load(std::memory_order_relaxed);
+                    summary.maxNs = std::max(summary.maxNs, stats->maxNs.load(std::memory_order_relaxed));
+                    for (size_t i = 0; i < kNumBuckets; ++i) {
+                        summary.buckets[i] += stats->buckets[i].load(std::memory_order_relaxed);
+                    }
+                }
+            }
+            size_t numEvents = buffer->numEvents.load(std::memory_order_acquire);
+            for (size_t i = 0; i < numEvents; ++i) {
+                const RawEvent *chunk = buffer->chunks[i / ThreadBuffer::kChunkEvents].load(std::memory_order_acquire);
+                events.push_back(chunk[i % ThreadBuffer::kChunkEvents]);
+            }
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (mode_ == Mode::Raw) {
+        std::sort(events.begin(), events.end(), [](const RawEvent &a, const RawEvent &b) { return a.startNs < b.startNs; });
+        for (const auto &event : events) {
+            stream << event.name << ": " << event.durationNs / 1e6 << "ms\n";
+        }
+        if (dropped > 0) {
+            stream << "# " << dropped << " raw events dropped\n";
+        }
+        stream << "\n";
+    }
+
+    std::vector<std::pair<std::string, const OpSummary *>> sorted;
+    for (const auto &item : summaries) {
+        if (item.second.count > 0) {
+            sorted.emplace_back(item.first, &item.second);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second->totalNs > b.second->totalNs; });
+    char line[256];
+    snprintf(line, sizeof(line), "%-48s %10s %12s %10s %10s %10s %10s\n", "name", "count", "total(ms)", "avg(ms)", "p50(ms)", "p99(ms)", "max(ms)");
+    stream << line;
+    for (const auto &item : sorted) {
+        const OpSummary &summary = *item.second;
+        snprintf(line,
+                 sizeof(line),
+                 "%-48s %10llu %12.3f %10.4f %10.4f %10.4f %10.4f\n",
+                 item.first.c_str(),
+                 static_cast<unsigned long long>(summary.count),
+                 summary.totalNs / 1e6,
+                 summary.totalNs / 1e6 / summary.count,
+                 summary.percentileNs(0.5) / 1e6,
+                 summary.percentileNs(0.99) / 1e6,
+                 summary.maxNs / 1e6);
+        stream << line;
+    }
+    return static_cast<bool>(stream);
+}
+
+void TimeElapsedRecord::reset() {
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+    for (auto &buffer : buffers_) {
+        std::lock_guard<std::mutex> opsLock(buffer->opsMutex);
+        for (auto &stats : buffer->ops) {
+            stats->count.store(0, std::memory_order_relaxed);
+            stats->totalNs.store(0, std::memory_order_relaxed);
+            stats->maxNs.store(0, std::memory_order_relaxed);
+            for (auto &bucket : stats->buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        buffer->numEvents.store(0, std::memory_order_release);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
 TimeElapsedRecord TimeElapsed::timeElapsedRecord("op_time.dat");
 
+bool adaptorHooksEnabled() {
+    // called while the generated adaptors are initialized, so timeElapsedRecord may not be constructed yet
+    const char *fallbackLib = getenv("DIOPI_FALLBACK_LIB");
+    const char *fallbackOps = getenv("DIOPI_FALLBACK_OPS");
+    return TimeElapsedRecord::modeFromEnv() != TimeElapsedRecord::Mode::Off || (fallbackLib != nullptr && fallbackLib[0] != '\0') ||
+           (fallbackOps != nullptr && fallbackOps[0] != '\0');
+}
+
+extern "C" {
+
+diopiError_t diopiAdaptorTimingDump(const char *fileName) {
+    if (!TimeElapsed::timeElapsedRecord.isEnableTiming()) {
+        return diopiNotInited;
+    }
+    return TimeElapsed::timeElapsedRecord.dump(fileName) ? diopiSuccess : diopiErrorOccurred;
+}
+
+diopiError_t diopiAdaptorTimingReset() {
+    TimeElapsed::timeElapsedRecord.reset();
+    return diopiSuccess;
+}
+
+}  // extern "C"
+
+bool castHandlesStrides() {
+    static const bool handles = [] {
+        const diopiOpCapabilities_t *caps = opCapabilities("diopiCastDtype");
+        return caps != nullptr && caps->memory_formats == 0;
+    }();
+    return handles;
+}
+
+bool isLazyLayoutEnabled() {
+    static const bool enabled = [] {
+        const char *envVar = getenv("DIOPI_LAZY_LAYOUT");
+        return envVar != nullptr && (strcmp(envVar, "ON") == 0 || strcmp(envVar, "1") == 0);
+    }();
+    return enabled;
+}
+
 std::vector<diopiMemoryFormat_t> defaultFormats{};
@@ -10,9 +10,22 @@
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <string>
+#include <utility>
 #include <vector>
 
+// Returns the error of a diopi call from the enclosing function, for adaptor code built from several calls
+#define DIOPI_ADAPTOR_CALL(Expr)   \
+    do {                           \
+        diopiError_t ret = Expr;   \
+        if (diopiSuccess != ret) { \
+            return ret;            \
+        }                          \
+    } while (false)
+
 std::vector<int64_t> calcStrides(diopiSize_t size, diopiMemoryFormat_t format = diopiMemoryFormat_t::Contiguous);
 
 bool isLikeChannelsLast(diopiConstTensorHandle_t tensor, bool checkContiguous, diopiMemoryFormat_t format = diopiMemoryFormat_t::ChannelsLast);
@@ -27,45 +40,67 @@ std::vector<diopiMemoryFormat_t> setIntersection(std::vector<diopiMemoryFormat_t
 
 std::vector<diopiMemoryFormat_t> obtainTargetMemoryFormats(size_t shapeLen, std::vector<diopiMemoryFormat_t> supportMemoryFormats);
 
+// What the backend reports for opName through diopiGetOpCapabilities, nullptr when it reports nothing. The backend
+// is asked once per op, later calls return the cached answer.
+const diopiOpCapabilities_t *opCapabilities(const char *opName);
+
+// Per-scope timing of the adaptor, enabled by DIOPI_ENABLE_TIMING. Each thread
+// records into its own buffers, so a scope never takes a lock or writes to a
+// shared stream; the buffers are merged only when a report is produced, at exit or
+// through diopiAdaptorTimingDump. The report lists count/total/avg/p50/p99/max per
+// scope name. DIOPI_ENABLE_TIMING=RAW additionally keeps every event and writes
+// one "name: x ms" line per scope ahead of the summary.
 class TimeElapsedRecord {
 public:
-    TimeElapsedRecord(const char *fileName) : enableTiming_(false) {
-        const char *enableEnvVar = getenv("DIOPI_ENABLE_TIMING");
-        if (enableEnvVar && strcmp(enableEnvVar, "OFF") != 0 && strcmp(enableEnvVar, "0") != 0) {
-            enableTiming_ = true;
-            stream_ = std::ofstream(fileName, std::ios::out | std::ios::trunc);
-        }
-    }
-    bool isEnableTiming() { return enableTiming_; }
-    std::ofstream &getOStream() { return stream_; }
+    enum class Mode { Off, Histogram, Raw };
+
+    static Mode modeFromEnv();
+
+    explicit TimeElapsedRecord(const char *fileName);
+    ~TimeElapsedRecord();
+    bool isEnableTiming() const { return mode_ != Mode::Off; }
+    void record(const char *name, int64_t startNs, int64_t durationNs);
+    // Writes the report to fileName, or to the default file when it is nullptr.
+    bool dump(const char *fileName);
+    // Clears the collected data. Scopes closing concurrently may survive the reset.
+    void reset();
 
 private:
-    bool enableTiming_;
-    std::ofstream stream_;
+    struct ThreadBuffer;
+    ThreadBuffer &localBuffer();
+
+    Mode mode_;
+    std::string fileName_;
+    std::mutex buffersMutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
 };
 
 class TimeElapsed {
 public:
     TimeElapsed(const char *opName) : opName_(opName) {
         if (timeElapsedRecord.isEnableTiming()) {
-            start_ = std::chrono::steady_clock::now();
+            startNs_ = nowNs();
         }
     }
     ~TimeElapsed() {
         if (timeElapsedRecord.isEnableTiming()) {
-            auto end = std::chrono::steady_clock::now();
-            std::chrono::duration<double, std::milli> elapsed = end - start_;  // ms
-            double elapsedTime = elapsed.count();
-            timeElapsedRecord.getOStream() << opName_ << ": " << elapsedTime << "ms" << std::endl;
+            timeElapsedRecord.record(opName_, startNs_, nowNs() - startNs_);
         }
     }
 
+    static TimeElapsedRecord timeElapsedRecord;
+
 private:
+    static int64_t nowNs() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
     const char *opName_;
-    std::chrono::time_point<std::chrono::steady_clock> start_;
-    static TimeElapsedRecord timeElapsedRecord;
+    int64_t startNs_ = 0;
 };
 
+// Timing, the host fallback and ops forced off the vendor kernel need the full adaptor path. Without them, the generated adaptors send
+// calls whose arguments already conform straight to the kernel. Only reads the environment.
+bool adaptorHooksEnabled();
+
 class ConvertType {
 public:
     ConvertType() : val_(0){};
@@ -101,117 +136,282 @@ public:
     }
 };
 
-template <class T, class strategy = NoCast>
-ConvertType castImpl(diopiContextHandle_t ctx, T src, T *dst, std::vector<diopiMemoryFormat_t> supportMemoryFormats = {}) {
-    ConvertType convertType;
-    if (!src) {
-        *dst = src;
-        return convertType;
-    }
-    diopiDtype_t srcDtype, dstDtype;
-    diopiGetTensorDtype(src, &srcDtype);
-    diopiSize_t srcSize, srcStride;
-    diopiGetTensorShape(src, &srcSize);
-    diopiGetTensorStride(src, &srcStride);
-    strategy::getDstDtype(srcDtype, dstDtype);
-    std::vector<diopiMemoryFormat_t> targetMemoryFormats = obtainTargetMemoryFormats(srcSize.len, supportMemoryFormats);
-    diopiTensorHandle_t memoryFormatedTensor = nullptr;
-
-    // convertDtype
-
-    diopiDevice_t device;
-    diopiGetTensorDevice(src, &device);
-    diopiTensorHandle_t tmp0 = nullptr;
-    bool needConvertDtype = srcDtype != dstDtype;
-    if (needConvertDtype) {
-        diopiRequireTensor(ctx, &tmp0, &srcSize, &srcStride, dstDtype, device);
-        diopiCastDtype(ctx, tmp0, src);
-        convertType.setDtypeConverted();
+inline bool needConvertMemoryFormat(diopiSize_t size, diopiSize_t stride, const std::vector<diopiMemoryFormat_t> &targetMemoryFormats) {
+    for (auto memoryFormat : targetMemoryFormats) {
+        if (isContiguous(size, stride, memoryFormat)) {
+            return false;
+        }
+    }
+    return !targetMemoryFormats.empty();
+}
+
+// What converting one tensor argument takes, it only depends on the dtype, shape and strides of the tensor
+struct ConvertPlan {
+    diopiDtype_t dstDtype;
+    bool convertDtype = false;
+    bool convertLayout = false;
+    diopiMemoryFormat_t targetMemoryFormat = diopiMemoryFormat_t::Contiguous;
+    // strides of targetMemoryFormat, only set when convertLayout is
+    std::vector<int64_t> dstStride;
+};
+
+inline bool hasCapability(uint64_t mask, int value) { return value >= 0 && value < 64 && (mask >> value) & 1u; }
+
+// The memory formats caps reports, none (any layout) when its mask is empty. Without caps, supportMemoryFormats as
+// generated from the device config.
+inline std::vector<diopiMemoryFormat_t> capableMemoryFormats(const diopiOpCapabilities_t *caps, const std::vector<diopiMemoryFormat_t> &supportMemoryFormats) {
+    if (caps == nullptr) {
+        return supportMemoryFormats;
+    }
+    std::vector<diopiMemoryFormat_t> formats;
+    for (auto format : {diopiMemoryFormat_t::Contiguous, diopiMemoryFormat_t::ChannelsLast, diopiMemoryFormat_t::ChannelsLast3d,
+                        diopiMemoryFormat_t::ChannelsLast1d}) {
+        if (hasCapability(caps->memory_formats, format)) {
+            formats.push_back(format);
+        }
+    }
+    return formats;
+}
+
+// A dtype the backend reports as native is never cast, whatever the strategy generated from the device config says
+template <class strategy>
+ConvertPlan makeConvertPlan(diopiDtype_t srcDtype, diopiSize_t srcSize, diopiSize_t srcStride, const std::vector<diopiMemoryFormat_t> &supportMemoryFormats,
+                            const diopiOpCapabilities_t *caps = nullptr) {
+    ConvertPlan plan;
+    if (caps != nullptr && hasCapability(caps->dtypes, srcDtype)) {
+        plan.dstDtype = srcDtype;
     } else {
-        tmp0 = const_cast<typename RemoveConst<T>::type>(src);
+        strategy::getDstDtype(srcDtype, plan.dstDtype);
     }
+    plan.convertDtype = srcDtype != plan.dstDtype;
+    std::vector<diopiMemoryFormat_t> targetMemoryFormats = obtainTargetMemoryFormats(srcSize.len, capableMemoryFormats(caps, supportMemoryFormats));
+    plan.convertLayout = needConvertMemoryFormat(srcSize, srcStride, targetMemoryFormats);
+    if (plan.convertLayout) {
+        plan.targetMemoryFormat = targetMemoryFormats[0];
+        plan.dstStride = calcStrides(srcSize, plan.targetMemoryFormat);
+    }
+    return plan;
+}
 
-    diopiDtype_t tmp0Dtype;
-    diopiGetTensorDtype(tmp0, &tmp0Dtype);
+// Conversion plans of one tensor argument of one op, keyed by dtype, shape and strides. The generated adaptors keep a
+// thread_local cache per argument, so a loop repeating the same shapes neither takes a lock nor allocates to find its plan.
+// With an opName, the plans follow what the backend reports for the op on top of the generated strategy and formats.
+// Misses are timed as "convert_plan", so the timing report counts the plans that had to be made.
+template <class strategy = NoCast>
+class ConvertPlanCache {
+public:
+    explicit ConvertPlanCache(const char *opName = nullptr, std::vector<diopiMemoryFormat_t> supportMemoryFormats = {})
+        : supportMemoryFormats_(std::move(supportMemoryFormats)), caps_(opCapabilities(opName)) {}
+
+    const ConvertPlan &lookup(diopiDtype_t dtype, diopiSize_t size, diopiSize_t stride) {
+        uint64_t hash = static_cast<uint64_t>(dtype);
+        for (int64_t i = 0; i < size.len; ++i) {
+            hash = (hash ^ static_cast<uint64_t>(size.data[i])) * 0x100000001b3ull;
+            hash = (hash ^ static_cast<uint64_t>(stride.data[i])) * 0x100000001b3ull;
+        }
+        Entry &entry = entries_[hash % kEntries];
+        if (!entry.valid || entry.dtype != dtype || !entry.matches(size, stride)) {
+            TimeElapsed planTimeElapsed("convert_plan");
+            entry.valid = true;
+            entry.dtype = dtype;
+            entry.shape.assign(size.data, size.data + size.len);
+            entry.stride.assign(stride.data, stride.data + stride.len);
+            entry.plan = makeConvertPlan<strategy>(dtype, size, stride, supportMemoryFormats_, caps_);
+        }
+        return entry.plan;
+    }
 
-    // convert memoryformat
-    bool needConvertMemoryFormat = true;
-    if (targetMemoryFormats.empty()) {
-        needConvertMemoryFormat = false;
+private:
+    static constexpr size_t kEntries = 8;
+
+    struct Entry {
+        bool valid = false;
+        diopiDtype_t dtype;
+        std::vector<int64_t> shape;
+        std::vector<int64_t> stride;
+        ConvertPlan plan;
+
+        bool matches(diopiSize_t size, diopiSize_t stride) const {
+            return static_cast<size_t>(size.len) == shape.size() && std::equal(shape.begin(), shape.end(), size.data) &&
+                   std::equal(this->stride.begin(), this->stride.end(), stride.data);
+        }
+    };
+
+    std::vector<diopiMemoryFormat_t> supportMemoryFormats_;
+    const diopiOpCapabilities_t *caps_;
+    Entry entries_[kEntries];
+};
+
+// All the metadata the adaptor needs in one runtime call, or through the single getters when the runtime lacks diopiGetTensorMeta
+inline void getTensorMeta(diopiConstTensorHandle_t tensor, diopiTensorMeta_t &meta) {
+    if (diopiGetTensorMeta != nullptr && diopiGetTensorMeta(tensor, &meta) == diopiSuccess) {
+        return;
     }
-    for (auto memoryFormat : targetMemoryFormats) {
-        if (isContiguous(srcSize, srcStride, memoryFormat)) {
-            needConvertMemoryFormat = false;
-            break;
+    diopiGetTensorShape(tensor, &meta.shape);
+    diopiGetTensorStride(tensor, &meta.stride);
+    diopiGetTensorDtype(tensor, &meta.dtype);
+    diopiGetTensorNumel(tensor, &meta.numel);
+    meta.device = diopi_device;
+    meta.storage_offset = 0;
+    meta.itemsize = 0;
+    if (diopiGetTensorDevice != nullptr) {
+        diopiGetTensorDevice(tensor, &meta.device);
+    }
+    if (diopiGetTensorStorageOffset != nullptr) {
+        diopiGetTensorStorageOffset(tensor, &meta.storage_offset);
+    }
+    if (diopiGetTensorElemSize != nullptr) {
+        diopiGetTensorElemSize(tensor, &meta.itemsize);
+    }
+}
+
+// Metadata and plan of one tensor argument for the duration of one adaptor call. The up-front check fills it, so the
+// conversions of the slow path neither query the runtime nor search the plan cache again. plan points into the plan
+// cache of the argument, which no other lookup touches during the call.
+struct ArgMeta {
+    diopiTensorMeta_t meta;
+    const ConvertPlan *plan = nullptr;
+};
+
+template <class strategy>
+inline const ConvertPlan &lookupPlan(diopiConstTensorHandle_t tensor, ConvertPlanCache<strategy> &planCache, ArgMeta &arg) {
+    if (arg.plan == nullptr) {
+        getTensorMeta(tensor, arg.meta);
+        arg.plan = &planCache.lookup(arg.meta.dtype, arg.meta.shape, arg.meta.stride);
+    }
+    return *arg.plan;
+}
+
+// True when tensor needs neither a cast nor a layout change, the up-front check of the generated adaptors
+template <class strategy>
+inline bool isConforming(diopiConstTensorHandle_t tensor, ConvertPlanCache<strategy> &planCache, ArgMeta &arg) {
+    if (!tensor) {
+        return true;
+    }
+    const ConvertPlan &plan = lookupPlan(tensor, planCache, arg);
+    return !plan.convertDtype && !plan.convertLayout;
+}
+
+template <class strategy>
+inline bool isConforming(const diopiConstTensorHandle_t *tensors, int64_t num, ConvertPlanCache<strategy> &planCache) {
+    for (int64_t i = 0; i < num; ++i) {
+        ArgMeta arg;
+        if (!isConforming(tensors[i], planCache, arg)) {
+            return false;
         }
     }
-    diopiSize_t dstStride = srcStride;
-    diopiSize_t dstSize = srcSize;
-    if (needConvertMemoryFormat) {
-        diopiContiguous(ctx, &memoryFormatedTensor, tmp0, targetMemoryFormats[0]);
+    return true;
+}
+
+// Whether diopiCastDtype may write another layout than the one it reads, so that one pass converts dtype and memory
+// format at once. Only trusted when the backend reports that its cast takes any layout, camb's cast for one expects
+// the strides of both tensors to match.
+bool castHandlesStrides();
+
+template <class T>
+ConvertType castByPlan(diopiContextHandle_t ctx, T src, T *dst, const ConvertPlan &plan, const diopiTensorMeta_t &meta) {
+    ConvertType convertType;
+    if (plan.convertDtype) {
+        const bool fused = plan.convertLayout && castHandlesStrides();
+        diopiSize_t dstStride = meta.stride;
+        if (fused) {
+            dstStride.data = plan.dstStride.data();
+            dstStride.len = plan.dstStride.size();
+        }
+        diopiTensorHandle_t tmp = nullptr;
+        diopiRequireTensor(ctx, &tmp, &meta.shape, &dstStride, plan.dstDtype, meta.device);
+        diopiCastDtype(ctx, tmp, src);
+        convertType.setDtypeConverted();
+        if (plan.convertLayout) {
+            if (!fused) {
+                diopiTensorHandle_t memoryFormatedTensor = nullptr;
+                diopiContiguous(ctx, &memoryFormatedTensor, tmp, plan.targetMemoryFormat);
+                tmp = memoryFormatedTensor;
+            }
+            convertType.setMemoryFormatConverted();
+        }
+        *dst = tmp;
+    } else if (plan.convertLayout) {
+        diopiTensorHandle_t memoryFormatedTensor = nullptr;
+        diopiContiguous(ctx, &memoryFormatedTensor, src, plan.targetMemoryFormat);
         convertType.setMemoryFormatConverted();
-        diopiGetTensorStride(memoryFormatedTensor, &dstStride);
-        diopiGetTensorShape(memoryFormatedTensor, &dstSize);
+        *dst = memoryFormatedTensor;
     } else {
-        memoryFormatedTensor = tmp0;
+        *dst = src;
     }
-
-    *dst = memoryFormatedTensor;
     return convertType;
 }
 
-template <class T, class strategy>
-ConvertType requireTensorIfMemoryFormatConvert(diopiContextHandle_t ctx, T src, T *dst, std::vector<diopiMemoryFormat_t> supportMemoryFormats) {
-    ConvertType convertType;
+template <class T, class strategy = NoCast>
+ConvertType castImpl(diopiContextHandle_t ctx, T src, T *dst, std::vector<diopiMemoryFormat_t> supportMemoryFormats = {}) {
     if (!src) {
         *dst = src;
-        return convertType;
-    }
-    diopiDtype_t srcDtype, dstDtype;
-    diopiGetTensorDtype(src, &srcDtype);
-    diopiSize_t srcSize, srcStride;
-    diopiGetTensorShape(src, &srcSize);
-    diopiGetTensorStride(src, &srcStride);
-    strategy::getDstDtype(srcDtype, dstDtype);
-    std::vector<diopiMemoryFormat_t> targetMemoryFormats = obtainTargetMemoryFormats(srcSize.len, supportMemoryFormats);
-    bool needConvertMemoryFormat = true;
-    if (targetMemoryFormats.empty()) {
-        needConvertMemoryFormat = false;
+        return ConvertType();
     }
-    for (auto memoryFormat : targetMemoryFormats) {
-        if (isContiguous(srcSize, srcStride, memoryFormat)) {
-            needConvertMemoryFormat = false;
-            break;
-        }
+    diopiTensorMeta_t meta;
+    getTensorMeta(src, meta);
+    return castByPlan(ctx, src, dst, makeConvertPlan<strategy>(meta.dtype, meta.shape, meta.stride, supportMemoryFormats), meta);
+}
+
+template <class T, class strategy>
+ConvertType castImpl(diopiContextHandle_t ctx, T src, T *dst, ConvertPlanCache<strategy> &planCache, ArgMeta &arg) {
+    if (!src) {
+        *dst = src;
+        return ConvertType();
     }
-    diopiSize_t dstStride = srcStride;
-    std::vector<int64_t> dstStrideVec;
-    diopiSize_t dstSize = srcSize;
-    if (needConvertMemoryFormat) {
-        diopiMemoryFormat_t targetMemoryForamt = targetMemoryFormats[0];
-        dstStrideVec = calcStrides(dstSize, targetMemoryForamt);
-        dstStride.data = dstStrideVec.data();
-        dstStride.len = dstStrideVec.size();
+    const ConvertPlan &plan = lookupPlan(src, planCache, arg);
+    return castByPlan(ctx, src, dst, plan, arg.meta);
+}
+
+template <class T, class strategy>
+ConvertType castImpl(diopiContextHandle_t ctx, T src, T *dst, ConvertPlanCache<strategy> &planCache) {
+    ArgMeta arg;
+    return castImpl(ctx, src, dst, planCache, arg);
+}
+
+template <class T>
+ConvertType requireTensorByPlan(diopiContextHandle_t ctx, T src, T *dst, const ConvertPlan &plan, const diopiTensorMeta_t &meta) {
+    ConvertType convertType;
+    diopiSize_t dstStride = meta.stride;
+    if (plan.convertLayout) {
+        dstStride.data = plan.dstStride.data();
+        dstStride.len = plan.dstStride.size();
         convertType.setMemoryFormatConverted();
     }
-
-    // convert Dtype
-    if (srcDtype != dstDtype) {
+    if (plan.convertDtype) {
         convertType.setDtypeConverted();
     }
     if (convertType.isConverted()) {
-        diopiDevice_t device;
-        diopiGetTensorDevice(src, &device);
         diopiTensorHandle_t tmp = nullptr;
-        diopiRequireTensor(ctx, &tmp, &dstSize, &dstStride, dstDtype, device);
+        diopiRequireTensor(ctx, &tmp, &meta.shape, &dstStride, plan.dstDtype, meta.device);
         *dst = tmp;
     } else {
         *dst = src;
     }
-
     return convertType;
 }
 
+template <class T, class strategy>
+ConvertType requireTensorIfMemoryFormatConvert(diopiContextHandle_t ctx, T src, T *dst, std::vector<diopiMemoryFormat_t> supportMemoryFormats) {
+    if (!src) {
+        *dst = src;
+        return ConvertType();
+    }
+    diopiTensorMeta_t meta;
+    getTensorMeta(src, meta);
+    return requireTensorByPlan(ctx, src, dst, makeConvertPlan<strategy>(meta.dtype, meta.shape, meta.stride, supportMemoryFormats), meta);
+}
+
+template <class T, class strategy>
+ConvertType requireTensorIfMemoryFormatConvert(diopiContextHandle_t ctx, T src, T *dst, ConvertPlanCache<strategy> &planCache, ArgMeta &arg) {
+    if (!src) {
+        *dst = src;
+        return ConvertType();
+    }
+    const ConvertPlan &plan = lookupPlan(src, planCache, arg);
+    return requireTensorByPlan(ctx, src, dst, plan, arg.meta);
+}
+
 template <typename Adaptor, typename... Args>
 void dispatchDiopi(diopiContextHandle_t ctx, Args &&...args) {
     auto adaptor = Adaptor();
@@ -230,6 +430,19 @@ inline bool isEqualDiopiSize(diopiSize_t val1, diopiSize_t val2) {
     return false;
 }
 
+// With DIOPI_LAZY_LAYOUT on, an output that was only converted for its memory format keeps the layout
+// the kernel produced: payload takes over the storage and strides of tmp instead of receiving a transposing
+// copy. A following op that supports the same layout then uses it as is, so a run of layout-sensitive ops
+// only converts at its boundaries. The runtime has to provide diopiTensorAdoptLayout and may still refuse.
+bool isLazyLayoutEnabled();
+
+inline bool adoptLayout(diopiTensorHandle_t payload, diopiConstTensorHandle_t tmp) {
+    if (diopiTensorAdoptLayout == nullptr || !isLazyLayoutEnabled()) {
+        return false;
+    }
+    return diopiTensorAdoptLayout(payload, tmp) == diopiSuccess;
+}
+
 template <class strategy = NoCast>
 class DiopiTensorWrapper {
 public:
@@ -256,6 +469,16 @@ public:
         }
     }
 
+    DiopiTensorWrapper(diopiContextHandle_t ctx, diopiTensorHandle_t payload, ConvertPlanCache<strategy> &planCache, ArgMeta &arg, bool inp)
+        : ctx_(ctx), payload_(payload) {
+        TimeElapsed castOutConstructTimeElapsed("out_construct");
+        if (inp) {
+            convertType_ = castImpl<diopiTensorHandle_t, strategy>(ctx, payload_, &tmp_, planCache, arg);
+        } else {
+            convertType_ = requireTensorIfMemoryFormatConvert<diopiTensorHandle_t, strategy>(ctx, payload_, &tmp_, planCache, arg);
+        }
+    }
+
     ~DiopiTensorWrapper() {
         TimeElapsed castOutDeconstructTimeElapsed("out_deconstruct");
         if (!convertType_.isConverted()) {
@@ -264,37 +487,150 @@ public:
             }
             return;
         }
-        diopiTensorHandle_t memoryFormatedTensor = tmp_;
-        if (convertType_.isMemoryFormatConverted()) {
-            diopiCopyInp(ctx_, memoryFormatedTensor, payload_);
-        }
-        if (convertType_.isDtypeConverted()) {
-            diopiCastDtype(ctx_, payload_, memoryFormatedTensor);
+        if (convertType_.isDtypeConverted() && convertType_.isMemoryFormatConverted() && !castHandlesStrides()) {
+            // restore the layout of payload_ in the dtype of tmp_ first, the cast then runs between matching strides
+            diopiTensorMeta_t meta;
+            getTensorMeta(payload_, meta);
+            diopiDtype_t dtype;
+            diopiGetTensorDtype(tmp_, &dtype);
+            diopiTensorHandle_t strided = nullptr;
+            diopiRequireTensor(ctx_, &strided, &meta.shape, &meta.stride, dtype, meta.device);
+            diopiCopyInp(ctx_, tmp_, strided);
+            diopiCastDtype(ctx_, payload_, strided);
+        } else if (convertType_.isDtypeConverted()) {
+            diopiCastDtype(ctx_, payload_, tmp_);
+        } else if (!adoptLayout(payload_, tmp_)) {
+            diopiCopyInp(ctx_, tmp_, payload_);
         }
-
-        // if (convertType_.isDtypeConverted() &&
-        // !convertType_.isMemoryFormatConverted()) {
-        //     diopiCastDtype(ctx_, payload_, tmp_);
-        // } else if (!convertType_.isDtypeConverted() &&
-        // convertType_.isMemoryFormatConverted()) {
-        //     diopiCopyInp(ctx_, tmp_, payload_);
-        // } else {
-        //     diopiDtype_t dtype;
-        //     diopiGetTensorDtype(tmp_, &dtype);
-        //     diopiSize_t size, stride, dstStride;
-        //     diopiGetTensorShape(payload_, &size);
-        //     diopiGetTensorStride(payload_, &stride);
-        //     diopiDevice_t device;
-        //     diopiGetTensorDevice(payload_, &device);
-        //     diopiTensorHandle_t tmp = nullptr;
-        //     diopiRequireTensor(ctx_, &tmp, &size, &stride, dtype, device);
-        //     diopiCopyInp(ctx_, tmp_, tmp);
-        //     diopiCastDtype(ctx_, payload_, tmp);
-        // }
     }
 
 public:
     operator diopiTensorHandle_t() { return tmp_; }
 };
 
+// Converts the arguments of an elementwise op tile by tile instead of as whole tensors. When a dtype
+// conversion is needed, each converted argument gets one tile-sized buffer: a tile is cast into it,
+// the op runs on the tile and the outputs are cast back. This repeats over the flattened tensors, so
+// in-place ops on huge tensors (optimizer states) need one tile of extra memory instead of a full copy.
+// Only applies when all tensors are contiguous with the same shape and need no layout change; add()
+// returns false otherwise and the adaptor takes its regular path.
+class ChunkedElementwise {
+public:
+    static constexpr int64_t kTileBytes = 1 << 20;
+
+    explicit ChunkedElementwise(diopiContextHandle_t ctx) : ctx_(ctx) {}
+
+    template <class strategy>
+    bool add(diopiConstTensorHandle_t tensor, ConvertPlanCache<strategy> &planCache, ArgMeta &arg, bool output) {
+        if (!tensor) {
+            args_.push_back(Arg{nullptr, diopiTensorMeta_t(), diopi_dtype_float32, output});
+            return true;
+        }
+        const ConvertPlan &plan = lookupPlan(tensor, planCache, arg);
+        const diopiTensorMeta_t &meta = arg.meta;
+        diopiSize_t size = meta.shape;
+        if (plan.convertLayout || meta.itemsize <= 0 || !isContiguous(size, meta.stride)) {
+            return false;
+        }
+        if (numel_ < 0) {
+            shape_.assign(size.data, size.data + size.len);
+            numel_ = 1;
+            for (auto dim : shape_) {
+                numel_ *= dim;
+            }
+        } else if (static_cast<size_t>(size.len) != shape_.size() || !std::equal(shape_.begin(), shape_.end(), size.data)) {
+            return false;
+        }
+        args_.push_back(Arg{tensor, meta, plan.dstDtype, output});
+        convert_ = convert_ || plan.convertDtype;
+        return true;
+    }
+
+    // worth it only when some argument is converted and the tensors span more than one tile
+    bool ready() const {
+        return convert_ && diopiRequireTensorView != nullptr && diopiTensorResetView != nullptr && diopiGetTensorStorageOffset != nullptr &&
+               numel_ > tileElems();
+    }
+
+    // func receives the per-tile handles of the arguments, in the order they were added. Each argument gets one view that
+    // moves from tile to tile, so the handles the context holds do not grow with the number of tiles.
+    template <class Func>
+    diopiError_t run(Func &&func) {
+        const int64_t tile = tileElems();
+        diopiSize_t tileSize{&tile, 1};
+        std::vector<diopiTensorHandle_t> views(args_.size(), nullptr);
+        std::vector<diopiTensorHandle_t> buffers(args_.size(), nullptr);
+        std::vector<diopiTensorHandle_t> handles(args_.size(), nullptr);
+        for (size_t i = 0; i < args_.size(); ++i) {
+            if (!args_[i].tensor) {
+                continue;
+            }
+            diopiError_t ret = diopiRequireTensorView(ctx_, &views[i], args_[i].tensor, &tileSize, nullptr, args_[i].meta.storage_offset);
+            handles[i] = views[i];
+            if (ret == diopiSuccess && args_[i].meta.dtype != args_[i].dstDtype) {
+                // the kernel sees the converted tile through a view of the buffer, which shrinks for the last tile
+                ret = diopiRequireTensor(ctx_, &buffers[i], &tileSize, nullptr, args_[i].dstDtype, args_[i].meta.device);
+                ret = ret == diopiSuccess ? diopiRequireTensorView(ctx_, &handles[i], buffers[i], &tileSize, nullptr, 0) : ret;
+            }
+            if (ret != diopiSuccess) {
+                return ret;
+            }
+        }
+        for (int64_t begin = 0; begin < numel_; begin += tile) {
+            int64_t len = std::min(tile, numel_ - begin);
+            diopiSize_t lenSize{&len, 1};
+            for (size_t i = 0; i < args_.size(); ++i) {
+                if (!args_[i].tensor) {
+                    continue;
+                }
+                diopiError_t ret = begin > 0 ? diopiTensorResetView(views[i], &lenSize, nullptr, args_[i].meta.storage_offset + begin) : diopiSuccess;
+                if (ret == diopiSuccess && buffers[i]) {
+                    ret = len < tile ? diopiTensorResetView(handles[i], &lenSize, nullptr, 0) : diopiSuccess;
+                    ret = ret == diopiSuccess ? diopiCastDtype(ctx_, handles[i], views[i]) : ret;
+                }
+                if (ret != diopiSuccess) {
+                    return ret;
+                }
+            }
+            diopiError_t ret = func(handles.data());
+            if (ret != diopiSuccess) {
+                return ret;
+            }
+            for (size_t i = 0; i < args_.size(); ++i) {
+                if (buffers[i] && args_[i].output) {
+                    ret = diopiCastDtype(ctx_, views[i], handles[i]);
+                    if (ret != diopiSuccess) {
+                        return ret;
+                    }
+                }
+            }
+        }
+        return diopiSuccess;
+    }
+
+private:
+    struct Arg {
+        diopiConstTensorHandle_t tensor;
+        diopiTensorMeta_t meta;
+        diopiDtype_t dstDtype;
+        bool output;
+    };
+
+    int64_t tileElems() const {
+        int64_t maxItemSize = 1;
+        for (const auto &arg : args_) {
+            if (arg.tensor) {
+                maxItemSize = std::max(maxItemSize, arg.meta.itemsize);
+            }
+        }
+        return kTileBytes / maxItemSize;
+    }
+
+    diopiContextHandle_t ctx_;
+    std::vector<Arg> args_;
+    std::vector<int64_t> shape_;
+    int64_t numel_ = -1;
+    bool convert_ = false;
+};
+
 #endif  // DIOPI_ADAPTOR_CSRC_CONVERT_HPP_
\ No newline at end of file
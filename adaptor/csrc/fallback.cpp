@@ -0,0 +1,230 @@
+#include "fallback.hpp"
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+
+namespace {
+
+thread_local int fallbackDepth = 0;
+
+int64_t nowNs() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+struct FallbackStats {
+    int64_t calls = 0;
+    int64_t failures = 0;
+    int64_t totalNs = 0;
+    int64_t copiedBytes = 0;
+};
+
+class FallbackRegistry {
+public:
+    static FallbackRegistry &instance() {
+        static FallbackRegistry registry;
+        return registry;
+    }
+
+    bool loaded() const { return handle_ != nullptr; }
+
+    void *symbol(const char *funcName) {
+        if (handle_ == nullptr) {
+            return nullptr;
+        }
+        void *func = dlsym(handle_, funcName);
+        if (func == nullptr) {
+            fprintf(stderr, "[DIOPI] fallback library %s has no %s\n", libPath_.c_str(), funcName);
+        }
+        return func;
+    }
+
+    void record(const char *opName, int64_t elapsedNs, int64_t copiedBytes, bool failed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FallbackStats &stats = stats_[opName];
+        ++stats.calls;
+        stats.failures += failed ? 1 : 0;
+        stats.totalNs += elapsedNs;
+        stats.copiedBytes += copiedBytes;
+    }
+
+    bool dump(FILE *file) {
+        std::vector<std::pair<std::string, FallbackStats>> sorted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sorted.assign(stats_.begin(), stats_.end());
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second.totalNs > b.second.totalNs; });
+        fprintf(file, "[DIOPI] ops run by the host fallback (%s)\n", libPath_.c_str());
+        fprintf(file, "%-48s %10s %10s %12s %12s\n", "op", "calls", "failures", "total(ms)", "copied(MB)");
+        for (const auto &item : sorted) {
+            const FallbackStats &stats = item.second;
+            fprintf(file,
+                    "%-48s %10lld %10lld %12.3f %12.3f\n",
+                    item.first.c_str(),
+                    static_cast<long long>(stats.calls),
+                    static_cast<long long>(stats.failures),
+                    stats.totalNs / 1e6,
+                    stats.copiedBytes / 1048576.0);
+        }
+        return ferror(file) == 0;
+    }
+
+    ~FallbackRegistry() {
+        bool used = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            used = !stats_.empty();
+        }
+        if (used) {
+            dump(stdout);
+        }
+    }
+
+private:
+    FallbackRegistry() {
+        const char *libPath = getenv("DIOPI_FALLBACK_LIB");
+        if (libPath == nullptr || libPath[0] == '\0') {
+            return;
+        }
+        libPath_ = libPath;
+        // RTLD_LOCAL keeps the diopi symbols of the library from interposing the ones of the vendor library
+        handle_ = dlopen(libPath, RTLD_NOW | RTLD_LOCAL);
+        if (handle_ == nullptr) {
+            fprintf(stderr, "[DIOPI] failed to load the fallback library %s: %s\n", libPath, dlerror());
+        }
+    }
+
+    void *handle_ = nullptr;
+    std::string libPath_;
+    std::mutex mutex_;
+    std::map<std::string, FallbackStats> stats_;
+};
+
+}  // namespace
+
+void *fallbackSymbol(const char *funcName) { return FallbackRegistry::instance().symbol(funcName); }
+
+bool inHostFallback() { return fallbackDepth > 0; }
+
+bool forceFallback(const char *funcName) {
+    static const std::set<std::string> forced = [] {
+        std::set<std::string> names;
+        const char *env = getenv("DIOPI_FALLBACK_OPS");
+        std::stringstream list(env != nullptr ? env : "");
+        std::string name;
+        while (std::getline(list, name, ',')) {
+            if (!name.empty()) {
+                names.insert(name);
+            }
+        }
+        return names;
+    }();
+    return !forced.empty() && !inHostFallback() && forced.count(funcName) > 0;
+}
+
+HostFallback::HostFallback(diopiContextHandle_t ctx, const char *opName) : ctx_(ctx), opName_(opName), startNs_(nowNs()) { ++fallbackDepth; }
+
+HostFallback::~HostFallback() {
+    --fallbackDepth;
+    FallbackRegistry::instance().record(opName_, nowNs() - startNs_, bytes_, !ok_);
+}
+
+diopiTensorHandle_t HostFallback::toHost(diopiConstTensorHandle_t tensor) {
+    if (tensor == nullptr || !ok_) {
+        return nullptr;
+    }
+    diopiDevice_t device = diopi_device;
+    if (diopiGetTensorDevice != nullptr) {
+        diopiGetTensorDevice(tensor, &device);
+    }
+    if (device == diopi_host) {
+        return const_cast<diopiTensorHandle_t>(tensor);
+    }
+    if (diopiTensorCopyToBuffer == nullptr || diopiTensorCopyFromBuffer == nullptr) {
+        ok_ = false;
+        return nullptr;
+    }
+    diopiSize_t shape;
+    diopiSize_t stride;
+    diopiDtype_t dtype;
+    diopiGetTensorShape(tensor, &shape);
+    diopiGetTensorStride(tensor, &stride);
+    diopiGetTensorDtype(tensor, &dtype);
+    // same strides on host, so the copies move the elements of the tensor as one span
+    diopiTensorHandle_t hostTensor = nullptr;
+    void *hostData = nullptr;
+    if (diopiRequireTensor(ctx_, &hostTensor, &shape, &stride, dtype, diopi_host) != diopiSuccess || diopiGetTensorData(hostTensor, &hostData) != diopiSuccess ||
+        diopiTensorCopyToBuffer(ctx_, tensor, hostData) != diopiSuccess) {
+        ok_ = false;
+        return nullptr;
+    }
+    int64_t numel = 0;
+    int64_t elemSize = 0;
+    diopiGetTensorNumel(tensor, &numel);
+    if (diopiGetTensorElemSize != nullptr) {
+        diopiGetTensorElemSize(tensor, &elemSize);
+    }
+    bytes_ += numel * elemSize;
+    return hostTensor;
+}
+
+diopiConstTensorHandle_t HostFallback::input(diopiConstTensorHandle_t tensor) { return toHost(tensor); }
+
+diopiConstTensorHandle_t *HostFallback::inputs(const diopiConstTensorHandle_t *tensors, int64_t num) {
+    arrays_.emplace_back(num);
+    std::vector<diopiConstTensorHandle_t> &hostTensors = arrays_.back();
+    for (int64_t i = 0; i < num; ++i) {
+        hostTensors[i] = toHost(tensors[i]);
+    }
+    return hostTensors.data();
+}
+
+diopiTensorHandle_t HostFallback::output(diopiTensorHandle_t tensor) {
+    diopiTensorHandle_t hostTensor = toHost(tensor);
+    if (hostTensor != nullptr && hostTensor != tensor) {
+        outputs_.emplace_back(tensor, hostTensor);
+    }
+    return hostTensor;
+}
+
+diopiError_t HostFallback::finish(diopiError_t ret) {
+    if (ret != diopiSuccess) {
+        ok_ = false;
+        return ret;
+    }
+    for (auto &output : outputs_) {
+        void *hostData = nullptr;
+        diopiGetTensorData(output.second, &hostData);
+        if (diopiTensorCopyFromBuffer(ctx_, hostData, output.first) != diopiSuccess) {
+            ok_ = false;
+            return diopiErrorOccurred;
+        }
+    }
+    return diopiSuccess;
+}
+
+extern "C" {
+
+diopiError_t diopiAdaptorFallbackDump(const char *fileName) {
+    if (!FallbackRegistry::instance().loaded()) {
+        return diopiNotInited;
+    }
+    FILE *file = fileName != nullptr ? fopen(fileName, "w") : stdout;
+    if (file == nullptr) {
+        return diopiErrorOccurred;
+    }
+    bool ok = FallbackRegistry::instance().dump(file);
+    if (file != stdout) {
+        fclose(file);
+    }
+    return ok ? diopiSuccess : diopiErrorOccurred;
+}
+
+}  // extern "C"
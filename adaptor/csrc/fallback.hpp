@@ -0,0 +1,62 @@
+#ifndef DIOPI_ADAPTOR_CSRC_FALLBACK_HPP_
+#define DIOPI_ADAPTOR_CSRC_FALLBACK_HPP_
+
+#include <diopi/diopirt.h>
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Host reference fallback of the generated adaptors, enabled by setting DIOPI_FALLBACK_LIB to a DIOPI
+// implementation library that runs on the host. When the vendor kernel returns diopiNoImplement or
+// diopiDtypeNotSupported, the adaptor looks the op up in that library, copies the tensor arguments to
+// host, runs the op there and copies the outputs back. Calls and time spent are counted per op and
+// reported at exit or through diopiAdaptorFallbackDump, so the most expensive missing kernels stand out.
+// DIOPI_FALLBACK_OPS takes a comma separated list of functions, e.g. diopiAdd,diopiMulInp, whose vendor kernels
+// are skipped so that they always run in their composite version or the fallback library, which helps to bisect a
+// wrong result.
+
+// The symbol of the op in the fallback library, nullptr when the fallback is off or lacks the op.
+void *fallbackSymbol(const char *funcName);
+
+// True while the current thread runs an op in the fallback library. Calls made from there never fall back again,
+// so a fallback library built with the adaptor, even the vendor library itself, runs its own kernels.
+bool inHostFallback();
+
+inline bool shouldFallback(diopiError_t ret) { return (ret == diopiNoImplement || ret == diopiDtypeNotSupported) && !inHostFallback(); }
+
+// True when DIOPI_FALLBACK_OPS lists funcName, the adaptor then reports diopiNoImplement instead of calling the vendor.
+bool forceFallback(const char *funcName);
+
+// Host copies of the arguments of one fallback call. The copies are required from ctx, so they live
+// until the context releases its tensors.
+class HostFallback {
+public:
+    HostFallback(diopiContextHandle_t ctx, const char *opName);
+    ~HostFallback();
+    HostFallback(const HostFallback &) = delete;
+    HostFallback &operator=(const HostFallback &) = delete;
+
+    diopiConstTensorHandle_t input(diopiConstTensorHandle_t tensor);
+    diopiConstTensorHandle_t *inputs(const diopiConstTensorHandle_t *tensors, int64_t num);
+    // outputs are copied in as well, in-place ops read them
+    diopiTensorHandle_t output(diopiTensorHandle_t tensor);
+    // copies the outputs back to the device when the host call succeeded
+    diopiError_t finish(diopiError_t ret);
+    // false when an argument could not be copied to host, the caller should keep the original error then
+    bool ok() const { return ok_; }
+
+private:
+    diopiTensorHandle_t toHost(diopiConstTensorHandle_t tensor);
+
+    diopiContextHandle_t ctx_;
+    const char *opName_;
+    int64_t startNs_;
+    int64_t bytes_ = 0;
+    bool ok_ = true;
+    std::vector<std::pair<diopiTensorHandle_t, diopiTensorHandle_t>> outputs_;  // (device, host)
+    std::deque<std::vector<diopiConstTensorHandle_t>> arrays_;
+};
+
+#endif  // DIOPI_ADAPTOR_CSRC_FALLBACK_HPP_
@@ -25,30 +25,33 @@ PYBIND11_MODULE(export_functions, m) {
     m.def("diopiGetImplVersion", &diopiGetImplVersion);
     m.def("diopiGetVersion", &diopiGetVersion);
     m.def("diopiGetLastErrorString", &diopiGetLastErrorString);
+    m.def("diopiGetOpCapabilities", [](const char* opName) {
+        diopiOpCapabilities_t caps{};
+        diopiError_t ret = diopiGetOpCapabilities ? diopiGetOpCapabilities(opName, &caps) : diopiError_t::diopiNoImplement;
+        return std::make_pair(ret, caps);
+    });
+    m.def("diopiAdaptorTimingDump", [](const char* fileName) {
+        return diopiAdaptorTimingDump ? diopiAdaptorTimingDump(fileName) : diopiError_t::diopiNoImplement;
+    });
+    m.def("diopiAdaptorTimingReset", []() { return diopiAdaptorTimingReset ? diopiAdaptorTimingReset() : diopiError_t::diopiNoImplement; });
+    m.def("diopiAdaptorFallbackDump", [](const char* fileName) {
+        return diopiAdaptorFallbackDump ? diopiAdaptorFallbackDump(fileName) : diopiError_t::diopiNoImplement;
+    });
     ${export_functions}
 }
 // NOLINTEND
 """)
 
+    # the GIL is released for the kernel call only, python objects are touched again by ${out_copy}
     function_template = CodeTemplate("""\
 m.def("${func_name}", [](${attrs}) {
     if (${func_name}) {
         ${convert}
-        diopiError_t ret = ${call_func};
-        ${out_copy}
-        return ret;
-    } else {
-        return diopiError_t::diopiNoImplement;
-    }
-});
-""")
-
-    function_ascend_template = CodeTemplate("""\
-m.def("${func_name}", [](${attrs}) {
-    if (${func_name}) {
-        ${convert}
-        py::gil_scoped_release no_gil;
-        diopiError_t ret = ${call_func};
+        diopiError_t ret;
+        {
+            py::gil_scoped_release no_gil;
+            ret = ${call_func};
+        }
         ${out_copy}
         return ret;
     } else {
@@ -16,11 +16,60 @@
 
 namespace py = pybind11;
 
+namespace {
+
+// A numpy array over the elements of a tensor. Host tensors are exported in place, device tensors as a read-only
+// snapshot copied to pinned host memory for this export alone. The array holds a reference to the storage it
+// points into, so it stays valid after the tensor is gone.
+py::array tensorToArray(const diopiTensor& tensor) {
+    if (tensor.storage() == nullptr) {
+        return py::array();
+    }
+    // python struct format descriptors indexed by diopiDtype_t, up to diopi_dtype_bool
+    static const char fmt[] = "bBhHiIlLefd?";
+    if (static_cast<size_t>(tensor.dtype()) >= sizeof(fmt) - 1) {
+        throw std::invalid_argument("the dtype can not be exported to numpy");
+    }
+    std::shared_ptr<Storage> owner = tensor.storage();
+    void* ptr = const_cast<void*>(tensor.data());
+    if (tensor.device() == diopi_device) {
+        owner = std::make_shared<Storage>(pinnedHostCachedMalloc, pinnedHostCachedFree, tensor.nbytes());
+        diopiStreamHandle_t stream;
+        diopiGetStream(tensor.getCtx(), &stream);
+        device_memcpy_d2h_async(stream, owner->data(), tensor.data(), tensor.nbytes());
+        device_synchronize_stream(stream);
+        ptr = owner->data();
+    }
+    const ssize_t esize = tensor.elemSize();
+    const diopiSize_t shape = tensor.shape();
+    const diopiSize_t stride = tensor.stride();
+    std::vector<ssize_t> arrayShape(shape.data, shape.data + shape.len);
+    std::vector<ssize_t> arrayStrides;
+    for (int64_t i = 0; i < stride.len; ++i) {
+        arrayStrides.push_back(stride.data[i] * esize);
+    }
+    py::capsule base(new std::shared_ptr<Storage>(owner), [](void* ref) { delete static_cast<std::shared_ptr<Storage>*>(ref); });
+    py::array array(py::dtype(std::string(1, fmt[static_cast<size_t>(tensor.dtype())])), arrayShape, arrayStrides, ptr, base);
+    if (tensor.device() == diopi_device) {
+        // writes to the snapshot would never reach the device
+        array.attr("setflags")(py::arg("write") = false);
+    }
+    return array;
+}
+
+void checkError(diopiError_t ret) {
+    if (ret != diopiSuccess) {
+        throw std::runtime_error("diopirt call failed with error " + std::to_string(static_cast<int>(ret)));
+    }
+}
+
+}  // namespace
+
 PYBIND11_MODULE(export_runtime, m) {
     py::options options;
     options.disable_function_signatures();
 
-    py::class_<diopiTensor, std::shared_ptr<diopiTensor>>(m, "diopiTensor", py::buffer_protocol())
+    py::class_<diopiTensor, std::shared_ptr<diopiTensor>>(m, "diopiTensor")
         .def(py::init([](diopiSize_t* shape, diopiSize_t* stride, diopiDtype_t dtype, diopiDevice_t device, diopiContextHandle_t context, const void* src) {
             auto tensor = diopiTensor(shape, stride, dtype, device, context, src);
             return tensor;
@@ -40,8 +89,15 @@ PYBIND11_MODULE(export_runtime, m) {
         .def("numel", &diopiTensor::numel)
         .def("reset_shape", &diopiTensor::resetShape)
         .def("itemsize", &diopiTensor::elemSize)
+        .def("storage_offset", &diopiTensor::storageOffset)
         .def("context", &diopiTensor::getCtx)
-        .def_buffer(&diopiTensor::buffer);
+        .def("__array__", [](const diopiTensor& self, py::object dtype, py::object copy) {
+            py::array array = tensorToArray(self);
+            if (!dtype.is_none() || (!copy.is_none() && copy.cast<bool>())) {
+                return py::array(array.attr("astype")(dtype.is_none() ? py::object(array.dtype()) : dtype));
+            }
+            return array;
+        }, py::arg("dtype") = py::none(), py::arg("copy") = py::none());
 
     py::class_<diopiGenerator, std::shared_ptr<diopiGenerator>>(m, "diopiGenerator", py::buffer_protocol())
         .def(py::init([](diopiConstTensorHandle_t state) {
@@ -55,7 +111,56 @@ PYBIND11_MODULE(export_runtime, m) {
         .def("state", &diopiGenerator::state)
         .def("set_state", &diopiGenerator::set_state);
 
-    py::class_<diopiContext>(m, "Context", py::buffer_protocol()).def(py::init<>()).def("clear_tensors", &diopiContext::clearTensors);
+    py::class_<diopiContext>(m, "Context", py::buffer_protocol())
+        .def(py::init<>())
+        .def(py::init<bool>(), py::arg("arena"))
+        .def_property_readonly("arena", &diopiContext::arenaMode)
+        .def("make_child", &diopiContext::makeChild, py::return_value_policy::take_ownership)
+        // the threads sharing a context run these concurrently
+        .def("clear_tensors", &diopiContext::clearTensors, py::call_guard<py::gil_scoped_release>())
+        .def("num_tensors", &diopiContext::numTensors, py::call_guard<py::gil_scoped_release>())
+        // a temporary owned by the context until clear_tensors, as required by the ops
+        .def(
+            "require_tensor",
+            [](diopiContext& context, std::vector<int64_t> shape, diopiDtype_t dtype, diopiDevice_t device) {
+                diopiSize_t size{shape.data(), static_cast<int64_t>(shape.size())};
+                diopiTensorHandle_t tensor = nullptr;
+                checkError(diopiRequireTensor(&context, &tensor, &size, nullptr, dtype, device));
+                return tensor;
+            },
+            py::return_value_policy::reference,
+            py::call_guard<py::gil_scoped_release>())
+        // frees a temporary before clear_tensors, arena temporaries stay until then
+        .def("destroy_tensor", &diopiContext::destroyTensor, py::call_guard<py::gil_scoped_release>())
+        // a view owned by the context like the temporaries, None when the runtime refuses it
+        .def(
+            "require_tensor_view",
+            [](diopiContext& context, diopiConstTensorHandle_t src, std::vector<int64_t> shape, std::vector<int64_t> stride, int64_t offset) {
+                diopiSize_t size{shape.data(), static_cast<int64_t>(shape.size())};
+                diopiSize_t strideSize{stride.data(), static_cast<int64_t>(stride.size())};
+                diopiTensorHandle_t tensor = nullptr;
+                return diopiRequireTensorView(&context, &tensor, src, &size, &strideSize, offset) == diopiSuccess ? tensor : nullptr;
+            },
+            py::return_value_policy::reference)
+        .def("synchronize", [](diopiContext& context) { device_synchronize_stream(context.getStreamHandle()); })
+        // streams and events are handed to python as integer handles
+        .def(
+            "stream", [](diopiContext& context) { return reinterpret_cast<uintptr_t>(context.getStreamHandle()); }, py::call_guard<py::gil_scoped_release>())
+        .def("stream_from_pool",
+             [](diopiContext& context) {
+                 diopiStreamHandle_t stream = nullptr;
+                 checkError(diopiGetStreamFromPool(&context, &stream));
+                 return reinterpret_cast<uintptr_t>(stream);
+             })
+        .def(
+            "create_event",
+            [](diopiContext& context, bool disableTiming) {
+                diopiEventHandle_t event = nullptr;
+                checkError(diopiEventCreateWithFlags(&context, &event, disableTiming ? diopiEventDisableTiming : diopiEventDefault));
+                return reinterpret_cast<uintptr_t>(event);
+            },
+            py::arg("disable_timing") = false)
+        .def("destroy_event", [](diopiContext& context, uintptr_t event) { checkError(diopiEventDestroy(&context, reinterpret_cast<diopiEventHandle_t>(event))); });
 
     py::enum_<diopiDevice_t>(m, "Device").value("Host", diopiDevice_t::diopi_host).value("AIChip", diopiDevice_t::diopi_device);
 
@@ -142,13 +247,131 @@ PYBIND11_MODULE(export_runtime, m) {
         .def_readwrite("ival", &diopiScalar_t::ival)
         .def_readwrite("fval", &diopiScalar_t::fval);
 
+    py::class_<diopiMemoryStats_t>(m, "diopiMemoryStats")
+        .def(py::init<>())
+        .def_readonly("allocated_bytes", &diopiMemoryStats_t::allocated_bytes)
+        .def_readonly("peak_allocated_bytes", &diopiMemoryStats_t::peak_allocated_bytes)
+        .def_readonly("reserved_bytes", &diopiMemoryStats_t::reserved_bytes)
+        .def_readonly("peak_reserved_bytes", &diopiMemoryStats_t::peak_reserved_bytes)
+        .def_readonly("cached_bytes", &diopiMemoryStats_t::cached_bytes)
+        .def_readonly("fragmented_bytes", &diopiMemoryStats_t::fragmented_bytes)
+        .def_readonly("num_allocs", &diopiMemoryStats_t::num_allocs)
+        .def_readonly("num_device_allocs", &diopiMemoryStats_t::num_device_allocs);
+
+    py::class_<diopiOpCapabilities_t>(m, "diopiOpCapabilities")
+        .def(py::init<>())
+        .def_readonly("dtypes", &diopiOpCapabilities_t::dtypes)
+        .def_readonly("memory_formats", &diopiOpCapabilities_t::memory_formats)
+        .def_readonly("inplace_safe", &diopiOpCapabilities_t::inplace_safe)
+        .def_readonly("workspace_bytes", &diopiOpCapabilities_t::workspace_bytes);
+
     py::class_<PtrWrapper<diopiTensor>>(m, "TensorP").def(py::init<diopiTensor*>()).def(py::init<py::none>()).def("data", &PtrWrapper<diopiTensor>::operator*);
 
     m.def("diopi_tensor_copy_to_buffer",
           [](diopiContextHandle_t context, diopiConstTensorHandle_t tensor, void* ptr) { diopiTensorCopyToBuffer(context, tensor, ptr); });
+    // the buffers have to stay alive until event has completed, a stream or event of 0 stands for nullptr
+    m.def(
+        "diopi_tensor_copy_to_buffer_async",
+        [](diopiContextHandle_t context, diopiConstTensorHandle_t tensor, py::buffer buffer, uintptr_t stream, uintptr_t event) {
+            checkError(diopiTensorCopyToBufferAsync(
+                context, tensor, buffer.request(true).ptr, reinterpret_cast<diopiStreamHandle_t>(stream), reinterpret_cast<diopiEventHandle_t>(event)));
+        },
+        py::arg("context"), py::arg("tensor"), py::arg("buffer"), py::arg("stream") = 0, py::arg("event") = 0);
+    m.def(
+        "diopi_tensor_copy_from_buffer_async",
+        [](diopiContextHandle_t context, py::buffer buffer, diopiTensorHandle_t tensor, uintptr_t stream, uintptr_t event) {
+            checkError(diopiTensorCopyFromBufferAsync(
+                context, buffer.request().ptr, tensor, reinterpret_cast<diopiStreamHandle_t>(stream), reinterpret_cast<diopiEventHandle_t>(event)));
+        },
+        py::arg("context"), py::arg("buffer"), py::arg("tensor"), py::arg("stream") = 0, py::arg("event") = 0);
+    m.def("event_record", [](uintptr_t event, uintptr_t stream) {
+        checkError(diopiEventRecord(reinterpret_cast<diopiEventHandle_t>(event), reinterpret_cast<diopiStreamHandle_t>(stream)));
+    });
+    m.def("stream_wait_event", [](uintptr_t stream, uintptr_t event) {
+        checkError(diopiStreamWaitEvent(reinterpret_cast<diopiStreamHandle_t>(stream), reinterpret_cast<diopiEventHandle_t>(event)));
+    });
+    m.def("event_query", [](uintptr_t event) {
+        int32_t completed = 0;
+        checkError(diopiEventQuery(reinterpret_cast<diopiEventHandle_t>(event), &completed));
+        return completed != 0;
+    });
+    m.def("event_synchronize", [](uintptr_t event) { checkError(diopiEventSynchronize(reinterpret_cast<diopiEventHandle_t>(event))); });
+    m.def("event_elapsed_time", [](uintptr_t start, uintptr_t end) {
+        float ms = 0;
+        checkError(diopiEventElapsedTime(reinterpret_cast<diopiEventHandle_t>(start), reinterpret_cast<diopiEventHandle_t>(end), &ms));
+        return ms;
+    });
+    // the name is passed through one buffer per thread, as camb's DIOPI_RECORD_START does
+    m.def("record_start", [](const std::string& name) {
+        thread_local char recordName[100];
+        snprintf(recordName, sizeof(recordName), "%s", name.c_str());
+        void* record = nullptr;
+        checkError(diopiRecordStart(recordName, &record));
+        return reinterpret_cast<uintptr_t>(record);
+    });
+    m.def("record_end", [](uintptr_t record) {
+        void* handle = reinterpret_cast<void*>(record);
+        checkError(diopiRecordEnd(&handle));
+    });
+    m.def("reset_view", [](diopiTensor& tensor, std::vector<int64_t> shape, std::vector<int64_t> stride, int64_t offset) {
+        diopiSize_t size{shape.data(), static_cast<int64_t>(shape.size())};
+        diopiSize_t strideSize{stride.data(), static_cast<int64_t>(stride.size())};
+        return diopiTensorResetView(&tensor, &size, &strideSize, offset) == diopiSuccess;
+    });
+    // the metadata of one diopiGetTensorMeta call and the same fields through the single getters, for comparison
+    m.def("get_tensor_meta", [](const diopiTensor& tensor) {
+        diopiTensorMeta_t meta{};
+        checkError(diopiGetTensorMeta(&tensor, &meta));
+        py::dict fields;
+        fields["shape"] = std::vector<int64_t>(meta.shape.data, meta.shape.data + meta.shape.len);
+        fields["stride"] = std::vector<int64_t>(meta.stride.data, meta.stride.data + meta.stride.len);
+        fields["dtype"] = meta.dtype;
+        fields["device"] = meta.device;
+        fields["storage_offset"] = meta.storage_offset;
+        fields["itemsize"] = meta.itemsize;
+        fields["numel"] = meta.numel;
+        return fields;
+    });
+    m.def("get_tensor_fields", [](diopiTensor& tensor) {
+        diopiSize_t shape, stride;
+        diopiDtype_t dtype;
+        diopiDevice_t device;
+        int64_t storageOffset = 0, itemsize = 0, numel = 0;
+        void *data = nullptr, *storage = nullptr;
+        checkError(diopiGetTensorShape(&tensor, &shape));
+        checkError(diopiGetTensorStride(&tensor, &stride));
+        checkError(diopiGetTensorDtype(&tensor, &dtype));
+        checkError(diopiGetTensorDevice(&tensor, &device));
+        checkError(diopiGetTensorStorageOffset(&tensor, &storageOffset));
+        checkError(diopiGetTensorElemSize(&tensor, &itemsize));
+        checkError(diopiGetTensorNumel(&tensor, &numel));
+        checkError(diopiGetTensorData(&tensor, &data));
+        checkError(diopiGetTensorStoragePtr(&tensor, &storage));
+        py::dict fields;
+        fields["shape"] = std::vector<int64_t>(shape.data, shape.data + shape.len);
+        fields["stride"] = std::vector<int64_t>(stride.data, stride.data + stride.len);
+        fields["dtype"] = dtype;
+        fields["device"] = device;
+        fields["storage_offset"] = storageOffset;
+        fields["itemsize"] = itemsize;
+        fields["numel"] = numel;
+        fields["data"] = reinterpret_cast<uintptr_t>(data);
+        fields["storage"] = reinterpret_cast<uintptr_t>(storage);
+        return fields;
+    });
+    m.def("adopt_layout", [](diopiTensor& dst, const diopiTensor& src) { return diopiTensorAdoptLayout(&dst, &src) == diopiSuccess; });
     m.def("get_last_error_string", &diopiGetLastErrorString);
     m.def("diopi_init", &diopiInit);
     m.def("diopi_finalize", &diopiFinalize);
+    m.def("empty_cache", &diopiEmptyCache);
+    m.def("get_memory_stats", [](diopiContextHandle_t context, diopiDevice_t device) {
+        diopiMemoryStats_t stats{};
+        diopiGetMemoryStats(context, device, &stats);
+        return stats;
+    });
+    // the pinned staging memory of the exports is pooled apart from the host tensors
+    m.def("get_pinned_memory_stats", []() { return pinnedHostAllocator().stats(); });
+    m.def("reset_peak_memory_stats", [](diopiContextHandle_t context, diopiDevice_t device) { diopiResetPeakMemoryStats(context, device); });
     m.def("init_library", &initLibrary);
     m.def("finalize_library", &finalizeLibrary);
     m.def("build_generator_state", [](diopiContextHandle_t ctx) {
@@ -13,14 +13,22 @@
 #include <diopi/diopirt.h>
 #include <diopi/functions.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cinttypes>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 extern "C" {
@@ -57,6 +65,388 @@ static void* hostMalloc(uint64_t bytes) { return malloc(bytes); }
 
 static void hostFree(void* ptr) { free(ptr); }
 
+static void* pinnedHostMalloc(uint64_t bytes) { return device_malloc_host != nullptr ? device_malloc_host(bytes) : hostMalloc(bytes); }
+
+static void pinnedHostFree(void* ptr) {
+    if (device_free_host != nullptr) {
+        device_free_host(ptr);
+    } else {
+        hostFree(ptr);
+    }
+}
+
+void* pinnedHostCachedMalloc(uint64_t bytes) { return pinnedHostAllocator().allocate(bytes); }
+
+void pinnedHostCachedFree(void* ptr) { pinnedHostAllocator().deallocate(ptr); }
+
+static void* hostCachedMalloc(uint64_t bytes) { return hostAllocator().allocate(bytes); }
+
+static void hostCachedFree(void* ptr) { hostAllocator().deallocate(ptr); }
+
+static void* deviceCachedMalloc(uint64_t bytes) { return deviceAllocator().allocate(bytes); }
+
+static void deviceCachedFree(void* ptr) { deviceAllocator().deallocate(ptr); }
+
+static const uint64_t kMinBlockSize = 512;
+static const uint64_t kSmallBlockLimit = 1 << 20;
+
+static thread_local diopiStreamHandle_t currentAllocStream = nullptr;
+
+CachingAllocator::StreamGuard::StreamGuard(diopiStreamHandle_t stream) : prevStream_(currentAllocStream) { currentAllocStream = stream; }
+
+CachingAllocator::StreamGuard::~StreamGuard() { currentAllocStream = prevStream_; }
+
+CachingAllocator::CachingAllocator(malloc_func_t rawMalloc, free_func_t rawFree, bool streamAware)
+    : rawMalloc_(rawMalloc), rawFree_(rawFree), streamAware_(streamAware), enabled_(true) {
+    assert(rawMalloc_);
+    assert(rawFree_);
+    const char* cachingEnv = getenv("DIOPIRT_CACHING_ALLOCATOR");
+    if (cachingEnv != nullptr && (strcmp(cachingEnv, "0") == 0 || strcmp(cachingEnv, "OFF") == 0)) {
+        enabled_ = false;
+    }
+}
+
+uint64_t CachingAllocator::roundSize(uint64_t bytes) {
+    if (bytes <= kSmallBlockLimit) {
+        return bytes <= kMinBlockSize ? kMinBlockSize : (bytes + kMinBlockSize - 1) / kMinBlockSize * kMinBlockSize;
+    }
+    // eight size classes per power of two, which bounds the rounding waste of large blocks to 12.5%
+    uint64_t pow2 = kSmallBlockLimit;
+    while (pow2 < bytes) {
+        pow2 <<= 1;
+    }
+    const uint64_t step = pow2 / 8;
+    return (bytes + step - 1) / step * step;
+}
+
+void* CachingAllocator::allocate(uint64_t bytes) {
+    if (!enabled_) {
+        // blocks are still tracked so that the statistics stay meaningful
+        void* ptr = rawMalloc_(bytes);
+        if (ptr != nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            blocks_[ptr] = Block{bytes, bytes, nullptr, false};
+            onAllocate(blocks_[ptr], true);
+        }
+        return ptr;
+    }
+    const uint64_t size = roundSize(bytes);
+    diopiStreamHandle_t stream = streamAware_ ? currentAllocStream : nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = freeBlocks_.find(FreeListKey(stream, size));
+    if (it != freeBlocks_.end() && !it->second.empty()) {
+        void* ptr = it->second.back();
+        it->second.pop_back();
+        Block& block = blocks_[ptr];
+        block.requested = bytes;
+        onAllocate(block, false);
+        return ptr;
+    }
+    void* ptr = rawMalloc_(size);
+    if (ptr == nullptr) {
+        // out of memory: give every cached block back and retry once
+        releaseCachedBlocks(nullptr, true);
+        ptr = rawMalloc_(size);
+        if (ptr == nullptr) {
+            return nullptr;
+        }
+    }
+    blocks_[ptr] = Block{size, bytes, stream, false};
+    onAllocate(blocks_[ptr], true);
+    return ptr;
+}
+
+void CachingAllocator::deallocate(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blocks_.find(ptr);
+    if (it == blocks_.end()) {
+        rawFree_(ptr);
+        return;
+    }
+    if (!enabled_ || it->second.retired) {
+        onDeallocate(it->second, false);
+        blocks_.erase(it);
+        rawFree_(ptr);
+        return;
+    }
+    onDeallocate(it->second, true);
+    freeBlocks_[FreeListKey(it->second.stream, it->second.size)].push_back(ptr);
+}
+
+void CachingAllocator::onAllocate(const Block& block, bool fromDevice) {
+    stats_.allocated_bytes += block.requested;
+    stats_.fragmented_bytes += block.size - block.requested;
+    stats_.num_allocs += 1;
+    if (fromDevice) {
+        stats_.reserved_bytes += block.size;
+        stats_.num_device_allocs += 1;
+    } else {
+        stats_.cached_bytes -= block.size;
+    }
+    stats_.peak_allocated_bytes = std::max(stats_.peak_allocated_bytes, stats_.allocated_bytes);
+    stats_.peak_reserved_bytes = std::max(stats_.peak_reserved_bytes, stats_.reserved_bytes);
+}
+
+void CachingAllocator::onDeallocate(const Block& block, bool toCache) {
+    stats_.allocated_bytes -= block.requested;
+    stats_.fragmented_bytes -= block.size - block.requested;
+    if (toCache) {
+        stats_.cached_bytes += block.size;
+    } else {
+        stats_.reserved_bytes -= block.size;
+    }
+}
+
+diopiMemoryStats_t CachingAllocator::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void CachingAllocator::resetPeakStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.peak_allocated_bytes = stats_.allocated_bytes;
+    stats_.peak_reserved_bytes = stats_.reserved_bytes;
+}
+
+void CachingAllocator::releaseCachedBlocks(diopiStreamHandle_t stream, bool allStreams) {
+    diopiStreamHandle_t syncedStream = nullptr;
+    for (auto it = freeBlocks_.begin(); it != freeBlocks_.end();) {
+        diopiStreamHandle_t blockStream = it->first.first;
+        if (!allStreams && blockStream != stream) {
+            ++it;
+            continue;
+        }
+        // a cached block may still be read by work queued before it was freed
+        if (blockStream != nullptr && blockStream != syncedStream) {
+            device_synchronize_stream(blockStream);
+            syncedStream = blockStream;
+        }
+        for (void* ptr : it->second) {
+            stats_.cached_bytes -= it->first.second;
+            stats_.reserved_bytes -= it->first.second;
+            blocks_.erase(ptr);
+            rawFree_(ptr);
+        }
+        it = freeBlocks_.erase(it);
+    }
+}
+
+void CachingAllocator::emptyCache() {
+    if (!enabled_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    releaseCachedBlocks(nullptr, true);
+}
+
+void CachingAllocator::releaseStream(diopiStreamHandle_t stream) {
+    if (!enabled_ || !streamAware_ || stream == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    device_synchronize_stream(stream);
+    releaseCachedBlocks(stream, false);
+    // blocks still alive can not be cached under a stream handle that is about to be reused
+    for (auto& block : blocks_) {
+        if (block.second.stream == stream) {
+            block.second.retired = true;
+        }
+    }
+}
+
+CachingAllocator& hostAllocator() {
+    static CachingAllocator allocator(hostMalloc, hostFree, false);
+    return allocator;
+}
+
+CachingAllocator& deviceAllocator() {
+    static CachingAllocator allocator(device_malloc, device_free, true);
+    return allocator;
+}
+
+CachingAllocator& pinnedHostAllocator() {
+    static CachingAllocator allocator(pinnedHostMalloc, pinnedHostFree, false);
+    return allocator;
+}
+
+static std::shared_ptr<Storage> makeStorage(diopiDevice_t device, diopiContextHandle_t context, int64_t nbytes) {
+    if (device == diopi_host) {
+        return std::make_shared<Storage>(hostCachedMalloc, hostCachedFree, nbytes);
+    }
+    CachingAllocator::StreamGuard guard(context != nullptr ? context->getStreamHandle() : nullptr);
+    return std::make_shared<Storage>(deviceCachedMalloc, deviceCachedFree, nbytes);
+}
+
+std::shared_ptr<Storage> ContextArena::allocate(diopiContextHandle_t context, int64_t nbytes, int64_t* offset) {
+    nbytes = (nbytes + kAlignment - 1) / kAlignment * kAlignment;
+    for (; current_ < chunks_.size(); ++current_) {
+        Chunk& chunk = chunks_[current_];
+        if (chunk.used + nbytes <= chunk.storage->nbytes()) {
+            *offset = chunk.used;
+            chunk.used += nbytes;
+            return chunk.storage;
+        }
+    }
+    // grow geometrically so that the number of chunks stays logarithmic in the peak footprint
+    int64_t chunkSize = nbytes > kMinChunkSize ? nbytes : kMinChunkSize;
+    if (!chunks_.empty() && 2 * chunks_.back().storage->nbytes() > chunkSize) {
+        chunkSize = 2 * chunks_.back().storage->nbytes();
+    }
+    chunks_.push_back(Chunk{makeStorage(device_, context, chunkSize), nbytes});
+    current_ = chunks_.size() - 1;
+    *offset = 0;
+    return chunks_.back().storage;
+}
+
+void ContextArena::reset() {
+    for (auto& chunk : chunks_) {
+        chunk.used = 0;
+    }
+    current_ = 0;
+}
+
+static bool hasDeviceEvents() {
+    static const bool available = device_make_event != nullptr && device_destroy_event != nullptr && device_record_event != nullptr &&
+                                  device_stream_wait_event != nullptr && device_query_event != nullptr && device_synchronize_event != nullptr &&
+                                  device_event_elapsed_time != nullptr;
+    return available;
+}
+
+static int64_t hostNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RuntimeEvent::RuntimeEvent(diopiEventFlags_t flags) : timing_((flags & diopiEventDisableTiming) == 0) {
+    if (hasDeviceEvents()) {
+        device_make_event(&deviceEvent_, flags);
+    }
+}
+
+RuntimeEvent::~RuntimeEvent() {
+    if (deviceEvent_ != nullptr) {
+        device_destroy_event(deviceEvent_);
+        deviceEvent_ = nullptr;
+    }
+}
+
+diopiError_t RuntimeEvent::record(diopiStreamHandle_t stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recorded_ = true;
+    if (deviceEvent_ != nullptr) {
+        return device_record_event(deviceEvent_, stream);
+    }
+    stream_ = stream;
+    if (!timing_) {
+        pending_ = true;
+        return diopiSuccess;
+    }
+    // the timestamp has to be taken once the work before the event has completed, not when it was enqueued
+    pending_ = false;
+    diopiError_t ret = device_synchronize_stream(stream);
+    hostTimeNs_ = hostNowNs();
+    return ret;
+}
+
+diopiError_t RuntimeEvent::complete() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pending_) {
+        return diopiSuccess;
+    }
+    // the other threads waiting for the event block on the lock until the stream has drained
+    diopiError_t ret = device_synchronize_stream(stream_);
+    pending_ = false;
+    return ret;
+}
+
+diopiError_t RuntimeEvent::block(diopiStreamHandle_t stream) const {
+    if (deviceEvent_ != nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return recorded_ ? device_stream_wait_event(stream, deviceEvent_) : diopiSuccess;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // work queued later on the stream of the event is ordered after it already
+        if (stream == stream_) {
+            return diopiSuccess;
+        }
+    }
+    return complete();
+}
+
+diopiError_t RuntimeEvent::query(int32_t* completed) const {
+    if (deviceEvent_ != nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (recorded_) {
+            return device_query_event(deviceEvent_, completed);
+        }
+        *completed = 1;
+        return diopiSuccess;
+    }
+    // the runtime cannot poll a stream, so a pending emulated event is waited for and then reported completed
+    *completed = 1;
+    return complete();
+}
+
+diopiError_t RuntimeEvent::synchronize() const {
+    if (deviceEvent_ != nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return recorded_ ? device_synchronize_event(deviceEvent_) : diopiSuccess;
+    }
+    return complete();
+}
+
+diopiError_t RuntimeEvent::elapsedSince(const RuntimeEvent& start, float* ms) const {
+    if (!timing_ || !start.timing_) {
+        diopi_err("diopiEventElapsedTime: the events were created with diopiEventDisableTiming\n");
+        return diopiErrorOccurred;
+    }
+    int64_t startNs = 0;
+    {
+        std::lock_guard<std::mutex> lock(start.mutex_);
+        if (!start.recorded_) {
+            diopi_err("diopiEventElapsedTime: both events have to be recorded\n");
+            return diopiErrorOccurred;
+        }
+        startNs = start.hostTimeNs_;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!recorded_) {
+        diopi_err("diopiEventElapsedTime: both events have to be recorded\n");
+        return diopiErrorOccurred;
+    }
+    if (deviceEvent_ != nullptr) {
+        return device_event_elapsed_time(start.deviceEvent_, deviceEvent_, ms);
+    }
+    *ms = static_cast<float>(hostTimeNs_ - startNs) / 1e6f;
+    return diopiSuccess;
+}
+
+diopiContext::diopiContext() {
+    const char* env = std::getenv("DIOPIRT_CONTEXT_ARENA");
+    arenaMode_ = env != nullptr && (std::string(env) == "1" || std::string(env) == "ON");
+}
+
+diopiTensorHandle_t diopiContext::createArenaTensor(const diopiSize_t* size, const diopiSize_t* stride, const diopiDtype_t dtype, const diopiDevice_t dev) {
+    std::lock_guard<std::mutex> lock(arenaMutex_);
+    if (slabUsed_ == slab_.size()) {
+        slab_.emplace_back();
+    }
+    diopiTensorHandle_t tensor = &slab_[slabUsed_++];
+    tensor->resetView(nullptr, 0, size, stride, dtype, dev, this);
+    const int64_t nbytes = tensor->nbytes();
+    if (nbytes > 0) {
+        int64_t offset = 0;
+        ContextArena& arena = dev == diopi_host ? hostArena_ : deviceArena_;
+        std::shared_ptr<Storage> chunk = arena.allocate(this, nbytes, &offset);
+        // kAlignment is a multiple of every item size, so the byte offset is a whole number of elements
+        tensor->resetView(chunk, offset / tensor->elemSize(), size, stride, dtype, dev, this);
+    }
+    return tensor;
+}
+
 int32_t itemsize(const diopiDtype_t dtype) {
     switch (dtype) {
         case diopi_dtype_int32:
@@ -141,19 +531,57 @@ diopiTensor::diopiTensor(const diopiSize_t* shape, const diopiSize_t* stride, di
         }
         strideNumel += (shape_[i] - 1) * stride_[i];
     }
-    strideNumel *= itemsize(dtype);
-    const int64_t nbytes = strideNumel;
+    // an empty tensor owns no memory whatever its strides
+    const int64_t nbytes = numel_ == 0 ? 0 : strideNumel * itemsize(dtype);
     // const int64_t nbytes = numel_ * itemsize(dtype);
-    if (device_ == diopi_host) {
-        storage_ = std::make_shared<Storage>(hostMalloc, hostFree, nbytes);
-    } else {
-        storage_ = std::make_shared<Storage>(device_malloc, device_free, nbytes);
-    }
+    storage_ = makeStorage(device_, context_, nbytes);
+    setWindow(0, nbytes);
     if (src != nullptr) {
         diopiTensorCopyFromBuffer(context, src, this);
     }
 }
 
+diopiTensor::diopiTensor(const std::shared_ptr<Storage>& storage, int64_t storageOffset, const diopiSize_t* shape, const diopiSize_t* stride,
+                         diopiDtype_t dtype, diopiDevice_t device, diopiContextHandle_t context) {
+    resetView(storage, storageOffset, shape, stride, dtype, device, context);
+}
+
+void diopiTensor::resetView(const std::shared_ptr<Storage>& storage, int64_t storageOffset, const diopiSize_t* shape, const diopiSize_t* stride,
+                            diopiDtype_t dtype, diopiDevice_t device, diopiContextHandle_t context) {
+    assert(shape);
+
+    dtype_ = dtype;
+    device_ = device;
+    storage_ = storage;
+    storageOffset_ = storageOffset;
+    context_ = context;
+    shape_.assign(shape->data, shape->data + shape->len);
+    stride_.resize(shape->len);
+    int64_t strideTemp = 1;
+    numel_ = 1;
+    for (int64_t i = shape->len - 1; i >= 0; --i) {
+        numel_ *= shape->data[i];
+        if (stride != nullptr && stride->data != nullptr) {
+            stride_[i] = stride->data[i];
+        } else {
+            stride_[i] = strideTemp;
+            strideTemp *= shape->data[i];
+        }
+    }
+    setWindow(storageOffset_ * elemSize(), storageOffset_ * elemSize() + nbytes());
+}
+
+int64_t diopiTensor::nbytes() const {
+    if (numel_ == 0) {
+        return 0;
+    }
+    int64_t strideNumel = 1;
+    for (size_t i = 0; i < shape_.size(); ++i) {
+        strideNumel += (shape_[i] - 1) * stride_[i];
+    }
+    return strideNumel * elemSize();
+}
+
 diopiTensor& diopiTensor::operator=(const diopiTensor& other) {
     if (this == &other) {
         return *this;
@@ -165,11 +593,9 @@ diopiTensor& diopiTensor::operator=(const diopiTensor& other) {
     device_ = other.device_;
     numel_ = other.numel_;
     context_ = other.context_;
-    if (device_ == diopi_host) {
-        storage_ = std::make_shared<Storage>(hostMalloc, hostFree, other.nbytes());
-    } else {
-        storage_ = std::make_shared<Storage>(device_malloc, device_free, other.nbytes());
-    }
+    storageOffset_ = 0;
+    storage_ = makeStorage(device_, context_, other.nbytes());
+    setWindow(0, other.nbytes());
 
     const void* src = other.data();
     if (src == nullptr) {
@@ -182,6 +608,8 @@ diopiTensor& diopiTensor::operator=(const diopiTensor& other) {
         diopiStreamHandle_t stream;
         diopiGetStream(context_, &stream);
         device_memcpy_d2d_async(stream, data(), src, other.nbytes());
+        // the source may be released or written by the caller right after the assignment, e.g. by a generator state
+        // taken from a temporary, and the copy may be read from another context or from the host
         device_synchronize_stream(stream);
     }
     return *this;
@@ -246,17 +674,17 @@ DIOPI_RT_API diopiError_t diopiGetTensorElemSize(diopiConstTensorHandle_t th, in
 }
 
 DIOPI_RT_API diopiError_t diopiGetTensorStoragePtr(diopiConstTensorHandle_t th, void** pStoragePtr) {
-    *pStoragePtr = const_cast<void*>(th->data());
+    *pStoragePtr = th->storage() == nullptr ? nullptr : th->storage()->data();
     return diopiSuccess;
 }
 
 DIOPI_RT_API diopiError_t diopiGetTensorStorageOffset(diopiConstTensorHandle_t th, int64_t* pOffset) {
-    *pOffset = 0;
+    *pOffset = th->storageOffset();
     return diopiSuccess;
 }
 
 DIOPI_RT_API diopiError_t diopiGetTensorStorageNbytes(diopiConstTensorHandle_t th, size_t* pNbytes) {
-    *pNbytes = th->nbytes();
+    *pNbytes = th->storageNbytes();
     return diopiSuccess;
 }
 
@@ -265,11 +693,246 @@ DIOPI_RT_API diopiError_t diopiGetTensorDeviceIndex(diopiConstTensorHandle_t th,
     return diopiSuccess;
 }
 
+DIOPI_RT_API diopiError_t diopiGetTensorMeta(diopiConstTensorHandle_t th, diopiTensorMeta_t* meta) {
+    meta->shape = th->shape();
+    meta->stride = th->stride();
+    meta->dtype = th->dtype();
+    meta->device = th->device();
+    meta->storage_offset = th->storageOffset();
+    meta->itemsize = th->elemSize();
+    meta->numel = th->numel();
+    return diopiSuccess;
+}
+
 diopiError_t diopiGetStream(diopiContextHandle_t ctx, diopiStreamHandle_t* stream) {
     *stream = ctx->getStreamHandle();
     return diopiSuccess;
 }
 
+DIOPI_RT_API diopiError_t diopiGetStreamFromPool(diopiContextHandle_t ctx, diopiStreamHandle_t* stream) {
+    *stream = ctx->getStreamFromPool();
+    return diopiSuccess;
+}
+
+DIOPI_RT_API diopiError_t diopiEventCreate(diopiContextHandle_t ctx, diopiEventHandle_t* event) {
+    return diopiEventCreateWithFlags(ctx, event, diopiEventDefault);
+}
+
+DIOPI_RT_API diopiError_t diopiEventCreateWithFlags(diopiContextHandle_t ctx, diopiEventHandle_t* event, diopiEventFlags_t flags) {
+    *event = ctx->createEvent(flags);
+    return diopiSuccess;
+}
+
+DIOPI_RT_API diopiError_t diopiEventDestroy(diopiContextHandle_t ctx, diopiEventHandle_t event) {
+    if (!ctx->destroyEvent(static_cast<RuntimeEvent*>(event))) {
+        diopi_err("diopiEventDestroy: the event was not created from this context\n");
+        return diopiErrorOccurred;
+    }
+    return diopiSuccess;
+}
+
+DIOPI_RT_API diopiError_t diopiEventRecord(diopiEventHandle_t event, diopiStreamHandle_t stream) {
+    return static_cast<RuntimeEvent*>(event)->record(stream);
+}
+
+DIOPI_RT_API diopiError_t diopiStreamWaitEvent(diopiStreamHandle_t stream, diopiEventHandle_t event) {
+    return static_cast<const RuntimeEvent*>(event)->block(stream);
+}
+
+DIOPI_RT_API diopiError_t diopiEventQuery(diopiEventHandle_t event, int32_t* isCompleted) {
+    return static_cast<const RuntimeEvent*>(event)->query(isCompleted);
+}
+
+DIOPI_RT_API diopiError_t diopiEventSynchronize(diopiEventHandle_t event) { return static_cast<const RuntimeEvent*>(event)->synchronize(); }
+
+DIOPI_RT_API diopiError_t diopiEventElapsedTime(diopiEventHandle_t start, diopiEventHandle_t end, float* ms) {
+    return static_cast<const RuntimeEvent*>(end)->elapsedSince(*static_cast<const RuntimeEvent*>(start), ms);
+}
+
+// Span recorder behind diopiRecordStart/diopiRecordEnd, switched on by the same DIOPI_RECORD_ENV the backends check.
+// Every thread appends to its own ring buffer without locking and publishes a finished span by a release store of the
+// span counter. The trace goes to DIOPIRT_PROFILE_FILE (diopirt_trace.json by default) when the runtime is finalized;
+// threads still recording by then may overwrite the oldest spans of a full ring while they are dumped.
+struct ProfileSpan {
+    const char* name;
+    int64_t startNs;
+    int64_t durNs;
+    int64_t selfNs;
+    int64_t bytes;
+    int32_t depth;
+};
+
+struct ProfileBuffer {
+    struct OpenSpan {
+        const char* name;
+        int64_t startNs;
+        int64_t childNs;
+        int64_t startBytes;
+    };
+
+    ProfileBuffer(int32_t tid, size_t capacity) : tid(tid), spans(capacity) {}
+
+    // the name of a span as it stays valid until the dump
+    const char* intern(const char* recordName);
+
+    int32_t tid;
+    std::vector<ProfileSpan> spans;
+    // total number of spans ever recorded, the ring keeps the last spans.size() of them
+    std::atomic<uint64_t> recorded{0};
+    // the members below are only touched by the owning thread
+    std::vector<OpenSpan> open;
+    std::unordered_map<const char*, const char*> namesByPtr;
+    std::unordered_set<std::string> names;
+    // bytes requested through diopiRequireTensor on this thread
+    std::atomic<int64_t> requestedBytes{0};
+};
+
+// Names are mostly string literals, so the caller's pointer finds the interned copy without hashing the text. A stack
+// buffer (camb's DIOPI_RECORD_START) reuses one address for many names, the strcmp catches that and re-points the slot.
+const char* ProfileBuffer::intern(const char* recordName) {
+    const char*& name = namesByPtr[recordName];
+    if (name == nullptr || strcmp(name, recordName) != 0) {
+        name = names.emplace(recordName).first->c_str();
+    }
+    return name;
+}
+
+class Profiler final {
+public:
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    bool enabled() const { return enabled_; }
+
+    ProfileBuffer& threadBuffer() {
+        thread_local std::shared_ptr<ProfileBuffer> buffer;
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffer = std::make_shared<ProfileBuffer>(static_cast<int32_t>(buffers_.size()), capacity_);
+            buffers_.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    void dump();
+
+private:
+    Profiler() {
+        const char* env = std::getenv("DIOPI_RECORD_ENV");
+        enabled_ = env != nullptr && strcmp(env, "0") != 0 && strcmp(env, "OFF") != 0 && strcmp(env, "off") != 0;
+        const char* path = std::getenv("DIOPIRT_PROFILE_FILE");
+        path_ = path != nullptr ? path : "diopirt_trace.json";
+        const char* capacity = std::getenv("DIOPIRT_PROFILE_CAPACITY");
+        capacity_ = capacity != nullptr && atoll(capacity) > 0 ? static_cast<size_t>(atoll(capacity)) : (1 << 16);
+    }
+
+    bool enabled_;
+    std::string path_;
+    size_t capacity_;
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<ProfileBuffer>> buffers_;
+};
+
+static void writeJsonString(FILE* fp, const char* str) {
+    fputc('"', fp);
+    for (; *str != '\0'; ++str) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', fp);
+        }
+        if (static_cast<unsigned char>(*str) >= 0x20) {
+            fputc(*str, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+void Profiler::dump() {
+    struct OpStat {
+        int64_t calls = 0;
+        int64_t totalNs = 0;
+        int64_t selfNs = 0;
+        int64_t maxNs = 0;
+        int64_t bytes = 0;
+    };
+    std::map<std::string, OpStat> stats;
+    uint64_t dropped = 0;
+
+    FILE* fp = fopen(path_.c_str(), "w");
+    if (fp == nullptr) {
+        fprintf(stderr, PRINT_RED "diopirt profiler: failed to open %s\n" PRINT_COLOR_NONE, path_.c_str());
+    } else {
+        fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    }
+    bool first = true;
+    std::lock_guard<std::mutex> registryLock(mutex_);
+    for (auto& buffer : buffers_) {
+        const size_t capacity = buffer->spans.size();
+        const uint64_t recorded = buffer->recorded.load(std::memory_order_acquire);
+        const uint64_t count = recorded < capacity ? recorded : capacity;
+        dropped += recorded - count;
+        for (uint64_t i = recorded - count; i < recorded; ++i) {
+            const ProfileSpan& span = buffer->spans[i % capacity];
+            OpStat& stat = stats[span.name];
+            stat.calls += 1;
+            stat.totalNs += span.durNs;
+            stat.selfNs += span.selfNs;
+            stat.maxNs = std::max(stat.maxNs, span.durNs);
+            stat.bytes += span.bytes;
+            if (fp == nullptr) {
+                continue;
+            }
+            fprintf(fp, "%s\n{\"name\":", first ? "" : ",");
+            writeJsonString(fp, span.name);
+            fprintf(fp,
+                    ",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%d,\"bytes\":%" PRId64 "}}",
+                    buffer->tid,
+                    span.startNs / 1e3,
+                    span.durNs / 1e3,
+                    span.depth,
+                    span.bytes);
+            first = false;
+        }
+    }
+    if (fp != nullptr) {
+        fprintf(fp, "\n]}\n");
+        fclose(fp);
+    }
+    if (stats.empty()) {
+        return;
+    }
+
+    std::vector<std::pair<std::string, OpStat>> rows(stats.begin(), stats.end());
+    std::sort(rows.begin(), rows.end(), [](const std::pair<std::string, OpStat>& a, const std::pair<std::string, OpStat>& b) {
+        return a.second.selfNs > b.second.selfNs;
+    });
+    fprintf(stdout, "%-48s %10s %14s %14s %12s %12s %14s\n", "name", "calls", "total(ms)", "self(ms)", "avg(us)", "max(us)", "bytes");
+    for (const auto& row : rows) {
+        const OpStat& stat = row.second;
+        fprintf(stdout,
+                "%-48s %10" PRId64 " %14.3f %14.3f %12.3f %12.3f %14" PRId64 "\n",
+                row.first.c_str(),
+                stat.calls,
+                stat.totalNs / 1e6,
+                stat.selfNs / 1e6,
+                stat.totalNs / 1e3 / stat.calls,
+                stat.maxNs / 1e3,
+                stat.bytes);
+    }
+    if (dropped > 0) {
+        fprintf(stdout, "%" PRIu64 " older spans were dropped, raise DIOPIRT_PROFILE_CAPACITY to keep them\n", dropped);
+    }
+    fprintf(stdout, "trace written to %s\n", path_.c_str());
+}
+
+static void profileRequestedBytes(int64_t nbytes) {
+    Profiler& profiler = Profiler::instance();
+    if (profiler.enabled()) {
+        profiler.threadBuffer().requestedBytes.fetch_add(nbytes, std::memory_order_relaxed);
+    }
+}
+
 DIOPI_RT_API diopiError_t diopiRequireTensor(diopiContextHandle_t ctx, diopiTensorHandle_t* tensor, const diopiSize_t* size, const diopiSize_t* stride,
                                              const diopiDtype_t dtype, const diopiDevice_t dev) {
     diopi_log("requires a Tensor, size:[%16p, %" PRId64 "], stride:%16p, dtype:%d[%s], device:%d[%s]",
@@ -281,16 +944,120 @@ DIOPI_RT_API diopiError_t diopiRequireTensor(diopiContextHandle_t ctx, diopiTens
               dev,
               deviceToStr(dev));
     *tensor = ctx->createTensor(size, stride, dtype, dev);
+    profileRequestedBytes((*tensor)->nbytes());
 
     return diopiSuccess;
 }
 
+namespace {
+
+// a view of src must address nothing but the elements src may reach, see diopiTensor::windowBegin
+bool viewFitsSource(diopiConstTensorHandle_t src, const diopiSize_t* size, const diopiSize_t* stride, int64_t storageOffset) {
+    if (src == nullptr || src->storage() == nullptr || storageOffset < 0) {
+        return false;
+    }
+    int64_t lastElem = storageOffset;
+    int64_t contiguousStride = 1;
+    bool empty = false;
+    for (int64_t i = size->len - 1; i >= 0; --i) {
+        int64_t st = stride != nullptr && stride->data != nullptr ? stride->data[i] : contiguousStride;
+        if (st < 0) {
+            return false;
+        }
+        empty = empty || size->data[i] == 0;
+        lastElem += (size->data[i] - 1) * st;
+        contiguousStride *= size->data[i];
+    }
+    // an empty view addresses nothing, it only has to start within the window
+    const int64_t begin = storageOffset * src->elemSize();
+    const int64_t end = empty ? begin : (lastElem + 1) * src->elemSize();
+    if (begin < src->windowBegin() || end > src->windowEnd()) {
+        diopi_err("diopiRequireTensorView/diopiTensorResetView: the view exceeds the elements of the source tensor\n");
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+DIOPI_RT_API diopiError_t diopiRequireTensorView(diopiContextHandle_t ctx, diopiTensorHandle_t* tensor, diopiConstTensorHandle_t src, const diopiSize_t* size,
+                                                 const diopiSize_t* stride, int64_t storageOffset) {
+    // a zero-dim view may come without shape data, see diopiTensor::shape
+    if (tensor == nullptr || size == nullptr || (size->data == nullptr && size->len > 0)) {
+        return diopiErrorOccurred;
+    }
+    diopi_log("requires a view, src:%16p, size:[%16p, %" PRId64 "], stride:%16p, offset:%" PRId64, src, size->data, size->len, stride, storageOffset);
+    if (!viewFitsSource(src, size, stride, storageOffset)) {
+        return diopiErrorOccurred;
+    }
+    *tensor = ctx->createTensorView(src, size, stride, storageOffset);
+    return diopiSuccess;
+}
+
+DIOPI_RT_API diopiError_t diopiTensorResetView(diopiTensorHandle_t tensor, const diopiSize_t* size, const diopiSize_t* stride, int64_t storageOffset) {
+    if (size == nullptr || (size->data == nullptr && size->len > 0)) {
+        return diopiErrorOccurred;
+    }
+    diopi_log("resets a view, tensor:%16p, size:[%16p, %" PRId64 "], stride:%16p, offset:%" PRId64, tensor, size->data, size->len, stride, storageOffset);
+    if (!viewFitsSource(tensor, size, stride, storageOffset)) {
+        return diopiErrorOccurred;
+    }
+    // the view keeps the window of the tensor it was made from, so it can move to any tile of it
+    const int64_t windowBegin = tensor->windowBegin();
+    const int64_t windowEnd = tensor->windowEnd();
+    tensor->resetView(tensor->storage(), storageOffset, size, stride, tensor->dtype(), tensor->device(), tensor->getCtx());
+    tensor->setWindow(windowBegin, windowEnd);
+    return diopiSuccess;
+}
+
+DIOPI_RT_API diopiError_t diopiTensorAdoptLayout(diopiTensorHandle_t dst, diopiConstTensorHandle_t src) {
+    diopi_log("adopts the layout, dst:%16p, src:%16p", dst, src);
+    if (dst == nullptr || src == nullptr || src->storage() == nullptr || dst->dtype() != src->dtype() || dst->device() != src->device()) {
+        return diopiErrorOccurred;
+    }
+    diopiSize_t dstShape = dst->shape();
+    diopiSize_t srcShape = src->shape();
+    if (dstShape.len != srcShape.len || !std::equal(dstShape.data, dstShape.data + dstShape.len, srcShape.data)) {
+        return diopiErrorOccurred;
+    }
+    // other owners of either storage would observe the swap, e.g. the base of a view, the other tensors of an arena chunk or
+    // a numpy array exported from the tensor, which holds a reference to the storage for as long as it lives
+    if (src->storage().use_count() != 1 || (dst->storage() != nullptr && dst->storage().use_count() != 1)) {
+        return diopiErrorOccurred;
+    }
+    diopiSize_t stride = src->stride();
+    dst->resetView(src->storage(), src->storageOffset(), &srcShape, &stride, src->dtype(), src->device(), dst->getCtx());
+    dst->setWindow(src->windowBegin(), src->windowEnd());
+    return diopiSuccess;
+}
+
 DIOPI_RT_API diopiError_t diopiRequireBuffer(diopiContextHandle_t ctx, diopiTensorHandle_t* tensor, int64_t bytes, diopiDevice_t dev) {
     diopi_log("requires a buffer, bytes: %" PRId64 ", device: %s", bytes, deviceToStr(dev));
     diopiSize_t size{&bytes, 1};
     return diopiRequireTensor(ctx, tensor, &size, nullptr, diopi_dtype_int8, dev);
 }
 
+DIOPI_RT_API diopiError_t diopiEmptyCache() {
+    hostAllocator().emptyCache();
+    pinnedHostAllocator().emptyCache();
+    deviceAllocator().emptyCache();
+    return diopiSuccess;
+}
+
+DIOPI_RT_API diopiError_t diopiGetMemoryStats(diopiContextHandle_t ctx, diopiDevice_t device, diopiMemoryStats_t* stats) {
+    *stats = device == diopi_host ? hostAllocator().stats() : deviceAllocator().stats();
+    return diopiSuccess;
+}
+
+DIOPI_RT_API diopiError_t diopiResetPeakMemoryStats(diopiContextHandle_t ctx, diopiDevice_t device) {
+    if (device == diopi_host) {
+        hostAllocator().resetPeakStats();
+    } else {
+        deviceAllocator().resetPeakStats();
+    }
+    return diopiSuccess;
+}
+
 DIOPI_RT_API diopiError_t diopiInit() {
     static int32_t inited = 0;
     if (inited) {
@@ -313,34 +1080,85 @@ DIOPI_RT_API diopiError_t diopiFinalize() {
         return diopiSuccess;
     }
     finalized = 1;
+    if (Profiler::instance().enabled()) {
+        Profiler::instance().dump();
+    }
 
     return diopiSuccess;
 }
 
-DIOPI_RT_API diopiError_t diopiTensorCopyFromBuffer(diopiContextHandle_t ctx, const void* src, diopiTensorHandle_t tensor) {
+static void enqueueCopyFromBuffer(diopiStreamHandle_t stream, const void* src, diopiTensorHandle_t tensor) {
     if (tensor->device() == diopi_device) {
-        diopiStreamHandle_t stream;
-        diopiGetStream(ctx, &stream);
         device_memcpy_h2d_async(stream, tensor->data(), src, tensor->nbytes());
-        device_synchronize_stream(stream);
     } else {
         std::memcpy(tensor->data(), src, tensor->nbytes());
     }
-    return diopiSuccess;
 }
 
-DIOPI_RT_API diopiError_t diopiTensorCopyToBuffer(diopiContextHandle_t ctx, diopiConstTensorHandle_t tensor, void* dst) {
+static void enqueueCopyToBuffer(diopiStreamHandle_t stream, diopiConstTensorHandle_t tensor, void* dst) {
     if (tensor->device() == diopi_device) {
-        diopiStreamHandle_t stream;
-        diopiGetStream(ctx, &stream);
         device_memcpy_d2h_async(stream, dst, tensor->data(), tensor->nbytes());
-        device_synchronize_stream(stream);
     } else {
         std::memcpy(dst, tensor->data(), tensor->nbytes());
     }
+}
+
+static diopiError_t recordCopyEvent(diopiStreamHandle_t stream, diopiEventHandle_t event) {
+    return event == nullptr ? diopiSuccess : static_cast<RuntimeEvent*>(event)->record(stream);
+}
+
+DIOPI_RT_API diopiError_t diopiTensorCopyFromBuffer(diopiContextHandle_t ctx, const void* src, diopiTensorHandle_t tensor) {
+    diopiStreamHandle_t stream;
+    diopiGetStream(ctx, &stream);
+    enqueueCopyFromBuffer(stream, src, tensor);
+    if (tensor->device() == diopi_device) {
+        device_synchronize_stream(stream);
+    }
     return diopiSuccess;
 }
 
+DIOPI_RT_API diopiError_t diopiTensorCopyToBuffer(diopiContextHandle_t ctx, diopiConstTensorHandle_t tensor, void* dst) {
+    diopiStreamHandle_t stream;
+    diopiGetStream(ctx, &stream);
+    enqueueCopyToBuffer(stream, tensor, dst);
+    if (tensor->device() == diopi_device) {
+        device_synchronize_stream(stream);
+    }
+    return diopiSuccess;
+}
+
+DIOPI_RT_API diopiError_t diopiTensorCopyFromBufferAsync(diopiContextHandle_t ctx, const void* src, diopiTensorHandle_t tensor, diopiStreamHandle_t stream,
+                                                         diopiEventHandle_t event) {
+    return diopiTensorsCopyFromBuffersAsync(ctx, &src, &tensor, 1, stream, event);
+}
+
+DIOPI_RT_API diopiError_t diopiTensorCopyToBufferAsync(diopiContextHandle_t ctx, diopiConstTensorHandle_t tensor, void* dst, diopiStreamHandle_t stream,
+                                                       diopiEventHandle_t event) {
+    return diopiTensorsCopyToBuffersAsync(ctx, &tensor, &dst, 1, stream, event);
+}
+
+DIOPI_RT_API diopiError_t diopiTensorsCopyFromBuffersAsync(diopiContextHandle_t ctx, const void* const* srcs, const diopiTensorHandle_t* tensors, int64_t num,
+                                                           diopiStreamHandle_t stream, diopiEventHandle_t event) {
+    if (stream == nullptr) {
+        diopiGetStream(ctx, &stream);
+    }
+    for (int64_t i = 0; i < num; ++i) {
+        enqueueCopyFromBuffer(stream, srcs[i], tensors[i]);
+    }
+    return recordCopyEvent(stream, event);
+}
+
+DIOPI_RT_API diopiError_t diopiTensorsCopyToBuffersAsync(diopiContextHandle_t ctx, const diopiConstTensorHandle_t* tensors, void* const* dsts, int64_t num,
+                                                         diopiStreamHandle_t stream, diopiEventHandle_t event) {
+    if (stream == nullptr) {
+        diopiGetStream(ctx, &stream);
+    }
+    for (int64_t i = 0; i < num; ++i) {
+        enqueueCopyToBuffer(stream, tensors[i], dsts[i]);
+    }
+    return recordCopyEvent(stream, event);
+}
+
 DIOPI_RT_API diopiError_t diopiGeneratorGetState(diopiContextHandle_t ctx, diopiConstGeneratorHandle_t th, diopiTensorHandle_t* data) {
     const diopiTensor& state = th->state();
     diopiDtype_t dtype;
@@ -363,8 +1181,50 @@ DIOPI_RT_API diopiError_t diopiGeneratorSetState(diopiGeneratorHandle_t th, diop
     return diopiSuccess;
 }
 
-DIOPI_RT_API diopiError_t diopiRecordStart(const char* recordName, void** record) { return diopiSuccess; }
+DIOPI_RT_API diopiError_t diopiRecordStart(const char* recordName, void** record) {
+    Profiler& profiler = Profiler::instance();
+    if (!profiler.enabled() || recordName == nullptr) {
+        return diopiSuccess;
+    }
+    ProfileBuffer& buffer = profiler.threadBuffer();
+    const char* name = buffer.intern(recordName);
+    buffer.open.push_back(ProfileBuffer::OpenSpan{name, hostNowNs(), 0, buffer.requestedBytes.load(std::memory_order_relaxed)});
+    if (record != nullptr) {
+        // remember the nesting level so that an unbalanced diopiRecordEnd can be detected
+        *record = reinterpret_cast<void*>(buffer.open.size());
+    }
+    return diopiSuccess;
+}
 
-DIOPI_RT_API diopiError_t diopiRecordEnd(void** record) { return diopiSuccess; }
+DIOPI_RT_API diopiError_t diopiRecordEnd(void** record) {
+    Profiler& profiler = Profiler::instance();
+    if (!profiler.enabled()) {
+        return diopiSuccess;
+    }
+    const int64_t endNs = hostNowNs();
+    ProfileBuffer& buffer = profiler.threadBuffer();
+    if (buffer.open.empty() || (record != nullptr && *record != nullptr && reinterpret_cast<size_t>(*record) != buffer.open.size())) {
+        diopi_err("diopiRecordEnd: does not match the innermost diopiRecordStart\n");
+        return diopiErrorOccurred;
+    }
+    const ProfileBuffer::OpenSpan& open = buffer.open.back();
+    const uint64_t recorded = buffer.recorded.load(std::memory_order_relaxed);
+    ProfileSpan& span = buffer.spans[recorded % buffer.spans.size()];
+    span.name = open.name;
+    span.startNs = open.startNs;
+    span.durNs = endNs - open.startNs;
+    span.selfNs = span.durNs - open.childNs;
+    span.bytes = buffer.requestedBytes.load(std::memory_order_relaxed) - open.startBytes;
+    span.depth = static_cast<int32_t>(buffer.open.size()) - 1;
+    buffer.recorded.store(recorded + 1, std::memory_order_release);
+    buffer.open.pop_back();
+    if (!buffer.open.empty()) {
+        buffer.open.back().childNs += span.durNs;
+    }
+    if (record != nullptr) {
+        *record = nullptr;
+    }
+    return diopiSuccess;
+}
 
 }  // extern "C"
@@ -34,6 +34,26 @@ extern diopiError_t device_make_stream(diopiStreamHandle_t*);
 extern diopiError_t device_destroy_stream(diopiStreamHandle_t);
 extern diopiError_t device_synchronize_stream(diopiStreamHandle_t stream);
 
+/**
+ * optional hooks for page-locked host memory used to stage device data, malloc/free are used if they are not provided
+ **/
+extern DIOPI_ATTR_WEEK void* device_malloc_host(uint64_t bytes);
+extern DIOPI_ATTR_WEEK void device_free_host(void* ptr);
+
+/**
+ * optional hooks for device events, all of them have to be provided. Without them events are emulated on the host:
+ * recording a timed event synchronizes the stream and takes a host timestamp, recording one created with
+ * diopiEventDisableTiming only remembers the stream, which is synchronized once the event is waited for or queried.
+ * device_make_event gets the flags of diopiEventCreateWithFlags, so that untimed events can skip the timestamps on the device.
+ **/
+extern DIOPI_ATTR_WEEK diopiError_t device_make_event(void** event, diopiEventFlags_t flags);
+extern DIOPI_ATTR_WEEK diopiError_t device_destroy_event(void* event);
+extern DIOPI_ATTR_WEEK diopiError_t device_record_event(void* event, diopiStreamHandle_t stream);
+extern DIOPI_ATTR_WEEK diopiError_t device_stream_wait_event(diopiStreamHandle_t stream, void* event);
+extern DIOPI_ATTR_WEEK diopiError_t device_query_event(void* event, int32_t* is_completed);
+extern DIOPI_ATTR_WEEK diopiError_t device_synchronize_event(void* event);
+extern DIOPI_ATTR_WEEK diopiError_t device_event_elapsed_time(void* start, void* end, float* ms);
+
 /**
  * User-implemented functions
  **/
@@ -16,9 +16,15 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace py = pybind11;
@@ -41,6 +47,74 @@ private:
 extern "C" {
 
 int32_t itemsize(const diopiDtype_t dtype);
+
+/**
+ * A size-class caching allocator placed in front of the raw malloc/free hooks.
+ * Freed blocks are kept in free lists keyed by (stream, size class) and are only handed out again to
+ * requests on the same stream, so reuse is always ordered after the work that was queued on the block.
+ * A tensor used on another stream than the one it was allocated on must be synchronized by the caller.
+ * Set the environment variable DIOPIRT_CACHING_ALLOCATOR=0 to forward every call to the raw hooks.
+ */
+class CachingAllocator final {
+public:
+    CachingAllocator(malloc_func_t rawMalloc, free_func_t rawFree, bool streamAware);
+    CachingAllocator(const CachingAllocator&) = delete;
+    CachingAllocator& operator=(const CachingAllocator&) = delete;
+    // cached blocks are deliberately not released here, the device may already be finalized at exit
+    ~CachingAllocator() = default;
+
+    void* allocate(uint64_t bytes);
+    void deallocate(void* ptr);
+    // release every cached block back to the raw allocator
+    void emptyCache();
+    // synchronize a stream that is about to be destroyed and drop the blocks cached for it
+    void releaseStream(diopiStreamHandle_t stream);
+
+    static uint64_t roundSize(uint64_t bytes);
+
+    diopiMemoryStats_t stats();
+    // the peaks restart from the current values, the allocation counts keep accumulating
+    void resetPeakStats();
+
+    // the stream that allocations issued by the current thread will be bound to
+    class StreamGuard final {
+    public:
+        explicit StreamGuard(diopiStreamHandle_t stream);
+        ~StreamGuard();
+
+    private:
+        diopiStreamHandle_t prevStream_;
+    };
+
+private:
+    struct Block {
+        uint64_t size;
+        uint64_t requested;
+        diopiStreamHandle_t stream;
+        bool retired;
+    };
+    using FreeListKey = std::pair<diopiStreamHandle_t, uint64_t>;
+
+    void releaseCachedBlocks(diopiStreamHandle_t stream, bool allStreams);
+    void onAllocate(const Block& block, bool fromDevice);
+    void onDeallocate(const Block& block, bool toCache);
+
+    malloc_func_t rawMalloc_;
+    free_func_t rawFree_;
+    bool streamAware_;
+    bool enabled_;
+    std::mutex mutex_;
+    std::unordered_map<void*, Block> blocks_;
+    std::map<FreeListKey, std::vector<void*>> freeBlocks_;
+    diopiMemoryStats_t stats_{};
+};
+
+CachingAllocator& hostAllocator();
+CachingAllocator& deviceAllocator();
+CachingAllocator& pinnedHostAllocator();
+void* pinnedHostCachedMalloc(uint64_t bytes);
+void pinnedHostCachedFree(void* ptr);
+
 class Storage final {
 private:
     malloc_func_t mallocFn_;
@@ -74,13 +148,24 @@ private:
     diopiDevice_t device_;
     int64_t numel_;
     std::shared_ptr<Storage> storage_ = nullptr;
+    // offset of the first element in the storage, counted in elements of dtype_
+    int64_t storageOffset_ = 0;
+    // the bytes of the storage views of this tensor may address, [windowBegin_, windowEnd_)
+    int64_t windowBegin_ = 0;
+    int64_t windowEnd_ = 0;
     diopiContextHandle_t context_;
 
 public:
     diopiTensor(const diopiSize_t* shape, const diopiSize_t* stride, diopiDtype_t dtype, diopiDevice_t device, diopiContextHandle_t context, const void* src);
+    // a view sharing the storage of an existing tensor
+    diopiTensor(const std::shared_ptr<Storage>& storage, int64_t storageOffset, const diopiSize_t* shape, const diopiSize_t* stride, diopiDtype_t dtype,
+                diopiDevice_t device, diopiContextHandle_t context);
     diopiTensor() {}
     ~diopiTensor() {}
     diopiTensor& operator=(const diopiTensor& other);
+    // re-initialize this object in place as a view, reusing the capacity of the shape and stride vectors
+    void resetView(const std::shared_ptr<Storage>& storage, int64_t storageOffset, const diopiSize_t* shape, const diopiSize_t* stride, diopiDtype_t dtype,
+                   diopiDevice_t device, diopiContextHandle_t context);
 
     diopiSize_t shape() const {
         diopiSize_t size{shape_.data(), static_cast<int64_t>(shape_.size())};
@@ -99,39 +184,22 @@ public:
     int64_t numel() const { return numel_; }
     int64_t elemSize() const { return itemsize(this->dtype()); }
 
-    void* data() { return storage_->data(); }
-    const void* data() const { return storage_->data(); }
-    int64_t nbytes() const { return storage_->nbytes(); }
-    py::buffer_info buffer() const {
-        if (storage_ == nullptr) {
-            return py::buffer_info();
-        }
-        try {
-            diopiStreamHandle_t stream;
-            auto ptr = malloc(nbytes());
-            diopiGetStream(getCtx(), &stream);
-            device_memcpy_d2h_async(stream, ptr, data(), nbytes());
-            device_synchronize_stream(stream);
-            ssize_t esize = elemSize();
-            std::vector<ssize_t> buffer_shape;
-            std::vector<ssize_t> buffer_strides;
-            for (int64_t i = 0; i < shape().len; ++i) {
-                buffer_shape.push_back(shape().data[i]);
-                buffer_strides.push_back(stride().data[i] * esize);
-            }
-            static const char fmt[] = "bBhHiIlLefd?";
-            auto temp = reinterpret_cast<double*>(ptr);
-            return py::buffer_info(ptr,                                               /* Pointer to buffer */
-                                   esize,                                             /* Size of one scalar */
-                                   std::string(1, fmt[static_cast<size_t>(dtype())]), /* Python struct format descriptor */
-                                   shape().len,                                       /* Number of dimensions */
-                                   buffer_shape,                                      /* Buffer dimensions */
-                                   buffer_strides                                     /* Strides (in bytes) for each index */
-            );                                                                        // NOLINT
-        } catch (const std::exception& e) {
-            // XXX(xintian): return an invalid buffer to raise an exception.
-            return py::buffer_info((char*){0}, -1);
-        }
+    void* data() { return storage_ == nullptr ? nullptr : static_cast<char*>(storage_->data()) + storageOffset_ * elemSize(); }
+    const void* data() const { return storage_ == nullptr ? nullptr : static_cast<const char*>(storage_->data()) + storageOffset_ * elemSize(); }
+    // bytes spanned by the elements of this tensor, starting at data()
+    int64_t nbytes() const;
+
+    const std::shared_ptr<Storage>& storage() const { return storage_; }
+    int64_t storageOffset() const { return storageOffset_; }
+    int64_t storageNbytes() const { return storage_ == nullptr ? 0 : storage_->nbytes(); }
+
+    // a tensor may address its own elements, a view the elements of the tensor it was made from, not the rest of a
+    // storage shared with others, e.g. an arena chunk
+    int64_t windowBegin() const { return windowBegin_; }
+    int64_t windowEnd() const { return windowEnd_; }
+    void setWindow(int64_t begin, int64_t end) {
+        windowBegin_ = begin;
+        windowEnd_ = end;
     }
 
     diopiContextHandle_t getCtx() const { return context_; }
@@ -151,59 +219,240 @@ public:
     void set_state(diopiConstTensorHandle_t new_state) { state_ = *new_state; }
 };
 
+// An event marks a point in the work queued on a stream. Without the vendor event hooks it is emulated on the host:
+// recording a timed event synchronizes the stream and takes a host timestamp, so that diopiEventElapsedTime measures
+// completed work rather than the time it was enqueued. Recording an event created with diopiEventDisableTiming only
+// remembers the stream, which is synchronized once the event is waited for, queried, or blocks another stream.
+// The emulated state is guarded by a lock, so one event may be waited for from several threads.
+class RuntimeEvent final {
+public:
+    explicit RuntimeEvent(diopiEventFlags_t flags);
+    ~RuntimeEvent();
+    RuntimeEvent(const RuntimeEvent&) = delete;
+    RuntimeEvent& operator=(const RuntimeEvent&) = delete;
+
+    diopiError_t record(diopiStreamHandle_t stream);
+    diopiError_t block(diopiStreamHandle_t stream) const;
+    diopiError_t query(int32_t* completed) const;
+    diopiError_t synchronize() const;
+    // milliseconds from start to this event
+    diopiError_t elapsedSince(const RuntimeEvent& start, float* ms) const;
+
+private:
+    // synchronizes the stream an emulated event was recorded on, once
+    diopiError_t complete() const;
+
+    const bool timing_;
+    void* deviceEvent_ = nullptr;
+    mutable std::mutex mutex_;
+    diopiStreamHandle_t stream_ = nullptr;
+    int64_t hostTimeNs_ = 0;
+    bool recorded_ = false;
+    mutable bool pending_ = false;
+};
+
+// Bump region the temporaries of an arena-mode context are carved from. Chunks come from the caching allocator
+// and are only rewound by reset(), never returned, so a steady-state op cycle does no allocation at all.
+class ContextArena final {
+public:
+    static constexpr int64_t kAlignment = 256;
+    static constexpr int64_t kMinChunkSize = 4 << 20;
+
+    explicit ContextArena(diopiDevice_t device) : device_(device) {}
+
+    // returns the chunk holding the region and sets *offset to its byte offset in the chunk
+    std::shared_ptr<Storage> allocate(diopiContextHandle_t context, int64_t nbytes, int64_t* offset);
+    void reset();
+
+private:
+    struct Chunk {
+        std::shared_ptr<Storage> storage;
+        int64_t used;
+    };
+
+    diopiDevice_t device_;
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;
+};
+
+// A context may be shared by threads running ops concurrently: the stream is created once, tensors are registered
+// in sharded sets and the arenas, the stream pool and the events are guarded by their own locks. clearTensors() and
+// the destructor must not race with ops still using the context.
+// For independent ops run from a thread pool, each worker should own a child context from makeChild(): it has its own
+// stream, so the ops do not serialize on one queue, while all contexts draw from the same process-wide caching allocator.
 struct diopiContext {
 private:
+    struct TensorShard {
+        std::mutex mutex;
+        std::set<diopiTensorHandle_t> tensors;
+    };
+    static constexpr size_t kTensorShards = 8;
+
     diopiStreamHandle_t stream_{nullptr};
-    std::set<diopiTensorHandle_t> setTensors_;
+    std::once_flag streamOnce_;
+    TensorShard shards_[kTensorShards];
+    // arena mode: tensors are slab entries viewing the arenas, released all at once by clearTensors()
+    bool arenaMode_ = false;
+    std::mutex arenaMutex_;
+    std::deque<diopiTensor> slab_;
+    size_t slabUsed_ = 0;
+    ContextArena hostArena_{diopi_host};
+    ContextArena deviceArena_{diopi_device};
+    // auxiliary streams handed out round-robin by diopiGetStreamFromPool
+    static constexpr size_t kStreamPoolSize = 4;
+    std::mutex auxMutex_;
+    std::vector<diopiStreamHandle_t> streamPool_;
+    size_t nextPoolStream_ = 0;
+    std::set<RuntimeEvent*> events_;
+
+    TensorShard& shardOf(diopiConstTensorHandle_t tensor) { return shards_[(reinterpret_cast<uintptr_t>(tensor) >> 4) % kTensorShards]; }
+
+    diopiTensorHandle_t registerTensor(diopiTensorHandle_t tensor) {
+        TensorShard& shard = shardOf(tensor);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.tensors.insert(tensor);
+        return tensor;
+    }
+
+    diopiTensorHandle_t createArenaTensor(const diopiSize_t* size, const diopiSize_t* stride, const diopiDtype_t dtype, const diopiDevice_t dev);
 
 public:
-    diopiContext() = default;
+    // the arena mode defaults to DIOPIRT_CONTEXT_ARENA=1/ON
+    diopiContext();
+    explicit diopiContext(bool arenaMode) : arenaMode_(arenaMode) {}
+    diopiContext(const diopiContext&) = delete;
+    diopiContext& operator=(const diopiContext&) = delete;
 
     ~diopiContext() {
+        for (auto event : events_) {
+            delete event;
+        }
+        events_.clear();
+        for (auto stream : streamPool_) {
+            device_synchronize_stream(stream);
+            device_destroy_stream(stream);
+        }
+        streamPool_.clear();
         if (nullptr != stream_) {
+            deviceAllocator().releaseStream(stream_);
             device_destroy_stream(stream_);
         }
-        for (auto it : setTensors_) {
-            delete it;
+        for (auto& shard : shards_) {
+            for (auto it : shard.tensors) {
+                delete it;
+            }
+            shard.tensors.clear();
         }
-        setTensors_.clear();
     }
 
+    // a context with the same options and its own stream, the caller owns it
+    diopiContext* makeChild() const { return new diopiContext(arenaMode_); }
+
     diopiStreamHandle_t getStreamHandle() {
-        if (stream_ == nullptr) {
-            device_make_stream(&stream_);
-        }
+        std::call_once(streamOnce_, [this]() { device_make_stream(&stream_); });
         return stream_;
     }
 
+    diopiStreamHandle_t getStreamFromPool() {
+        std::lock_guard<std::mutex> lock(auxMutex_);
+        if (streamPool_.size() < kStreamPoolSize) {
+            diopiStreamHandle_t stream = nullptr;
+            device_make_stream(&stream);
+            streamPool_.push_back(stream);
+            return stream;
+        }
+        return streamPool_[nextPoolStream_++ % kStreamPoolSize];
+    }
+
+    RuntimeEvent* createEvent(diopiEventFlags_t flags) {
+        RuntimeEvent* event = new RuntimeEvent(flags);
+        std::lock_guard<std::mutex> lock(auxMutex_);
+        events_.insert(event);
+        return event;
+    }
+
+    bool destroyEvent(RuntimeEvent* event) {
+        {
+            std::lock_guard<std::mutex> lock(auxMutex_);
+            auto it = events_.find(event);
+            if (events_.end() == it) {
+                return false;
+            }
+            events_.erase(it);
+        }
+        delete event;
+        return true;
+    }
+
+    bool arenaMode() const { return arenaMode_; }
+
     diopiTensorHandle_t createTensor(const diopiSize_t* size, const diopiSize_t* stride, const diopiDtype_t dtype, const diopiDevice_t dev) {
-        diopiTensorHandle_t tensor = new diopiTensor(size, stride, dtype, dev, this, nullptr);
-        setTensors_.insert(tensor);
-        return tensor;
+        if (arenaMode_) {
+            return createArenaTensor(size, stride, dtype, dev);
+        }
+        return registerTensor(new diopiTensor(size, stride, dtype, dev, this, nullptr));
+    }
+
+    diopiTensorHandle_t createTensorView(diopiConstTensorHandle_t src, const diopiSize_t* size, const diopiSize_t* stride, int64_t storageOffset) {
+        diopiTensorHandle_t view = new diopiTensor(src->storage(), storageOffset, size, stride, src->dtype(), src->device(), this);
+        view->setWindow(src->windowBegin(), src->windowEnd());
+        return registerTensor(view);
     }
 
+    // arena tensors are not tracked individually and stay alive until clearTensors()
     void destroyTensor(diopiTensorHandle_t tensor) {
-        auto it = setTensors_.find(tensor);
-        if (setTensors_.end() != it) {
-            setTensors_.erase(it);
-            delete tensor;
+        TensorShard& shard = shardOf(tensor);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.tensors.find(tensor);
+            if (shard.tensors.end() == it) {
+                return;
+            }
+            shard.tensors.erase(it);
         }
+        delete tensor;
+    }
+
+    // the tensors and views required since the last clearTensors()
+    size_t numTensors() {
+        size_t count = 0;
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            count += shard.tensors.size();
+        }
+        std::lock_guard<std::mutex> lock(arenaMutex_);
+        return count + slabUsed_;
     }
 
     void clearTensors() {
-        if (stream_ != nullptr) {
-            for (auto it : setTensors_) {
+        // temporaries may still be in use by work forked onto the auxiliary streams
+        {
+            std::lock_guard<std::mutex> lock(auxMutex_);
+            for (auto stream : streamPool_) {
+                device_synchronize_stream(stream);
+            }
+        }
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto it : shard.tensors) {
                 delete it;
             }
-            setTensors_.clear();
-            device_synchronize_stream(stream_);
+            shard.tensors.clear();
+        }
+        // through the accessor: another thread may be making the stream right now
+        device_synchronize_stream(getStreamHandle());
+        // nothing queued on the stream reads the arenas any more, hand the whole region out again
+        if (arenaMode_) {
+            std::lock_guard<std::mutex> lock(arenaMutex_);
+            slabUsed_ = 0;
+            hostArena_.reset();
+            deviceArena_.reset();
         }
     }
 };
 
-DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorCopyToBuffer(diopiContextHandle_t ctx, diopiConstTensorHandle_t tensor, void* dst);
-
-DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorCopyFromBuffer(diopiContextHandle_t ctx, const void* src, diopiTensorHandle_t tensor);
+// releases the cached blocks of the host, pinned host and device allocators
+DIOPI_RT_API diopiError_t diopiEmptyCache();
 
 DIOPI_RT_API diopiError_t diopiInit();
 
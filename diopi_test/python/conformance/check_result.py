@@ -44,7 +44,7 @@ class CheckResult(object):
 
     @staticmethod
     def compare_tensor(output, output_reference, **kwargs):
-        CheckResult.allclose(output.numpy(), output_reference, **kwargs)
+        CheckResult.allclose(output.numpy(copy=False), output_reference, **kwargs)
 
     @staticmethod
     def compare_list(output, output_reference, **kwargs):
@@ -53,7 +53,7 @@ class CheckResult(object):
         for i in range(len(output)):
             if isinstance(output[i], Tensor):
                 kwargs['name'] = "out" + str(i)
-                CheckResult.allclose(output[i].numpy(), output_reference[i], **kwargs)
+                CheckResult.allclose(output[i].numpy(copy=False), output_reference[i], **kwargs)
 
     @staticmethod
     def compare_dict(output, output_reference, **kwargs):
@@ -62,7 +62,7 @@ class CheckResult(object):
         for k, v in output.items():
             if isinstance(v, Tensor):
                 kwargs['name'] = k
-                CheckResult.allclose(v.numpy(), output_reference[k], **kwargs)
+                CheckResult.allclose(v.numpy(copy=False), output_reference[k], **kwargs)
 
     @staticmethod
     def compare_num(output, output_reference, **kwargs):
@@ -19,6 +19,7 @@ from diopilib import (
     get_last_error_string,
     finalize_library,
     diopi_finalize,
+    empty_cache,
     init_library,
     diopiGenerator,
 )
@@ -186,6 +187,8 @@ def diopi_rt_init():
 
 
 def on_diopi_rt_exit():
+    # cached blocks must go back to the device before the vendor library is finalized
+    empty_cache()
     finalize_library()
     diopi_finalize()
 
@@ -309,7 +312,11 @@ class Tensor(diopiTensor):
             )
         return tr
 
-    def numpy(self) -> np.ndarray:
+    def numpy(self, copy=True) -> np.ndarray:
+        if not copy and self.get_dtype().value <= Dtype.bool.value:
+            # host tensors are exported in place, device tensors as a read-only snapshot taken by this call;
+            # either way the array keeps the memory it points into alive
+            return np.asarray(self)
         data = np.empty((1,), to_numpy_dtype(self.get_dtype()))
         element_size = data.itemsize
         sumsize = int(
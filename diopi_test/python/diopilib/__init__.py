@@ -0,0 +1,2 @@
+from .export_runtime import *
+from .export_functions import *
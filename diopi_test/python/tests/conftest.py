@@ -1,3 +1,8 @@
+import os
+import subprocess
+import sys
+import textwrap
+
 import pytest
 
 
@@ -9,3 +14,18 @@ def pytest_addoption(parser):
 @pytest.fixture(scope="session")
 def test_all(request):
     return request.config.getoption("--test-all-models")
+
+
+@pytest.fixture(scope="session")
+def run_script():
+    # settings read once per process, such as environment switches, need a fresh interpreter; the script runs from
+    # diopi_test/python so that it imports diopilib and conformance like the tests do
+    cwd = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+    def run(source, *args, **env):
+        command = [sys.executable, "-c", textwrap.dedent(source)] + [str(arg) for arg in args]
+        result = subprocess.run(command, cwd=cwd, env=dict(os.environ, **env), capture_output=True, text=True)
+        assert result.returncode == 0, result.stdout + result.stderr
+        return result
+
+    return run
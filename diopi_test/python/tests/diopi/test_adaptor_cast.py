@@ -0,0 +1,98 @@
+import numpy as np
+
+from diopilib import Context, Dtype
+from conformance.diopi_functions import check_function, check_returncode
+from conformance.diopi_runtime import Scalar, Sizes, Tensor
+
+
+# uint16 is not native to the cpu kernels, convert_config.yaml makes the adaptor cast it to int64
+class TestAdaptorCast(object):
+    context = Context()
+
+    def test_non_contiguous_input(self):
+        base = np.random.randint(0, 1000, size=(12, 10)).astype(np.uint16)
+        input = base.T
+        other = np.random.randint(0, 1000, size=(10, 12)).astype(np.uint16)
+        out = Tensor((10, 12), Dtype.uint16, context=self.context)
+        ret = check_function("diopiAdd")(
+            self.context, out, Tensor.from_numpy(input, context=self.context), Tensor.from_numpy(other, context=self.context), Scalar(1)
+        )
+        check_returncode(ret)
+        np.testing.assert_array_equal(out.numpy(), input + other)
+
+    def test_non_contiguous_output(self):
+        input = np.random.randint(0, 1000, size=(6, 9)).astype(np.uint16)
+        other = np.random.randint(0, 1000, size=(9, 6)).astype(np.uint16).T
+        # a column-major output
+        out = Tensor((6, 9), Dtype.uint16, stride=Sizes([1, 6]), context=self.context)
+        ret = check_function("diopiAdd")(
+            self.context, out, Tensor.from_numpy(input, context=self.context), Tensor.from_numpy(other, context=self.context), Scalar(2)
+        )
+        check_returncode(ret)
+        result = out.numpy()
+        assert out.get_stride().data == [1, 6]
+        np.testing.assert_array_equal(result, input + 2 * other)
+
+    def test_non_contiguous_inplace(self):
+        base = np.random.randint(0, 1000, size=(8, 16)).astype(np.uint16)
+        input = base[:, ::2]
+        other = np.random.randint(0, 1000, size=(8, 8)).astype(np.uint16)
+        tensor = Tensor.from_numpy(input, context=self.context)
+        assert tensor.get_stride().data == [16, 2]
+        ret = check_function("diopiAddInp")(self.context, tensor, Tensor.from_numpy(other, context=self.context), Scalar(1))
+        check_returncode(ret)
+        np.testing.assert_array_equal(tensor.numpy(), input + other)
+
+    def test_cast_with_layout(self, run_script, tmp_path):
+        # convert_config.yaml runs diopiRMSNorm on contiguous float32: a channels-last float16 input is cast straight
+        # into contiguous memory and the result cast straight back into the channels-last out, one diopiCastDtype per
+        # tensor and no diopiContiguous temporary; float32 needs the layout alone
+        script = """
+            import os
+            import sys
+
+            import numpy as np
+            from diopilib import Context, Dtype, diopiAdaptorTimingDump, diopiAdaptorTimingReset
+            from conformance.diopi_functions import check_function, check_returncode
+            from conformance.diopi_runtime import Sizes, Tensor, from_numpy_dtype
+
+            context = Context()
+            shape = (2, 3, 4, 5)
+            channels_last = Sizes([60, 1, 15, 3])
+
+
+            def rms_norm(dtype, report):
+                x = np.random.randn(*shape).astype(dtype)
+                weight = np.random.rand(5).astype(dtype)
+                input = Tensor(shape, from_numpy_dtype(np.dtype(dtype)), stride=channels_last, context=context)
+                check_returncode(check_function("diopiCopyInp")(context, Tensor.from_numpy(x, context=context), input))
+                out = Tensor(shape, from_numpy_dtype(np.dtype(dtype)), stride=channels_last, context=context)
+                inv_rms = Tensor((2, 3, 4, 1), from_numpy_dtype(np.dtype(dtype)), context=context)
+                diopiAdaptorTimingReset()
+                ret = check_function("diopiRMSNorm")(context, out, inv_rms, input, Sizes([5]), Tensor.from_numpy(weight, context=context), None, 1e-6)
+                check_returncode(ret)
+                diopiAdaptorTimingDump(os.path.join(sys.argv[1], report))
+                x = x.astype(np.float32)
+                expected_inv_rms = 1 / np.sqrt((x * x).mean(-1, keepdims=True) + 1e-6)
+                tolerance = 2e-3 if dtype == np.float16 else 1e-5
+                assert out.get_stride().data == channels_last.data
+                np.testing.assert_allclose(out.numpy(), x * expected_inv_rms * weight, rtol=tolerance, atol=tolerance)
+                np.testing.assert_allclose(inv_rms.numpy(), expected_inv_rms, rtol=tolerance)
+
+
+            rms_norm(np.float16, "float16.txt")
+            rms_norm(np.float32, "float32.txt")
+        """
+        run_script(script, tmp_path, DIOPI_ENABLE_TIMING="ON", DIOPI_TIMING_FILE=str(tmp_path / "exit.txt"))
+
+        def counts(report):
+            with open(tmp_path / report) as timing:
+                return {row[0]: int(row[1]) for row in (line.split() for line in timing) if row[0] != "name"}
+
+        casts = counts("float16.txt")
+        # input and weight on the way in, out and inv_rms on the way back
+        assert casts["CastDtype_adaptor"] == 4
+        assert "Contiguous_adaptor" not in casts
+        layouts = counts("float32.txt")
+        assert "CastDtype_adaptor" not in layouts
+        assert layouts["Contiguous_adaptor"] == 1
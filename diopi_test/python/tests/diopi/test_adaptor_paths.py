@@ -0,0 +1,159 @@
+import json
+
+import numpy as np
+
+from diopilib import Context, Device, Dtype, diopiError, diopiGetOpCapabilities, get_memory_stats
+from conformance.diopi_functions import check_function, check_returncode
+from conformance.diopi_runtime import Scalar, Sizes, Tensor
+
+
+def num_allocs():
+    return get_memory_stats(None, Device.AIChip).num_allocs
+
+
+def add(context, x, y, alpha):
+    out = Tensor(x.shape, Dtype.uint16 if x.dtype == np.uint16 else Dtype.float32, context=context)
+    input = Tensor.from_numpy(x, context=context)
+    other = Tensor.from_numpy(y, context=context)
+    before = num_allocs()
+    check_returncode(check_function("diopiAdd")(context, out, input, other, Scalar(alpha)))
+    return out.numpy(), num_allocs() - before
+
+
+# The generated adaptors call the kernel right away when no argument needs a conversion, and convert on the slow
+# path otherwise. Both have to give the same results, the slow path reusing what the fast path looked up.
+class TestAdaptorPaths(object):
+    context = Context()
+
+    def test_fast_path_converts_nothing(self):
+        x = np.random.rand(4, 6).astype(np.float32)
+        y = np.random.rand(4, 6).astype(np.float32)
+        result, allocs = add(self.context, x, y, 2)
+        assert allocs == 0
+        np.testing.assert_allclose(result, x + 2 * y, rtol=1e-6)
+
+    def test_slow_path_casts(self):
+        x = np.random.randint(0, 1000, size=(4, 6)).astype(np.uint16)
+        y = np.random.randint(0, 1000, size=(4, 6)).astype(np.uint16)
+        result, allocs = add(self.context, x, y, 2)
+        # int64 copies of both inputs and of the output
+        assert allocs == 3
+        np.testing.assert_array_equal(result, x + 2 * y)
+
+    def test_repeated_inplace(self):
+        # repeated in-place calls hit the cached plans, the output is cast back each time
+        x = np.random.randint(0, 1000, size=(5, 3)).astype(np.uint16)
+        y = np.random.randint(0, 1000, size=(5, 3)).astype(np.uint16)
+        input = Tensor.from_numpy(x, context=self.context)
+        other = Tensor.from_numpy(y, context=self.context)
+        for _ in range(3):
+            check_returncode(check_function("diopiAddInp")(self.context, input, other, Scalar(1)))
+            x = x + y
+        np.testing.assert_array_equal(input.numpy(), x)
+
+    def test_op_capabilities(self):
+        ret, caps = diopiGetOpCapabilities("diopiCopyInp")
+        assert ret == diopiError.diopi_success
+        assert caps.dtypes >> Dtype.uint16.value & 1
+        assert caps.memory_formats == 0
+        ret, caps = diopiGetOpCapabilities("diopiAdd")
+        assert ret == diopiError.diopi_success
+        assert not caps.dtypes >> Dtype.uint16.value & 1
+        ret, _ = diopiGetOpCapabilities("diopiNoSuchOp")
+        assert ret == diopiError.diopi_no_implement
+
+    def test_capabilities_skip_conversions(self):
+        # the device config casts uint16 to int64, but diopiCopyInp reports uint16 as native and any layout, so a
+        # uint16 copy into a transposed tensor runs without a temporary
+        x = np.random.randint(0, 1000, size=(4, 6)).astype(np.uint16)
+        src = Tensor.from_numpy(x, context=self.context)
+        dst = Tensor((4, 6), Dtype.uint16, stride=Sizes([1, 4]), context=self.context)
+        before = num_allocs()
+        check_returncode(check_function("diopiCopyInp")(self.context, src, dst))
+        assert num_allocs() == before
+        np.testing.assert_array_equal(dst.numpy(), x)
+        # diopiAdd takes any layout too, a transposed operand is not made contiguous
+        y = np.random.rand(4, 6).astype(np.float32)
+        input = Tensor.from_numpy(y, context=self.context)
+        other = Tensor((4, 6), Dtype.float32, stride=Sizes([1, 4]), context=self.context)
+        check_returncode(check_function("diopiCopyInp")(self.context, input, other))
+        out = Tensor((4, 6), Dtype.float32, context=self.context)
+        before = num_allocs()
+        check_returncode(check_function("diopiAdd")(self.context, out, input, other, Scalar(1)))
+        assert num_allocs() == before
+        np.testing.assert_allclose(out.numpy(), 2 * y, rtol=1e-6)
+
+    def test_hooks_take_the_slow_path(self, run_script, tmp_path):
+        # with timing on, even conforming calls and ops without conversions pass through the timed slow path
+        script = """
+            import numpy as np
+            from diopilib import Context, Dtype
+            from conformance.diopi_functions import check_function, check_returncode
+            from conformance.diopi_runtime import Scalar, Sizes, Tensor
+
+            context = Context()
+            x = np.random.rand(4, 6).astype(np.float32)
+            y = np.random.rand(4, 6).astype(np.float32)
+            out = Tensor((4, 6), Dtype.float32, context=context)
+            check_returncode(check_function("diopiAdd")(context, out, Tensor.from_numpy(x, context=context), Tensor.from_numpy(y, context=context), Scalar(1)))
+            np.testing.assert_allclose(out.numpy(), x + y, rtol=1e-6)
+            copy = Tensor((4, 6), Dtype.float32, context=context)
+            check_returncode(check_function("diopiCopyInp")(context, out, copy))
+            np.testing.assert_array_equal(copy.numpy(), out.numpy())
+        """
+        timing_file = tmp_path / "timing.txt"
+        run_script(script, DIOPI_ENABLE_TIMING="ON", DIOPI_TIMING_FILE=str(timing_file))
+        report = timing_file.read_text()
+        assert "Add_adaptor" in report
+        assert "CopyInp_adaptor" in report
+
+    def test_plan_cache(self, run_script, tmp_path):
+        # each step prepares its tensors, then times the call alone: a plan made on a miss shows up as convert_plan
+        script = """
+            import json
+            import os
+            import sys
+
+            import numpy as np
+            from diopilib import Context, Dtype, diopiAdaptorTimingDump, diopiAdaptorTimingReset
+            from conformance.diopi_functions import check_function, check_returncode
+            from conformance.diopi_runtime import Scalar, Sizes, Tensor, from_numpy_dtype
+
+            context = Context()
+            report = os.path.join(sys.argv[1], "timing.txt")
+            misses = []
+
+
+            def step(dtype, shape, transposed=False):
+                x = np.random.randint(0, 1000, size=shape).astype(dtype)
+                y = np.random.randint(0, 1000, size=shape).astype(dtype)
+                input = Tensor.from_numpy(x, context=context)
+                other = Tensor.from_numpy(y, context=context)
+                if transposed:
+                    other = Tensor(shape, from_numpy_dtype(np.dtype(dtype)), stride=Sizes([1, shape[0]]), context=context)
+                    check_returncode(check_function("diopiCopyInp")(context, Tensor.from_numpy(y, context=context), other))
+                out = Tensor(shape, from_numpy_dtype(np.dtype(dtype)), context=context)
+                diopiAdaptorTimingReset()
+                check_returncode(check_function("diopiAdd")(context, out, input, other, Scalar(2)))
+                diopiAdaptorTimingDump(report)
+                np.testing.assert_array_equal(out.numpy(), x + 2 * y)
+                with open(report) as timing:
+                    rows = [line.split() for line in timing if line.startswith("convert_plan ")]
+                misses.append(int(rows[0][1]) if rows else 0)
+
+
+            step(np.float32, (4, 6))
+            step(np.float32, (4, 6))
+            step(np.uint16, (4, 6))
+            step(np.uint16, (4, 6))
+            step(np.uint16, (4, 6), transposed=True)
+            step(np.uint16, (4, 6), transposed=True)
+            step(np.uint16, (5, 3))
+            step(np.uint16, (5, 3))
+            print(json.dumps(misses))
+        """
+        result = run_script(script, tmp_path, DIOPI_ENABLE_TIMING="ON", DIOPI_TIMING_FILE=str(tmp_path / "exit.txt"))
+        misses = json.loads(result.stdout.splitlines()[-1])
+        # one plan per argument: a new dtype or shape misses for out, input and other, the transposed stride for other
+        # only; repeating a call finds every plan
+        assert misses == [3, 0, 3, 0, 1, 0, 3, 0]
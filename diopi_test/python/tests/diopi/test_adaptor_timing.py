@@ -0,0 +1,100 @@
+import pytest
+
+from diopilib import diopiAdaptorTimingDump, diopiError
+
+# The script runs diopiAdd a known number of times, dumps the report, resets and runs it again, so the second report
+# only counts the calls made after the reset.
+script = """
+    import sys
+
+    import numpy as np
+    from diopilib import Context, Dtype, diopiAdaptorTimingDump, diopiAdaptorTimingReset, diopiError
+    from conformance.diopi_functions import check_function, check_returncode
+    from conformance.diopi_runtime import Scalar, Tensor
+
+    context = Context()
+    x = np.random.rand(16, 16).astype(np.float32)
+    input = Tensor.from_numpy(x, context=context)
+    out = Tensor((16, 16), Dtype.float32, context=context)
+
+
+    def run(times):
+        for _ in range(times):
+            check_returncode(check_function("diopiAdd")(context, out, input, input, Scalar(1)))
+
+
+    run(40)
+    assert diopiAdaptorTimingDump(sys.argv[1]) == diopiError.diopi_success
+    assert diopiAdaptorTimingReset() == diopiError.diopi_success
+    run(7)
+    assert diopiAdaptorTimingDump(sys.argv[2]) == diopiError.diopi_success
+"""
+
+
+@pytest.fixture
+def run(run_script, tmp_path):
+    def run_timed(mode):
+        first, second = tmp_path / "first.txt", tmp_path / "second.txt"
+        # the report written at exit goes to DIOPI_TIMING_FILE, away from the explicit dumps
+        run_script(script, first, second, DIOPI_ENABLE_TIMING=mode, DIOPI_TIMING_FILE=str(tmp_path / "exit.txt"))
+        return [parse(path) for path in (first, second)]
+
+    return run_timed
+
+
+def parse(path):
+    # raw "name: x ms" lines, then a blank line in raw mode, then the summary table
+    with open(path) as report:
+        lines = report.read().splitlines()
+    raw = {}
+    if "" in lines:
+        blank = lines.index("")
+        for line in lines[:blank]:
+            name, duration = line.rsplit(": ", 1)
+            assert duration.endswith("ms")
+            raw.setdefault(name, []).append(float(duration[:-2]))
+        lines = lines[blank + 1:]
+    assert lines[0].split() == ["name", "count", "total(ms)", "avg(ms)", "p50(ms)", "p99(ms)", "max(ms)"]
+    summary = {}
+    for line in lines[1:]:
+        name, count, *values = line.split()
+        summary[name] = (int(count),) + tuple(float(v) for v in values)
+    return raw, summary
+
+
+def near_bucket(value, duration):
+    # a percentile is the middle of its log-linear bucket, 16 buckets per power of two, printed to 0.1us
+    return abs(value - duration) <= duration / 16 + 1e-4
+
+
+class TestAdaptorTiming(object):
+    def test_dump_needs_timing(self, tmp_path):
+        assert diopiAdaptorTimingDump(str(tmp_path / "timing.txt")) == diopiError.diopi_not_inited
+
+    def test_histogram(self, run):
+        (raw, summary), (raw_after_reset, summary_after_reset) = run("ON")
+        assert raw == {} and raw_after_reset == {}
+        count, total, avg, p50, p99, longest = summary["Add_adaptor"]
+        assert count == 40
+        assert avg == pytest.approx(total / count, rel=1e-3, abs=1e-4)
+        assert 0 < p50 <= p99 <= longest
+        assert summary_after_reset["Add_adaptor"][0] == 7
+        # scopes the second run did not enter are left out rather than listed with a zero count
+        assert all(stats[0] > 0 for stats in summary_after_reset.values())
+
+    def test_raw(self, run):
+        (raw, summary), (raw_after_reset, summary_after_reset) = run("RAW")
+        for events, stats in ((raw, summary), (raw_after_reset, summary_after_reset)):
+            assert sorted(events) == sorted(stats)
+            for name, durations in events.items():
+                count, total, _, p50, p99, longest = stats[name]
+                assert len(durations) == count
+                assert sum(durations) == pytest.approx(total, rel=1e-3, abs=1e-3)
+                ordered = sorted(durations)
+                assert longest == pytest.approx(ordered[-1], abs=1e-4)
+                # the buckets reproduce the nearest-rank percentiles of the raw events
+                for q, value in ((0.5, p50), (0.99, p99)):
+                    rank = min(len(ordered), max(1, int(q * count + 0.5)))
+                    assert near_bucket(value, ordered[rank - 1]), (name, q, value, ordered)
+        assert len(raw["Add_adaptor"]) == 40
+        assert len(raw_after_reset["Add_adaptor"]) == 7
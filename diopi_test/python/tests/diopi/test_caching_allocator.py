@@ -0,0 +1,81 @@
+from diopilib import Context, Device, Dtype, get_memory_stats
+from conformance.diopi_runtime import Tensor
+
+
+def device_stats():
+    return get_memory_stats(None, Device.AIChip)
+
+
+class TestCachingAllocator(object):
+    def test_reuse_same_size_class(self):
+        context = Context()
+        tensor = Tensor(size=(1000,), dtype=Dtype.float32, context=context)
+        del tensor
+        assert device_stats().cached_bytes >= 4096
+
+        before = device_stats()
+        # 4000 and 4080 bytes round to the same 4 KiB block
+        tensor = Tensor(size=(1020,), dtype=Dtype.float32, context=context)
+        stats = device_stats()
+        assert stats.num_allocs - before.num_allocs == 1
+        assert stats.num_device_allocs == before.num_device_allocs
+        del tensor
+
+    def test_reuse_large_size_class(self):
+        context = Context()
+        # blocks above 1 MiB are rounded to an eighth of the next power of two
+        tensor = Tensor(size=((1 << 20) + 1,), dtype=Dtype.uint8, context=context)
+        del tensor
+
+        before = device_stats()
+        tensor = Tensor(size=((1 << 20) + (100 << 10),), dtype=Dtype.uint8, context=context)
+        assert device_stats().num_device_allocs == before.num_device_allocs
+        del tensor
+
+    def test_no_reuse_across_size_classes(self):
+        context = Context()
+        tensor = Tensor(size=(1024,), dtype=Dtype.float32, context=context)
+        del tensor
+
+        before = device_stats()
+        tensor = Tensor(size=(4096,), dtype=Dtype.float32, context=context)
+        assert device_stats().num_device_allocs - before.num_device_allocs == 1
+        del tensor
+
+    def test_no_reuse_across_streams(self):
+        context = Context()
+        other = Context()
+        tensor = Tensor(size=(3000,), dtype=Dtype.float32, context=context)
+        del tensor
+
+        before = device_stats()
+        tensor = Tensor(size=(3000,), dtype=Dtype.float32, context=other)
+        assert device_stats().num_device_allocs - before.num_device_allocs == 1
+        del tensor
+
+        # the block freed on the first stream is still there for it
+        before = device_stats()
+        tensor = Tensor(size=(3000,), dtype=Dtype.float32, context=context)
+        assert device_stats().num_device_allocs == before.num_device_allocs
+        del tensor
+
+    def test_disabled(self, run_script):
+        run_script("""
+            from diopilib import Context, Device, Dtype, get_memory_stats, reset_peak_memory_stats
+            from conformance.diopi_runtime import Tensor
+
+            context = Context()
+            before = get_memory_stats(None, Device.AIChip)
+            reset_peak_memory_stats(None, Device.AIChip)
+            for _ in range(3):
+                tensor = Tensor(size=(1000,), dtype=Dtype.float32, context=context)
+                del tensor
+            stats = get_memory_stats(None, Device.AIChip)
+            # the counts are cumulative, the reset only restarts the peaks
+            assert stats.num_allocs - before.num_allocs == 3, stats.num_allocs
+            assert stats.num_device_allocs - before.num_device_allocs == 3, stats.num_device_allocs
+            assert stats.cached_bytes == 0, stats.cached_bytes
+            assert stats.reserved_bytes == before.reserved_bytes, stats.reserved_bytes
+            # without caching nothing is rounded up
+            assert stats.peak_reserved_bytes - before.reserved_bytes == 4000, stats.peak_reserved_bytes
+        """, DIOPIRT_CACHING_ALLOCATOR="0")
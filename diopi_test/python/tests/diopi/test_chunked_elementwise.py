@@ -0,0 +1,73 @@
+import numpy as np
+
+from diopilib import Context
+from conformance.diopi_functions import check_function, check_returncode
+from conformance.diopi_runtime import Scalar, Tensor
+
+
+# uint16 tensors are cast to int64 for the cpu kernels, tiles of ChunkedElementwise::kTileBytes hold 1 << 19 of them
+TILE = 1 << 19
+
+
+def inputs(numel):
+    rng = np.random.default_rng(numel)
+    return rng.integers(0, 1 << 16, size=numel, dtype=np.uint16), rng.integers(0, 1 << 16, size=numel, dtype=np.uint16)
+
+
+def add_inp(context, x, y):
+    input = Tensor.from_numpy(x, context=context)
+    other = Tensor.from_numpy(y, context=context)
+    context.clear_tensors()
+    check_returncode(check_function("diopiAddInp")(context, input, other, Scalar(3)))
+    return input.numpy(), context.num_tensors()
+
+
+def untiled_add_inp(run_script, tmp_path, x, y):
+    # hooks such as timing send every call through the regular path, which casts the whole tensors
+    script = """
+        import sys
+        import numpy as np
+        from diopilib import Context
+        from conformance.diopi_functions import check_function, check_returncode
+        from conformance.diopi_runtime import Scalar, Tensor
+
+        context = Context()
+        x, y = np.load(sys.argv[1]), np.load(sys.argv[2])
+        input = Tensor.from_numpy(x, context=context)
+        check_returncode(check_function("diopiAddInp")(context, input, Tensor.from_numpy(y, context=context), Scalar(3)))
+        np.save(sys.argv[1], input.numpy())
+    """
+    paths = [tmp_path / "x.npy", tmp_path / "y.npy"]
+    np.save(paths[0], x)
+    np.save(paths[1], y)
+    run_script(script, *paths, DIOPI_ENABLE_TIMING="ON", DIOPI_TIMING_FILE=str(tmp_path / "timing.txt"))
+    return np.load(paths[0])
+
+
+class TestChunkedElementwise(object):
+    context = Context()
+
+    def test_matches_untiled(self, run_script, tmp_path):
+        # two full tiles and a short one
+        x, y = inputs(2 * TILE + 1000)
+        tiled, _ = add_inp(self.context, x, y)
+        np.testing.assert_array_equal(tiled, untiled_add_inp(run_script, tmp_path, x, y))
+        np.testing.assert_array_equal(tiled, (x.astype(np.int64) + 3 * y.astype(np.int64)).astype(np.uint16))
+
+    def test_handles_do_not_grow_with_tiles(self):
+        # a view per argument plus a buffer and its view per cast argument, however many tiles there are
+        counts = []
+        for numel in (2 * TILE + 1, 7 * TILE + 5):
+            x, y = inputs(numel)
+            result, num_tensors = add_inp(self.context, x, y)
+            np.testing.assert_array_equal(result, (x.astype(np.int64) + 3 * y.astype(np.int64)).astype(np.uint16))
+            counts.append(num_tensors)
+        assert counts[0] == counts[1] == 6
+
+    def test_read_only_argument_is_kept(self):
+        x, y = inputs(3 * TILE)
+        other = Tensor.from_numpy(y, context=self.context)
+        input = Tensor.from_numpy(x, context=self.context)
+        check_returncode(check_function("diopiMulInp")(self.context, input, other))
+        np.testing.assert_array_equal(other.numpy(), y)
+        np.testing.assert_array_equal(input.numpy(), (x.astype(np.int64) * y.astype(np.int64)).astype(np.uint16))
@@ -0,0 +1,127 @@
+import numpy as np
+import pytest
+
+from diopilib import Context, Dtype, diopiError
+from conformance.diopi_functions import check_function, check_returncode, convert_reduction
+from conformance.diopi_runtime import Sizes, Tensor
+
+
+def log_softmax(x, axis):
+    shifted = x - x.max(axis=axis, keepdims=True)
+    return shifted - np.log(np.exp(shifted).sum(axis=axis, keepdims=True))
+
+
+def rms_norm(x, weight, ndim, eps):
+    axes = tuple(range(x.ndim - ndim, x.ndim))
+    inv_rms = 1.0 / np.sqrt((x * x).mean(axis=axes, keepdims=True) + eps)
+    return x * inv_rms * weight, inv_rms
+
+
+# The cpu config routes these ops to the composite versions in the adaptor, built from primitive diopi calls:
+# RMSNorm and CrossEntropyLoss because the cpu kernels lack them, Linear when its kernel declines a call.
+class TestCompositeOps(object):
+    context = Context()
+
+    def tensor(self, array):
+        return Tensor.from_numpy(np.ascontiguousarray(array), context=self.context)
+
+    def test_linear(self, run_script, tmp_path):
+        # the cpu kernel runs unless the op is forced off it, timing shows which of the two ran
+        script = """
+            import numpy as np
+            from diopilib import Context, Dtype
+            from conformance.diopi_functions import check_function, check_returncode
+            from conformance.diopi_runtime import Tensor
+
+            context = Context()
+            x = np.random.rand(2, 3, 8).astype(np.float32)
+            weight = np.random.rand(5, 8).astype(np.float32)
+            bias = np.random.rand(5).astype(np.float32)
+            for b in (bias, None):
+                out = Tensor((2, 3, 5), Dtype.float32, context=context)
+                bias_tensor = Tensor.from_numpy(b, context=context) if b is not None else None
+                ret = check_function("diopiLinear")(context, out, Tensor.from_numpy(x, context=context), Tensor.from_numpy(weight, context=context), bias_tensor)
+                check_returncode(ret)
+                np.testing.assert_allclose(out.numpy(), x @ weight.T + (b if b is not None else 0), rtol=1e-5)
+        """
+        for forced in ("diopiLinear", ""):
+            timing_file = tmp_path / ("timing%s.txt" % forced)
+            run_script(script, DIOPI_FALLBACK_OPS=forced, DIOPI_ENABLE_TIMING="ON", DIOPI_TIMING_FILE=str(timing_file))
+            assert ("Linear_composite" in timing_file.read_text()) == bool(forced)
+
+    def test_cross_entropy_probability_target(self):
+        x = np.random.randn(4, 6, 3).astype(np.float32)
+        target = np.random.rand(4, 6, 3).astype(np.float32)
+        target /= target.sum(axis=1, keepdims=True)
+        reference = -(log_softmax(x, 1) * target).sum(axis=1)
+        for reduction, expected in (("none", reference), ("mean", reference.mean()), ("sum", reference.sum())):
+            out = Tensor(expected.shape, Dtype.float32, context=self.context)
+            ret = check_function("diopiCrossEntropyLoss")(self.context, out, self.tensor(x), self.tensor(target), None, convert_reduction(reduction), -100, 0.0)
+            check_returncode(ret)
+            np.testing.assert_allclose(out.numpy(), expected, rtol=1e-5, atol=1e-6)
+
+    @pytest.mark.parametrize("dtype", [np.int64, np.int32, np.uint8, np.uint64])
+    def test_cross_entropy_class_target(self, dtype):
+        # class indices of every integer dtype need diopiNLLLoss, the cpu kernels lack it
+        x = np.random.randn(4, 6).astype(np.float32)
+        target = np.random.randint(0, 6, size=(4,)).astype(dtype)
+        out = Tensor((), Dtype.float32, context=self.context)
+        ret = check_function("diopiCrossEntropyLoss")(self.context, out, self.tensor(x), self.tensor(target), None, convert_reduction("mean"), -100, 0.0)
+        assert ret == diopiError.diopi_no_implement
+
+    def rms_norm(self, x, weight, ndim, inv_rms, eps=1e-6):
+        out = Tensor(x.shape, Dtype.float32, context=self.context)
+        ret = check_function("diopiRMSNorm")(
+            self.context, out, inv_rms, self.tensor(x), Sizes(list(x.shape[x.ndim - ndim :])), self.tensor(weight), None, eps
+        )
+        return ret, out
+
+    def test_rms_norm(self):
+        x = np.random.randn(3, 4, 8).astype(np.float32)
+        weight = np.random.rand(8).astype(np.float32)
+        expected, expected_inv_rms = rms_norm(x, weight, 1, 1e-6)
+        inv_rms = Tensor((3, 4, 1), Dtype.float32, context=self.context)
+        ret, out = self.rms_norm(x, weight, 1, inv_rms)
+        check_returncode(ret)
+        np.testing.assert_allclose(out.numpy(), expected, rtol=1e-5)
+        np.testing.assert_allclose(inv_rms.numpy(), expected_inv_rms, rtol=1e-5)
+
+    def test_rms_norm_inv_rms_geometry(self):
+        x = np.random.randn(3, 4, 8).astype(np.float32)
+        weight = np.random.rand(4, 8).astype(np.float32)
+        expected, expected_inv_rms = rms_norm(x, weight, 2, 1e-6)
+        # flat ones, viewed in place or strided and written by a copy, and one larger than the result as the
+        # conformance suite passes it
+        for shape, stride in (((3,), None), ((1, 3), None), ((3,), Sizes([2])), ((3, 1), Sizes([2, 1]))):
+            inv_rms = Tensor(shape, Dtype.float32, stride=stride, context=self.context) if stride else Tensor(shape, Dtype.float32, context=self.context)
+            ret, out = self.rms_norm(x, weight, 2, inv_rms)
+            check_returncode(ret)
+            np.testing.assert_allclose(out.numpy(), expected, rtol=1e-5)
+            np.testing.assert_allclose(inv_rms.numpy().reshape(-1), expected_inv_rms.reshape(-1), rtol=1e-5)
+        inv_rms = Tensor(x.shape, Dtype.float32, context=self.context)
+        ret, out = self.rms_norm(x, weight, 2, inv_rms)
+        check_returncode(ret)
+        np.testing.assert_allclose(inv_rms.numpy().reshape(-1)[:3], expected_inv_rms.reshape(-1), rtol=1e-5)
+
+    def test_rms_norm_in_place(self):
+        # out aliasing input cannot hold the squares, input is read again once inv_rms is known
+        x = np.random.randn(3, 4, 8).astype(np.float32)
+        weight = np.random.rand(8).astype(np.float32)
+        expected, expected_inv_rms = rms_norm(x, weight, 1, 1e-6)
+        inout = self.tensor(x)
+        inv_rms = Tensor((3, 4, 1), Dtype.float32, context=self.context)
+        check_returncode(check_function("diopiRMSNorm")(self.context, inout, inv_rms, inout, Sizes([8]), self.tensor(weight), None, 1e-6))
+        np.testing.assert_allclose(inout.numpy(), expected, rtol=1e-5)
+        np.testing.assert_allclose(inv_rms.numpy(), expected_inv_rms, rtol=1e-5)
+
+    def test_rms_norm_rejects(self):
+        x = np.random.randn(3, 8).astype(np.float32)
+        weight = np.random.rand(8).astype(np.float32)
+        # too small for the result
+        ret, _ = self.rms_norm(x, weight, 1, Tensor((2,), Dtype.float32, context=self.context))
+        assert ret == diopiError.diopi_error_occurred
+        # bias is not applied, so the op is not implemented with one
+        out = Tensor(x.shape, Dtype.float32, context=self.context)
+        inv_rms = Tensor((3, 1), Dtype.float32, context=self.context)
+        ret = check_function("diopiRMSNorm")(self.context, out, inv_rms, self.tensor(x), Sizes([8]), self.tensor(weight), self.tensor(weight), 1e-6)
+        assert ret == diopiError.diopi_no_implement
@@ -0,0 +1,112 @@
+from threading import Thread
+
+from diopilib import Context, Device, Dtype, get_memory_stats, reset_view
+
+
+def device_stats():
+    return get_memory_stats(None, Device.AIChip)
+
+
+def require_temporaries(context, count=200):
+    for i in range(count):
+        context.require_tensor([64, 1 + i % 7], Dtype.float32, Device.AIChip)
+        context.require_tensor([i + 1], Dtype.int64, Device.AIChip)
+
+
+class TestContextArena(object):
+    def test_clear_returns_to_baseline(self):
+        context = Context(arena=False)
+        baseline = device_stats()
+        require_temporaries(context)
+        assert device_stats().allocated_bytes > baseline.allocated_bytes
+        context.clear_tensors()
+        assert device_stats().allocated_bytes == baseline.allocated_bytes
+
+    def test_arena_reuses_its_chunks(self):
+        context = Context(arena=True)
+        baseline = device_stats()
+        require_temporaries(context)
+        context.clear_tensors()
+        after_first = device_stats()
+        # the arena keeps its chunks, a second step of the same shape needs no allocation at all
+        require_temporaries(context)
+        stats = device_stats()
+        assert stats.num_allocs == after_first.num_allocs
+        assert stats.allocated_bytes == after_first.allocated_bytes
+        context.clear_tensors()
+
+        del context
+        assert device_stats().allocated_bytes == baseline.allocated_bytes
+
+    def test_arena_host_temporaries(self):
+        context = Context(arena=True)
+        baseline = get_memory_stats(None, Device.Host)
+        for i in range(100):
+            context.require_tensor([256, i + 1], Dtype.float32, Device.Host)
+        context.clear_tensors()
+        del context
+        assert get_memory_stats(None, Device.Host).allocated_bytes == baseline.allocated_bytes
+
+    def test_clear_host_only_context(self):
+        # host temporaries are freed even when nothing was queued on the stream
+        context = Context(arena=False)
+        baseline = get_memory_stats(None, Device.Host)
+        for i in range(100):
+            context.require_tensor([256, i + 1], Dtype.float32, Device.Host)
+        context.clear_tensors()
+        assert get_memory_stats(None, Device.Host).allocated_bytes == baseline.allocated_bytes
+
+    def test_views_stay_within_their_source(self):
+        # the arena tensors share one chunk, a view of one must not reach its neighbours
+        context = Context(arena=True)
+        first = context.require_tensor([4, 8], Dtype.float32, Device.AIChip)
+        second = context.require_tensor([4, 8], Dtype.float32, Device.AIChip)
+        assert first.storage_offset() + 32 <= second.storage_offset()
+        offset = first.storage_offset()
+        assert context.require_tensor_view(first, [8, 4], [1, 8], offset) is not None
+        assert context.require_tensor_view(first, [33], [1], offset) is None
+        assert context.require_tensor_view(first, [8], [1], offset + 28) is None
+        assert context.require_tensor_view(first, [0], [1], offset + 32) is not None
+        # a view moves over the tiles of its source, not beyond them, and views of it see the source only
+        tile = context.require_tensor_view(first, [2, 8], [8, 1], offset)
+        assert reset_view(tile, [2, 8], [8, 1], offset + 16)
+        assert not reset_view(tile, [2, 8], [8, 1], offset + 24)
+        assert context.require_tensor_view(tile, [4, 8], [8, 1], offset) is not None
+        assert context.require_tensor_view(tile, [5, 8], [8, 1], offset) is None
+        context.clear_tensors()
+
+    def test_threads_share_a_context(self):
+        # every thread keeps its device temporaries and frees its host ones, the count sees exactly the kept ones
+        context = Context(arena=False)
+        baseline = device_stats()
+        threads, steps = 8, 200
+
+        def work():
+            for i in range(steps):
+                context.require_tensor([16, 1 + i % 5], Dtype.float32, Device.AIChip)
+                context.destroy_tensor(context.require_tensor([i + 1], Dtype.int64, Device.Host))
+
+        workers = [Thread(target=work) for _ in range(threads)]
+        for worker in workers:
+            worker.start()
+        for worker in workers:
+            worker.join()
+        assert context.num_tensors() == threads * steps
+        context.clear_tensors()
+        assert context.num_tensors() == 0
+        assert device_stats().allocated_bytes == baseline.allocated_bytes
+
+    def test_clear_while_the_stream_is_made(self):
+        # clear_tensors and the first users of the stream race to make it, all of them must see the same one
+        for _ in range(50):
+            context = Context(arena=False)
+            context.require_tensor([8], Dtype.float32, Device.Host)
+            streams = []
+            workers = [Thread(target=lambda: streams.append(context.stream())) for _ in range(4)]
+            workers.append(Thread(target=context.clear_tensors))
+            for worker in workers:
+                worker.start()
+            for worker in workers:
+                worker.join()
+            assert len(set(streams)) == 1 and streams[0] != 0
+            assert context.num_tensors() == 0
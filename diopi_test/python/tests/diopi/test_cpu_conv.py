@@ -0,0 +1,154 @@
+import numpy as np
+import pytest
+
+from diopilib import Context, diopiError
+from conformance.diopi_functions import check_function
+from conformance.diopi_runtime import Dtype, Sizes, Tensor
+
+# DIOPI_CPU_CONV_ALGO is read once per process, so each algorithm runs in its own; an algorithm forced on a problem it
+# does not apply to falls back to the heuristics. The script checks every case against numpy and saves the results
+# for the comparison with the direct loop. The 1x1 cases with stride or padding must not take gemm1x1, and the 3x3 ones
+# with stride, dilation, a kernel depth or a depth of input must not take Winograd; the grouped 3x3 one may.
+script = """
+    import sys
+
+    import numpy as np
+    from diopilib import Context
+    from conformance.diopi_functions import check_function, check_returncode
+    from conformance.diopi_runtime import Sizes, Tensor, from_numpy_dtype
+
+    context = Context()
+    # name: batch, in channels, input size, out channels, kernel, stride, padding, dilation, groups
+    cases = {
+        "3x3": (2, 16, (13, 11), 16, (3, 3), (1, 1), (1, 1), (1, 1), 1),
+        "3x3_thin": (1, 3, (6, 7), 5, (3, 3), (1, 1), (0, 0), (1, 1), 1),
+        "3x3_groups": (1, 8, (9, 10), 12, (3, 3), (1, 1), (1, 1), (1, 1), 4),
+        "3x3_stride": (2, 16, (13, 11), 16, (3, 3), (2, 2), (1, 1), (1, 1), 1),
+        "3x3_dilation": (1, 16, (12, 13), 16, (3, 3), (1, 1), (2, 2), (2, 2), 1),
+        "3x3_groups_stride": (1, 8, (11, 9), 12, (3, 3), (2, 1), (1, 0), (1, 1), 2),
+        "depthwise": (2, 6, (8, 9), 6, (3, 3), (1, 1), (1, 1), (1, 1), 6),
+        "5x5": (1, 8, (10, 9), 16, (5, 5), (1, 1), (2, 1), (1, 1), 1),
+        "1x1": (2, 8, (5, 6), 12, (1, 1), (1, 1), (0, 0), (1, 1), 1),
+        "1x1_stride": (1, 8, (7, 6), 12, (1, 1), (2, 2), (0, 0), (1, 1), 1),
+        "1x1_padding": (1, 8, (5, 6), 12, (1, 1), (1, 1), (1, 1), (1, 1), 1),
+        "3d": (1, 4, (4, 5, 6), 6, (3, 3, 3), (1, 1, 1), (1, 1, 1), (1, 1, 1), 1),
+        "3d_flat_kernel": (1, 16, (3, 6, 7), 16, (1, 3, 3), (1, 1, 1), (0, 1, 1), (1, 1, 1), 1),
+    }
+    tolerances = {np.float32: 1e-3, np.float64: 1e-9}
+
+
+    def windows(padded, kernel, stride, dilation, out_size):
+        # the slice of the padded input each kernel position reads, one per output position
+        for offset in np.ndindex(*kernel):
+            index = tuple(slice(o * d, o * d + (n - 1) * s + 1, s) for o, d, n, s in zip(offset, dilation, out_size, stride))
+            yield offset, (Ellipsis,) + index
+
+
+    def reference(x, w, bias, gy, stride, padding, dilation, groups):
+        # out, grad_input and grad_weight in float64, grouped channels split off the channel dim
+        n, c = x.shape[:2]
+        kernel = w.shape[2:]
+        pad = ((0, 0), (0, 0)) + tuple((p, p) for p in padding)
+        xp = np.pad(x, pad).reshape((n, groups, c // groups) + tuple(s + 2 * p for s, p in zip(x.shape[2:], padding)))
+        wg = w.reshape((groups, w.shape[0] // groups) + w.shape[1:])
+        gyg = gy.reshape((n, groups, gy.shape[1] // groups) + gy.shape[2:])
+        out_size = gy.shape[2:]
+        y = np.zeros(gyg.shape)
+        gxp = np.zeros(xp.shape)
+        gw = np.zeros(wg.shape)
+        for offset, index in windows(xp, kernel, stride, dilation, out_size):
+            wk = wg[(Ellipsis,) + offset]
+            y += np.einsum("ngc...,goc->ngo...", xp[index], wk)
+            gxp[index] += np.einsum("ngo...,goc->ngc...", gyg, wk)
+            gw[(Ellipsis,) + offset] = np.einsum("ngop,ngcp->goc", gyg.reshape(gyg.shape[:3] + (-1,)), xp[index].reshape(xp.shape[:3] + (-1,)))
+        y = y.reshape(gy.shape) + bias.reshape((1, -1) + (1,) * len(kernel))
+        gx = gxp.reshape((n, c) + xp.shape[3:])[(Ellipsis,) + tuple(slice(p, p + s) for p, s in zip(padding, x.shape[2:]))]
+        return y, gx, gw.reshape(w.shape)
+
+
+    results = {}
+    for dtype in tolerances:
+        rng = np.random.default_rng(0)
+        for name, (n, c, size, oc, kernel, stride, padding, dilation, groups) in cases.items():
+            dims = len(size)
+            out_size = tuple((s + 2 * p - d * (k - 1) - 1) // t + 1 for s, k, t, p, d in zip(size, kernel, stride, padding, dilation))
+            x = rng.standard_normal((n, c) + size).astype(dtype)
+            w = rng.standard_normal((oc, c // groups) + kernel).astype(dtype)
+            bias = rng.standard_normal(oc).astype(dtype)
+            gy = rng.standard_normal((n, oc) + out_size).astype(dtype)
+            expected = reference(*(a.astype(np.float64) for a in (x, w, bias, gy)), stride, padding, dilation, groups)
+
+            tensors = [Tensor.from_numpy(a, context=context) for a in (x, w, bias, gy)]
+            out = Tensor((n, oc) + out_size, from_numpy_dtype(np.dtype(dtype)), context=context)
+            grad_input = Tensor(x.shape, from_numpy_dtype(np.dtype(dtype)), context=context)
+            grad_weight = Tensor(w.shape, from_numpy_dtype(np.dtype(dtype)), context=context)
+            params = (Sizes(list(stride)), Sizes(list(padding)), Sizes(list(dilation)), groups)
+            check_returncode(check_function("diopiConvolution%dd" % dims)(context, out, tensors[0], tensors[1], tensors[2], *params))
+            check_returncode(check_function("diopiConvolution%ddBackward" % dims)(context, grad_input, grad_weight, None, tensors[3], tensors[0],
+                                                                                  tensors[1], None, *params))
+            for label, tensor, value in zip(("out", "grad_input", "grad_weight"), (out, grad_input, grad_weight), expected):
+                scale = max(1.0, np.abs(value).max())
+                np.testing.assert_allclose(tensor.numpy(), value, rtol=tolerances[dtype], atol=tolerances[dtype] * scale,
+                                           err_msg="%s %s %s" % (np.dtype(dtype).name, name, label))
+                results["%s/%s/%s" % (np.dtype(dtype).name, name, label)] = tensor.numpy()
+    np.savez(sys.argv[1], **results)
+"""
+
+
+def run(run_script, path, **env):
+    run_script(script, path, **env)
+    return np.load(str(path))
+
+
+@pytest.fixture(scope="module")
+def direct(run_script, tmp_path_factory):
+    return run(run_script, tmp_path_factory.mktemp("conv") / "direct.npz", DIOPI_CPU_CONV_ALGO="direct")
+
+
+class TestCpuConv(object):
+    @pytest.mark.parametrize("env", [{"DIOPI_CPU_CONV_ALGO": "im2col"}, {"DIOPI_CPU_CONV_ALGO": "gemm1x1"},
+                                     {"DIOPI_CPU_CONV_ALGO": "winograd2"}, {"DIOPI_CPU_CONV_ALGO": "winograd4"},
+                                     {"DIOPI_CPU_CONV_AUTOTUNE": "1"}, {}],
+                             ids=["im2col", "gemm1x1", "winograd2", "winograd4", "autotune", "heuristic"])
+    def test_algo(self, run_script, env, direct, tmp_path):
+        results = run(run_script, tmp_path / "algo.npz", **env)
+        assert sorted(results.files) == sorted(direct.files)
+        for key in direct.files:
+            tolerance = 1e-3 if key.startswith("float32") else 1e-9
+            scale = max(1.0, np.abs(direct[key]).max())
+            np.testing.assert_allclose(results[key], direct[key], rtol=tolerance, atol=tolerance * scale, err_msg=key)
+
+
+# The backward ops check the gradients against the sizes they are given: grad_bias against bias_sizes, and for the
+# transposed convolution grad_output against the input size and output_padding.
+class TestCpuConvSizes(object):
+    context = Context()
+
+    def tensor(self, array):
+        return Tensor.from_numpy(array.astype(np.float32), context=self.context)
+
+    def test_grad_bias(self):
+        rng = np.random.default_rng(0)
+        x, w, gy = (self.tensor(rng.standard_normal(shape)) for shape in ((1, 2, 5, 5), (3, 2, 3, 3), (1, 3, 3, 3)))
+        params = (Sizes([1, 1]), Sizes([0, 0]), Sizes([1, 1]), 1)
+        backward = check_function("diopiConvolution2dBackward")
+        grad_bias = Tensor((3,), Dtype.float32, context=self.context)
+        assert backward(self.context, None, None, grad_bias, gy, x, w, Sizes([3]), *params) == diopiError.diopi_success
+        np.testing.assert_allclose(grad_bias.numpy(), gy.numpy().sum(axis=(0, 2, 3)), rtol=1e-5)
+        assert backward(self.context, None, None, grad_bias, gy, x, w, Sizes([1, 3]), *params) != diopiError.diopi_success
+        grad_bias = Tensor((4,), Dtype.float32, context=self.context)
+        assert backward(self.context, None, None, grad_bias, gy, x, w, None, *params) != diopiError.diopi_success
+
+    def test_transposed_sizes(self):
+        rng = np.random.default_rng(0)
+        # an input of 4 with stride 2, padding 1 and a 3x3 kernel gives 7, or 8 with an output_padding of 1
+        x, w, gy = (self.tensor(rng.standard_normal(shape)) for shape in ((1, 2, 4, 4), (2, 3, 3, 3), (1, 3, 8, 8)))
+        backward = check_function("diopiConvTranspose2dBackward")
+
+        def run(grad_input, output_padding):
+            return backward(self.context, grad_input, None, None, gy, x, w, None, Sizes([2, 2]), Sizes([1, 1]), Sizes([1, 1]),
+                            Sizes(output_padding), 1)
+
+        assert run(Tensor((1, 2, 4, 4), Dtype.float32, context=self.context), [1, 1]) == diopiError.diopi_success
+        assert run(Tensor((1, 2, 4, 4), Dtype.float32, context=self.context), [0, 0]) != diopiError.diopi_success
+        assert run(Tensor((1, 2, 4, 5), Dtype.float32, context=self.context), [1, 1]) != diopiError.diopi_success
@@ -0,0 +1,80 @@
+import pytest
+
+# The micro-kernel is picked once per process, so each instruction set runs in its own. The shapes straddle the blocks
+# of gemm.cpp (kc = 256, mc = 144 rows, nc = 3072 columns) and the register tiles of every kernel (mr up to 12, nr up
+# to 32), so that every product ends in partial tiles and blocks; k > 256 also accumulates over several blocks of k.
+script = """
+    import numpy as np
+    from diopilib import Context, Dtype
+    from conformance.diopi_functions import check_function, check_returncode
+    from conformance.diopi_runtime import Scalar, Sizes, Tensor, from_numpy_dtype
+
+    context = Context()
+    shapes = [(1, 1, 1), (13, 7, 17), (145, 257, 33), (7, 513, 9), (3, 5, 3075), (4, 0, 5)]
+    tolerances = {np.float16: 2e-2, np.float32: 1e-4, np.float64: 1e-10}
+
+
+    def strides(shape):
+        result = [1] * len(shape)
+        for d in range(len(shape) - 2, -1, -1):
+            result[d] = result[d + 1] * shape[d + 1]
+        return result
+
+
+    def layout(array, kind):
+        # contiguous, transposed (the last two dims swapped in memory) or padded (rows longer than the matrix)
+        shape = list(array.shape)
+        if kind == "transposed":
+            stride = strides(shape[:-2] + [shape[-1], shape[-2]])
+            stride[-1], stride[-2] = stride[-2], stride[-1]
+        elif kind == "padded":
+            stride = strides(shape[:-1] + [shape[-1] + 3])
+        else:
+            stride = strides(shape)
+        tensor = Tensor(shape, from_numpy_dtype(array.dtype), stride=Sizes(stride), context=context)
+        check_returncode(check_function("diopiCopyInp")(context, Tensor.from_numpy(np.ascontiguousarray(array), context=context), tensor))
+        return tensor
+
+
+    def check(out, expected, dtype):
+        np.testing.assert_allclose(out.numpy().astype(np.float64), expected, rtol=tolerances[dtype], atol=tolerances[dtype])
+
+
+    for dtype in tolerances:
+        for m, k, n in shapes:
+            a = np.random.randn(m, k).astype(dtype)
+            b = np.random.randn(k, n).astype(dtype)
+            expected = a.astype(np.float64) @ b.astype(np.float64)
+            for kinds in (("contiguous", "contiguous", "contiguous"), ("transposed", "contiguous", "padded"),
+                          ("contiguous", "transposed", "transposed"), ("padded", "padded", "contiguous"),
+                          ("transposed", "transposed", "padded")):
+                out = layout(np.zeros((m, n), dtype), kinds[2])
+                check_returncode(check_function("diopiMm")(context, out, layout(a, kinds[0]), layout(b, kinds[1])))
+                check(out, expected, dtype)
+
+            # the bias seen with a zero row stride, written on the first block of k only
+            bias = np.random.randn(n).astype(dtype)
+            out = layout(np.zeros((m, n), dtype), "padded")
+            check_returncode(check_function("diopiAddmm")(context, out, Tensor.from_numpy(bias, context=context), layout(a, "transposed"),
+                                                         layout(b, "padded"), Scalar(0.5), Scalar(2.0)))
+            check(out, 0.5 * bias.astype(np.float64) + 2.0 * expected, dtype)
+
+        # batches: b broadcast over the batch of a, then batches with their own transposed b and an in-place addend
+        a = np.random.randn(3, 37, 261).astype(dtype)
+        b = np.random.randn(261, 19).astype(dtype)
+        out = Tensor((3, 37, 19), from_numpy_dtype(np.dtype(dtype)), context=context)
+        check_returncode(check_function("diopiMatmul")(context, out, layout(a, "padded"), layout(b, "transposed")))
+        check(out, a.astype(np.float64) @ b.astype(np.float64), dtype)
+
+        batch2 = np.random.randn(3, 261, 19).astype(dtype)
+        addend = np.random.randn(3, 37, 19).astype(dtype)
+        out = layout(addend, "transposed")
+        check_returncode(check_function("diopiBaddbmm")(context, out, out, layout(a, "contiguous"), layout(batch2, "transposed"), 0.25, 1.5))
+        check(out, 0.25 * addend.astype(np.float64) + 1.5 * (a.astype(np.float64) @ batch2.astype(np.float64)), dtype)
+"""
+
+
+class TestCpuGemm(object):
+    @pytest.mark.parametrize("isa", ["generic", "avx2", "avx512"])
+    def test_gemm(self, run_script, isa):
+        run_script(script, DIOPI_CPU_MAX_ISA=isa)
@@ -0,0 +1,196 @@
+import importlib.util
+import os
+import sys
+
+import numpy as np
+import pytest
+
+from diopilib import Context, diopiError
+from conformance.diopi_functions import check_function, check_returncode, convert_round_mode
+from conformance.diopi_runtime import Scalar, Sizes, Tensor, TensorP, from_numpy_dtype
+
+impl_folder = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "..", "..", "impl", "cpu")
+
+
+def softmax(x, axis):
+    e = np.exp(x - x.max(axis=axis, keepdims=True))
+    return e / e.sum(axis=axis, keepdims=True)
+
+
+# Checks the cpu kernels against numpy across the dtypes info.cpp reports for them, including
+# broadcast and strided inputs; the full conformance run needs torch generated reference data.
+class TestCpuKernels(object):
+    context = Context()
+
+    def tensor(self, array):
+        return Tensor.from_numpy(np.ascontiguousarray(array), context=self.context)
+
+    def empty(self, shape, dtype):
+        return Tensor(shape, from_numpy_dtype(np.dtype(dtype)), context=self.context)
+
+    def values(self, shape, dtype):
+        if dtype == np.bool_:
+            return np.random.rand(*shape) > 0.5
+        if np.issubdtype(dtype, np.integer):
+            return np.random.randint(1, 10, size=shape).astype(dtype)
+        return (np.random.rand(*shape) + 0.5).astype(dtype)
+
+    @pytest.mark.parametrize("dtype", [np.float16, np.float32, np.float64, np.int8, np.uint8, np.int32, np.int64])
+    def test_binary(self, dtype):
+        x = self.values((4, 1, 5), dtype)
+        y = self.values((3, 5), dtype)
+        rtol = 1e-3 if dtype == np.float16 else 1e-6
+        cases = [("diopiAdd", (Scalar(2),), x + 2 * y), ("diopiSub", (Scalar(1),), x - y), ("diopiMul", (), x * y)]
+        for name, extra, expected in cases:
+            out = self.empty(expected.shape, dtype)
+            check_returncode(check_function(name)(self.context, out, self.tensor(x), self.tensor(y), *extra))
+            np.testing.assert_allclose(out.numpy(), expected.astype(dtype), rtol=rtol)
+
+    @pytest.mark.parametrize("dtype", [np.float16, np.float32, np.float64])
+    def test_div_strided(self, dtype):
+        x = self.values((6, 8), dtype)
+        y = self.values((6, 8), dtype)
+        other = Tensor((6, 8), from_numpy_dtype(np.dtype(dtype)), stride=Sizes([1, 6]), context=self.context)
+        check_returncode(check_function("diopiCopyInp")(self.context, self.tensor(y), other))
+        out = self.empty((6, 8), dtype)
+        check_returncode(check_function("diopiDiv")(self.context, out, self.tensor(x), other, convert_round_mode(None)))
+        np.testing.assert_allclose(out.numpy(), x / y, rtol=1e-3 if dtype == np.float16 else 1e-6)
+
+    @pytest.mark.parametrize("name, ref", [("diopiExp", np.exp), ("diopiSqrt", np.sqrt), ("diopiTanh", np.tanh),
+                                           ("diopiLog", np.log), ("diopiSigmoid", lambda x: 1 / (1 + np.exp(-x)))])
+    @pytest.mark.parametrize("dtype", [np.float32, np.float64, np.int32, np.uint8, np.bool_])
+    def test_floating_unary(self, name, ref, dtype):
+        # integral and bool inputs are promoted to the floating out like torch does
+        x = self.values((7, 9), dtype)
+        out = self.empty(x.shape, np.float64 if dtype == np.float64 else np.float32)
+        check_returncode(check_function(name)(self.context, out, self.tensor(x)))
+        with np.errstate(divide="ignore"):
+            np.testing.assert_allclose(out.numpy(), ref(x.astype(np.float64)), rtol=1e-5)
+
+    @pytest.mark.parametrize("dtype", [np.float32, np.int8, np.int64])
+    def test_abs_neg(self, dtype):
+        x = (self.values((5, 6), dtype) - 5).astype(dtype)
+        for name, expected in (("diopiAbs", np.abs(x)), ("diopiNeg", -x)):
+            out = self.empty(x.shape, dtype)
+            check_returncode(check_function(name)(self.context, out, self.tensor(x)))
+            np.testing.assert_array_equal(out.numpy(), expected)
+
+    def test_abs_bool_not_supported(self):
+        # the case device_configs.py skips
+        x = self.tensor(np.array([True, False]))
+        out = self.empty((2,), np.bool_)
+        assert check_function("diopiAbs")(self.context, out, x) == diopiError.diopi_dtype_not_supported
+
+    @pytest.mark.parametrize("dtype", [np.float32, np.int32, np.bool_])
+    def test_compare_where(self, dtype):
+        x = self.values((4, 5), dtype)
+        y = self.values((4, 5), dtype)
+        for name, expected in (("diopiEq", x == y), ("diopiLt", x < y)):
+            out = self.empty(x.shape, np.bool_)
+            check_returncode(check_function(name)(self.context, out, self.tensor(x), self.tensor(y)))
+            np.testing.assert_array_equal(out.numpy(), expected)
+        cond = x >= y
+        out = self.empty(x.shape, dtype)
+        check_returncode(check_function("diopiWhere")(self.context, out, self.tensor(cond), self.tensor(x), self.tensor(y)))
+        np.testing.assert_array_equal(out.numpy(), np.where(cond, x, y))
+
+    def test_clamp(self):
+        x = np.random.randn(6, 7).astype(np.float32)
+        out = self.empty(x.shape, np.float32)
+        check_returncode(check_function("diopiClampScalar")(self.context, out, self.tensor(x), Scalar(-0.5), Scalar(0.5)))
+        np.testing.assert_allclose(out.numpy(), np.clip(x, -0.5, 0.5))
+
+    @pytest.mark.parametrize("dtype", [np.float32, np.float64, np.int32, np.bool_])
+    def test_sum_mean(self, dtype):
+        x = self.values((3, 4, 5), dtype)
+        out_dtype = np.int64 if dtype in (np.int32, np.bool_) else dtype
+        for dims in ([], [1], [0, 2]):
+            axis = tuple(dims) if dims else None
+            expected = x.sum(axis=axis, dtype=out_dtype)
+            out = self.empty(np.shape(expected), out_dtype)
+            check_returncode(check_function("diopiSum")(self.context, out, self.tensor(x), Sizes(dims)))
+            np.testing.assert_allclose(out.numpy(), expected, rtol=1e-5)
+        if out_dtype != np.int64:
+            out = self.empty((3, 5), dtype)
+            check_returncode(check_function("diopiMean")(self.context, out, self.tensor(x), Sizes([1])))
+            np.testing.assert_allclose(out.numpy(), x.mean(axis=1), rtol=1e-5)
+
+    @pytest.mark.parametrize("dtype", [np.float32, np.float64])
+    def test_matmul(self, dtype):
+        a = np.random.randn(33, 17).astype(dtype)
+        b = np.random.randn(17, 21).astype(dtype)
+        bias = np.random.randn(21).astype(dtype)
+        out = self.empty((33, 21), dtype)
+        check_returncode(check_function("diopiMm")(self.context, out, self.tensor(a), self.tensor(b)))
+        np.testing.assert_allclose(out.numpy(), a @ b, rtol=1e-4, atol=1e-4)
+        check_returncode(check_function("diopiAddmm")(self.context, out, self.tensor(bias), self.tensor(a), self.tensor(b), Scalar(0.5), Scalar(2.0)))
+        np.testing.assert_allclose(out.numpy(), 0.5 * bias + 2.0 * (a @ b), rtol=1e-4, atol=1e-4)
+        batch = np.random.randn(3, 33, 17).astype(dtype)
+        out = self.empty((3, 33, 21), dtype)
+        check_returncode(check_function("diopiMatmul")(self.context, out, self.tensor(batch), self.tensor(b)))
+        np.testing.assert_allclose(out.numpy(), batch @ b, rtol=1e-4, atol=1e-4)
+
+    @pytest.mark.parametrize("dim", [0, 1, -1])
+    def test_softmax(self, dim):
+        x = np.random.randn(4, 6, 5).astype(np.float32)
+        out = self.empty(x.shape, np.float32)
+        check_returncode(check_function("diopiSoftmax")(self.context, out, self.tensor(x), dim))
+        np.testing.assert_allclose(out.numpy(), softmax(x, dim), rtol=1e-5, atol=1e-6)
+
+    @pytest.mark.parametrize("dim", [0, 1, -1])
+    def test_cat(self, dim):
+        parts = [np.random.randn(2, 3, 4).astype(np.float32) for _ in range(3)]
+        expected = np.concatenate(parts, axis=dim)
+        out = self.empty(expected.shape, np.float32)
+        tensors = [self.tensor(p) for p in parts]
+        handles = [TensorP(t) for t in tensors]
+        check_returncode(check_function("diopiCat")(self.context, out, handles, len(handles), dim))
+        np.testing.assert_array_equal(out.numpy(), expected)
+
+    def test_cat_shape_mismatch(self):
+        tensors = [self.tensor(np.zeros((2, 3), np.float32)), self.tensor(np.zeros((2, 4), np.float32))]
+        handles = [TensorP(t) for t in tensors]
+        out = self.empty((4, 3), np.float32)
+        assert check_function("diopiCat")(self.context, out, handles, 2, 0) == diopiError.diopi_error_occurred
+
+    @pytest.mark.parametrize("isa", ["generic", "avx2", "avx512"])
+    def test_isa(self, run_script, isa):
+        # the vectorized loops are built per instruction set and picked once per process, lengths off the vector widths
+        # leave a scalar tail and the scalar operand takes the broadcast register
+        run_script("""
+            import numpy as np
+            from diopilib import Context
+            from conformance.diopi_functions import check_function, check_returncode
+            from conformance.diopi_runtime import Scalar, Tensor, from_numpy_dtype
+
+            context = Context()
+            for dtype, rtol in ((np.float16, 1e-3), (np.float32, 2e-6), (np.float64, 1e-12), (np.int8, 0), (np.int64, 0)):
+                for n in (1, 7, 33, 1000):
+                    x = (np.random.rand(n) * 8 - 3).astype(dtype)
+                    y = (np.random.rand(n) * 8 - 3).astype(dtype)
+                    cases = [("diopiAdd", (y, Scalar(1)), x + y),
+                             ("diopiMul", (y[:1],), x * y[:1]),
+                             ("diopiMaximum", (y,), np.maximum(x, y))]
+                    if np.issubdtype(dtype, np.floating):
+                        cases.append(("diopiExp", (), np.exp(x.astype(np.float64))))
+                    for name, extra, expected in cases:
+                        out = Tensor(x.shape, from_numpy_dtype(np.dtype(dtype)), context=context)
+                        args = [Tensor.from_numpy(a, context=context) if isinstance(a, np.ndarray) else a for a in extra]
+                        check_returncode(check_function(name)(context, out, Tensor.from_numpy(x, context=context), *args))
+                        np.testing.assert_allclose(out.numpy(), expected.astype(dtype), rtol=rtol)
+        """, DIOPI_CPU_MAX_ISA=isa)
+
+    def test_device_configs(self):
+        # the skip rules main.py applies to the generated cases for this impl
+        from conformance import collect_case
+        sys.path.insert(0, os.path.dirname(collect_case.__file__))
+        try:
+            spec = importlib.util.spec_from_file_location("cpu_device_configs", os.path.join(impl_folder, "device_configs.py"))
+            module = importlib.util.module_from_spec(spec)
+            spec.loader.exec_module(module)
+        finally:
+            sys.path.pop(0)
+        config = collect_case.DeviceConfig(module.device_configs)
+        config.run()
+        rules = config.rules()
+        assert rules["pointwise_op_bool::abs"]["skip"]["tensor_para"]["input"]["dtype"] == {np.bool_}
@@ -0,0 +1,80 @@
+import importlib.util
+import os
+import shutil
+import subprocess
+import textwrap
+
+import pytest
+
+repo = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "..", "..")
+include = os.path.join(repo, "proto", "include")
+pytestmark = pytest.mark.skipif(shutil.which("g++") is None, reason="needs g++ to build the wrapper")
+
+
+def generate(path, headers):
+    # a fresh module per wrapper, the generator collects the functions in module globals
+    spec = importlib.util.spec_from_file_location("code_gen", os.path.join(repo, "impl", "torch", "code_gen.py"))
+    code_gen = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(code_gen)
+    for lines in headers:
+        code_gen.gen_wrapper_func(lines)
+    code_gen.write_wrapper_file(str(path))
+    return code_gen.func_names
+
+
+def build(*args):
+    result = subprocess.run(["g++", "-std=c++14", "-I" + include] + [str(arg) for arg in args], capture_output=True, text=True)
+    assert result.returncode == 0, result.stderr
+
+
+# The DYLOAD wrapper forwards every function of the proto headers to libdiopi_real_impl.so through a table filled
+# when it is loaded; a slot left empty is looked up again on its first call and reported once if still missing.
+class TestDyloadWrapper(object):
+    def test_proto_headers(self, tmp_path):
+        headers = []
+        for name in ("functions.h", "functions_mmcv.h", "functions_ext.h"):
+            with open(os.path.join(include, "diopi", name)) as header:
+                headers.append(header.readlines())
+        assert len(generate(tmp_path / "wrap_func.cpp", headers)) > 0
+        build("-fsyntax-only", tmp_path / "wrap_func.cpp")
+
+    def test_no_functions(self, tmp_path):
+        assert generate(tmp_path / "wrap_func.cpp", [[]]) == []
+        build("-fsyntax-only", tmp_path / "wrap_func.cpp")
+
+    def test_missing_symbol(self, tmp_path):
+        declarations = [
+            "DIOPI_API diopiError_t diopiBmm(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input,\n",
+            "                                diopiConstTensorHandle_t mat2);\n",
+            "DIOPI_API diopiError_t diopiMm(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t mat2);\n",
+        ]
+        assert generate(tmp_path / "wrap_func.cpp", [declarations]) == ["diopiBmm", "diopiMm"]
+        # the real library implements diopiBmm only
+        (tmp_path / "real.cpp").write_text(textwrap.dedent("""
+            #include <diopi/functions.h>
+
+            diopiError_t diopiBmm(diopiContextHandle_t, diopiTensorHandle_t, diopiConstTensorHandle_t, diopiConstTensorHandle_t) { return diopiSuccess; }
+        """))
+        (tmp_path / "main.cpp").write_text(textwrap.dedent("""
+            #include <diopi/functions.h>
+            #include <stdio.h>
+
+            int main() {
+                printf("bmm %d\\n", diopiBmm(NULL, NULL, NULL, NULL));
+                for (int i = 0; i < 3; ++i) {
+                    printf("mm %d\\n", diopiMm(NULL, NULL, NULL, NULL));
+                }
+                return 0;
+            }
+        """))
+        build("-shared", "-fPIC", tmp_path / "real.cpp", "-o", tmp_path / "libdiopi_real_impl.so")
+        build("-shared", "-fPIC", tmp_path / "wrap_func.cpp", "-o", tmp_path / "libdiopi_impl.so", "-ldl")
+        # the program only holds weak references to the wrapper, which --as-needed would drop
+        build(tmp_path / "main.cpp", "-L" + str(tmp_path), "-Wl,--no-as-needed", "-ldiopi_impl", "-o", tmp_path / "main")
+        env = dict(os.environ, LD_LIBRARY_PATH=str(tmp_path))
+        result = subprocess.run([str(tmp_path / "main")], env=env, capture_output=True, text=True)
+        assert result.returncode == 0, result.stdout + result.stderr
+        lines = result.stdout.splitlines()
+        assert "bmm 0" in lines
+        assert lines.count("mm 1") == 3
+        assert lines.count("[wrap_func] diopiMm not implemented!") == 1
@@ -0,0 +1,136 @@
+import time
+
+import numpy as np
+import pytest
+
+from diopilib import (
+    Context,
+    Dtype,
+    diopi_tensor_copy_from_buffer_async,
+    diopi_tensor_copy_to_buffer_async,
+    event_elapsed_time,
+    event_query,
+    event_record,
+    event_synchronize,
+    stream_wait_event,
+)
+from conformance.diopi_functions import check_function, check_returncode
+from conformance.diopi_runtime import Scalar, Tensor
+
+
+class TestEvents(object):
+    def test_record_and_synchronize(self):
+        context = Context()
+        event = context.create_event()
+        event_record(event, context.stream())
+        event_synchronize(event)
+        assert event_query(event)
+        context.destroy_event(event)
+
+    def test_elapsed_time_needs_recorded_events(self):
+        context = Context()
+        start = context.create_event()
+        end = context.create_event()
+        event_record(start, context.stream())
+        with pytest.raises(RuntimeError):
+            event_elapsed_time(start, end)
+        context.destroy_event(start)
+        context.destroy_event(end)
+
+    def test_elapsed_time_covers_the_kernel(self):
+        # an emulated event is stamped once the work queued before it has completed, so the time between two events
+        # around a kernel is close to the time the kernel took rather than the time it took to enqueue it
+        context = Context()
+        start = context.create_event()
+        end = context.create_event()
+        x = np.random.rand(1024, 1024)
+        input = Tensor.from_numpy(x, context=context)
+        out = Tensor(x.shape, Dtype.float64, context=context)
+        began = time.perf_counter()
+        event_record(start, context.stream())
+        check_returncode(check_function("diopiMm")(context, out, input, input))
+        event_record(end, context.stream())
+        event_synchronize(end)
+        wall = (time.perf_counter() - began) * 1e3
+        elapsed = event_elapsed_time(start, end)
+        assert 0.5 * wall <= elapsed <= wall, (elapsed, wall)
+        context.destroy_event(start)
+        context.destroy_event(end)
+
+    def test_untimed_events(self):
+        context = Context()
+        start = context.create_event(disable_timing=True)
+        end = context.create_event(disable_timing=True)
+        event_record(start, context.stream())
+        event_record(end, context.stream())
+        # an emulated event that is still pending is waited for, so the query reports it completed
+        assert event_query(end)
+        with pytest.raises(RuntimeError):
+            event_elapsed_time(start, end)
+        context.destroy_event(start)
+        context.destroy_event(end)
+
+    def test_destroy_foreign_event(self):
+        context = Context()
+        other = Context()
+        event = other.create_event()
+        with pytest.raises(RuntimeError):
+            context.destroy_event(event)
+        other.destroy_event(event)
+
+    def test_pool_streams(self):
+        context = Context()
+        pool = [context.stream_from_pool() for _ in range(8)]
+        # the pool holds four distinct streams, apart from the main one, handed out round-robin
+        assert len(set(pool[:4])) == 4
+        assert context.stream() not in pool
+        assert pool[4:] == pool[:4]
+
+    def test_ordering_across_pool_streams(self):
+        context = Context()
+        first = context.stream_from_pool()
+        second = context.stream_from_pool()
+        assert first != second
+
+        produced = context.create_event()
+        consumed = context.create_event()
+        event_record(produced, first)
+        # the work queued on the second stream after the wait starts once the first stream reached the event
+        stream_wait_event(second, produced)
+        event_record(consumed, second)
+        event_synchronize(consumed)
+        assert event_query(produced)
+        assert event_query(consumed)
+        assert event_elapsed_time(produced, consumed) >= 0.0
+        context.destroy_event(produced)
+        context.destroy_event(consumed)
+
+    def test_async_copies_on_pool_streams(self):
+        # the upload runs on a pool stream and the kernel on the stream of the context waits for it, the download runs on
+        # another pool stream after the kernel
+        context = Context()
+        upload = context.stream_from_pool()
+        download = context.stream_from_pool()
+        # untimed events keep the copies from being waited for when they are recorded
+        uploaded = context.create_event(disable_timing=True)
+        computed = context.create_event(disable_timing=True)
+        downloaded = context.create_event(disable_timing=True)
+        x = np.random.rand(64, 33).astype(np.float32)
+        input = Tensor(x.shape, Dtype.float32, context=context)
+        diopi_tensor_copy_from_buffer_async(context, x, input, upload, uploaded)
+        stream_wait_event(context.stream(), uploaded)
+        out = Tensor(x.shape, Dtype.float32, context=context)
+        check_returncode(check_function("diopiAddScalar")(context, out, input, Scalar(1.0), Scalar(1.0)))
+        event_record(computed, context.stream())
+        stream_wait_event(download, computed)
+        result = np.empty_like(x)
+        diopi_tensor_copy_to_buffer_async(context, out, result, download, downloaded)
+        event_synchronize(downloaded)
+        assert event_query(uploaded) and event_query(computed)
+        np.testing.assert_allclose(result, x + 1, rtol=1e-6)
+        # without a stream the copies go on the stream of the context
+        diopi_tensor_copy_to_buffer_async(context, input, result)
+        context.synchronize()
+        np.testing.assert_array_equal(result, x)
+        for event in (uploaded, computed, downloaded):
+            context.destroy_event(event)
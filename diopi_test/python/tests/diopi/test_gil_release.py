@@ -0,0 +1,42 @@
+import time
+from threading import Thread
+
+import numpy as np
+
+from diopilib import Context
+from conformance.diopi_functions import check_function, check_returncode
+from conformance.diopi_runtime import Dtype, Tensor
+
+
+# The generated bindings release the GIL for the DIOPI call, so a Python thread keeps running while another one is
+# inside a kernel. Were the GIL held, the ticks of the main thread could not fall inside a call.
+class TestGilRelease(object):
+    def test_python_runs_during_a_kernel(self):
+        context = Context()
+        x = np.random.rand(1024, 1024)
+        input = Tensor.from_numpy(x, context=context)
+        outs = [Tensor((1024, 1024), Dtype.float64, context=context) for _ in range(4)]
+        calls = []
+
+        def work():
+            for out in outs:
+                start = time.perf_counter()
+                check_returncode(check_function("diopiMm")(context, out, input, input))
+                calls.append((start, time.perf_counter()))
+
+        worker = Thread(target=work)
+        ticks = []
+        worker.start()
+        while worker.is_alive():
+            ticks.append(time.perf_counter())
+        worker.join()
+
+        # the Python code around the kernel lets the main thread in as well, so only the early middle of a call counts
+        overlapped = 0
+        for start, end in calls:
+            duration = end - start
+            overlapped += any(start + 0.2 * duration < tick < start + 0.6 * duration for tick in ticks)
+        assert overlapped >= len(calls) // 2, (calls, len(ticks))
+        expected = x @ x
+        for out in outs:
+            np.testing.assert_allclose(out.numpy(), expected, rtol=1e-10)
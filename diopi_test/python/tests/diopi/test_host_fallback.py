@@ -0,0 +1,74 @@
+import os
+
+import pytest
+
+from diopilib import diopiAdaptorFallbackDump, diopiError
+
+
+SCRIPT = """
+import sys
+
+import numpy as np
+from diopilib import Context, Device, Dtype, diopiAdaptorFallbackDump, diopiError
+from conformance.diopi_runtime import Tensor, Scalar
+from conformance.diopi_functions import check_function, check_returncode
+
+context = Context()
+x = np.random.rand(3, 5).astype(np.float32)
+y = np.random.rand(3, 5).astype(np.float32)
+input = Tensor.from_numpy(x, context=context, device=Device.AIChip)
+other = Tensor.from_numpy(y, context=context, device=Device.AIChip)
+out = Tensor((3, 5), Dtype.float32, context=context, device=Device.AIChip)
+check_returncode(check_function("diopiAdd")(context, out, input, other, Scalar(2)))
+np.testing.assert_allclose(out.numpy(), x + 2 * y, rtol=1e-6)
+check_returncode(check_function("diopiAddInp")(context, input, other, Scalar(1)))
+np.testing.assert_allclose(input.numpy(), x + y, rtol=1e-6)
+assert diopiAdaptorFallbackDump(sys.argv[1]) == diopiError.diopi_success
+"""
+
+
+def impl_library():
+    # the vendor library already loaded by the test process serves as its own fallback
+    with open("/proc/self/maps") as maps:
+        for line in maps:
+            path = line.split()[-1]
+            if os.path.basename(path) == "libdiopi_impl.so":
+                return path
+    raise RuntimeError("libdiopi_impl.so is not loaded")
+
+
+@pytest.fixture
+def run_with_fallback(run_script, tmp_path):
+    def run(forced_ops):
+        report = tmp_path / "fallback.txt"
+        run_script(SCRIPT, report, DIOPI_FALLBACK_LIB=impl_library(), DIOPI_FALLBACK_OPS=forced_ops)
+        return report.read_text()
+
+    return run
+
+
+def report_rows(report):
+    rows = {}
+    for line in report.splitlines():
+        fields = line.split()
+        if len(fields) == 5 and fields[1].isdigit():
+            rows[fields[0]] = (int(fields[1]), int(fields[2]))
+    return rows
+
+
+class TestHostFallback(object):
+    def test_forced_ops_match_reference(self, run_with_fallback):
+        rows = report_rows(run_with_fallback("diopiAdd,diopiAddInp"))
+        assert rows.get("Add") == (1, 0)
+        assert rows.get("AddInp") == (1, 0)
+
+    def test_only_listed_ops_fall_back(self, run_with_fallback):
+        rows = report_rows(run_with_fallback("diopiAddInp"))
+        assert "Add" not in rows
+        assert rows.get("AddInp") == (1, 0)
+
+    def test_vendor_kernels_without_forcing(self, run_with_fallback):
+        assert report_rows(run_with_fallback("")) == {}
+
+    def test_dump_needs_the_library(self, tmp_path):
+        assert diopiAdaptorFallbackDump(str(tmp_path / "fallback.txt")) == diopiError.diopi_not_inited
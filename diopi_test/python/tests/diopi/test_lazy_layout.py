@@ -0,0 +1,74 @@
+import textwrap
+
+import pytest
+
+
+PRELUDE = """
+import gc
+import numpy as np
+from diopilib import Context, Device, Dtype, adopt_layout
+from conformance.diopi_runtime import Tensor
+
+context = Context()
+data = np.random.rand(2, 3, 4, 5).astype(np.float32)
+# the same values in channels last
+channels_last = np.ascontiguousarray(data.transpose(0, 2, 3, 1)).transpose(0, 3, 1, 2)
+"""
+
+
+# the switch is read once per process
+@pytest.fixture
+def run_with_lazy_layout(run_script):
+    return lambda script: run_script(PRELUDE + textwrap.dedent(script), DIOPI_LAZY_LAYOUT="1")
+
+
+class TestLazyLayout(object):
+    def test_adopt_layout(self, run_with_lazy_layout):
+        run_with_lazy_layout("""
+            for device in (Device.Host, Device.AIChip):
+                dst = Tensor((2, 3, 4, 5), Dtype.float32, context=context, device=device)
+                src = Tensor.from_numpy(channels_last, context=context, device=device)
+                assert adopt_layout(dst, src)
+                assert dst.get_stride().data == src.get_stride().data
+                np.testing.assert_array_equal(dst.numpy(), data)
+        """)
+
+    def test_refused_while_exported(self, run_with_lazy_layout):
+        run_with_lazy_layout("""
+            dst = Tensor.from_numpy(data, context=context, device=Device.Host)
+            exported = dst.numpy(copy=False)
+            src = Tensor.from_numpy(channels_last, context=context, device=Device.Host)
+            # the array still points into the storage of dst
+            assert not adopt_layout(dst, src)
+            assert dst.get_stride().data == [60, 20, 5, 1]
+            np.testing.assert_array_equal(exported, data)
+
+            del exported
+            gc.collect()
+            assert adopt_layout(dst, src)
+            np.testing.assert_array_equal(dst.numpy(), data)
+        """)
+
+    def test_refused_while_source_exported(self, run_with_lazy_layout):
+        run_with_lazy_layout("""
+            src = Tensor.from_numpy(channels_last, context=context, device=Device.Host)
+            exported = src.numpy(copy=False)
+            dst = Tensor.from_numpy(data, context=context, device=Device.Host)
+            assert not adopt_layout(dst, src)
+            del exported
+            gc.collect()
+            assert adopt_layout(dst, src)
+        """)
+
+    def test_ops(self, run_with_lazy_layout):
+        # the adaptor may hand its outputs the layout of the kernel, the values must not change
+        run_with_lazy_layout("""
+            from conformance.diopi_functions import check_function, check_returncode
+            from conformance.diopi_runtime import Scalar
+
+            input = Tensor.from_numpy(channels_last, context=context)
+            other = Tensor.from_numpy(data, context=context)
+            out = Tensor.from_numpy(np.zeros_like(data), context=context)
+            check_returncode(check_function("diopiAdd")(context, out, input, other, Scalar(1.0)))
+            np.testing.assert_allclose(out.numpy(), 2 * data)
+        """)
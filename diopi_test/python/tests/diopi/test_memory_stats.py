@@ -0,0 +1,44 @@
+from diopilib import Context, Device, Dtype, empty_cache, get_memory_stats, get_pinned_memory_stats, reset_peak_memory_stats
+from conformance.diopi_runtime import Tensor
+
+
+class TestMemoryStats(object):
+    context = Context()
+
+    def test_allocated_bytes(self):
+        before = get_memory_stats(self.context, Device.AIChip)
+        tensor = Tensor(size=(1024, 256), dtype=Dtype.float32, context=self.context)
+        during = get_memory_stats(self.context, Device.AIChip)
+        assert during.allocated_bytes - before.allocated_bytes == 1024 * 256 * 4
+        assert during.reserved_bytes >= during.allocated_bytes
+        del tensor
+        after = get_memory_stats(self.context, Device.AIChip)
+        assert after.allocated_bytes == before.allocated_bytes
+
+    def test_reset_peak(self):
+        tensor = Tensor(size=(4096, 256), dtype=Dtype.float32, context=self.context)
+        del tensor
+        before = get_memory_stats(self.context, Device.AIChip)
+        assert before.peak_allocated_bytes >= 4096 * 256 * 4 + before.allocated_bytes
+
+        reset_peak_memory_stats(self.context, Device.AIChip)
+        stats = get_memory_stats(self.context, Device.AIChip)
+        assert stats.peak_allocated_bytes == stats.allocated_bytes
+        # the allocation counts are cumulative, a reset leaves them alone
+        assert stats.num_allocs == before.num_allocs
+        assert stats.num_device_allocs == before.num_device_allocs
+
+    def test_empty_cache(self):
+        # the snapshot exported from a device tensor is staged in pinned memory, which is cached like the rest
+        tensor = Tensor(size=(1024, 256), dtype=Dtype.float32, context=self.context)
+        host = Tensor(size=(1024, 256), dtype=Dtype.float32, context=self.context, device=Device.Host)
+        array = tensor.numpy(copy=False)
+        del tensor, host, array
+        assert get_memory_stats(self.context, Device.AIChip).cached_bytes >= 1024 * 256 * 4
+        assert get_memory_stats(self.context, Device.Host).cached_bytes >= 1024 * 256 * 4
+        assert get_pinned_memory_stats().cached_bytes >= 1024 * 256 * 4
+
+        empty_cache()
+        assert get_memory_stats(self.context, Device.AIChip).cached_bytes == 0
+        assert get_memory_stats(self.context, Device.Host).cached_bytes == 0
+        assert get_pinned_memory_stats().cached_bytes == 0
@@ -0,0 +1,197 @@
+import json
+
+import pytest
+
+
+# DIOPI_RECORD_ENV is read once per process, so every case records in a fresh interpreter and ends it with
+# diopiFinalize, which writes the trace and prints the summary
+@pytest.fixture
+def profile(run_script, tmp_path):
+    trace_file = tmp_path / "trace.json"
+
+    def run(source, **env):
+        result = run_script(source, DIOPI_RECORD_ENV="1", DIOPIRT_PROFILE_FILE=str(trace_file), **env)
+        with open(trace_file) as trace:
+            trace = json.load(trace)
+        # the chrome trace format: complete events in microseconds
+        assert trace["displayTimeUnit"] == "ns"
+        for event in trace["traceEvents"]:
+            assert event["ph"] == "X"
+            assert event["pid"] == 0
+            assert isinstance(event["tid"], int)
+            assert event["ts"] >= 0 and event["dur"] >= 0
+            assert set(event["args"]) == {"depth", "bytes"}
+        summary = {}
+        for line in result.stdout.splitlines():
+            row = line.split()
+            if len(row) == 7 and row[0] != "name":
+                summary[row[0]] = {"calls": int(row[1]), "total": float(row[2]), "self": float(row[3]), "bytes": int(row[6])}
+        return trace["traceEvents"], summary, result.stdout
+
+    return run
+
+
+def by_name(events):
+    spans = {}
+    for event in events:
+        spans.setdefault(event["name"], []).append(event)
+    return spans
+
+
+class TestProfiler(object):
+    def test_nesting(self, profile):
+        script = """
+            import time
+
+            from diopilib import diopi_finalize, record_end, record_start
+
+            outer = record_start("outer")
+            time.sleep(0.01)
+            inner = record_start("inner")
+            time.sleep(0.02)
+            record_end(inner)
+            record_end(outer)
+            diopi_finalize()
+        """
+        events, summary, _ = profile(script)
+        spans = by_name(events)
+        outer, inner = spans["outer"][0], spans["inner"][0]
+        assert outer["args"]["depth"] == 0
+        assert inner["args"]["depth"] == 1
+        assert outer["ts"] <= inner["ts"] and inner["ts"] + inner["dur"] <= outer["ts"] + outer["dur"]
+        assert inner["dur"] >= 20e3
+        # the time of the inner span counts for the outer one in total, not in self
+        assert summary["outer"]["total"] >= summary["inner"]["total"] + 10
+        assert summary["outer"]["self"] == pytest.approx(summary["outer"]["total"] - summary["inner"]["total"], abs=2e-3)
+        assert summary["inner"]["self"] == summary["inner"]["total"]
+
+    def test_bytes(self, profile):
+        script = """
+            from diopilib import Context, Device, Dtype, diopi_finalize, record_end, record_start
+
+            context = Context()
+            outer = record_start("outer")
+            context.require_tensor([4, 8], Dtype.float32, Device.AIChip)
+            inner = record_start("inner")
+            context.require_tensor([4, 4], Dtype.int16, Device.Host)
+            record_end(inner)
+            record_end(outer)
+            empty = record_start("empty")
+            record_end(empty)
+            diopi_finalize()
+        """
+        events, summary, _ = profile(script)
+        spans = by_name(events)
+        # the bytes of diopiRequireTensor within a span, nested spans included
+        assert spans["inner"][0]["args"]["bytes"] == 32
+        assert spans["outer"][0]["args"]["bytes"] == 128 + 32
+        assert spans["empty"][0]["args"]["bytes"] == 0
+        assert summary["outer"]["bytes"] == 160
+
+    def test_names_from_one_buffer(self, profile):
+        # the binding passes every name through the same char buffer, each span keeps the name it was started with
+        script = """
+            from diopilib import diopi_finalize, record_end, record_start
+
+            for name in ("first", "second", "first", "third"):
+                record_end(record_start(name))
+            outer = record_start("outer")
+            inner = record_start("inner")
+            record_end(inner)
+            record_end(outer)
+            diopi_finalize()
+        """
+        events, summary, _ = profile(script)
+        assert [event["name"] for event in events] == ["first", "second", "first", "third", "inner", "outer"]
+        assert summary["first"]["calls"] == 2
+
+    def test_threads(self, profile):
+        script = """
+            import threading
+
+            from diopilib import diopi_finalize, record_end, record_start
+
+            barrier = threading.Barrier(4)
+
+
+            def work(index):
+                barrier.wait()
+                for _ in range(50):
+                    outer = record_start("thread%d" % index)
+                    inner = record_start("inner")
+                    record_end(inner)
+                    record_end(outer)
+
+
+            threads = [threading.Thread(target=work, args=(index,)) for index in range(4)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+            diopi_finalize()
+        """
+        events, summary, _ = profile(script)
+        spans = by_name(events)
+        # each thread has a buffer of its own, a span and its children share its tid
+        tids = set()
+        for index in range(4):
+            outer = spans["thread%d" % index]
+            assert len(outer) == 50
+            assert len({event["tid"] for event in outer}) == 1
+            tids.add(outer[0]["tid"])
+        assert len(tids) == 4
+        assert summary["inner"]["calls"] == 200
+        assert sorted(event["tid"] for event in spans["inner"]) == sorted(event["tid"] for event in events if event["name"] != "inner")
+        assert all(event["args"]["depth"] == 1 for event in spans["inner"])
+
+    def test_unbalanced_end(self, profile):
+        script = """
+            import pytest
+
+            from diopilib import diopi_finalize, record_end, record_start
+
+            # nothing is open
+            with pytest.raises(RuntimeError):
+                record_end(0)
+            outer = record_start("outer")
+            inner = record_start("inner")
+            # the outer span cannot end while the inner one is open
+            with pytest.raises(RuntimeError):
+                record_end(outer)
+            record_end(inner)
+            record_end(outer)
+            with pytest.raises(RuntimeError):
+                record_end(outer)
+            diopi_finalize()
+        """
+        events, _, _ = profile(script)
+        assert [event["name"] for event in events] == ["inner", "outer"]
+
+    def test_ring_wrap(self, profile):
+        script = """
+            from diopilib import diopi_finalize, record_end, record_start
+
+            for index in range(20):
+                record_end(record_start("span%d" % index))
+            diopi_finalize()
+        """
+        events, summary, stdout = profile(script, DIOPIRT_PROFILE_CAPACITY="8")
+        # the ring keeps the newest spans
+        assert [event["name"] for event in events] == ["span%d" % index for index in range(12, 20)]
+        assert len(summary) == 8
+        assert "12 older spans were dropped" in stdout
+
+    def test_disabled(self, run_script, tmp_path):
+        script = """
+            from diopilib import diopi_finalize, record_end, record_start
+
+            record = record_start("span")
+            assert record == 0
+            record_end(record)
+            # an unbalanced end is not looked at either
+            record_end(record)
+            diopi_finalize()
+        """
+        trace_file = tmp_path / "trace.json"
+        run_script(script, DIOPI_RECORD_ENV="0", DIOPIRT_PROFILE_FILE=str(trace_file))
+        assert not trace_file.exists()
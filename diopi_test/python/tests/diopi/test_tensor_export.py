@@ -0,0 +1,57 @@
+import gc
+
+import numpy as np
+import pytest
+
+from diopilib import Context, Device
+from conformance.diopi_functions import check_function, check_returncode
+from conformance.diopi_runtime import Tensor
+
+
+class TestTensorExport(object):
+    context = Context()
+
+    def test_host_export_in_place(self):
+        tensor = Tensor.from_numpy(np.arange(12, dtype=np.float32).reshape(3, 4), context=self.context, device=Device.Host)
+        array = tensor.numpy(copy=False)
+        assert array.flags.writeable
+        array[1, 2] = -1.0
+        assert tensor.numpy()[1, 2] == -1.0
+
+    def test_host_export_outlives_tensor(self):
+        tensor = Tensor.from_numpy(np.arange(4096, dtype=np.float32), context=self.context, device=Device.Host)
+        array = tensor.numpy(copy=False)
+        del tensor
+        gc.collect()
+        # the cached block of the freed tensor would be handed to this one if the export did not hold it
+        other = Tensor.from_numpy(np.zeros(4096, dtype=np.float32), context=self.context, device=Device.Host)
+        np.testing.assert_array_equal(array, np.arange(4096, dtype=np.float32))
+        del other
+
+    def test_device_export_is_a_snapshot(self):
+        data = np.arange(256, dtype=np.int32).reshape(16, 16)
+        tensor = Tensor.from_numpy(data, context=self.context)
+        first = tensor.numpy(copy=False)
+        assert not first.flags.writeable
+        with pytest.raises(ValueError):
+            first[0, 0] = 1
+
+        doubled = Tensor.from_numpy(data * 2, context=self.context)
+        check_returncode(check_function("diopiCopyInp")(self.context, doubled, tensor))
+        second = tensor.numpy(copy=False)
+        np.testing.assert_array_equal(first, data)
+        np.testing.assert_array_equal(second, data * 2)
+
+    def test_device_export_outlives_tensor(self):
+        data = np.arange(1024, dtype=np.float64)
+        tensor = Tensor.from_numpy(data, context=self.context)
+        array = tensor.numpy(copy=False)
+        del tensor
+        gc.collect()
+        np.testing.assert_array_equal(array, data)
+
+    def test_export_view(self):
+        data = np.arange(24, dtype=np.float32).reshape(4, 6)[:, 1:5]
+        tensor = Tensor.from_numpy(data, context=self.context)
+        np.testing.assert_array_equal(tensor.numpy(copy=False), data)
+        np.testing.assert_array_equal(np.asarray(tensor, dtype=np.float64), data.astype(np.float64))
@@ -0,0 +1,62 @@
+import numpy as np
+
+from diopilib import Context, Device, Dtype, get_tensor_fields, get_tensor_meta, reset_view
+from conformance.diopi_runtime import Sizes, Tensor
+
+
+# diopiGetTensorMeta answers the adaptor in one call what it used to ask the single getters, so both must agree on
+# every tensor, views with a storage offset included; the data pointer is the storage moved by that offset.
+def check_meta(tensor):
+    meta = get_tensor_meta(tensor)
+    fields = get_tensor_fields(tensor)
+    data, storage = fields.pop("data"), fields.pop("storage")
+    assert meta == fields
+    assert data == storage + meta["storage_offset"] * meta["itemsize"]
+    return meta
+
+
+class TestTensorMeta(object):
+    context = Context(arena=True)
+
+    def test_owning_tensors(self):
+        for shape, dtype, device in (((3, 4), Dtype.float32, Device.AIChip), ((5,), Dtype.int64, Device.Host),
+                                     ((2, 3, 4), Dtype.float16, Device.AIChip), ((), Dtype.float64, Device.Host),
+                                     ((0, 5), Dtype.int8, Device.AIChip)):
+            tensor = Tensor(shape, dtype, context=self.context, device=device)
+            meta = check_meta(tensor)
+            assert meta["shape"] == list(shape)
+            assert meta["dtype"] == dtype and meta["device"] == device
+            assert meta["numel"] == int(np.prod(shape))
+            assert meta["storage_offset"] == 0
+
+    def test_strided_tensor(self):
+        tensor = Tensor((4, 6), Dtype.float32, stride=Sizes([1, 4]), context=self.context)
+        meta = check_meta(tensor)
+        assert meta["stride"] == [1, 4]
+        assert meta["itemsize"] == 4
+
+    def test_views_with_an_offset(self):
+        # the arena temporaries are views of a shared chunk, so even the second one starts at an offset
+        first = self.context.require_tensor([4, 8], Dtype.float32, Device.AIChip)
+        second = self.context.require_tensor([4, 8], Dtype.int32, Device.AIChip)
+        assert check_meta(second)["storage_offset"] > 0
+        offset = first.storage_offset()
+        view = self.context.require_tensor_view(first, [3, 4], [1, 8], offset + 5)
+        meta = check_meta(view)
+        assert meta["shape"] == [3, 4] and meta["stride"] == [1, 8]
+        assert meta["storage_offset"] == offset + 5 and meta["numel"] == 12
+        assert reset_view(view, [2, 2], [8, 1], offset + 18)
+        meta = check_meta(view)
+        assert meta["shape"] == [2, 2] and meta["stride"] == [8, 1] and meta["storage_offset"] == offset + 18
+        self.context.clear_tensors()
+
+    def test_views_of_an_owning_tensor(self):
+        context = Context(arena=False)
+        source = context.require_tensor([6, 5], Dtype.int16, Device.Host)
+        assert source.storage_offset() == 0
+        view = context.require_tensor_view(source, [5], [6], 3)
+        meta = check_meta(view)
+        assert meta["storage_offset"] == 3 and meta["itemsize"] == 2 and meta["device"] == Device.Host
+        empty = context.require_tensor_view(source, [0], [1], 30)
+        assert check_meta(empty)["numel"] == 0
+        context.clear_tensors()
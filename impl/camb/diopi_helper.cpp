@@ -105,25 +105,28 @@ DiopiTensor::DiopiTensor(const diopiTensorHandle_t& tensor) : tensor_(tensor) {
     if (tensor_ != nullptr) {
         // fix later
         // DIOPI_CHECK_ABORT(this->device() == diopiDevice_t::diopi_device, "%s", "tensor_ is not on camb device.");
-        diopiSize_t diopiShape;
-        diopiSize_t diopiStride;
-        diopiDtype_t diopiDtype;
-        diopiGetTensorShape(tensor_, &diopiShape);
-        std::vector<int64_t> shapeTmp(diopiShape.data, diopiShape.data + diopiShape.len);
-        diopiGetTensorStride(tensor_, &diopiStride);
-        std::vector<int64_t> strideTmp(diopiStride.data, diopiStride.data + diopiStride.len);
-        diopiGetTensorDtype(tensor_, &diopiDtype);
-        shape_ = std::move(shapeTmp);
-        stride_ = std::move(strideTmp);
-        dtype_ = diopiDtype;
+        // a single runtime call when it offers one, the getters otherwise
+        diopiTensorMeta_t meta;
+        if (diopiGetTensorMeta == nullptr || diopiGetTensorMeta(tensor_, &meta) != diopiSuccess) {
+            diopiGetTensorShape(tensor_, &meta.shape);
+            diopiGetTensorStride(tensor_, &meta.stride);
+            diopiGetTensorDtype(tensor_, &meta.dtype);
+            diopiGetTensorDevice(tensor_, &meta.device);
+            diopiGetTensorNumel(tensor_, &meta.numel);
+            diopiGetTensorElemSize(tensor_, &meta.itemsize);
+        }
+        shape_.assign(meta.shape.data, meta.shape.data + meta.shape.len);
+        stride_.assign(meta.stride.data, meta.stride.data + meta.stride.len);
+        dtype_ = meta.dtype;
+        device_ = meta.device;
+        numel_ = meta.numel;
+        elemsize_ = meta.itemsize;
     }
 }
 
 diopiDevice_t DiopiTensor::device() const {
     DIOPI_CHECK_NULLPTR_ABORT(tensor_);
-    diopiDevice_t device;
-    diopiGetTensorDevice(tensor_, &device);
-    return device;
+    return device_;
 }
 
 diopiDtype_t DiopiTensor::dtype() const {
@@ -161,15 +164,11 @@ DiopiTensor DiopiTensor::viewAsReal() const {
 
 int64_t DiopiTensor::numel() const {
     DIOPI_CHECK_NULLPTR_ABORT(tensor_);
-    int64_t numel;
-    diopiGetTensorNumel(tensor_, &numel);
-    return numel;
+    return numel_;
 }
 int64_t DiopiTensor::elemsize() const {
     DIOPI_CHECK_NULLPTR_ABORT(tensor_);
-    int64_t elemsize;
-    diopiGetTensorElemSize(tensor_, &elemsize);
-    return elemsize;
+    return elemsize_;
 }
 
 bool DiopiTensor::isContiguous(diopiMemoryFormat_t format) const {
@@ -191,6 +191,10 @@ protected:
     diopiDtype_t dtype_{diopi_dtype_unsupported};
     std::vector<int64_t> shape_{0};
     std::vector<int64_t> stride_{0};
+    // taken from the handle once, the views above never change them
+    diopiDevice_t device_{diopi_device};
+    int64_t numel_{0};
+    int64_t elemsize_{0};
 };
 
 DiopiTensor makeTensor(diopiContextHandle_t ctx, const diopiScalar_t* pScalar);
@@ -0,0 +1,1085 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "conv.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu_helper.hpp"
+#include "gemm.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+// bytes of transformed input and products a chunk of Winograd tiles is sized to
+constexpr int64_t kWinogradBytes = 1 << 22;
+
+// multiply-adds below which the weight gradient of an image is too small to split across the threads
+constexpr int64_t kImageWork = 1 << 22;
+
+int64_t ceilDiv(int64_t a, int64_t b) { return (a + b - 1) / b; }
+
+// sizes of a convolution over D, H and W, the channels counted per group
+struct ConvGeometry {
+    int64_t batch = 0;
+    int64_t groups = 1;
+    int64_t inC = 0;
+    int64_t outC = 0;
+    int64_t in[3] = {1, 1, 1};
+    int64_t out[3] = {1, 1, 1};
+    int64_t kernel[3] = {1, 1, 1};
+    int64_t inVolume = 1;
+    int64_t outVolume = 1;
+    int64_t kernelVolume = 1;
+};
+
+// A convolution from input to out. The backward passes keep the roles: gradInput is the input, gradOutput the out.
+struct ConvProblem {
+    ConvParams params;
+    ConvGeometry geo;
+    ConvTensor input;
+    ConvTensor weight;
+    ConvTensor out;
+    const void* bias = nullptr;
+    int64_t biasStride = 0;
+};
+
+diopiError_t checkProblem(const ConvParams& params, const ConvTensor& input, const ConvTensor& weight, const ConvTensor& out) {
+    DIOPI_CHECK(params.groups > 0 && input.shape[1] % params.groups == 0 && out.shape[1] % params.groups == 0,
+                "the channels of input and out must divide into %ld groups", params.groups);
+    DIOPI_CHECK(weight.shape[0] == out.shape[1] && weight.shape[1] * params.groups == input.shape[1], "weight does not match the channels of input and out");
+    DIOPI_CHECK(input.shape[0] == out.shape[0], "input and out must have the same batch size");
+    for (int64_t d = 0; d < 3; ++d) {
+        DIOPI_CHECK(params.stride[d] > 0 && params.dilation[d] > 0 && params.padding[d] >= 0, "stride and dilation must be positive, padding non-negative");
+        const int64_t span = params.dilation[d] * (weight.shape[d + 2] - 1) + 1;
+        const int64_t padded = input.shape[d + 2] + 2 * params.padding[d];
+        DIOPI_CHECK(padded >= span && out.shape[d + 2] == (padded - span) / params.stride[d] + 1, "out does not have the spatial size of the convolution");
+    }
+    return diopiSuccess;
+}
+
+ConvProblem makeProblem(const ConvParams& params, const ConvTensor& input, const ConvTensor& weight, const ConvTensor& out, const void* bias,
+                        int64_t biasStride) {
+    ConvProblem p;
+    p.params = params;
+    p.input = input;
+    p.weight = weight;
+    p.out = out;
+    p.bias = bias;
+    p.biasStride = biasStride;
+    ConvGeometry& geo = p.geo;
+    geo.batch = input.shape[0];
+    geo.groups = params.groups;
+    geo.inC = input.shape[1] / params.groups;
+    geo.outC = out.shape[1] / params.groups;
+    for (int64_t d = 0; d < 3; ++d) {
+        geo.in[d] = input.shape[d + 2];
+        geo.out[d] = out.shape[d + 2];
+        geo.kernel[d] = weight.shape[d + 2];
+        geo.inVolume *= geo.in[d];
+        geo.outVolume *= geo.out[d];
+        geo.kernelVolume *= geo.kernel[d];
+    }
+    return p;
+}
+
+template <typename T>
+T* element(const ConvTensor& t, int64_t n, int64_t c, int64_t d, int64_t h, int64_t w) {
+    return static_cast<T*>(t.data) + n * t.stride[0] + c * t.stride[1] + d * t.stride[2] + h * t.stride[3] + w * t.stride[4];
+}
+
+// Whether D, H and W of t fold into one dim, whose stride is returned
+bool spatialStride(const ConvTensor& t, int64_t& stride) {
+    int64_t size = 1;
+    stride = 1;
+    for (int64_t d = 4; d >= 2; --d) {
+        if (t.shape[d] == 1) {
+            continue;
+        }
+        if (size == 1) {
+            stride = t.stride[d];
+        } else if (t.stride[d] != stride * size) {
+            return false;
+        }
+        size *= t.shape[d];
+    }
+    return true;
+}
+
+bool isContiguous(const ConvTensor& t) {
+    int64_t expected = 1;
+    for (int64_t d = 4; d >= 0; --d) {
+        if (t.shape[d] != 1 && t.stride[d] != expected) {
+            return false;
+        }
+        expected *= t.shape[d];
+    }
+    return true;
+}
+
+ConvTensor contiguousLike(const ConvTensor& t, void* data) {
+    ConvTensor result = t;
+    result.data = data;
+    int64_t stride = 1;
+    for (int64_t d = 4; d >= 0; --d) {
+        result.stride[d] = stride;
+        stride *= t.shape[d];
+    }
+    return result;
+}
+
+int64_t numel(const ConvTensor& t) { return t.shape[0] * t.shape[1] * t.shape[2] * t.shape[3] * t.shape[4]; }
+
+template <typename T>
+void copyTensor(const ConvTensor& src, const ConvTensor& dst) {
+    const int64_t width = src.shape[4];
+    parallelFor(numel(src) / std::max<int64_t>(1, width), std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, width)), [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+            const int64_t h = row % src.shape[3];
+            const int64_t d = row / src.shape[3] % src.shape[2];
+            const int64_t c = row / (src.shape[3] * src.shape[2]) % src.shape[1];
+            const int64_t n = row / (src.shape[3] * src.shape[2] * src.shape[1]);
+            const T* from = element<const T>(src, n, c, d, h, 0);
+            T* to = element<T>(dst, n, c, d, h, 0);
+            for (int64_t w = 0; w < width; ++w) {
+                to[w * dst.stride[4]] = from[w * src.stride[4]];
+            }
+        }
+    });
+}
+
+template <typename T>
+ConvTensor contiguousCopy(const ConvTensor& t, std::vector<T>& buffer) {
+    buffer.resize(numel(t));
+    const ConvTensor result = contiguousLike(t, buffer.data());
+    copyTensor<T>(t, result);
+    return result;
+}
+
+GemmOperand operand(const void* data, int64_t rowStride, int64_t colStride, const std::vector<int64_t>& batchStrides = {}) {
+    GemmOperand result;
+    result.data = const_cast<void*>(data);
+    result.rowStride = rowStride;
+    result.colStride = colStride;
+    result.batchStrides = batchStrides;
+    return result;
+}
+
+// rows x cols of T as a GEMM operand in Acc: the memory itself when T is Acc, a contiguous copy in buffer otherwise
+template <typename Acc, typename T>
+GemmOperand accOperand(const T* data, int64_t rows, int64_t cols, int64_t rowStride, int64_t colStride, std::vector<Acc>& buffer) {
+    if (std::is_same<T, Acc>::value) {
+        return operand(data, rowStride, colStride);
+    }
+    buffer.resize(rows * cols);
+    for (int64_t i = 0; i < rows; ++i) {
+        for (int64_t j = 0; j < cols; ++j) {
+            buffer[i * cols + j] = static_cast<Acc>(data[i * rowStride + j * colStride]);
+        }
+    }
+    return operand(buffer.data(), cols, 1);
+}
+
+// the out positions [lo, hi) along a dim whose input position out * stride + offset falls inside [0, size)
+void validRange(int64_t offset, int64_t stride, int64_t size, int64_t outSize, int64_t& lo, int64_t& hi) {
+    lo = offset >= 0 ? 0 : std::min(outSize, ceilDiv(-offset, stride));
+    hi = offset >= size ? 0 : std::min(outSize, ceilDiv(size - offset, stride));
+    hi = std::max(lo, hi);
+}
+
+// Runs task(index, parallel) over count independent tasks: one per thread when there are enough of them, otherwise
+// one after another with the threads inside each
+template <typename F>
+void forEachTask(int64_t count, F&& task) {
+    if (count >= ThreadPool::instance().numThreads()) {
+        parallelFor(count, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                task(i, false);
+            }
+        });
+        return;
+    }
+    for (int64_t i = 0; i < count; ++i) {
+        task(i, true);
+    }
+}
+
+/**
+ * The patches of image n and group g of the input as the rows of col, one per input channel and kernel offset, each
+ * holding the value under that offset for every out position, zero in the padding.
+ */
+template <typename T, typename Dst>
+void im2col(const ConvProblem& p, int64_t n, int64_t g, Dst* col, bool parallel) {
+    const ConvGeometry& geo = p.geo;
+    const ConvParams& q = p.params;
+    const ConvTensor& x = p.input;
+    const T* image = element<const T>(x, n, g * geo.inC, 0, 0, 0);
+    auto fill = [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+            const int64_t kw = row % geo.kernel[2];
+            const int64_t kh = row / geo.kernel[2] % geo.kernel[1];
+            const int64_t kd = row / (geo.kernel[2] * geo.kernel[1]) % geo.kernel[0];
+            const int64_t c = row / geo.kernelVolume;
+            const int64_t offW = kw * q.dilation[2] - q.padding[2];
+            int64_t lo;
+            int64_t hi;
+            validRange(offW, q.stride[2], geo.in[2], geo.out[2], lo, hi);
+            const int64_t step = q.stride[2] * x.stride[4];
+            Dst* dst = col + row * geo.outVolume;
+            for (int64_t od = 0; od < geo.out[0]; ++od) {
+                const int64_t id = od * q.stride[0] - q.padding[0] + kd * q.dilation[0];
+                for (int64_t oh = 0; oh < geo.out[1]; ++oh) {
+                    const int64_t ih = oh * q.stride[1] - q.padding[1] + kh * q.dilation[1];
+                    Dst* line = dst + (od * geo.out[1] + oh) * geo.out[2];
+                    if (id < 0 || id >= geo.in[0] || ih < 0 || ih >= geo.in[1]) {
+                        std::fill(line, line + geo.out[2], Dst(0.0f));
+                        continue;
+                    }
+                    const int64_t start = c * x.stride[1] + id * x.stride[2] + ih * x.stride[3] + offW * x.stride[4];
+                    std::fill(line, line + lo, Dst(0.0f));
+                    for (int64_t ow = lo; ow < hi; ++ow) {
+                        line[ow] = static_cast<Dst>(image[start + ow * step]);
+                    }
+                    std::fill(line + hi, line + geo.out[2], Dst(0.0f));
+                }
+            }
+        }
+    };
+    const int64_t rows = geo.inC * geo.kernelVolume;
+    if (parallel) {
+        parallelFor(rows, std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, geo.outVolume)), fill);
+    } else {
+        fill(0, rows);
+    }
+}
+
+// Adds the rows of col, laid out as by im2col, back onto the input positions of image n and group g they were taken
+// from, and writes those channels of the input plus the bias
+template <typename T, typename Acc>
+void col2im(const ConvProblem& p, int64_t n, int64_t g, const Acc* col, bool parallel) {
+    const ConvGeometry& geo = p.geo;
+    const ConvParams& q = p.params;
+    const T* bias = static_cast<const T*>(p.bias);
+    auto channels = [&](int64_t begin, int64_t end) {
+        static thread_local std::vector<Acc> plane;
+        plane.resize(geo.inVolume);
+        for (int64_t c = begin; c < end; ++c) {
+            std::fill(plane.begin(), plane.end(), Acc(0));
+            for (int64_t k = 0; k < geo.kernelVolume; ++k) {
+                const int64_t kw = k % geo.kernel[2];
+                const int64_t kh = k / geo.kernel[2] % geo.kernel[1];
+                const int64_t kd = k / (geo.kernel[2] * geo.kernel[1]);
+                const int64_t offW = kw * q.dilation[2] - q.padding[2];
+                int64_t lo;
+                int64_t hi;
+                validRange(offW, q.stride[2], geo.in[2], geo.out[2], lo, hi);
+                const Acc* src = col + (c * geo.kernelVolume + k) * geo.outVolume;
+                for (int64_t od = 0; od < geo.out[0]; ++od) {
+                    const int64_t id = od * q.stride[0] - q.padding[0] + kd * q.dilation[0];
+                    if (id < 0 || id >= geo.in[0]) {
+                        continue;
+                    }
+                    for (int64_t oh = 0; oh < geo.out[1]; ++oh) {
+                        const int64_t ih = oh * q.stride[1] - q.padding[1] + kh * q.dilation[1];
+                        if (ih < 0 || ih >= geo.in[1]) {
+                            continue;
+                        }
+                        const Acc* line = src + (od * geo.out[1] + oh) * geo.out[2];
+                        const int64_t start = (id * geo.in[1] + ih) * geo.in[2] + offW;
+                        for (int64_t ow = lo; ow < hi; ++ow) {
+                            plane[start + ow * q.stride[2]] += line[ow];
+                        }
+                    }
+                }
+            }
+            const int64_t channel = g * geo.inC + c;
+            const Acc shift = bias != nullptr ? static_cast<Acc>(bias[channel * p.biasStride]) : Acc(0);
+            for (int64_t id = 0; id < geo.in[0]; ++id) {
+                for (int64_t ih = 0; ih < geo.in[1]; ++ih) {
+                    T* dst = element<T>(p.input, n, channel, id, ih, 0);
+                    const Acc* src = plane.data() + (id * geo.in[1] + ih) * geo.in[2];
+                    for (int64_t iw = 0; iw < geo.in[2]; ++iw) {
+                        dst[iw * p.input.stride[4]] = static_cast<T>(src[iw] + shift);
+                    }
+                }
+            }
+        }
+    };
+    if (parallel) {
+        parallelFor(geo.inC, 1, channels);
+    } else {
+        channels(0, geo.inC);
+    }
+}
+
+// bias of the out channels of group g as the addend of a GEMM whose rows are those channels
+template <typename T>
+void biasAddend(const ConvProblem& p, int64_t g, GemmDesc& desc) {
+    if (p.bias != nullptr) {
+        desc.addend = operand(static_cast<const T*>(p.bias) + g * p.geo.outC * p.biasStride, p.biasStride, 0);
+        desc.beta = 1.0;
+    }
+}
+
+/**
+ * Direct convolution on channels-last input, copied so in Acc unless it is laid out so already. For each row of out
+ * positions the accumulators of all out channels sit side by side and each input value is multiplied into the weights
+ * of its out channels, contiguous as well, so that the innermost loop vectorizes; a depthwise convolution runs over
+ * all channels at once instead.
+ */
+template <typename T>
+void convDirect(const ConvProblem& p) {
+    using Acc = typename ComputeType<T>::type;
+    const ConvGeometry& geo = p.geo;
+    const ConvParams& q = p.params;
+    const int64_t inChannels = geo.groups * geo.inC;
+    const int64_t outChannels = geo.groups * geo.outC;
+    const bool depthwise = geo.inC == 1 && geo.outC == 1;
+
+    const ConvTensor& x = p.input;
+    static thread_local std::vector<Acc> channelsLastBuffer;
+    const Acc* input = static_cast<const Acc*>(x.data);
+    int64_t inStride[4] = {x.stride[0], x.stride[2], x.stride[3], x.stride[4]};
+    if (!std::is_same<T, Acc>::value || x.stride[1] != 1) {
+        channelsLastBuffer.resize(geo.batch * geo.inVolume * inChannels);
+        Acc* const channelsLast = channelsLastBuffer.data();
+        parallelFor(geo.batch * geo.inVolume, std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, inChannels)), [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                const int64_t w = i % geo.in[2];
+                const int64_t h = i / geo.in[2] % geo.in[1];
+                const int64_t d = i / (geo.in[2] * geo.in[1]) % geo.in[0];
+                const T* src = element<const T>(x, i / geo.inVolume, 0, d, h, w);
+                Acc* dst = channelsLast + i * inChannels;
+                for (int64_t c = 0; c < inChannels; ++c) {
+                    dst[c] = static_cast<Acc>(src[c * x.stride[1]]);
+                }
+            }
+        });
+        input = channelsLast;
+        inStride[0] = geo.inVolume * inChannels;
+        inStride[1] = geo.in[1] * geo.in[2] * inChannels;
+        inStride[2] = geo.in[2] * inChannels;
+        inStride[3] = inChannels;
+    }
+
+    // depthwise: kernel offset, channel; otherwise group, kernel offset, in channel, out channel
+    std::vector<Acc> weight(geo.groups * geo.kernelVolume * geo.inC * geo.outC);
+    for (int64_t o = 0; o < outChannels; ++o) {
+        const int64_t g = o / geo.outC;
+        const int64_t co = o % geo.outC;
+        for (int64_t ci = 0; ci < geo.inC; ++ci) {
+            for (int64_t k = 0; k < geo.kernelVolume; ++k) {
+                const int64_t kw = k % geo.kernel[2];
+                const int64_t kh = k / geo.kernel[2] % geo.kernel[1];
+                const int64_t kd = k / (geo.kernel[2] * geo.kernel[1]);
+                const int64_t index = depthwise ? k * outChannels + o : ((g * geo.kernelVolume + k) * geo.inC + ci) * geo.outC + co;
+                weight[index] = static_cast<Acc>(*element<const T>(p.weight, o, ci, kd, kh, kw));
+            }
+        }
+    }
+
+    const T* bias = static_cast<const T*>(p.bias);
+    const ConvTensor& y = p.out;
+    parallelFor(geo.batch * geo.out[0] * geo.out[1], 1, [&](int64_t begin, int64_t end) {
+        static thread_local std::vector<Acc> acc;
+        acc.resize(geo.out[2] * outChannels);
+        for (int64_t row = begin; row < end; ++row) {
+            const int64_t oh = row % geo.out[1];
+            const int64_t od = row / geo.out[1] % geo.out[0];
+            const int64_t n = row / (geo.out[1] * geo.out[0]);
+            for (int64_t ow = 0; ow < geo.out[2]; ++ow) {
+                for (int64_t o = 0; o < outChannels; ++o) {
+                    acc[ow * outChannels + o] = bias != nullptr ? static_cast<Acc>(bias[o * p.biasStride]) : Acc(0);
+                }
+            }
+            for (int64_t kd = 0; kd < geo.kernel[0]; ++kd) {
+                const int64_t id = od * q.stride[0] - q.padding[0] + kd * q.dilation[0];
+                if (id < 0 || id >= geo.in[0]) {
+                    continue;
+                }
+                for (int64_t kh = 0; kh < geo.kernel[1]; ++kh) {
+                    const int64_t ih = oh * q.stride[1] - q.padding[1] + kh * q.dilation[1];
+                    if (ih < 0 || ih >= geo.in[1]) {
+                        continue;
+                    }
+                    for (int64_t kw = 0; kw < geo.kernel[2]; ++kw) {
+                        const int64_t offW = kw * q.dilation[2] - q.padding[2];
+                        int64_t lo;
+                        int64_t hi;
+                        validRange(offW, q.stride[2], geo.in[2], geo.out[2], lo, hi);
+                        const int64_t k = (kd * geo.kernel[1] + kh) * geo.kernel[2] + kw;
+                        for (int64_t ow = lo; ow < hi; ++ow) {
+                            const Acc* src = input + n * inStride[0] + id * inStride[1] + ih * inStride[2] + (ow * q.stride[2] + offW) * inStride[3];
+                            Acc* dst = acc.data() + ow * outChannels;
+                            if (depthwise) {
+                                const Acc* w = weight.data() + k * outChannels;
+                                for (int64_t c = 0; c < outChannels; ++c) {
+                                    dst[c] += src[c] * w[c];
+                                }
+                                continue;
+                            }
+                            for (int64_t g = 0; g < geo.groups; ++g) {
+                                const Acc* w = weight.data() + (g * geo.kernelVolume + k) * geo.inC * geo.outC;
+                                const Acc* xg = src + g * geo.inC;
+                                Acc* ag = dst + g * geo.outC;
+                                for (int64_t ci = 0; ci < geo.inC; ++ci) {
+                                    const Acc value = xg[ci];
+                                    const Acc* wr = w + ci * geo.outC;
+                                    for (int64_t co = 0; co < geo.outC; ++co) {
+                                        ag[co] += value * wr[co];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            for (int64_t o = 0; o < outChannels; ++o) {
+                T* dst = element<T>(y, n, o, od, oh, 0);
+                for (int64_t ow = 0; ow < geo.out[2]; ++ow) {
+                    dst[ow * y.stride[4]] = static_cast<T>(acc[ow * outChannels + o]);
+                }
+            }
+        }
+    });
+}
+
+// One GEMM per image and group, out = weight @ col + bias, over the patches im2col unrolls; the weight is contiguous
+template <typename T>
+void convIm2col(const ConvProblem& p) {
+    const ConvGeometry& geo = p.geo;
+    const int64_t rows = geo.inC * geo.kernelVolume;
+    int64_t outStride = 1;
+    spatialStride(p.out, outStride);
+    forEachTask(geo.batch * geo.groups, [&](int64_t task, bool parallel) {
+        const int64_t n = task / geo.groups;
+        const int64_t g = task % geo.groups;
+        static thread_local std::vector<T> col;
+        col.resize(rows * geo.outVolume);
+        im2col<T>(p, n, g, col.data(), parallel);
+        GemmDesc desc;
+        desc.m = geo.outC;
+        desc.n = geo.outVolume;
+        desc.k = rows;
+        desc.a = operand(element<const T>(p.weight, g * geo.outC, 0, 0, 0, 0), p.weight.stride[0], 1);
+        desc.b = operand(col.data(), geo.outVolume, 1);
+        desc.c = operand(element<T>(p.out, n, g * geo.outC, 0, 0, 0), p.out.stride[1], outStride);
+        biasAddend<T>(p, g, desc);
+        gemm<T>(desc);
+    });
+}
+
+// out = weight @ input for each image and group, the input positions being the columns, as one batched GEMM
+template <typename T>
+void convGemm1x1(const ConvProblem& p) {
+    const ConvGeometry& geo = p.geo;
+    const ConvTensor& x = p.input;
+    const ConvTensor& w = p.weight;
+    const ConvTensor& y = p.out;
+    int64_t inStride = 1;
+    int64_t outStride = 1;
+    spatialStride(x, inStride);
+    spatialStride(y, outStride);
+    GemmDesc desc;
+    desc.m = geo.outC;
+    desc.n = geo.outVolume;
+    desc.k = geo.inC;
+    desc.batchShape = {geo.batch, geo.groups};
+    desc.a = operand(w.data, w.stride[0], w.stride[1], {0, geo.outC * w.stride[0]});
+    desc.b = operand(x.data, x.stride[1], inStride, {x.stride[0], geo.inC * x.stride[1]});
+    desc.c = operand(y.data, y.stride[1], outStride, {y.stride[0], geo.outC * y.stride[1]});
+    if (p.bias != nullptr) {
+        desc.addend = operand(p.bias, p.biasStride, 0, {0, geo.outC * p.biasStride});
+        desc.beta = 1.0;
+    }
+    gemm<T>(desc);
+}
+
+// Winograd F(2x2, 3x3) and F(4x4, 3x3) (Lavin and Gray, 2015): an M x M tile of out is at ((g w gt) . (bt d b)) a for
+// the weight w and the Alpha x Alpha input tile d, Alpha = M + 2
+constexpr double kWinogradBT2[4][4] = {{1, 0, -1, 0}, {0, 1, 1, 0}, {0, -1, 1, 0}, {0, 1, 0, -1}};
+constexpr double kWinogradG2[4][3] = {{1, 0, 0}, {0.5, 0.5, 0.5}, {0.5, -0.5, 0.5}, {0, 0, 1}};
+constexpr double kWinogradAT2[2][4] = {{1, 1, 1, 0}, {0, 1, -1, -1}};
+constexpr double kWinogradBT4[6][6] = {{4, 0, -5, 0, 1, 0},  {0, -4, -4, 1, 1, 0}, {0, 4, -4, -1, 1, 0},
+                                       {0, -2, -1, 2, 1, 0}, {0, 2, -1, -2, 1, 0}, {0, 4, 0, -5, 0, 1}};
+constexpr double kWinogradG4[6][3] = {{1.0 / 4, 0, 0},           {-1.0 / 6, -1.0 / 6, -1.0 / 6}, {-1.0 / 6, 1.0 / 6, -1.0 / 6},
+                                      {1.0 / 24, 1.0 / 12, 1.0 / 6}, {1.0 / 24, -1.0 / 12, 1.0 / 6}, {0, 0, 1}};
+constexpr double kWinogradAT4[4][6] = {{1, 1, 1, 1, 1, 0}, {0, 1, -1, 2, -2, 0}, {0, 1, 1, 4, 4, 0}, {0, 1, -1, 8, -8, 1}};
+
+// tiles, or channels of the weight, transformed together, one per SIMD lane
+constexpr int64_t kWinogradLanes = 16;
+
+// y = l x l^T for l of R x C, on kWinogradLanes matrices at once. The coefficients of l that are 0 are skipped.
+template <typename Acc, int64_t R, int64_t C>
+void sandwich(const double (&l)[R][C], const Acc (&x)[C][C][kWinogradLanes], Acc (&y)[R][R][kWinogradLanes]) {
+    Acc t[R][C][kWinogradLanes] = {};
+    for (int64_t i = 0; i < R; ++i) {
+        for (int64_t k = 0; k < C; ++k) {
+            const Acc coef = static_cast<Acc>(l[i][k]);
+            if (coef == Acc(0)) {
+                continue;
+            }
+            for (int64_t j = 0; j < C; ++j) {
+                for (int64_t lane = 0; lane < kWinogradLanes; ++lane) {
+                    t[i][j][lane] += coef * x[k][j][lane];
+                }
+            }
+        }
+    }
+    for (int64_t i = 0; i < R; ++i) {
+        for (int64_t j = 0; j < R; ++j) {
+            Acc* dst = y[i][j];
+            std::fill(dst, dst + kWinogradLanes, Acc(0));
+            for (int64_t k = 0; k < C; ++k) {
+                const Acc coef = static_cast<Acc>(l[j][k]);
+                if (coef == Acc(0)) {
+                    continue;
+                }
+                for (int64_t lane = 0; lane < kWinogradLanes; ++lane) {
+                    dst[lane] += t[i][k][lane] * coef;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Winograd convolution in Acc. The tiles of all images are taken a chunk at a time: their input tiles are transformed,
+ * then for each of the Alpha x Alpha points the transformed weight, out channels x in channels, multiplies the
+ * transformed tiles, in channels x tiles, all points making one batched GEMM, and the products are transformed back
+ * into out. The transforms run on kWinogradLanes consecutive tiles, or in channels for the weight, at a time.
+ */
+template <typename T, int64_t M, int64_t Alpha>
+void convWinograd(const ConvProblem& p, const double (&bt)[Alpha][Alpha], const double (&gt)[Alpha][3], const double (&at)[M][Alpha]) {
+    using Acc = typename ComputeType<T>::type;
+    constexpr int64_t kPoints = Alpha * Alpha;
+    constexpr int64_t kLanes = kWinogradLanes;
+    const ConvGeometry& geo = p.geo;
+    const int64_t tilesW = ceilDiv(geo.out[2], M);
+    const int64_t imageTiles = ceilDiv(geo.out[1], M) * tilesW;
+    const int64_t tiles = geo.batch * imageTiles;
+    const int64_t chunk = std::max<int64_t>(1, std::min(tiles, kWinogradBytes / (kPoints * (geo.inC + geo.outC) * static_cast<int64_t>(sizeof(Acc)))));
+    // the buffers stay with the calling thread, the tasks reach them through these pointers
+    static thread_local std::vector<Acc> weightBuffer;
+    static thread_local std::vector<Acc> inputBuffer;
+    static thread_local std::vector<Acc> productBuffer;
+    weightBuffer.resize(kPoints * geo.outC * geo.inC);
+    inputBuffer.resize(kPoints * geo.inC * chunk);
+    productBuffer.resize(kPoints * geo.outC * chunk);
+    Acc* const weight = weightBuffer.data();
+    Acc* const input = inputBuffer.data();
+    Acc* const products = productBuffer.data();
+    const T* bias = static_cast<const T*>(p.bias);
+    const ConvTensor& x = p.input;
+    const ConvTensor& y = p.out;
+    const int64_t inBlocks = ceilDiv(geo.inC, kLanes);
+
+    for (int64_t g = 0; g < geo.groups; ++g) {
+        parallelFor(geo.outC * inBlocks, 16, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                const int64_t co = i / inBlocks;
+                const int64_t ci0 = i % inBlocks * kLanes;
+                const int64_t lanes = std::min(kLanes, geo.inC - ci0);
+                Acc w[3][3][kLanes] = {};
+                for (int64_t lane = 0; lane < lanes; ++lane) {
+                    for (int64_t r = 0; r < 3; ++r) {
+                        for (int64_t s = 0; s < 3; ++s) {
+                            w[r][s][lane] = static_cast<Acc>(*element<const T>(p.weight, g * geo.outC + co, ci0 + lane, 0, r, s));
+                        }
+                    }
+                }
+                Acc u[Alpha][Alpha][kLanes];
+                sandwich(gt, w, u);
+                for (int64_t point = 0; point < kPoints; ++point) {
+                    Acc* dst = weight + (point * geo.outC + co) * geo.inC + ci0;
+                    std::copy(u[point / Alpha][point % Alpha], u[point / Alpha][point % Alpha] + lanes, dst);
+                }
+            }
+        });
+
+        for (int64_t first = 0; first < tiles; first += chunk) {
+            const int64_t count = std::min(chunk, tiles - first);
+            const int64_t tileBlocks = ceilDiv(count, kLanes);
+            parallelFor(geo.inC * tileBlocks, 16, [&](int64_t begin, int64_t end) {
+                for (int64_t i = begin; i < end; ++i) {
+                    const int64_t ci = i / tileBlocks;
+                    const int64_t j0 = i % tileBlocks * kLanes;
+                    const int64_t lanes = std::min(kLanes, count - j0);
+                    Acc d[Alpha][Alpha][kLanes] = {};
+                    for (int64_t lane = 0; lane < lanes; ++lane) {
+                        const int64_t tile = first + j0 + lane;
+                        const int64_t h0 = tile % imageTiles / tilesW * M - p.params.padding[1];
+                        const int64_t w0 = tile % tilesW * M - p.params.padding[2];
+                        const T* src = element<const T>(x, tile / imageTiles, g * geo.inC + ci, 0, 0, 0);
+                        if (h0 >= 0 && w0 >= 0 && h0 + Alpha <= geo.in[1] && w0 + Alpha <= geo.in[2]) {
+                            const T* corner = src + h0 * x.stride[3] + w0 * x.stride[4];
+                            for (int64_t r = 0; r < Alpha; ++r) {
+                                for (int64_t s = 0; s < Alpha; ++s) {
+                                    d[r][s][lane] = static_cast<Acc>(corner[r * x.stride[3] + s * x.stride[4]]);
+                                }
+                            }
+                            continue;
+                        }
+                        for (int64_t r = 0; r < Alpha; ++r) {
+                            const int64_t h = h0 + r;
+                            if (h < 0 || h >= geo.in[1]) {
+                                continue;
+                            }
+                            for (int64_t s = 0; s < Alpha; ++s) {
+                                const int64_t w = w0 + s;
+                                if (w >= 0 && w < geo.in[2]) {
+                                    d[r][s][lane] = static_cast<Acc>(src[h * x.stride[3] + w * x.stride[4]]);
+                                }
+                            }
+                        }
+                    }
+                    Acc v[Alpha][Alpha][kLanes];
+                    sandwich(bt, d, v);
+                    for (int64_t point = 0; point < kPoints; ++point) {
+                        Acc* dst = input + (point * geo.inC + ci) * chunk + j0;
+                        std::copy(v[point / Alpha][point % Alpha], v[point / Alpha][point % Alpha] + lanes, dst);
+                    }
+                }
+            });
+
+            GemmDesc desc;
+            desc.m = geo.outC;
+            desc.n = count;
+            desc.k = geo.inC;
+            desc.batchShape = {kPoints};
+            desc.a = operand(weight, geo.inC, 1, {geo.outC * geo.inC});
+            desc.b = operand(input, chunk, 1, {geo.inC * chunk});
+            desc.c = operand(products, chunk, 1, {geo.outC * chunk});
+            gemm<Acc>(desc);
+
+            parallelFor(geo.outC * tileBlocks, 16, [&](int64_t begin, int64_t end) {
+                for (int64_t i = begin; i < end; ++i) {
+                    const int64_t co = i / tileBlocks;
+                    const int64_t j0 = i % tileBlocks * kLanes;
+                    const int64_t lanes = std::min(kLanes, count - j0);
+                    Acc product[Alpha][Alpha][kLanes] = {};
+                    for (int64_t point = 0; point < kPoints; ++point) {
+                        const Acc* src = products + (point * geo.outC + co) * chunk + j0;
+                        std::copy(src, src + lanes, product[point / Alpha][point % Alpha]);
+                    }
+                    Acc tileOut[M][M][kLanes];
+                    sandwich(at, product, tileOut);
+                    const int64_t channel = g * geo.outC + co;
+                    const Acc shift = bias != nullptr ? static_cast<Acc>(bias[channel * p.biasStride]) : Acc(0);
+                    for (int64_t lane = 0; lane < lanes; ++lane) {
+                        const int64_t tile = first + j0 + lane;
+                        const int64_t h0 = tile % imageTiles / tilesW * M;
+                        const int64_t w0 = tile % tilesW * M;
+                        T* dst = element<T>(y, tile / imageTiles, channel, 0, 0, 0);
+                        for (int64_t r = 0; r < M && h0 + r < geo.out[1]; ++r) {
+                            for (int64_t s = 0; s < M && w0 + s < geo.out[2]; ++s) {
+                                dst[(h0 + r) * y.stride[3] + (w0 + s) * y.stride[4]] = static_cast<T>(tileOut[r][s][lane] + shift);
+                            }
+                        }
+                    }
+                }
+            });
+        }
+    }
+}
+
+constexpr const char* kAlgoNames[] = {"direct", "im2col", "gemm1x1", "winograd2", "winograd4"};
+constexpr int64_t kAlgoCount = sizeof(kAlgoNames) / sizeof(kAlgoNames[0]);
+
+bool applies(ConvAlgo algo, const ConvProblem& p) {
+    const ConvGeometry& geo = p.geo;
+    const ConvParams& q = p.params;
+    int64_t stride = 0;
+    switch (algo) {
+        case ConvAlgo::kGemm1x1: {
+            bool result = geo.kernelVolume == 1 && spatialStride(p.input, stride) && spatialStride(p.out, stride);
+            for (int64_t d = 0; d < 3; ++d) {
+                result = result && q.stride[d] == 1 && q.padding[d] == 0;
+            }
+            return result;
+        }
+        case ConvAlgo::kWinograd2:
+        case ConvAlgo::kWinograd4:
+            return geo.in[0] == 1 && geo.out[0] == 1 && geo.kernel[0] == 1 && q.padding[0] == 0 && geo.kernel[1] == 3 && geo.kernel[2] == 3 &&
+                   q.stride[1] == 1 && q.stride[2] == 1 && q.dilation[1] == 1 && q.dilation[2] == 1;
+        default:
+            return true;
+    }
+}
+
+/**
+ * A GEMM straight on the input for 1x1 kernels; the direct loop for depthwise convolutions and for those with too few
+ * channels to fill the micro-kernel of a GEMM; Winograd, which saves 2.25x (F(2x2)) or 4x (F(4x4)) of the multiplies,
+ * for 3x3 kernels with channels enough for its transforms to pay off, F(4x4) once the out is large enough to fill
+ * its tiles; im2col and a GEMM otherwise.
+ */
+ConvAlgo heuristicAlgo(const ConvProblem& p) {
+    const ConvGeometry& geo = p.geo;
+    if (applies(ConvAlgo::kGemm1x1, p)) {
+        return ConvAlgo::kGemm1x1;
+    }
+    if (geo.inC == 1 && geo.outC == 1) {
+        return ConvAlgo::kDirect;
+    }
+    if (applies(ConvAlgo::kWinograd4, p) && geo.inC >= 16 && geo.outC >= 16) {
+        return geo.out[1] >= 8 && geo.out[2] >= 8 ? ConvAlgo::kWinograd4 : ConvAlgo::kWinograd2;
+    }
+    if (geo.outC < 8 || geo.inC * geo.kernelVolume < 16) {
+        return ConvAlgo::kDirect;
+    }
+    return ConvAlgo::kIm2col;
+}
+
+// DIOPI_CPU_CONV_ALGO, when it names an algorithm
+bool forcedAlgo(ConvAlgo& algo) {
+    static const int64_t forced = []() -> int64_t {
+        const char* env = std::getenv("DIOPI_CPU_CONV_ALGO");
+        for (int64_t i = 0; env != nullptr && i < kAlgoCount; ++i) {
+            if (std::string(env) == kAlgoNames[i]) {
+                return i;
+            }
+        }
+        return -1;
+    }();
+    algo = static_cast<ConvAlgo>(forced);
+    return forced >= 0;
+}
+
+bool autotuneEnabled() {
+    static const bool enabled = []() {
+        const char* env = std::getenv("DIOPI_CPU_CONV_AUTOTUNE");
+        return env != nullptr && std::string(env) == "1";
+    }();
+    return enabled;
+}
+
+// the algorithms autotuning found fastest, by problem
+struct AutotuneCache {
+    std::mutex mutex;
+    std::unordered_map<std::string, ConvAlgo> algos;
+};
+
+AutotuneCache& autotuneCache() {
+    static AutotuneCache cache;
+    return cache;
+}
+
+std::string problemKey(diopiDtype_t dtype, const ConvProblem& p) {
+    const ConvGeometry& geo = p.geo;
+    std::string key = std::to_string(dtype);
+    auto add = [&](int64_t value) {
+        key += ',';
+        key += std::to_string(value);
+    };
+    add(geo.batch);
+    add(geo.groups);
+    add(geo.inC);
+    add(geo.outC);
+    for (int64_t d = 0; d < 3; ++d) {
+        add(geo.in[d]);
+        add(geo.kernel[d]);
+        add(p.params.stride[d]);
+        add(p.params.padding[d]);
+        add(p.params.dilation[d]);
+    }
+    add(p.input.stride[1] == 1);
+    return key;
+}
+
+template <typename T>
+void runAlgo(ConvAlgo algo, const ConvProblem& p) {
+    switch (algo) {
+        case ConvAlgo::kDirect:
+            convDirect<T>(p);
+            break;
+        case ConvAlgo::kGemm1x1:
+            convGemm1x1<T>(p);
+            break;
+        case ConvAlgo::kWinograd2:
+            convWinograd<T>(p, kWinogradBT2, kWinogradG2, kWinogradAT2);
+            break;
+        case ConvAlgo::kWinograd4:
+            convWinograd<T>(p, kWinogradBT4, kWinogradG4, kWinogradAT4);
+            break;
+        default:
+            convIm2col<T>(p);
+    }
+}
+
+// Runs p with the forced algorithm, the tuned one or the one of the heuristics
+template <typename T>
+void runProblem(diopiDtype_t dtype, const ConvProblem& p) {
+    ConvAlgo algo;
+    if (forcedAlgo(algo) && applies(algo, p)) {
+        runAlgo<T>(algo, p);
+        return;
+    }
+    if (!autotuneEnabled()) {
+        runAlgo<T>(heuristicAlgo(p), p);
+        return;
+    }
+    const std::string key = problemKey(dtype, p);
+    AutotuneCache& cache = autotuneCache();
+    bool tuned;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto found = cache.algos.find(key);
+        tuned = found != cache.algos.end();
+        if (tuned) {
+            algo = found->second;
+        }
+    }
+    if (tuned) {
+        runAlgo<T>(algo, p);
+        return;
+    }
+    // every algorithm computes the same out, so the timed runs leave it written
+    double best = std::numeric_limits<double>::infinity();
+    for (int64_t i = 0; i < kAlgoCount; ++i) {
+        const ConvAlgo candidate = static_cast<ConvAlgo>(i);
+        if (!applies(candidate, p)) {
+            continue;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        runAlgo<T>(candidate, p);
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed < best) {
+            best = elapsed;
+            algo = candidate;
+        }
+    }
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.algos[key] = algo;
+}
+
+// The weight is made contiguous for im2col, and out is computed in a contiguous copy when its D, H and W do not fold
+template <typename T>
+void forward(diopiDtype_t dtype, ConvProblem p) {
+    const ConvGeometry& geo = p.geo;
+    if (geo.batch == 0 || geo.groups * geo.outC == 0 || geo.outVolume == 0) {
+        return;
+    }
+    std::vector<T> weight;
+    if (!isContiguous(p.weight)) {
+        p.weight = contiguousCopy(p.weight, weight);
+    }
+    int64_t stride;
+    if (spatialStride(p.out, stride)) {
+        runProblem<T>(dtype, p);
+        return;
+    }
+    const ConvTensor out = p.out;
+    std::vector<T> buffer(numel(out));
+    p.out = contiguousLike(out, buffer.data());
+    runProblem<T>(dtype, p);
+    copyTensor<T>(p.out, out);
+}
+
+/**
+ * With stride 1 and padding within the kernel span, gradInput is the convolution of gradOutput, padded by the rest of
+ * the span, with the weight flipped along D, H and W and its in and out channels swapped within each group. Otherwise
+ * the columns weight^T @ gradOutput of each image and group, computed in Acc, are added back onto gradInput by col2im.
+ */
+template <typename T>
+void backwardData(diopiDtype_t dtype, ConvProblem p) {
+    using Acc = typename ComputeType<T>::type;
+    const ConvGeometry& geo = p.geo;
+    const ConvParams& q = p.params;
+    if (geo.batch == 0 || geo.groups * geo.inC == 0 || geo.inVolume == 0) {
+        return;
+    }
+    const int64_t rows = geo.inC * geo.kernelVolume;
+    bool flip = true;
+    for (int64_t d = 0; d < 3; ++d) {
+        flip = flip && q.stride[d] == 1 && q.padding[d] <= q.dilation[d] * (geo.kernel[d] - 1);
+    }
+    if (flip) {
+        std::vector<T> flipped(geo.groups * geo.outC * rows);
+        ConvTensor weight;
+        weight.shape[0] = geo.groups * geo.inC;
+        weight.shape[1] = geo.outC;
+        std::copy(geo.kernel, geo.kernel + 3, weight.shape + 2);
+        weight = contiguousLike(weight, flipped.data());
+        for (int64_t o = 0; o < geo.groups * geo.outC; ++o) {
+            const int64_t g = o / geo.outC;
+            const int64_t co = o % geo.outC;
+            for (int64_t ci = 0; ci < geo.inC; ++ci) {
+                for (int64_t k = 0; k < geo.kernelVolume; ++k) {
+                    const int64_t kw = k % geo.kernel[2];
+                    const int64_t kh = k / geo.kernel[2] % geo.kernel[1];
+                    const int64_t kd = k / (geo.kernel[2] * geo.kernel[1]);
+                    const int64_t at = ((g * geo.inC + ci) * geo.outC + co) * geo.kernelVolume + geo.kernelVolume - 1 - k;
+                    flipped[at] = *element<const T>(p.weight, o, ci, kd, kh, kw);
+                }
+            }
+        }
+        ConvParams params = q;
+        for (int64_t d = 0; d < 3; ++d) {
+            params.padding[d] = q.dilation[d] * (geo.kernel[d] - 1) - q.padding[d];
+        }
+        forward<T>(dtype, makeProblem(params, p.out, weight, p.input, p.bias, p.biasStride));
+        return;
+    }
+
+    std::vector<T> gradOutput;
+    int64_t outStride;
+    if (!spatialStride(p.out, outStride)) {
+        p.out = contiguousCopy(p.out, gradOutput);
+        spatialStride(p.out, outStride);
+    }
+    std::vector<Acc> weight(geo.groups * geo.outC * rows);
+    for (int64_t o = 0; o < geo.groups * geo.outC; ++o) {
+        for (int64_t r = 0; r < rows; ++r) {
+            const int64_t k = r % geo.kernelVolume;
+            weight[o * rows + r] =
+                static_cast<Acc>(*element<const T>(p.weight, o, r / geo.kernelVolume, k / (geo.kernel[2] * geo.kernel[1]), k / geo.kernel[2] % geo.kernel[1],
+                                                   k % geo.kernel[2]));
+        }
+    }
+    forEachTask(geo.batch * geo.groups, [&](int64_t task, bool parallel) {
+        const int64_t n = task / geo.groups;
+        const int64_t g = task % geo.groups;
+        static thread_local std::vector<Acc> col;
+        static thread_local std::vector<Acc> gradOut;
+        col.resize(rows * geo.outVolume);
+        GemmDesc desc;
+        desc.m = rows;
+        desc.n = geo.outVolume;
+        desc.k = geo.outC;
+        desc.a = operand(weight.data() + g * geo.outC * rows, 1, rows);
+        desc.b = accOperand<Acc>(element<const T>(p.out, n, g * geo.outC, 0, 0, 0), geo.outC, geo.outVolume, p.out.stride[1], outStride, gradOut);
+        desc.c = operand(col.data(), geo.outVolume, 1);
+        gemm<Acc>(desc);
+        col2im<T>(p, n, g, col.data(), parallel);
+    });
+}
+
+/**
+ * gradWeight = gradOutput @ col^T for each group, summed over the images in Acc; a 1x1 convolution of stride 1 reads
+ * the input in place of col. Images too small to split across the threads are shared out among them instead, each
+ * thread summing its own part.
+ */
+template <typename T>
+void backwardWeight(ConvProblem p) {
+    using Acc = typename ComputeType<T>::type;
+    const ConvGeometry& geo = p.geo;
+    const ConvParams& q = p.params;
+    const int64_t rows = geo.inC * geo.kernelVolume;
+    const int64_t size = geo.groups * geo.outC * rows;
+    if (size == 0) {
+        return;
+    }
+    std::vector<T> gradOutput;
+    int64_t outStride;
+    if (!spatialStride(p.out, outStride)) {
+        p.out = contiguousCopy(p.out, gradOutput);
+        spatialStride(p.out, outStride);
+    }
+    int64_t inStride = 1;
+    bool inPlace = std::is_same<T, Acc>::value && geo.kernelVolume == 1 && spatialStride(p.input, inStride);
+    for (int64_t d = 0; d < 3; ++d) {
+        inPlace = inPlace && q.stride[d] == 1 && q.padding[d] == 0;
+    }
+
+    const int64_t work = geo.groups * geo.outC * rows * geo.outVolume;
+    const int64_t parts = work < kImageWork ? std::max<int64_t>(1, std::min(geo.batch, ThreadPool::instance().numThreads())) : 1;
+    std::vector<Acc> grads(parts * size);
+    auto accumulate = [&](int64_t part, bool parallel) {
+        static thread_local std::vector<Acc> col;
+        static thread_local std::vector<Acc> gradOut;
+        Acc* grad = grads.data() + part * size;
+        const int64_t begin = geo.batch * part / parts;
+        const int64_t end = geo.batch * (part + 1) / parts;
+        for (int64_t n = begin; n < end; ++n) {
+            for (int64_t g = 0; g < geo.groups; ++g) {
+                GemmDesc desc;
+                desc.m = geo.outC;
+                desc.n = rows;
+                desc.k = geo.outVolume;
+                desc.a = accOperand<Acc>(element<const T>(p.out, n, g * geo.outC, 0, 0, 0), geo.outC, geo.outVolume, p.out.stride[1], outStride, gradOut);
+                if (inPlace) {
+                    desc.b = operand(element<const T>(p.input, n, g * geo.inC, 0, 0, 0), inStride, p.input.stride[1]);
+                } else {
+                    col.resize(rows * geo.outVolume);
+                    im2col<T>(p, n, g, col.data(), parallel);
+                    desc.b = operand(col.data(), 1, geo.outVolume);
+                }
+                desc.c = operand(grad + g * geo.outC * rows, rows, 1);
+                if (n > begin) {
+                    desc.addend = desc.c;
+                    desc.beta = 1.0;
+                }
+                gemm<Acc>(desc);
+            }
+        }
+    };
+    if (parts > 1) {
+        parallelFor(parts, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t part = begin; part < end; ++part) {
+                accumulate(part, false);
+            }
+        });
+    } else {
+        accumulate(0, true);
+    }
+
+    parallelFor(size, kGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            Acc sum = 0;
+            for (int64_t part = 0; part < parts; ++part) {
+                sum += grads[part * size + i];
+            }
+            const int64_t k = i % geo.kernelVolume;
+            *element<T>(p.weight, i / rows, i / geo.kernelVolume % geo.inC, k / (geo.kernel[2] * geo.kernel[1]), k / geo.kernel[2] % geo.kernel[1],
+                        k % geo.kernel[2]) = static_cast<T>(sum);
+        }
+    });
+}
+
+}  // namespace
+
+diopiError_t convForward(diopiDtype_t dtype, const ConvParams& params, const ConvTensor& input, const ConvTensor& weight, const void* bias, int64_t biasStride,
+                         const ConvTensor& out) {
+    DIOPI_CALL(checkProblem(params, input, weight, out));
+    const ConvProblem p = makeProblem(params, input, weight, out, bias, biasStride);
+    return dispatchFloatingTypes(dtype, [&](auto tag) {
+        forward<typename decltype(tag)::type>(dtype, p);
+        return diopiSuccess;
+    });
+}
+
+diopiError_t convBackwardData(diopiDtype_t dtype, const ConvParams& params, const ConvTensor& gradOutput, const ConvTensor& weight, const void* bias,
+                              int64_t biasStride, const ConvTensor& gradInput) {
+    DIOPI_CALL(checkProblem(params, gradInput, weight, gradOutput));
+    const ConvProblem p = makeProblem(params, gradInput, weight, gradOutput, bias, biasStride);
+    return dispatchFloatingTypes(dtype, [&](auto tag) {
+        backwardData<typename decltype(tag)::type>(dtype, p);
+        return diopiSuccess;
+    });
+}
+
+diopiError_t convBackwardWeight(diopiDtype_t dtype, const ConvParams& params, const ConvTensor& gradOutput, const ConvTensor& input,
+                                const ConvTensor& gradWeight) {
+    DIOPI_CALL(checkProblem(params, input, gradWeight, gradOutput));
+    const ConvProblem p = makeProblem(params, input, gradWeight, gradOutput, nullptr, 0);
+    return dispatchFloatingTypes(dtype, [&](auto tag) {
+        backwardWeight<typename decltype(tag)::type>(p);
+        return diopiSuccess;
+    });
+}
+
+}  // namespace cpu
+}  // namespace impl
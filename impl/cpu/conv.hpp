@@ -0,0 +1,62 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CPU_CONV_HPP_
+#define IMPL_CPU_CONV_HPP_
+
+#include <diopi/diopirt.h>
+
+#include <cstdint>
+
+namespace impl {
+namespace cpu {
+
+// A tensor of a convolution seen as N, C, D, H, W with strides in elements; a 2-d convolution has D = 1. A weight is
+// seen the same way as out channels, in channels of a group, kd, kh, kw.
+struct ConvTensor {
+    void* data = nullptr;
+    int64_t shape[5] = {1, 1, 1, 1, 1};
+    int64_t stride[5] = {0, 0, 0, 0, 0};
+};
+
+// stride, padding and dilation over D, H and W
+struct ConvParams {
+    int64_t stride[3] = {1, 1, 1};
+    int64_t padding[3] = {0, 0, 0};
+    int64_t dilation[3] = {1, 1, 1};
+    int64_t groups = 1;
+};
+
+/**
+ * The algorithms of convForward:
+ * - kDirect: loops over the output positions on channels-last input, for depthwise and thin convolutions;
+ * - kIm2col: unrolls the patches of each image and runs one GEMM per image and group;
+ * - kGemm1x1: a 1x1 convolution of stride 1 without padding, which is a GEMM on the input as it is;
+ * - kWinograd2, kWinograd4: Winograd F(2x2, 3x3) and F(4x4, 3x3) for 2-d 3x3 convolutions of stride 1.
+ * The choice follows the shapes. DIOPI_CPU_CONV_ALGO (direct, im2col, gemm1x1, winograd2 or winograd4) forces an
+ * algorithm wherever it applies; DIOPI_CPU_CONV_AUTOTUNE=1 times every algorithm that applies on the first call for
+ * each problem and keeps the fastest for the later ones.
+ */
+enum class ConvAlgo { kDirect, kIm2col, kGemm1x1, kWinograd2, kWinograd4 };
+
+// out = conv(input, weight) + bias, bias being null or one value per out channel bias stride apart
+diopiError_t convForward(diopiDtype_t dtype, const ConvParams& params, const ConvTensor& input, const ConvTensor& weight, const void* bias, int64_t biasStride,
+                         const ConvTensor& out);
+
+// gradInput of the convolution of gradInput's shape from gradOutput, plus bias when given, which makes it the
+// transposed convolution of gradOutput as well. Stride 1 runs as a convolution with the flipped weight, so with the
+// algorithms of convForward; other strides scatter the columns of a GEMM back onto gradInput.
+diopiError_t convBackwardData(diopiDtype_t dtype, const ConvParams& params, const ConvTensor& gradOutput, const ConvTensor& weight, const void* bias,
+                              int64_t biasStride, const ConvTensor& gradInput);
+
+// gradWeight of the convolution of input giving gradOutput, a GEMM of gradOutput with the unrolled patches of input
+diopiError_t convBackwardWeight(diopiDtype_t dtype, const ConvParams& params, const ConvTensor& gradOutput, const ConvTensor& input,
+                                const ConvTensor& gradWeight);
+
+}  // namespace cpu
+}  // namespace impl
+
+#endif  // IMPL_CPU_CONV_HPP_
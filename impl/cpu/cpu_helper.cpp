@@ -0,0 +1,144 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "cpu_helper.hpp"
+
+#include <cstdlib>
+#include <iterator>
+#include <string>
+
+namespace impl {
+namespace cpu {
+
+DiopiTensor::DiopiTensor(diopiConstTensorHandle_t tensor) : tensor_(tensor) {
+    if (tensor_ == nullptr) {
+        return;
+    }
+    diopiTensorMeta_t meta;
+    if (diopiGetTensorMeta == nullptr || diopiGetTensorMeta(tensor_, &meta) != diopiSuccess) {
+        diopiGetTensorShape(tensor_, &meta.shape);
+        diopiGetTensorStride(tensor_, &meta.stride);
+        diopiGetTensorDtype(tensor_, &meta.dtype);
+        diopiGetTensorDevice(tensor_, &meta.device);
+        diopiGetTensorNumel(tensor_, &meta.numel);
+        diopiGetTensorElemSize(tensor_, &meta.itemsize);
+    }
+    shape_.assign(meta.shape.data, meta.shape.data + meta.shape.len);
+    stride_.assign(meta.stride.data, meta.stride.data + meta.stride.len);
+    dtype_ = meta.dtype;
+    device_ = meta.device;
+    numel_ = meta.numel;
+    elemsize_ = meta.itemsize;
+    const void* data = nullptr;
+    diopiGetTensorDataConst(tensor_, &data);
+    data_ = const_cast<void*>(data);
+}
+
+bool DiopiTensor::isContiguous() const {
+    int64_t expected = 1;
+    for (int64_t i = dim() - 1; i >= 0; --i) {
+        if (shape_[i] != 1 && stride_[i] != expected) {
+            return false;
+        }
+        expected *= shape_[i];
+    }
+    return true;
+}
+
+diopiError_t requireTensor(diopiContextHandle_t ctx, const std::vector<int64_t>& shape, diopiDtype_t dtype, const DiopiTensor& like, DiopiTensor& out) {
+    diopiSize_t size{shape.data(), static_cast<int64_t>(shape.size())};
+    diopiTensorHandle_t tensor = nullptr;
+    DIOPI_CALL(diopiRequireTensor(ctx, &tensor, &size, nullptr, dtype, like.device()));
+    out = DiopiTensor(tensor);
+    return diopiSuccess;
+}
+
+diopiError_t castTo(diopiContextHandle_t ctx, const DiopiTensor& src, diopiDtype_t dtype, DiopiTensor& out) {
+    if (src.dtype() == dtype) {
+        out = src;
+        return diopiSuccess;
+    }
+    DIOPI_CALL(requireTensor(ctx, src.shape(), dtype, src, out));
+    return diopiCastDtype(ctx, out.tensorHandle(), src.tensorHandle());
+}
+
+diopiError_t makeContiguous(diopiContextHandle_t ctx, const DiopiTensor& src, DiopiTensor& out) {
+    if (src.isContiguous()) {
+        out = src;
+        return diopiSuccess;
+    }
+    DIOPI_CALL(requireTensor(ctx, src.shape(), src.dtype(), src, out));
+    return diopiCopyInp(ctx, src.tensorHandle(), out.tensorHandle());
+}
+
+diopiDtype_t promoteTypes(diopiDtype_t a, diopiDtype_t b) {
+    if (a == b) {
+        return a;
+    }
+    if ((a == diopi_dtype_int8 && b == diopi_dtype_uint8) || (a == diopi_dtype_uint8 && b == diopi_dtype_int8)) {
+        return diopi_dtype_int16;
+    }
+    // each dtype holds the values of the ones before it
+    static const diopiDtype_t order[] = {diopi_dtype_bool,  diopi_dtype_uint8,   diopi_dtype_int8,    diopi_dtype_int16,  diopi_dtype_int32,
+                                         diopi_dtype_int64, diopi_dtype_float16, diopi_dtype_float32, diopi_dtype_float64};
+    auto rank = [](diopiDtype_t dtype) { return std::find(std::begin(order), std::end(order), dtype) - std::begin(order); };
+    return rank(a) >= rank(b) ? a : b;
+}
+
+namespace {
+
+CpuIsa detectIsa() {
+    CpuIsa isa = CpuIsa::kGeneric;
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        isa = CpuIsa::kAvx512;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+        isa = CpuIsa::kAvx2;
+    }
+#endif
+    const char* env = std::getenv("DIOPI_CPU_MAX_ISA");
+    if (env != nullptr) {
+        const std::string cap(env);
+        if (cap == "generic") {
+            isa = CpuIsa::kGeneric;
+        } else if (cap == "avx2" && isa == CpuIsa::kAvx512) {
+            isa = CpuIsa::kAvx2;
+        }
+    }
+    return isa;
+}
+
+}  // namespace
+
+CpuIsa cpuIsa() {
+    static const CpuIsa isa = detectIsa();
+    return isa;
+}
+
+std::vector<int64_t> broadcastShape(const std::vector<int64_t>& a, const std::vector<int64_t>& b) {
+    std::vector<int64_t> shape(std::max(a.size(), b.size()), 1);
+    for (size_t i = 0; i < shape.size(); ++i) {
+        int64_t dimA = i < a.size() ? a[a.size() - 1 - i] : 1;
+        int64_t dimB = i < b.size() ? b[b.size() - 1 - i] : 1;
+        shape[shape.size() - 1 - i] = dimA == 1 ? dimB : dimA;
+    }
+    return shape;
+}
+
+std::vector<int64_t> broadcastStrides(const DiopiTensor& tensor, const std::vector<int64_t>& shape) {
+    std::vector<int64_t> strides(shape.size(), 0);
+    const int64_t lead = static_cast<int64_t>(shape.size()) - tensor.dim();
+    for (int64_t i = 0; i < tensor.dim(); ++i) {
+        if (tensor.shape()[i] != 1) {
+            strides[lead + i] = tensor.stride()[i];
+        }
+    }
+    return strides;
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,258 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CPU_CPU_HELPER_HPP_
+#define IMPL_CPU_CPU_HELPER_HPP_
+
+#include <diopi/diopirt.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "error.hpp"
+#include "impl_functions.hpp"
+#include "thread_pool.hpp"
+#include "vec.hpp"
+
+#define DIOPI_CHECK(cond, fmt, args...)                                                     \
+    do {                                                                                    \
+        if (!(cond)) {                                                                      \
+            impl::cpu::setLastErrorString(#fmt " at %s:%d.\n", ##args, __FILE__, __LINE__); \
+            return diopiErrorOccurred;                                                      \
+        }                                                                                   \
+    } while (false);
+
+#define DIOPI_CALL(Expr)                                                                                                     \
+    do {                                                                                                                     \
+        diopiError_t ret = Expr;                                                                                             \
+        if (diopiSuccess != ret) {                                                                                           \
+            impl::cpu::setLastErrorString("%s: %s at %s:%d\n", impl::cpu::getDiopiErrorStr(ret), #Expr, __FILE__, __LINE__); \
+            return ret;                                                                                                      \
+        }                                                                                                                    \
+    } while (false);
+
+namespace impl {
+namespace cpu {
+
+// Host view of a diopi tensor: the metadata is read once, strides are in elements
+class DiopiTensor {
+public:
+    DiopiTensor() = default;
+    explicit DiopiTensor(diopiConstTensorHandle_t tensor);
+
+    bool defined() const { return tensor_ != nullptr; }
+    diopiDtype_t dtype() const { return dtype_; }
+    diopiDevice_t device() const { return device_; }
+    const std::vector<int64_t>& shape() const { return shape_; }
+    const std::vector<int64_t>& stride() const { return stride_; }
+    int64_t dim() const { return static_cast<int64_t>(shape_.size()); }
+    int64_t numel() const { return numel_; }
+    int64_t elemsize() const { return elemsize_; }
+    bool isContiguous() const;
+
+    template <typename T>
+    T* data() const {
+        return static_cast<T*>(data_);
+    }
+
+    diopiTensorHandle_t tensorHandle() const { return const_cast<diopiTensorHandle_t>(tensor_); }
+
+private:
+    diopiConstTensorHandle_t tensor_ = nullptr;
+    void* data_ = nullptr;
+    diopiDtype_t dtype_{diopi_dtype_unsupported};
+    diopiDevice_t device_{diopi_host};
+    std::vector<int64_t> shape_;
+    std::vector<int64_t> stride_;
+    int64_t numel_ = 0;
+    int64_t elemsize_ = 0;
+};
+
+// a contiguous tensor of the given shape and dtype on the device of like
+diopiError_t requireTensor(diopiContextHandle_t ctx, const std::vector<int64_t>& shape, diopiDtype_t dtype, const DiopiTensor& like, DiopiTensor& out);
+
+// src cast to dtype, src itself when it already has it
+diopiError_t castTo(diopiContextHandle_t ctx, const DiopiTensor& src, diopiDtype_t dtype, DiopiTensor& out);
+
+// src with contiguous strides, src itself when it already has them
+diopiError_t makeContiguous(diopiContextHandle_t ctx, const DiopiTensor& src, DiopiTensor& out);
+
+std::vector<int64_t> broadcastShape(const std::vector<int64_t>& a, const std::vector<int64_t>& b);
+
+// strides of tensor seen with shape, 0 along the broadcast dimensions
+std::vector<int64_t> broadcastStrides(const DiopiTensor& tensor, const std::vector<int64_t>& shape);
+
+// dtype two operands of the given dtypes are computed in
+diopiDtype_t promoteTypes(diopiDtype_t a, diopiDtype_t b);
+
+// Instruction sets the GEMM micro-kernels and the vectorized elementwise loops are built for, besides the generic one
+// (SSE2 on x86-64, NEON on aarch64)
+enum class CpuIsa { kGeneric, kAvx2, kAvx512 };
+
+// Widest instruction set the CPU supports, detected once; DIOPI_CPU_MAX_ISA (avx512, avx2 or generic) caps it
+CpuIsa cpuIsa();
+
+inline bool isFloatingType(diopiDtype_t dtype) {
+    return dtype == diopi_dtype_float16 || dtype == diopi_dtype_float32 || dtype == diopi_dtype_float64;
+}
+
+inline bool isIntegralType(diopiDtype_t dtype) {
+    return dtype == diopi_dtype_int8 || dtype == diopi_dtype_uint8 || dtype == diopi_dtype_int16 || dtype == diopi_dtype_int32 || dtype == diopi_dtype_int64;
+}
+
+/********************************* dtype dispatch ****************************/
+
+template <typename T>
+struct TypeTag {
+    using type = T;
+};
+
+// type the kernels accumulate T in
+template <typename T>
+struct AccType {
+    using type = typename std::conditional<std::is_integral<T>::value, int64_t, T>::type;
+};
+template <>
+struct AccType<half> {
+    using type = float;
+};
+
+template <typename To, typename From>
+inline To castValue(From value) {
+    return static_cast<To>(value);
+}
+template <>
+inline bool castValue<bool, half>(half value) {
+    return static_cast<float>(value) != 0.0f;
+}
+
+template <typename T>
+inline T scalarValue(const diopiScalar_t* scalar) {
+    if (scalar == nullptr) {
+        return castValue<T>(1);
+    }
+    if (isFloatingType(scalar->stype)) {
+        return castValue<T>(scalar->fval);
+    }
+    return castValue<T>(scalar->ival);
+}
+
+// Calls f(TypeTag<T>()) with the C++ type of dtype
+template <typename F>
+diopiError_t dispatchAllTypes(diopiDtype_t dtype, F&& f) {
+    switch (dtype) {
+        case diopi_dtype_bool:
+            return f(TypeTag<bool>());
+        case diopi_dtype_int8:
+            return f(TypeTag<int8_t>());
+        case diopi_dtype_uint8:
+            return f(TypeTag<uint8_t>());
+        case diopi_dtype_int16:
+            return f(TypeTag<int16_t>());
+        case diopi_dtype_int32:
+            return f(TypeTag<int32_t>());
+        case diopi_dtype_int64:
+            return f(TypeTag<int64_t>());
+        case diopi_dtype_float16:
+            return f(TypeTag<half>());
+        case diopi_dtype_float32:
+            return f(TypeTag<float>());
+        case diopi_dtype_float64:
+            return f(TypeTag<double>());
+        default:
+            setLastErrorString("dtype %d is not supported at %s:%d.\n", dtype, __FILE__, __LINE__);
+            return diopiDtypeNotSupported;
+    }
+}
+
+// dispatchAllTypes plus the unsigned dtypes no kernel computes in, only casts and copies move them
+template <typename F>
+diopiError_t dispatchCastTypes(diopiDtype_t dtype, F&& f) {
+    switch (dtype) {
+        case diopi_dtype_uint16:
+            return f(TypeTag<uint16_t>());
+        case diopi_dtype_uint32:
+            return f(TypeTag<uint32_t>());
+        case diopi_dtype_uint64:
+            return f(TypeTag<uint64_t>());
+        default:
+            return dispatchAllTypes(dtype, std::forward<F>(f));
+    }
+}
+
+template <typename F>
+diopiError_t dispatchNumericTypes(diopiDtype_t dtype, F&& f) {
+    if (dtype == diopi_dtype_bool) {
+        setLastErrorString("dtype bool is not supported at %s:%d.\n", __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return dispatchAllTypes(dtype, std::forward<F>(f));
+}
+
+template <typename F>
+diopiError_t dispatchFloatingTypes(diopiDtype_t dtype, F&& f) {
+    switch (dtype) {
+        case diopi_dtype_float16:
+            return f(TypeTag<half>());
+        case diopi_dtype_float32:
+            return f(TypeTag<float>());
+        case diopi_dtype_float64:
+            return f(TypeTag<double>());
+        default:
+            setLastErrorString("dtype %d is not supported, a floating dtype is required at %s:%d.\n", dtype, __FILE__, __LINE__);
+            return diopiDtypeNotSupported;
+    }
+}
+
+/********************************* strided loops ****************************/
+
+// Walks the n-d index of shape from linear position begin to end. Each run along the innermost dimension is handed to
+// inner(offsets, strides, len) in one piece, with the element offset of every operand at its start.
+template <size_t N, typename Inner>
+void stridedLoop(const std::vector<int64_t>& shape, const std::vector<int64_t> (&strides)[N], int64_t begin, int64_t end, Inner&& inner) {
+    const int64_t ndim = static_cast<int64_t>(shape.size());
+    if (ndim == 0) {
+        int64_t offsets[N] = {0};
+        int64_t innerStrides[N] = {0};
+        inner(offsets, innerStrides, end - begin);
+        return;
+    }
+    std::vector<int64_t> index(ndim, 0);
+    int64_t rest = begin;
+    for (int64_t d = ndim - 1; d >= 0; --d) {
+        index[d] = rest % shape[d];
+        rest /= shape[d];
+    }
+    int64_t innerStrides[N];
+    for (size_t k = 0; k < N; ++k) {
+        innerStrides[k] = strides[k][ndim - 1];
+    }
+    int64_t pos = begin;
+    while (pos < end) {
+        int64_t offsets[N];
+        for (size_t k = 0; k < N; ++k) {
+            offsets[k] = 0;
+            for (int64_t d = 0; d < ndim; ++d) {
+                offsets[k] += index[d] * strides[k][d];
+            }
+        }
+        int64_t len = std::min(shape[ndim - 1] - index[ndim - 1], end - pos);
+        inner(offsets, innerStrides, len);
+        pos += len;
+        index[ndim - 1] += len;
+        for (int64_t d = ndim - 1; d > 0 && index[d] == shape[d]; --d) {
+            index[d] = 0;
+            ++index[d - 1];
+        }
+    }
+}
+
+}  // namespace cpu
+}  // namespace impl
+
+#endif  // IMPL_CPU_CPU_HELPER_HPP_
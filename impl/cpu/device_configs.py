@@ -0,0 +1,31 @@
+# Copyright (c) 2023, DeepLink.
+import numpy as np
+from skip import Skip
+
+# Integral and bool inputs of the floating unary ops are cast to the floating out, so only
+# ops whose out keeps the bool dtype fall outside the cpu kernels.
+device_configs = {
+    'pointwise_op_bool': dict(
+        name=['abs'],
+        tensor_para=dict(
+            args=[
+                {
+                    "ins": ['input'],
+                    "dtype": [Skip(np.bool_)],
+                },
+            ],
+        ),
+    ),
+
+    'pointwise_op_without_inplace_zero': dict(
+        name=['abs'],
+        tensor_para=dict(
+            args=[
+                {
+                    "ins": ['input'],
+                    "dtype": [Skip(np.bool_)],
+                },
+            ],
+        ),
+    ),
+}
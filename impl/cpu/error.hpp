@@ -0,0 +1,40 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CPU_ERROR_HPP_
+#define IMPL_CPU_ERROR_HPP_
+
+#include <diopi/diopirt.h>
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+namespace impl {
+
+namespace cpu {
+
+extern char strLastError[8192];
+extern int32_t curIdxError;
+extern std::mutex mtxLastError;
+
+template <typename... Types>
+inline void setLastErrorString(const char* szFmt, Types&&... args) {
+    std::lock_guard<std::mutex> lock(mtxLastError);
+    snprintf(strLastError + curIdxError, sizeof(strLastError) - curIdxError, szFmt, std::forward<Types>(args)...);
+    curIdxError = strlen(strLastError);
+}
+
+const char* cpuGetLastErrorString(bool clearBuff);
+
+const char* getDiopiErrorStr(diopiError_t err);
+
+}  // namespace cpu
+
+}  // namespace impl
+
+#endif  // IMPL_CPU_ERROR_HPP_
@@ -0,0 +1,195 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "../tensor_iterator.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+template <typename C>
+C divideIntegral(C x, C y, diopiRoundMode_t roundingMode) {
+    if (y == 0) {
+        return 0;
+    }
+    C value = static_cast<C>(x / y);
+    // the signs differ when x ^ y is negative
+    if (roundingMode == RoundModeFloor && x % y != 0 && (x ^ y) < 0) {
+        value = static_cast<C>(value - 1);
+    }
+    return value;
+}
+
+// x + alpha * y, also subtraction with a negated alpha
+struct AddOp {
+    const diopiScalar_t* alpha;
+    bool negate;
+
+    template <typename Tag>
+    auto operator()(Tag) const {
+        using C = typename ComputeType<typename Tag::type>::type;
+        const C scale = negate ? static_cast<C>(-scalarValue<C>(alpha)) : scalarValue<C>(alpha);
+        return [scale](auto x, auto y) { return x + y * decltype(x)(scale); };
+    }
+};
+
+struct MulOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x, auto y) { return x * y; };
+    }
+};
+
+struct DivOp {
+    diopiRoundMode_t roundingMode;
+
+    template <typename Tag>
+    auto operator()(Tag) const {
+        using C = typename ComputeType<typename Tag::type>::type;
+        return make(TypeTag<C>(), std::is_floating_point<C>());
+    }
+
+    template <typename C>
+    auto make(TypeTag<C>, std::true_type /*floating*/) const {
+        const diopiRoundMode_t mode = roundingMode;
+        return [mode](auto x, auto y) {
+            auto value = x / y;
+            if (mode == RoundModeTrunc) {
+                return vec::trunc(value);
+            }
+            if (mode == RoundModeFloor) {
+                return vec::floor(value);
+            }
+            return value;
+        };
+    }
+
+    // integers are divided lane by lane, a zero divisor gives 0 instead of a trap
+    template <typename C>
+    auto make(TypeTag<C>, std::false_type /*integral*/) const {
+        const diopiRoundMode_t mode = roundingMode;
+        return [mode](auto x, auto y) { return vec::map([mode](C a, C b) { return divideIntegral<C>(a, b, mode); }, x, y); };
+    }
+};
+
+// the binary op with other fixed to a scalar
+template <typename BinaryOp>
+struct WithScalar {
+    BinaryOp op;
+    const diopiScalar_t* other;
+
+    template <typename Tag>
+    auto operator()(Tag tag) const {
+        using C = typename ComputeType<typename Tag::type>::type;
+        auto binary = op(tag);
+        const C value = scalarValue<C>(other);
+        return [binary, value](auto x) { return binary(x, decltype(x)(value)); };
+    }
+};
+
+template <typename BinaryOp>
+WithScalar<BinaryOp> withScalar(BinaryOp op, const diopiScalar_t* other) {
+    return WithScalar<BinaryOp>{op, other};
+}
+
+// division of integers yields floats unless a rounding mode is given, the scalar then has to keep its precision
+diopiError_t divScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other,
+                       diopiRoundMode_t roundingMode) {
+    DiopiTensor outTensor(out);
+    if (isIntegralType(outTensor.dtype()) && isFloatingType(other->stype)) {
+        DiopiTensor result;
+        DIOPI_CALL(requireTensor(ctx, outTensor.shape(), diopi_dtype_float64, outTensor, result));
+        DIOPI_CALL(unaryOp(ctx, result.tensorHandle(), input, withScalar(DivOp{roundingMode}, other)));
+        return diopiCastDtype(ctx, out, result.tensorHandle());
+    }
+    return unaryOp(ctx, out, input, withScalar(DivOp{roundingMode}, other));
+}
+
+// division is not defined on bool, the other dtypes are computed in the dtype of out
+diopiError_t divide(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other,
+                    diopiRoundMode_t roundingMode) {
+    if (DiopiTensor(out).dtype() == diopi_dtype_bool) {
+        setLastErrorString("dtype bool is not supported at %s:%d.\n", __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return binaryOp(ctx, out, input, other, DivOp{roundingMode});
+}
+
+}  // namespace
+
+diopiError_t diopiAdd(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other,
+                      const diopiScalar_t* alpha) {
+    return binaryOp(ctx, out, input, other, AddOp{alpha, false});
+}
+
+diopiError_t diopiAddInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other, const diopiScalar_t* alpha) {
+    return binaryOp(ctx, input, input, other, AddOp{alpha, false});
+}
+
+diopiError_t diopiAddScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other,
+                            const diopiScalar_t* alpha) {
+    return unaryOp(ctx, out, input, withScalar(AddOp{alpha, false}, other));
+}
+
+diopiError_t diopiAddInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other, const diopiScalar_t* alpha) {
+    return unaryOp(ctx, input, input, withScalar(AddOp{alpha, false}, other));
+}
+
+diopiError_t diopiSub(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other,
+                      const diopiScalar_t* alpha) {
+    return binaryOp(ctx, out, input, other, AddOp{alpha, true});
+}
+
+diopiError_t diopiSubInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other, const diopiScalar_t* alpha) {
+    return binaryOp(ctx, input, input, other, AddOp{alpha, true});
+}
+
+diopiError_t diopiSubScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other,
+                            const diopiScalar_t* alpha) {
+    return unaryOp(ctx, out, input, withScalar(AddOp{alpha, true}, other));
+}
+
+diopiError_t diopiSubInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other, const diopiScalar_t* alpha) {
+    return unaryOp(ctx, input, input, withScalar(AddOp{alpha, true}, other));
+}
+
+diopiError_t diopiMul(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return binaryOp(ctx, out, input, other, MulOp());
+}
+
+diopiError_t diopiMulInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return binaryOp(ctx, input, input, other, MulOp());
+}
+
+diopiError_t diopiMulScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other) {
+    return unaryOp(ctx, out, input, withScalar(MulOp(), other));
+}
+
+diopiError_t diopiMulInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other) {
+    return unaryOp(ctx, input, input, withScalar(MulOp(), other));
+}
+
+diopiError_t diopiDiv(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other,
+                      diopiRoundMode_t rounding_mode) {
+    return divide(ctx, out, input, other, rounding_mode);
+}
+
+diopiError_t diopiDivInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other, diopiRoundMode_t rounding_mode) {
+    return divide(ctx, input, input, other, rounding_mode);
+}
+
+diopiError_t diopiDivScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other,
+                            diopiRoundMode_t rounding_mode) {
+    return divScalar(ctx, out, input, other, rounding_mode);
+}
+
+diopiError_t diopiDivInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other, diopiRoundMode_t rounding_mode) {
+    return divScalar(ctx, input, input, other, rounding_mode);
+}
+
+}  // namespace cpu
+}  // namespace impl
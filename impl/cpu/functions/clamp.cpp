@@ -0,0 +1,138 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <limits>
+
+#include "../tensor_iterator.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+template <typename C>
+C lowestValue() {
+    return std::numeric_limits<C>::has_infinity ? -std::numeric_limits<C>::infinity() : std::numeric_limits<C>::lowest();
+}
+
+template <typename C>
+C highestValue() {
+    return std::numeric_limits<C>::has_infinity ? std::numeric_limits<C>::infinity() : std::numeric_limits<C>::max();
+}
+
+// clamp to scalar bounds, a missing bound does not limit
+struct ClampScalarOp {
+    const diopiScalar_t* min;
+    const diopiScalar_t* max;
+
+    template <typename Tag>
+    auto operator()(Tag) const {
+        using C = typename ComputeType<typename Tag::type>::type;
+        const C lo = min != nullptr ? scalarValue<C>(min) : lowestValue<C>();
+        const C hi = max != nullptr ? scalarValue<C>(max) : highestValue<C>();
+        return [lo, hi](auto x) {
+            using V = decltype(x);
+            return vec::min(vec::max(x, V(lo)), V(hi));
+        };
+    }
+};
+
+// a NaN in either operand gives NaN
+struct MaxOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x, auto y) { return vec::max(x, y); };
+    }
+};
+
+struct MinOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x, auto y) { return vec::min(x, y); };
+    }
+};
+
+struct ClampOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x, auto lo, auto hi) { return vec::min(vec::max(x, lo), hi); };
+    }
+};
+
+diopiError_t clamp(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t min,
+                   diopiConstTensorHandle_t max) {
+    DIOPI_CHECK(min != nullptr || max != nullptr, "at least one of min and max must be given");
+    if (min == nullptr) {
+        return binaryOp(ctx, out, input, max, MinOp());
+    }
+    if (max == nullptr) {
+        return binaryOp(ctx, out, input, min, MaxOp());
+    }
+    return ternaryOp(ctx, out, input, min, max, ClampOp());
+}
+
+}  // namespace
+
+diopiError_t diopiClampInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* min, const diopiScalar_t* max) {
+    return unaryOp(ctx, input, input, ClampScalarOp{min, max});
+}
+
+diopiError_t diopiClampInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t min, diopiConstTensorHandle_t max) {
+    return clamp(ctx, input, input, min, max);
+}
+
+diopiError_t diopiClampScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* min,
+                              const diopiScalar_t* max) {
+    return unaryOp(ctx, out, input, ClampScalarOp{min, max});
+}
+
+diopiError_t diopiClamp(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t min,
+                        diopiConstTensorHandle_t max) {
+    return clamp(ctx, out, input, min, max);
+}
+
+diopiError_t diopiClampMaxInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* max) {
+    return unaryOp(ctx, input, input, ClampScalarOp{nullptr, max});
+}
+
+diopiError_t diopiClampMaxInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t max) {
+    return binaryOp(ctx, input, input, max, MinOp());
+}
+
+diopiError_t diopiClampMaxScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* max) {
+    return unaryOp(ctx, out, input, ClampScalarOp{nullptr, max});
+}
+
+diopiError_t diopiClampMax(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t max) {
+    return binaryOp(ctx, out, input, max, MinOp());
+}
+
+diopiError_t diopiClampMinInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* min) {
+    return unaryOp(ctx, input, input, ClampScalarOp{min, nullptr});
+}
+
+diopiError_t diopiClampMinInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t min) {
+    return binaryOp(ctx, input, input, min, MaxOp());
+}
+
+diopiError_t diopiClampMinScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* min) {
+    return unaryOp(ctx, out, input, ClampScalarOp{min, nullptr});
+}
+
+diopiError_t diopiClampMin(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t min) {
+    return binaryOp(ctx, out, input, min, MaxOp());
+}
+
+diopiError_t diopiMaximum(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return binaryOp(ctx, out, input, other, MaxOp());
+}
+
+diopiError_t diopiMinimum(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return binaryOp(ctx, out, input, other, MinOp());
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,225 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "../tensor_iterator.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+struct EqOp {
+    template <typename T>
+    bool operator()(T a, T b) const {
+        return a == b;
+    }
+};
+
+struct NeOp {
+    template <typename T>
+    bool operator()(T a, T b) const {
+        return a != b;
+    }
+};
+
+struct GeOp {
+    template <typename T>
+    bool operator()(T a, T b) const {
+        return a >= b;
+    }
+};
+
+struct GtOp {
+    template <typename T>
+    bool operator()(T a, T b) const {
+        return a > b;
+    }
+};
+
+struct LeOp {
+    template <typename T>
+    bool operator()(T a, T b) const {
+        return a <= b;
+    }
+};
+
+struct LtOp {
+    template <typename T>
+    bool operator()(T a, T b) const {
+        return a < b;
+    }
+};
+
+// The comparisons produce bool, written to out directly when it is bool and through a temporary otherwise
+diopiError_t requireBoolResult(diopiContextHandle_t ctx, const DiopiTensor& out, DiopiTensor& result) {
+    if (out.dtype() == diopi_dtype_bool) {
+        result = out;
+        return diopiSuccess;
+    }
+    return requireTensor(ctx, out.shape(), diopi_dtype_bool, out, result);
+}
+
+diopiError_t writeBack(diopiContextHandle_t ctx, const DiopiTensor& result, diopiTensorHandle_t out) {
+    if (result.tensorHandle() == out) {
+        return diopiSuccess;
+    }
+    return diopiCastDtype(ctx, out, result.tensorHandle());
+}
+
+// out = cmp(input, other) with both operands promoted to a common dtype
+template <typename CompareOp>
+diopiError_t compare(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other, CompareOp cmp) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor(input);
+    DiopiTensor otherTensor(other);
+    const diopiDtype_t dtype = promoteTypes(inputTensor.dtype(), otherTensor.dtype());
+    DiopiTensor lhs;
+    DiopiTensor rhs;
+    DiopiTensor result;
+    DIOPI_CALL(castTo(ctx, inputTensor, dtype, lhs));
+    DIOPI_CALL(castTo(ctx, otherTensor, dtype, rhs));
+    DIOPI_CALL(requireBoolResult(ctx, outTensor, result));
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(result).addInput(lhs).addInput(rhs).build());
+    DIOPI_CALL(dispatchAllTypes(dtype, [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        using C = typename ComputeType<T>::type;
+        cpuKernel<bool, T, T>(iter, [cmp](T a, T b) { return cmp(static_cast<C>(a), static_cast<C>(b)); });
+        return diopiSuccess;
+    }));
+    return writeBack(ctx, result, out);
+}
+
+template <typename T, typename S, typename CompareOp>
+void compareScalarKernel(const TensorIterator& iter, S value, CompareOp cmp) {
+    cpuKernel<bool, T>(iter, [value, cmp](T a) { return cmp(static_cast<S>(a), value); });
+}
+
+// out = cmp(input, other). A floating input is compared in its own dtype, an integral one in int64, or in float64
+// against a floating scalar.
+template <typename CompareOp>
+diopiError_t compareScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other, CompareOp cmp) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor(input);
+    DiopiTensor result;
+    DIOPI_CALL(requireBoolResult(ctx, outTensor, result));
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(result).addInput(inputTensor).build());
+    DIOPI_CALL(dispatchAllTypes(inputTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        using C = typename ComputeType<T>::type;
+        if (isFloatingType(inputTensor.dtype())) {
+            compareScalarKernel<T, C>(iter, scalarValue<C>(other), cmp);
+        } else if (isFloatingType(other->stype)) {
+            compareScalarKernel<T, double>(iter, other->fval, cmp);
+        } else {
+            compareScalarKernel<T, int64_t>(iter, other->ival, cmp);
+        }
+        return diopiSuccess;
+    }));
+    return writeBack(ctx, result, out);
+}
+
+}  // namespace
+
+diopiError_t diopiEqScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, out, input, other, EqOp());
+}
+
+diopiError_t diopiEqInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, input, input, other, EqOp());
+}
+
+diopiError_t diopiEq(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, out, input, other, EqOp());
+}
+
+diopiError_t diopiEqInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, input, input, other, EqOp());
+}
+
+diopiError_t diopiNeScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, out, input, other, NeOp());
+}
+
+diopiError_t diopiNeInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, input, input, other, NeOp());
+}
+
+diopiError_t diopiNe(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, out, input, other, NeOp());
+}
+
+diopiError_t diopiNeInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, input, input, other, NeOp());
+}
+
+diopiError_t diopiGeScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, out, input, other, GeOp());
+}
+
+diopiError_t diopiGeInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, input, input, other, GeOp());
+}
+
+diopiError_t diopiGe(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, out, input, other, GeOp());
+}
+
+diopiError_t diopiGeInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, input, input, other, GeOp());
+}
+
+diopiError_t diopiGtScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, out, input, other, GtOp());
+}
+
+diopiError_t diopiGtInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, input, input, other, GtOp());
+}
+
+diopiError_t diopiGt(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, out, input, other, GtOp());
+}
+
+diopiError_t diopiGtInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, input, input, other, GtOp());
+}
+
+diopiError_t diopiLeScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, out, input, other, LeOp());
+}
+
+diopiError_t diopiLeInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, input, input, other, LeOp());
+}
+
+diopiError_t diopiLe(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, out, input, other, LeOp());
+}
+
+diopiError_t diopiLeInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, input, input, other, LeOp());
+}
+
+diopiError_t diopiLtScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, out, input, other, LtOp());
+}
+
+diopiError_t diopiLtInpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t input, const diopiScalar_t* other) {
+    return compareScalar(ctx, input, input, other, LtOp());
+}
+
+diopiError_t diopiLt(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, out, input, other, LtOp());
+}
+
+diopiError_t diopiLtInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t other) {
+    return compare(ctx, input, input, other, LtOp());
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,244 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "../conv.hpp"
+#include "../cpu_helper.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+// a tensor of 2 + spatialDims dims as N, C, D, H, W, D being of size 1 for a 2-d convolution
+ConvTensor convTensor(const DiopiTensor& tensor) {
+    ConvTensor result;
+    result.data = tensor.data<void>();
+    const int64_t lead = 5 - tensor.dim();
+    for (int64_t d = 0; d < tensor.dim(); ++d) {
+        const int64_t to = d < 2 ? d : d + lead;
+        result.shape[to] = tensor.shape()[d];
+        result.stride[to] = tensor.stride()[d];
+    }
+    return result;
+}
+
+// stride, padding and dilation of a convolution over spatialDims dims, each given once for all of them or once per dim
+diopiError_t convParams(diopiSize_t stride, diopiSize_t padding, diopiSize_t dilation, int64_t groups, int64_t spatialDims, ConvParams& params) {
+    const diopiSize_t sizes[3] = {stride, padding, dilation};
+    int64_t* values[3] = {params.stride, params.padding, params.dilation};
+    for (int64_t i = 0; i < 3; ++i) {
+        DIOPI_CHECK(sizes[i].len == 1 || sizes[i].len == spatialDims, "stride, padding and dilation take 1 or %ld values", spatialDims);
+        for (int64_t d = 0; d < spatialDims; ++d) {
+            values[i][3 - spatialDims + d] = sizes[i].data[sizes[i].len == 1 ? 0 : d];
+        }
+    }
+    params.groups = groups;
+    return diopiSuccess;
+}
+
+diopiError_t checkDims(const DiopiTensor& tensor, int64_t spatialDims) {
+    DIOPI_CHECK(tensor.dim() == spatialDims + 2, "a %ld-d convolution takes tensors of %ld dims", spatialDims, spatialDims + 2);
+    return diopiSuccess;
+}
+
+// the bias cast to dtype, one value per channel biasStride apart; null without bias
+diopiError_t biasOf(diopiContextHandle_t ctx, diopiConstTensorHandle_t bias, diopiDtype_t dtype, int64_t channels, DiopiTensor& biasTensor,
+                    const void*& data, int64_t& stride) {
+    data = nullptr;
+    stride = 0;
+    if (bias == nullptr) {
+        return diopiSuccess;
+    }
+    DIOPI_CALL(castTo(ctx, DiopiTensor(bias), dtype, biasTensor));
+    DIOPI_CHECK(biasTensor.numel() == channels, "bias must have one element per out channel");
+    data = biasTensor.data<void>();
+    stride = biasTensor.dim() == 0 ? 0 : biasTensor.stride().back();
+    return diopiSuccess;
+}
+
+// grad_bias sums grad_output over all dims but the channels, it has the shape of bias_sizes when they are given
+diopiError_t gradBiasOf(diopiContextHandle_t ctx, diopiTensorHandle_t gradBias, const DiopiTensor& gradOutput, const diopiSize_t* biasSizes) {
+    DiopiTensor gradBiasTensor(gradBias);
+    DIOPI_CHECK(gradBiasTensor.numel() == gradOutput.shape()[1], "grad_bias must have one element per out channel");
+    if (biasSizes != nullptr) {
+        DIOPI_CHECK(gradBiasTensor.shape() == std::vector<int64_t>(biasSizes->data, biasSizes->data + biasSizes->len),
+                    "grad_bias does not have the shape given by bias_sizes");
+    }
+    std::vector<int64_t> dims{0};
+    for (int64_t d = 2; d < gradOutput.dim(); ++d) {
+        dims.push_back(d);
+    }
+    return diopiSum(ctx, gradBias, gradOutput.tensorHandle(), diopiSize_t{dims.data(), static_cast<int64_t>(dims.size())});
+}
+
+// out of a transposed convolution is as large as the input of the convolution from out to input, output_padding
+// telling the sizes apart that the stride maps to the same input
+diopiError_t checkTransposedSize(const DiopiTensor& out, const DiopiTensor& input, const DiopiTensor& weight, const ConvParams& params,
+                                 diopiSize_t outputPadding) {
+    DIOPI_CHECK(outputPadding.len == 1 || outputPadding.len == 2, "output_padding takes 1 or 2 values");
+    for (int64_t d = 0; d < 2; ++d) {
+        const int64_t extra = outputPadding.data[outputPadding.len == 1 ? 0 : d];
+        const int64_t expected = (input.shape()[d + 2] - 1) * params.stride[d + 1] - 2 * params.padding[d + 1] +
+                                 params.dilation[d + 1] * (weight.shape()[d + 2] - 1) + extra + 1;
+        DIOPI_CHECK(out.shape()[d + 2] == expected, "out does not have the spatial size of the transposed convolution");
+    }
+    return diopiSuccess;
+}
+
+diopiError_t convolution(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight,
+                         diopiConstTensorHandle_t bias, diopiSize_t stride, diopiSize_t padding, diopiSize_t dilation, int64_t groups, int64_t spatialDims) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DiopiTensor weightTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(weight), outTensor.dtype(), weightTensor));
+    DIOPI_CALL(checkDims(outTensor, spatialDims));
+    DIOPI_CALL(checkDims(inputTensor, spatialDims));
+    DIOPI_CALL(checkDims(weightTensor, spatialDims));
+    ConvParams params;
+    DIOPI_CALL(convParams(stride, padding, dilation, groups, spatialDims, params));
+    DiopiTensor biasTensor;
+    const void* biasData;
+    int64_t biasStride;
+    DIOPI_CALL(biasOf(ctx, bias, outTensor.dtype(), outTensor.shape()[1], biasTensor, biasData, biasStride));
+    return convForward(outTensor.dtype(), params, convTensor(inputTensor), convTensor(weightTensor), biasData, biasStride, convTensor(outTensor));
+}
+
+/**
+ * grad_input comes from convBackwardData and grad_weight from convBackwardWeight, grad_bias sums grad_output over all
+ * dims but the channels. Each gradient is optional.
+ */
+diopiError_t convolutionBackward(diopiContextHandle_t ctx, diopiTensorHandle_t grad_input, diopiTensorHandle_t grad_weight, diopiTensorHandle_t grad_bias,
+                                 diopiConstTensorHandle_t grad_output, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight,
+                                 const diopiSize_t* biasSizes, diopiSize_t stride, diopiSize_t padding, diopiSize_t dilation, int64_t groups,
+                                 int64_t spatialDims) {
+    DiopiTensor gradOutputTensor(grad_output);
+    DIOPI_CALL(checkDims(gradOutputTensor, spatialDims));
+    ConvParams params;
+    DIOPI_CALL(convParams(stride, padding, dilation, groups, spatialDims, params));
+
+    if (grad_input != nullptr) {
+        DiopiTensor gradInputTensor(grad_input);
+        DiopiTensor gradOutput;
+        DiopiTensor weightCast;
+        DIOPI_CALL(castTo(ctx, gradOutputTensor, gradInputTensor.dtype(), gradOutput));
+        DIOPI_CALL(castTo(ctx, DiopiTensor(weight), gradInputTensor.dtype(), weightCast));
+        DIOPI_CALL(checkDims(gradInputTensor, spatialDims));
+        DIOPI_CALL(checkDims(weightCast, spatialDims));
+        DIOPI_CALL(convBackwardData(gradInputTensor.dtype(), params, convTensor(gradOutput), convTensor(weightCast), nullptr, 0, convTensor(gradInputTensor)));
+    }
+
+    if (grad_weight != nullptr) {
+        DiopiTensor gradWeightTensor(grad_weight);
+        DiopiTensor gradOutput;
+        DiopiTensor inputCast;
+        DIOPI_CALL(castTo(ctx, gradOutputTensor, gradWeightTensor.dtype(), gradOutput));
+        DIOPI_CALL(castTo(ctx, DiopiTensor(input), gradWeightTensor.dtype(), inputCast));
+        DIOPI_CALL(checkDims(gradWeightTensor, spatialDims));
+        DIOPI_CALL(checkDims(inputCast, spatialDims));
+        DIOPI_CALL(convBackwardWeight(gradWeightTensor.dtype(), params, convTensor(gradOutput), convTensor(inputCast), convTensor(gradWeightTensor)));
+    }
+
+    if (grad_bias != nullptr) {
+        DIOPI_CALL(gradBiasOf(ctx, grad_bias, gradOutputTensor, biasSizes));
+    }
+    return diopiSuccess;
+}
+
+}  // namespace
+
+diopiError_t diopiConvolution2d(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight,
+                                diopiConstTensorHandle_t bias, diopiSize_t stride, diopiSize_t padding, diopiSize_t dilation, int64_t groups) {
+    return convolution(ctx, out, input, weight, bias, stride, padding, dilation, groups, 2);
+}
+
+diopiError_t diopiConvolution2dBackward(diopiContextHandle_t ctx, diopiTensorHandle_t grad_input, diopiTensorHandle_t grad_weight,
+                                        diopiTensorHandle_t grad_bias, diopiConstTensorHandle_t grad_output, diopiConstTensorHandle_t input,
+                                        diopiConstTensorHandle_t weight, diopiSize_t* bias_sizes, diopiSize_t stride, diopiSize_t padding,
+                                        diopiSize_t dilation, int64_t groups) {
+    return convolutionBackward(ctx, grad_input, grad_weight, grad_bias, grad_output, input, weight, bias_sizes, stride, padding, dilation, groups, 2);
+}
+
+diopiError_t diopiConvolution3d(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight,
+                                diopiConstTensorHandle_t bias, diopiSize_t stride, diopiSize_t padding, diopiSize_t dilation, int64_t groups) {
+    return convolution(ctx, out, input, weight, bias, stride, padding, dilation, groups, 3);
+}
+
+diopiError_t diopiConvolution3dBackward(diopiContextHandle_t ctx, diopiTensorHandle_t grad_input, diopiTensorHandle_t grad_weight,
+                                        diopiTensorHandle_t grad_bias, diopiConstTensorHandle_t grad_output, diopiConstTensorHandle_t input,
+                                        diopiConstTensorHandle_t weight, diopiSize_t* bias_sizes, diopiSize_t stride, diopiSize_t padding,
+                                        diopiSize_t dilation, int64_t groups) {
+    return convolutionBackward(ctx, grad_input, grad_weight, grad_bias, grad_output, input, weight, bias_sizes, stride, padding, dilation, groups, 3);
+}
+
+/**
+ * The transposed convolution is the input gradient of the convolution from out to input, whose weight it shares;
+ * output_padding only has to match the size of out.
+ */
+diopiError_t diopiConvTranspose2d(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight,
+                                  diopiConstTensorHandle_t bias, diopiSize_t stride, diopiSize_t padding, diopiSize_t output_padding, int64_t groups,
+                                  diopiSize_t dilation) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DiopiTensor weightTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(weight), outTensor.dtype(), weightTensor));
+    DIOPI_CALL(checkDims(outTensor, 2));
+    DIOPI_CALL(checkDims(inputTensor, 2));
+    DIOPI_CALL(checkDims(weightTensor, 2));
+    ConvParams params;
+    DIOPI_CALL(convParams(stride, padding, dilation, groups, 2, params));
+    DIOPI_CALL(checkTransposedSize(outTensor, inputTensor, weightTensor, params, output_padding));
+    DiopiTensor biasTensor;
+    const void* biasData;
+    int64_t biasStride;
+    DIOPI_CALL(biasOf(ctx, bias, outTensor.dtype(), outTensor.shape()[1], biasTensor, biasData, biasStride));
+    return convBackwardData(outTensor.dtype(), params, convTensor(inputTensor), convTensor(weightTensor), biasData, biasStride, convTensor(outTensor));
+}
+
+// grad_input is the convolution of grad_output, grad_weight that of the convolution from grad_output to input
+diopiError_t diopiConvTranspose2dBackward(diopiContextHandle_t ctx, diopiTensorHandle_t grad_input, diopiTensorHandle_t grad_weight,
+                                          diopiTensorHandle_t grad_bias, diopiConstTensorHandle_t grad_output, diopiConstTensorHandle_t input,
+                                          diopiConstTensorHandle_t weight, diopiSize_t* bias_sizes, diopiSize_t stride, diopiSize_t padding,
+                                          diopiSize_t dilation, diopiSize_t output_padding, int64_t groups) {
+    DiopiTensor gradOutputTensor(grad_output);
+    DiopiTensor inputTensor(input);
+    DiopiTensor weightTensor(weight);
+    DIOPI_CALL(checkDims(gradOutputTensor, 2));
+    DIOPI_CALL(checkDims(inputTensor, 2));
+    DIOPI_CALL(checkDims(weightTensor, 2));
+    ConvParams params;
+    DIOPI_CALL(convParams(stride, padding, dilation, groups, 2, params));
+    DIOPI_CALL(checkTransposedSize(gradOutputTensor, inputTensor, weightTensor, params, output_padding));
+
+    if (grad_input != nullptr) {
+        DiopiTensor gradInputTensor(grad_input);
+        DIOPI_CHECK(gradInputTensor.shape() == inputTensor.shape(), "grad_input must have the shape of input");
+        DiopiTensor gradOutput;
+        DiopiTensor weightCast;
+        DIOPI_CALL(castTo(ctx, gradOutputTensor, gradInputTensor.dtype(), gradOutput));
+        DIOPI_CALL(castTo(ctx, weightTensor, gradInputTensor.dtype(), weightCast));
+        DIOPI_CALL(convForward(gradInputTensor.dtype(), params, convTensor(gradOutput), convTensor(weightCast), nullptr, 0, convTensor(gradInputTensor)));
+    }
+
+    if (grad_weight != nullptr) {
+        DiopiTensor gradWeightTensor(grad_weight);
+        DiopiTensor gradOutput;
+        DiopiTensor inputCast;
+        DIOPI_CALL(castTo(ctx, gradOutputTensor, gradWeightTensor.dtype(), gradOutput));
+        DIOPI_CALL(castTo(ctx, inputTensor, gradWeightTensor.dtype(), inputCast));
+        DIOPI_CALL(checkDims(gradWeightTensor, 2));
+        DIOPI_CALL(convBackwardWeight(gradWeightTensor.dtype(), params, convTensor(inputCast), convTensor(gradOutput), convTensor(gradWeightTensor)));
+    }
+
+    if (grad_bias != nullptr) {
+        DIOPI_CALL(gradBiasOf(ctx, grad_bias, gradOutputTensor, bias_sizes));
+    }
+    return diopiSuccess;
+}
+
+}  // namespace cpu
+}  // namespace impl
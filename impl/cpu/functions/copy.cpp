@@ -0,0 +1,137 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "../tensor_iterator.hpp"
+
+namespace impl {
+namespace cpu {
+
+static diopiError_t copy(const DiopiTensor& src, const DiopiTensor& dest) {
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(dest).addInput(src).build());
+    const int64_t itemsize = dest.elemsize();
+    if (src.dtype() == dest.dtype() && iter.ndim() == 1 && iter.stride(0, 0) == itemsize && iter.stride(1, 0) == itemsize) {
+        char* dst = dest.data<char>();
+        const char* from = src.data<char>();
+        if (dst != from) {
+            parallelFor(dest.numel() * itemsize, kCacheChunkBytes,
+                        [&](int64_t begin, int64_t end) { std::memcpy(dst + begin, from + begin, end - begin); });
+        }
+        return diopiSuccess;
+    }
+    return dispatchCastTypes(dest.dtype(), [&](auto destTag) {
+        using TDest = typename decltype(destTag)::type;
+        return dispatchCastTypes(src.dtype(), [&](auto srcTag) {
+            using TSrc = typename decltype(srcTag)::type;
+            cpuKernel<TDest, TSrc>(iter, [](TSrc x) { return castValue<TDest>(x); });
+            return diopiSuccess;
+        });
+    });
+}
+
+diopiError_t diopiCopyInp(diopiContextHandle_t /*ctx*/, diopiConstTensorHandle_t src, diopiTensorHandle_t dest) {
+    return copy(DiopiTensor(src), DiopiTensor(dest));
+}
+
+diopiError_t diopiCastDtype(diopiContextHandle_t /*ctx*/, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    DiopiTensor inputTensor(input);
+    DiopiTensor outTensor(out);
+    DIOPI_CHECK(inputTensor.shape() == outTensor.shape(), "input and out must have the same shape");
+    return copy(inputTensor, outTensor);
+}
+
+// a copy of input with the strides of memoryFormat, which the adaptor asks for when an op needs another layout
+diopiError_t diopiContiguous(diopiContextHandle_t ctx, diopiTensorHandle_t* out, diopiConstTensorHandle_t input, diopiMemoryFormat_t memoryFormat) {
+    DiopiTensor inputTensor(input);
+    const int64_t ndim = inputTensor.dim();
+    // the dims from the innermost outwards
+    std::vector<int64_t> order;
+    switch (memoryFormat) {
+        case diopiMemoryFormat_t::Contiguous:
+            for (int64_t d = ndim - 1; d >= 0; --d) {
+                order.push_back(d);
+            }
+            break;
+        case diopiMemoryFormat_t::ChannelsLast1d:
+            DIOPI_CHECK(ndim == 3, "ChannelsLast1d needs a 3-d tensor, got %ld dims", ndim);
+            order = {1, 2, 0};
+            break;
+        case diopiMemoryFormat_t::ChannelsLast:
+            DIOPI_CHECK(ndim == 4, "ChannelsLast needs a 4-d tensor, got %ld dims", ndim);
+            order = {1, 3, 2, 0};
+            break;
+        case diopiMemoryFormat_t::ChannelsLast3d:
+            DIOPI_CHECK(ndim == 5, "ChannelsLast3d needs a 5-d tensor, got %ld dims", ndim);
+            order = {1, 4, 3, 2, 0};
+            break;
+        default:
+            return diopiNoImplement;
+    }
+    std::vector<int64_t> stride(ndim);
+    int64_t next = 1;
+    for (auto d : order) {
+        stride[d] = next;
+        next *= std::max<int64_t>(inputTensor.shape()[d], 1);
+    }
+    diopiSize_t size{inputTensor.shape().data(), ndim};
+    diopiSize_t strideSize{stride.data(), ndim};
+    DIOPI_CALL(diopiRequireTensor(ctx, out, &size, &strideSize, inputTensor.dtype(), inputTensor.device()));
+    return copy(inputTensor, DiopiTensor(*out));
+}
+
+// each input is copied into a view of its slice of out, so any strides of out and dtypes of the inputs work
+diopiError_t diopiCat(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t* tensors, int64_t num_inputs, int64_t dim) {
+    DIOPI_CHECK(tensors != nullptr && num_inputs > 0, "diopiCat expects at least one input tensor");
+    if (diopiRequireTensorView == nullptr || diopiGetTensorStorageOffset == nullptr) {
+        return diopiNoImplement;
+    }
+    DiopiTensor outTensor(out);
+    const int64_t ndim = outTensor.dim();
+    dim = dim < 0 ? dim + ndim : dim;
+    DIOPI_CHECK(dim >= 0 && dim < ndim, "dim %ld is out of range for a %ld-d output", dim, ndim);
+    int64_t outOffset = 0;
+    DIOPI_CALL(diopiGetTensorStorageOffset(out, &outOffset));
+    diopiSize_t outStride{outTensor.stride().data(), ndim};
+    int64_t begin = 0;
+    for (int64_t i = 0; i < num_inputs; ++i) {
+        DiopiTensor input(tensors[i]);
+        // empty 1-d inputs take no part, as in torch.cat
+        if (input.dim() == 1 && input.numel() == 0 && ndim != 1) {
+            continue;
+        }
+        DIOPI_CHECK(input.dim() == ndim, "input %ld of diopiCat has %ld dims, out has %ld", i, input.dim(), ndim);
+        for (int64_t d = 0; d < ndim; ++d) {
+            DIOPI_CHECK(d == dim || input.shape()[d] == outTensor.shape()[d], "input %ld of diopiCat differs from out in dim %ld", i, d);
+        }
+        DIOPI_CHECK(begin + input.shape()[dim] <= outTensor.shape()[dim], "out of diopiCat is too small in dim %ld", dim);
+        diopiSize_t size{input.shape().data(), ndim};
+        diopiTensorHandle_t slice = nullptr;
+        DIOPI_CALL(diopiRequireTensorView(ctx, &slice, out, &size, &outStride, outOffset + begin * outTensor.stride()[dim]));
+        DIOPI_CALL(copy(input, DiopiTensor(slice)));
+        begin += input.shape()[dim];
+    }
+    DIOPI_CHECK(begin == outTensor.shape()[dim], "the inputs of diopiCat do not fill out in dim %ld", dim);
+    return diopiSuccess;
+}
+
+diopiError_t diopiFill(diopiContextHandle_t /*ctx*/, diopiTensorHandle_t input, const diopiScalar_t* value) {
+    DiopiTensor inputTensor(input);
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(inputTensor).build());
+    return dispatchAllTypes(inputTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        const T fillValue = scalarValue<T>(value);
+        cpuKernel<T>(iter, [fillValue]() { return fillValue; });
+        return diopiSuccess;
+    });
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "../cpu_helper.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+char version[512];
+
+constexpr uint64_t dtypeBit(diopiDtype_t dtype) { return 1ull << dtype; }
+
+constexpr uint64_t kFloatingDtypes = dtypeBit(diopi_dtype_float16) | dtypeBit(diopi_dtype_float32) | dtypeBit(diopi_dtype_float64);
+constexpr uint64_t kNumericDtypes = kFloatingDtypes | dtypeBit(diopi_dtype_int8) | dtypeBit(diopi_dtype_uint8) | dtypeBit(diopi_dtype_int16) |
+                                    dtypeBit(diopi_dtype_int32) | dtypeBit(diopi_dtype_int64);
+constexpr uint64_t kAllDtypes = kNumericDtypes | dtypeBit(diopi_dtype_bool);
+// casts and copies also move the unsigned dtypes no kernel computes in
+constexpr uint64_t kCastDtypes = kAllDtypes | dtypeBit(diopi_dtype_uint16) | dtypeBit(diopi_dtype_uint32) | dtypeBit(diopi_dtype_uint64);
+
+// The kernels take any strides, so no op restricts the memory format
+diopiOpCapabilities_t elementwise(uint64_t dtypes) { return diopiOpCapabilities_t{dtypes, 0, 1, 0}; }
+diopiOpCapabilities_t reduction(uint64_t dtypes) { return diopiOpCapabilities_t{dtypes, 0, 0, 0}; }
+diopiOpCapabilities_t matrixProduct(uint64_t dtypes) { return diopiOpCapabilities_t{dtypes, 0, 0, 0}; }
+diopiOpCapabilities_t convolution(uint64_t dtypes) { return diopiOpCapabilities_t{dtypes, 0, 0, 0}; }
+diopiOpCapabilities_t concatenation(uint64_t dtypes) { return diopiOpCapabilities_t{dtypes, 0, 0, 0}; }
+
+const std::unordered_map<std::string, diopiOpCapabilities_t>& capabilities() {
+    static const std::unordered_map<std::string, diopiOpCapabilities_t> table{
+        {"diopiFill", elementwise(kAllDtypes)},
+        {"diopiCopyInp", elementwise(kCastDtypes)},
+        {"diopiCastDtype", elementwise(kCastDtypes)},
+        {"diopiContiguous", elementwise(kCastDtypes)},
+        {"diopiCat", concatenation(kCastDtypes)},
+        {"diopiAdd", elementwise(kAllDtypes)},
+        {"diopiAddInp", elementwise(kAllDtypes)},
+        {"diopiAddScalar", elementwise(kNumericDtypes)},
+        {"diopiAddInpScalar", elementwise(kNumericDtypes)},
+        {"diopiSub", elementwise(kAllDtypes)},
+        {"diopiSubInp", elementwise(kAllDtypes)},
+        {"diopiSubScalar", elementwise(kNumericDtypes)},
+        {"diopiSubInpScalar", elementwise(kNumericDtypes)},
+        {"diopiMul", elementwise(kAllDtypes)},
+        {"diopiMulInp", elementwise(kAllDtypes)},
+        {"diopiMulScalar", elementwise(kNumericDtypes)},
+        {"diopiMulInpScalar", elementwise(kNumericDtypes)},
+        {"diopiDiv", elementwise(kNumericDtypes)},
+        {"diopiDivInp", elementwise(kNumericDtypes)},
+        {"diopiDivScalar", elementwise(kNumericDtypes)},
+        {"diopiDivInpScalar", elementwise(kNumericDtypes)},
+        {"diopiNeg", elementwise(kNumericDtypes)},
+        {"diopiNegInp", elementwise(kNumericDtypes)},
+        {"diopiAbs", elementwise(kNumericDtypes)},
+        {"diopiAbsInp", elementwise(kNumericDtypes)},
+        {"diopiRelu", elementwise(kNumericDtypes)},
+        {"diopiReluInp", elementwise(kNumericDtypes)},
+        {"diopiExp", elementwise(kFloatingDtypes)},
+        {"diopiExpInp", elementwise(kFloatingDtypes)},
+        {"diopiLog", elementwise(kFloatingDtypes)},
+        {"diopiLogInp", elementwise(kFloatingDtypes)},
+        {"diopiSqrt", elementwise(kFloatingDtypes)},
+        {"diopiSqrtInp", elementwise(kFloatingDtypes)},
+        {"diopiRsqrt", elementwise(kFloatingDtypes)},
+        {"diopiRsqrtInp", elementwise(kFloatingDtypes)},
+        {"diopiSigmoid", elementwise(kFloatingDtypes)},
+        {"diopiSigmoidInp", elementwise(kFloatingDtypes)},
+        {"diopiTanh", elementwise(kFloatingDtypes)},
+        {"diopiTanhInp", elementwise(kFloatingDtypes)},
+        {"diopiSilu", elementwise(kFloatingDtypes)},
+        {"diopiSiluInp", elementwise(kFloatingDtypes)},
+        {"diopiEq", elementwise(kAllDtypes)},
+        {"diopiEqInp", elementwise(kAllDtypes)},
+        {"diopiEqScalar", elementwise(kAllDtypes)},
+        {"diopiEqInpScalar", elementwise(kAllDtypes)},
+        {"diopiNe", elementwise(kAllDtypes)},
+        {"diopiNeInp", elementwise(kAllDtypes)},
+        {"diopiNeScalar", elementwise(kAllDtypes)},
+        {"diopiNeInpScalar", elementwise(kAllDtypes)},
+        {"diopiGe", elementwise(kAllDtypes)},
+        {"diopiGeInp", elementwise(kAllDtypes)},
+        {"diopiGeScalar", elementwise(kAllDtypes)},
+        {"diopiGeInpScalar", elementwise(kAllDtypes)},
+        {"diopiGt", elementwise(kAllDtypes)},
+        {"diopiGtInp", elementwise(kAllDtypes)},
+        {"diopiGtScalar", elementwise(kAllDtypes)},
+        {"diopiGtInpScalar", elementwise(kAllDtypes)},
+        {"diopiLe", elementwise(kAllDtypes)},
+        {"diopiLeInp", elementwise(kAllDtypes)},
+        {"diopiLeScalar", elementwise(kAllDtypes)},
+        {"diopiLeInpScalar", elementwise(kAllDtypes)},
+        {"diopiLt", elementwise(kAllDtypes)},
+        {"diopiLtInp", elementwise(kAllDtypes)},
+        {"diopiLtScalar", elementwise(kAllDtypes)},
+        {"diopiLtInpScalar", elementwise(kAllDtypes)},
+        {"diopiClamp", elementwise(kNumericDtypes)},
+        {"diopiClampInp", elementwise(kNumericDtypes)},
+        {"diopiClampScalar", elementwise(kNumericDtypes)},
+        {"diopiClampInpScalar", elementwise(kNumericDtypes)},
+        {"diopiClampMax", elementwise(kNumericDtypes)},
+        {"diopiClampMaxInp", elementwise(kNumericDtypes)},
+        {"diopiClampMaxScalar", elementwise(kNumericDtypes)},
+        {"diopiClampMaxInpScalar", elementwise(kNumericDtypes)},
+        {"diopiClampMin", elementwise(kNumericDtypes)},
+        {"diopiClampMinInp", elementwise(kNumericDtypes)},
+        {"diopiClampMinScalar", elementwise(kNumericDtypes)},
+        {"diopiClampMinInpScalar", elementwise(kNumericDtypes)},
+        {"diopiMaximum", elementwise(kAllDtypes)},
+        {"diopiMinimum", elementwise(kAllDtypes)},
+        {"diopiWhere", elementwise(kAllDtypes)},
+        {"diopiAddcmul", elementwise(kNumericDtypes)},
+        {"diopiAddcmulInp", elementwise(kNumericDtypes)},
+        {"diopiLerpScalar", elementwise(kFloatingDtypes)},
+        {"diopiLerpTensor", elementwise(kFloatingDtypes)},
+        {"diopiSum", reduction(kNumericDtypes)},
+        {"diopiMean", reduction(kFloatingDtypes)},
+        {"diopiMaxAll", reduction(kAllDtypes)},
+        {"diopiMinAll", reduction(kAllDtypes)},
+        {"diopiMm", matrixProduct(kFloatingDtypes)},
+        {"diopiBmm", matrixProduct(kFloatingDtypes)},
+        {"diopiMatmul", matrixProduct(kFloatingDtypes)},
+        {"diopiAddmm", matrixProduct(kFloatingDtypes)},
+        {"diopiBaddbmm", matrixProduct(kFloatingDtypes)},
+        {"diopiBaddbmmInp", matrixProduct(kFloatingDtypes)},
+        {"diopiLinear", matrixProduct(kFloatingDtypes)},
+        {"diopiLinearBackward", matrixProduct(kFloatingDtypes)},
+        {"diopiConvolution2d", convolution(kFloatingDtypes)},
+        {"diopiConvolution2dBackward", convolution(kFloatingDtypes)},
+        {"diopiConvolution3d", convolution(kFloatingDtypes)},
+        {"diopiConvolution3dBackward", convolution(kFloatingDtypes)},
+        {"diopiConvTranspose2d", convolution(kFloatingDtypes)},
+        {"diopiConvTranspose2dBackward", convolution(kFloatingDtypes)},
+        {"diopiSoftmax", reduction(kFloatingDtypes)},
+        {"diopiLogSoftmax", reduction(kFloatingDtypes)},
+    };
+    return table;
+}
+
+}  // namespace
+
+}  // namespace cpu
+}  // namespace impl
+
+extern "C" DIOPI_RT_API const char* diopiGetVendorName() { return "CpuDevice"; }
+extern "C" DIOPI_RT_API const char* diopiGetImplVersion() {
+    if (strlen(impl::cpu::version) == 0) {
+        snprintf(impl::cpu::version,
+                 sizeof(impl::cpu::version),
+                 "CPU Threads: %ld; DIOPI Version: %d",
+                 impl::cpu::ThreadPool::instance().numThreads(),
+                 DIOPI_VERSION);
+    }
+    return impl::cpu::version;
+}
+
+extern "C" DIOPI_RT_API diopiError_t diopiGetOpCapabilities(const char* opName, diopiOpCapabilities_t* caps) {
+    auto it = impl::cpu::capabilities().find(opName);
+    if (it == impl::cpu::capabilities().end()) {
+        return diopiNoImplement;
+    }
+    *caps = it->second;
+    return diopiSuccess;
+}
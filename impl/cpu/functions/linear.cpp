@@ -0,0 +1,145 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "../cpu_helper.hpp"
+#include "../gemm.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+// tensor of features in its last dim as a batch of matrices, a single vector being one row
+MatrixLayout featureRows(const DiopiTensor& tensor) {
+    MatrixLayout layout{tensor.data<void>(), tensor.shape(), tensor.stride()};
+    if (layout.shape.size() == 1) {
+        layout.shape.insert(layout.shape.begin(), 1);
+        layout.stride.insert(layout.stride.begin(), 0);
+    }
+    return layout;
+}
+
+// out = input @ weight^T + bias; the rows of input run as one product when its leading dims fold, as a batch otherwise
+diopiError_t linear(const DiopiTensor& outTensor, const MatrixLayout& input, const MatrixLayout& weight, const DiopiTensor* bias) {
+    MatrixLayout a = input;
+    MatrixLayout c = featureRows(outTensor);
+    DIOPI_CHECK(a.shape.back() == weight.shape[0], "weight has %ld input features, input has %ld", weight.shape[0], a.shape.back());
+    DIOPI_CHECK(c.shape.size() == a.shape.size() && std::equal(c.shape.begin(), c.shape.end() - 1, a.shape.begin()) && c.shape.back() == weight.shape[1],
+                "out does not have the shape of the linear layer");
+    std::vector<int64_t> batchShape;
+    MatrixLayout foldedA = a;
+    MatrixLayout foldedC = c;
+    if (foldedA.foldBatch() && foldedC.foldBatch()) {
+        a = foldedA;
+        c = foldedC;
+    } else {
+        batchShape.assign(a.shape.begin(), a.shape.end() - 2);
+    }
+    GemmDesc desc;
+    desc.m = a.shape[a.shape.size() - 2];
+    desc.n = weight.shape[1];
+    desc.k = a.shape.back();
+    desc.batchShape = batchShape;
+    desc.a = a.operand(batchShape);
+    desc.b = weight.operand(batchShape);
+    desc.c = c.operand(batchShape);
+    if (bias != nullptr) {
+        DIOPI_CHECK(bias->numel() == desc.n, "bias must have one element per output feature");
+        desc.addend = MatrixLayout{bias->data<void>(), {1, desc.n}, {0, bias->dim() == 0 ? 0 : bias->stride().back()}}.operand(batchShape);
+        desc.beta = 1.0;
+    }
+    return gemm(outTensor.dtype(), desc);
+}
+
+}  // namespace
+
+diopiError_t diopiLinear(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight,
+                         diopiConstTensorHandle_t bias) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DiopiTensor weightTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(weight), outTensor.dtype(), weightTensor));
+    DIOPI_CHECK(inputTensor.dim() >= 1 && weightTensor.dim() == 2, "linear takes an input of at least one dim and a weight of two");
+    const MatrixLayout weightT = MatrixLayout{weightTensor.data<void>(), weightTensor.shape(), weightTensor.stride()}.transposed();
+    if (bias == nullptr) {
+        return linear(outTensor, featureRows(inputTensor), weightT, nullptr);
+    }
+    DiopiTensor biasTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(bias), outTensor.dtype(), biasTensor));
+    return linear(outTensor, featureRows(inputTensor), weightT, &biasTensor);
+}
+
+/**
+ * grad_input = grad_output @ weight, grad_weight = grad_output^T @ input over all the rows, which are made contiguous
+ * when their dims do not fold, and grad_bias sums grad_output over the rows. Each gradient is optional.
+ */
+diopiError_t diopiLinearBackward(diopiContextHandle_t ctx, diopiTensorHandle_t grad_input, diopiTensorHandle_t grad_weight, diopiTensorHandle_t grad_bias,
+                                 diopiConstTensorHandle_t grad_output, diopiConstTensorHandle_t input, diopiConstTensorHandle_t weight) {
+    DiopiTensor gradOutputTensor(grad_output);
+    DiopiTensor inputTensor(input);
+    DiopiTensor weightTensor(weight);
+    DIOPI_CHECK(gradOutputTensor.dim() >= 1 && weightTensor.dim() == 2, "linear takes an input of at least one dim and a weight of two");
+
+    if (grad_input != nullptr) {
+        DiopiTensor gradInputTensor(grad_input);
+        DiopiTensor gradOutput;
+        DiopiTensor weightCast;
+        DIOPI_CALL(castTo(ctx, gradOutputTensor, gradInputTensor.dtype(), gradOutput));
+        DIOPI_CALL(castTo(ctx, weightTensor, gradInputTensor.dtype(), weightCast));
+        const MatrixLayout weightLayout{weightCast.data<void>(), weightCast.shape(), weightCast.stride()};
+        DIOPI_CALL(linear(gradInputTensor, featureRows(gradOutput), weightLayout, nullptr));
+    }
+
+    if (grad_weight != nullptr) {
+        DiopiTensor gradWeightTensor(grad_weight);
+        DiopiTensor gradOutput;
+        DiopiTensor inputCast;
+        DIOPI_CALL(castTo(ctx, gradOutputTensor, gradWeightTensor.dtype(), gradOutput));
+        DIOPI_CALL(castTo(ctx, inputTensor, gradWeightTensor.dtype(), inputCast));
+        MatrixLayout rows = featureRows(gradOutput);
+        MatrixLayout inputRows = featureRows(inputCast);
+        DIOPI_CHECK(rows.shape.size() == inputRows.shape.size() && std::equal(rows.shape.begin(), rows.shape.end() - 1, inputRows.shape.begin()),
+                    "grad_output and input must have the same rows");
+        DiopiTensor gradOutputContiguous;
+        DiopiTensor inputContiguous;
+        if (!rows.foldBatch()) {
+            DIOPI_CALL(makeContiguous(ctx, gradOutput, gradOutputContiguous));
+            rows = featureRows(gradOutputContiguous);
+            rows.foldBatch();
+        }
+        if (!inputRows.foldBatch()) {
+            DIOPI_CALL(makeContiguous(ctx, inputCast, inputContiguous));
+            inputRows = featureRows(inputContiguous);
+            inputRows.foldBatch();
+        }
+        DIOPI_CHECK(gradWeightTensor.shape() == std::vector<int64_t>({rows.shape[1], inputRows.shape[1]}), "grad_weight does not have the shape of weight");
+        GemmDesc desc;
+        desc.m = rows.shape[1];
+        desc.n = inputRows.shape[1];
+        desc.k = rows.shape[0];
+        desc.a = rows.transposed().operand({});
+        desc.b = inputRows.operand({});
+        desc.c = MatrixLayout{gradWeightTensor.data<void>(), gradWeightTensor.shape(), gradWeightTensor.stride()}.operand({});
+        DIOPI_CALL(gemm(gradWeightTensor.dtype(), desc));
+    }
+
+    if (grad_bias != nullptr) {
+        if (gradOutputTensor.dim() == 1) {
+            DIOPI_CALL(diopiCopyInp(ctx, grad_output, grad_bias));
+        } else {
+            std::vector<int64_t> dims(gradOutputTensor.dim() - 1);
+            for (int64_t d = 0; d < gradOutputTensor.dim() - 1; ++d) {
+                dims[d] = d;
+            }
+            DIOPI_CALL(diopiSum(ctx, grad_bias, grad_output, diopiSize_t{dims.data(), static_cast<int64_t>(dims.size())}));
+        }
+    }
+    return diopiSuccess;
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,154 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "../cpu_helper.hpp"
+#include "../gemm.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+MatrixLayout matrixLayout(const DiopiTensor& tensor) { return MatrixLayout{tensor.data<void>(), tensor.shape(), tensor.stride()}; }
+
+// a vector of matmul seen as a matrix of one row or one column
+MatrixLayout rowVector(const DiopiTensor& tensor) { return MatrixLayout{tensor.data<void>(), {1, tensor.shape()[0]}, {0, tensor.stride()[0]}}; }
+MatrixLayout columnVector(const DiopiTensor& tensor) { return MatrixLayout{tensor.data<void>(), {tensor.shape()[0], 1}, {tensor.stride()[0], 0}}; }
+
+// The leading dims of shape, those of the batch
+std::vector<int64_t> batchDims(const std::vector<int64_t>& shape) { return std::vector<int64_t>(shape.begin(), shape.end() - 2); }
+
+bool broadcastsTo(const std::vector<int64_t>& shape, const std::vector<int64_t>& target) {
+    return shape.size() <= target.size() && broadcastShape(shape, target) == target;
+}
+
+/**
+ * out = alpha * input @ other + beta * addend with input, other and out laid out as batches of matrices. The batch
+ * dims of input and other broadcast against each other. When other is a single matrix and input and out have their
+ * batch dims laid out as one block of rows, the whole batch runs as one larger product.
+ */
+diopiError_t batchedProduct(const DiopiTensor& outTensor, MatrixLayout a, MatrixLayout b, MatrixLayout c, const MatrixLayout* addend, double alpha,
+                            double beta) {
+    const int64_t m = a.shape[a.shape.size() - 2];
+    const int64_t k = a.shape.back();
+    const int64_t n = b.shape.back();
+    DIOPI_CHECK(b.shape[b.shape.size() - 2] == k, "the inner dims of the product do not match: %ld and %ld", k, b.shape[b.shape.size() - 2]);
+    std::vector<int64_t> batchShape = batchDims(a.shape);
+    const std::vector<int64_t> otherBatch = batchDims(b.shape);
+    const std::vector<int64_t> common = broadcastShape(batchShape, otherBatch);
+    DIOPI_CHECK(broadcastsTo(batchShape, common) && broadcastsTo(otherBatch, common), "the batch dims of the product can not be broadcast together");
+    batchShape = common;
+    std::vector<int64_t> outShape = batchShape;
+    outShape.push_back(m);
+    outShape.push_back(n);
+    DIOPI_CHECK(c.shape == outShape, "out does not have the shape of the product");
+
+    GemmDesc desc;
+    desc.m = m;
+    desc.n = n;
+    desc.k = k;
+    desc.alpha = alpha;
+    desc.beta = beta;
+    MatrixLayout add;
+    if (addend != nullptr) {
+        add = *addend;
+        DIOPI_CHECK(broadcastsTo(add.shape, outShape), "input can not be broadcast to the shape of the product");
+    }
+    // an addend stays valid for the folded rows only when it is one row broadcast over all of them
+    if (b.shape.size() == 2 && !batchShape.empty() && (addend == nullptr || (add.shape.size() == 2 && add.shape[0] == 1))) {
+        MatrixLayout foldedA = a;
+        MatrixLayout foldedC = c;
+        if (foldedA.foldBatch() && foldedC.foldBatch()) {
+            desc.m = foldedC.shape[0];
+            a = foldedA;
+            c = foldedC;
+            batchShape.clear();
+        }
+    }
+    desc.batchShape = batchShape;
+    desc.a = a.operand(batchShape);
+    desc.b = b.operand(batchShape);
+    desc.c = c.operand(batchShape);
+    if (addend != nullptr) {
+        desc.addend = add.operand(batchShape);
+    }
+    return gemm(outTensor.dtype(), desc);
+}
+
+diopiError_t product(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other,
+                     diopiConstTensorHandle_t addend, double alpha, double beta, int64_t ndim) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DiopiTensor otherTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(other), outTensor.dtype(), otherTensor));
+    DIOPI_CHECK(inputTensor.dim() == ndim && otherTensor.dim() == ndim, "the operands of the product must have %ld dims", ndim);
+    if (addend == nullptr) {
+        return batchedProduct(outTensor, matrixLayout(inputTensor), matrixLayout(otherTensor), matrixLayout(outTensor), nullptr, alpha, beta);
+    }
+    DiopiTensor addendTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(addend), outTensor.dtype(), addendTensor));
+    MatrixLayout add = matrixLayout(addendTensor);
+    // an addend of fewer dims is a row, or a scalar, broadcast over the matrix
+    while (add.shape.size() < 2) {
+        add.shape.insert(add.shape.begin(), 1);
+        add.stride.insert(add.stride.begin(), 0);
+    }
+    return batchedProduct(outTensor, matrixLayout(inputTensor), matrixLayout(otherTensor), matrixLayout(outTensor), &add, alpha, beta);
+}
+
+}  // namespace
+
+diopiError_t diopiMm(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t mat2) {
+    return product(ctx, out, input, mat2, nullptr, 1.0, 0.0, 2);
+}
+
+diopiError_t diopiBmm(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t mat2) {
+    return product(ctx, out, input, mat2, nullptr, 1.0, 0.0, 3);
+}
+
+diopiError_t diopiAddmm(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t mat1,
+                        diopiConstTensorHandle_t mat2, const diopiScalar_t* beta, const diopiScalar_t* alpha) {
+    return product(ctx, out, mat1, mat2, input, scalarValue<double>(alpha), scalarValue<double>(beta), 2);
+}
+
+diopiError_t diopiBaddbmm(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t batch1,
+                          diopiConstTensorHandle_t batch2, double beta, double alpha) {
+    return product(ctx, out, batch1, batch2, input, alpha, beta, 3);
+}
+
+diopiError_t diopiBaddbmmInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t batch1, diopiConstTensorHandle_t batch2,
+                             double beta, double alpha) {
+    return product(ctx, input, batch1, batch2, input, alpha, beta, 3);
+}
+
+diopiError_t diopiMatmul(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DiopiTensor otherTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(other), outTensor.dtype(), otherTensor));
+    DIOPI_CHECK(inputTensor.dim() >= 1 && otherTensor.dim() >= 1, "both operands of matmul need at least one dim");
+    // a vector on the left is a row of one matrix, on the right a column; out lacks the matching dim
+    const bool vectorInput = inputTensor.dim() == 1;
+    const bool vectorOther = otherTensor.dim() == 1;
+    MatrixLayout a = vectorInput ? rowVector(inputTensor) : matrixLayout(inputTensor);
+    MatrixLayout b = vectorOther ? columnVector(otherTensor) : matrixLayout(otherTensor);
+    DIOPI_CHECK(outTensor.dim() >= (vectorInput ? 0 : 1) + (vectorOther ? 0 : 1), "out does not have the shape of the product");
+    MatrixLayout c = matrixLayout(outTensor);
+    if (vectorInput) {
+        c.shape.insert(c.shape.end() - (vectorOther ? 0 : 1), 1);
+        c.stride.insert(c.stride.end() - (vectorOther ? 0 : 1), 0);
+    }
+    if (vectorOther) {
+        c.shape.push_back(1);
+        c.stride.push_back(0);
+    }
+    return batchedProduct(outTensor, a, b, c, nullptr, 1.0, 0.0);
+}
+
+}  // namespace cpu
+}  // namespace impl
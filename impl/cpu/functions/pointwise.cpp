@@ -0,0 +1,95 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "../tensor_iterator.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+// input + value * tensor1 * tensor2
+struct AddcmulOp {
+    const diopiScalar_t* value;
+
+    template <typename Tag>
+    auto operator()(Tag) const {
+        using C = typename ComputeType<typename Tag::type>::type;
+        const C scale = scalarValue<C>(value);
+        return [scale](auto x, auto a, auto b) { return x + decltype(x)(scale) * a * b; };
+    }
+};
+
+// input + weight * (end - input), computed from the end for weights of 0.5 and above to stay exact at 1
+template <typename W>
+auto lerp(W x, W end, W weight) {
+    return vec::select(weight < W(0.5), x + weight * (end - x), end - (end - x) * (W(1) - weight));
+}
+
+struct LerpOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x, auto end, auto weight) { return lerp(x, end, weight); };
+    }
+};
+
+struct LerpScalarOp {
+    const diopiScalar_t* weight;
+
+    template <typename Tag>
+    auto operator()(Tag) const {
+        using C = typename ComputeType<typename Tag::type>::type;
+        const C w = scalarValue<C>(weight);
+        return [w](auto x, auto end) { return lerp(x, end, decltype(x)(w)); };
+    }
+};
+
+}  // namespace
+
+diopiError_t diopiWhere(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t condition, diopiConstTensorHandle_t input,
+                        diopiConstTensorHandle_t other) {
+    DiopiTensor outTensor(out);
+    DiopiTensor conditionTensor;
+    DiopiTensor inputTensor;
+    DiopiTensor otherTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(condition), diopi_dtype_bool, conditionTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(other), outTensor.dtype(), otherTensor));
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(outTensor).addInput(conditionTensor).addInput(inputTensor).addInput(otherTensor).build());
+    return dispatchAllTypes(outTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        cpuKernel<T, bool, T, T>(iter, [](bool cond, T x, T y) { return cond ? x : y; });
+        return diopiSuccess;
+    });
+}
+
+diopiError_t diopiAddcmul(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t tensor1,
+                          diopiConstTensorHandle_t tensor2, const diopiScalar_t* value) {
+    return ternaryOp(ctx, out, input, tensor1, tensor2, AddcmulOp{value});
+}
+
+diopiError_t diopiAddcmulInp(diopiContextHandle_t ctx, diopiTensorHandle_t input, diopiConstTensorHandle_t tensor1, diopiConstTensorHandle_t tensor2,
+                             const diopiScalar_t* value) {
+    return ternaryOp(ctx, input, input, tensor1, tensor2, AddcmulOp{value});
+}
+
+diopiError_t diopiLerpTensor(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t end,
+                             diopiConstTensorHandle_t weight) {
+    DiopiTensor outTensor(out);
+    DIOPI_CHECK(isFloatingType(outTensor.dtype()), "lerp requires a floating dtype");
+    return ternaryOp(ctx, out, input, end, weight, LerpOp());
+}
+
+diopiError_t diopiLerpScalar(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t end,
+                             const diopiScalar_t* weight) {
+    DiopiTensor outTensor(out);
+    DIOPI_CHECK(isFloatingType(outTensor.dtype()), "lerp requires a floating dtype");
+    return binaryOp(ctx, out, input, end, LerpScalarOp{weight});
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,228 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <cmath>
+
+#include "../cpu_helper.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+constexpr int kLanes = 8;
+
+// Sum of a contiguous run in independent lanes, which the compiler keeps in vector registers
+template <typename T, typename Acc>
+Acc sumContiguous(const T* data, int64_t n) {
+    Acc lanes[kLanes] = {};
+    int64_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+        for (int k = 0; k < kLanes; ++k) {
+            lanes[k] += static_cast<Acc>(data[i + k]);
+        }
+    }
+    Acc total = 0;
+    for (int k = 0; k < kLanes; ++k) {
+        total += lanes[k];
+    }
+    for (; i < n; ++i) {
+        total += static_cast<Acc>(data[i]);
+    }
+    return total;
+}
+
+// Splits the dims of input into the ones kept in out and the reduced ones
+struct ReducePlan {
+    std::vector<int64_t> keptShape;
+    std::vector<int64_t> keptStride;
+    std::vector<int64_t> reducedShape;
+    std::vector<int64_t> reducedStride;
+    int64_t numOut = 1;
+    int64_t reduceNumel = 1;
+
+    ReducePlan(const DiopiTensor& input, diopiSize_t dim) {
+        std::vector<bool> reduced(input.dim(), dim.len == 0);
+        for (int64_t i = 0; i < dim.len; ++i) {
+            int64_t d = dim.data[i] < 0 ? dim.data[i] + input.dim() : dim.data[i];
+            if (d >= 0 && d < input.dim()) {
+                reduced[d] = true;
+            }
+        }
+        for (int64_t d = 0; d < input.dim(); ++d) {
+            auto& shape = reduced[d] ? reducedShape : keptShape;
+            auto& stride = reduced[d] ? reducedStride : keptStride;
+            shape.push_back(input.shape()[d]);
+            stride.push_back(input.stride()[d]);
+            (reduced[d] ? reduceNumel : numOut) *= input.shape()[d];
+        }
+    }
+
+    // the reduced elements of every output are one contiguous run
+    bool reducedContiguous() const { return isRowMajor(reducedShape, reducedStride); }
+
+    // consecutive outputs read consecutive elements for every reduced index
+    bool keptContiguous() const { return isRowMajor(keptShape, keptStride); }
+
+    static bool isRowMajor(const std::vector<int64_t>& shape, const std::vector<int64_t>& stride) {
+        int64_t expected = 1;
+        for (int64_t i = static_cast<int64_t>(shape.size()) - 1; i >= 0; --i) {
+            if (shape[i] != 1 && stride[i] != expected) {
+                return false;
+            }
+            expected *= shape[i];
+        }
+        return true;
+    }
+};
+
+// out[o] = scale * sum of the reduced elements of output o, out contiguous with numOut elements
+template <typename T>
+void sumKernel(T* out, const T* input, const ReducePlan& plan, typename AccType<T>::type scale) {
+    using Acc = typename AccType<T>::type;
+    const std::vector<int64_t> keptStrides[1] = {plan.keptStride};
+    const std::vector<int64_t> reducedStrides[1] = {plan.reducedStride};
+    if (plan.keptContiguous() && !plan.reducedContiguous()) {
+        // reducing outer dims: every reduced index adds a contiguous row of outputs
+        parallelFor(plan.numOut, std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, plan.reduceNumel)), [&](int64_t begin, int64_t end) {
+            std::vector<Acc> acc(end - begin, Acc(0));
+            stridedLoop(plan.reducedShape, reducedStrides, 0, plan.reduceNumel, [&](const int64_t* offsets, const int64_t* st, int64_t len) {
+                for (int64_t j = 0; j < len; ++j) {
+                    const T* row = input + offsets[0] + j * st[0] + begin;
+                    for (int64_t o = 0; o < end - begin; ++o) {
+                        acc[o] += static_cast<Acc>(row[o]);
+                    }
+                }
+            });
+            for (int64_t o = begin; o < end; ++o) {
+                out[o] = castValue<T>(acc[o - begin] * scale);
+            }
+        });
+        return;
+    }
+    if (plan.numOut == 1 && plan.reducedContiguous()) {
+        // a full reduction is split in fixed blocks, which keeps the result independent of the number of threads
+        const int64_t numBlocks = (plan.reduceNumel + kGrainSize - 1) / kGrainSize;
+        std::vector<Acc> partial(numBlocks, Acc(0));
+        parallelFor(numBlocks, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t b = begin; b < end; ++b) {
+                const int64_t start = b * kGrainSize;
+                partial[b] = sumContiguous<T, Acc>(input + start, std::min(kGrainSize, plan.reduceNumel - start));
+            }
+        });
+        Acc total = 0;
+        for (auto value : partial) {
+            total += value;
+        }
+        out[0] = castValue<T>(total * scale);
+        return;
+    }
+    parallelFor(plan.numOut, std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, plan.reduceNumel)), [&](int64_t begin, int64_t end) {
+        int64_t pos = begin;
+        stridedLoop(plan.keptShape, keptStrides, begin, end, [&](const int64_t* keptOffsets, const int64_t* keptSt, int64_t keptLen) {
+            for (int64_t o = 0; o < keptLen; ++o) {
+                const T* base = input + keptOffsets[0] + o * keptSt[0];
+                Acc total = 0;
+                if (plan.reducedContiguous()) {
+                    total = sumContiguous<T, Acc>(base, plan.reduceNumel);
+                } else {
+                    stridedLoop(plan.reducedShape, reducedStrides, 0, plan.reduceNumel, [&](const int64_t* offsets, const int64_t* st, int64_t len) {
+                        for (int64_t j = 0; j < len; ++j) {
+                            total += static_cast<Acc>(base[offsets[0] + j * st[0]]);
+                        }
+                    });
+                }
+                out[pos++] = castValue<T>(total * scale);
+            }
+        });
+    });
+}
+
+diopiError_t reduceSum(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiSize_t dim, bool mean) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    ReducePlan plan(inputTensor, dim);
+    DIOPI_CHECK(plan.numOut == outTensor.numel(), "out has %ld elements, the reduction gives %ld", outTensor.numel(), plan.numOut);
+    DiopiTensor result = outTensor;
+    if (!outTensor.isContiguous()) {
+        DIOPI_CALL(requireTensor(ctx, outTensor.shape(), outTensor.dtype(), outTensor, result));
+    }
+    auto launch = [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        using Acc = typename AccType<T>::type;
+        Acc scale = mean ? static_cast<Acc>(1.0 / std::max<int64_t>(1, plan.reduceNumel)) : Acc(1);
+        if (mean && plan.reduceNumel == 0) {
+            scale = static_cast<Acc>(NAN);
+        }
+        sumKernel<T>(result.data<T>(), inputTensor.data<T>(), plan, scale);
+        return diopiSuccess;
+    };
+    DIOPI_CALL(mean ? dispatchFloatingTypes(outTensor.dtype(), launch) : dispatchNumericTypes(outTensor.dtype(), launch));
+    if (result.data<void>() != outTensor.data<void>()) {
+        DIOPI_CALL(diopiCopyInp(ctx, result.tensorHandle(), out));
+    }
+    return diopiSuccess;
+}
+
+// max or min of all the elements, NaN wins like in the reference
+template <bool isMax>
+diopiError_t reduceExtreme(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DIOPI_CALL(makeContiguous(ctx, DiopiTensor(input), inputTensor));
+    DIOPI_CHECK(inputTensor.numel() > 0, "the reduction of an empty tensor has no identity");
+    return dispatchAllTypes(inputTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        using Acc = typename AccType<T>::type;
+        auto better = [](Acc candidate, Acc current) { return candidate != candidate || (isMax ? candidate > current : candidate < current); };
+        const T* data = inputTensor.data<T>();
+        const int64_t n = inputTensor.numel();
+        const int64_t numBlocks = (n + kGrainSize - 1) / kGrainSize;
+        std::vector<Acc> partial(numBlocks);
+        parallelFor(numBlocks, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t b = begin; b < end; ++b) {
+                const int64_t start = b * kGrainSize;
+                const int64_t stop = std::min(n, start + kGrainSize);
+                Acc value = static_cast<Acc>(data[start]);
+                for (int64_t i = start + 1; i < stop && value == value; ++i) {
+                    if (better(static_cast<Acc>(data[i]), value)) {
+                        value = static_cast<Acc>(data[i]);
+                    }
+                }
+                partial[b] = value;
+            }
+        });
+        Acc value = partial[0];
+        for (auto candidate : partial) {
+            if (better(candidate, value)) {
+                value = candidate;
+            }
+        }
+        return dispatchAllTypes(outTensor.dtype(), [&](auto outTag) {
+            using TOut = typename decltype(outTag)::type;
+            *outTensor.data<TOut>() = castValue<TOut>(castValue<T>(value));
+            return diopiSuccess;
+        });
+    });
+}
+
+}  // namespace
+
+diopiError_t diopiSum(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiSize_t dim) {
+    return reduceSum(ctx, out, input, dim, false);
+}
+
+diopiError_t diopiMean(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiSize_t dim) {
+    return reduceSum(ctx, out, input, dim, true);
+}
+
+diopiError_t diopiMaxAll(diopiContextHandle_t ctx, diopiTensorHandle_t max, diopiConstTensorHandle_t input) { return reduceExtreme<true>(ctx, max, input); }
+
+diopiError_t diopiMinAll(diopiContextHandle_t ctx, diopiTensorHandle_t min, diopiConstTensorHandle_t input) { return reduceExtreme<false>(ctx, min, input); }
+
+}  // namespace cpu
+}  // namespace impl
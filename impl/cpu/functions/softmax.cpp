@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <cmath>
+#include <limits>
+
+#include "../cpu_helper.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+// input seen as [outer, size, inner] around dim, both tensors contiguous. Rows of the inner dimension are processed
+// together so that the loops over it stay contiguous.
+template <typename T, bool isLog>
+void softmaxKernel(T* out, const T* input, int64_t outer, int64_t size, int64_t inner) {
+    using Acc = typename AccType<T>::type;
+    const int64_t grain = std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, size * inner));
+    parallelFor(outer, grain, [&](int64_t begin, int64_t end) {
+        std::vector<Acc> maxValue(inner);
+        std::vector<Acc> sum(inner);
+        for (int64_t o = begin; o < end; ++o) {
+            const T* in = input + o * size * inner;
+            T* res = out + o * size * inner;
+            std::fill(maxValue.begin(), maxValue.end(), -std::numeric_limits<Acc>::infinity());
+            std::fill(sum.begin(), sum.end(), Acc(0));
+            for (int64_t s = 0; s < size; ++s) {
+                for (int64_t i = 0; i < inner; ++i) {
+                    maxValue[i] = std::max(maxValue[i], static_cast<Acc>(in[s * inner + i]));
+                }
+            }
+            for (int64_t s = 0; s < size; ++s) {
+                for (int64_t i = 0; i < inner; ++i) {
+                    sum[i] += std::exp(static_cast<Acc>(in[s * inner + i]) - maxValue[i]);
+                }
+            }
+            for (int64_t i = 0; i < inner; ++i) {
+                sum[i] = isLog ? std::log(sum[i]) + maxValue[i] : Acc(1) / sum[i];
+            }
+            for (int64_t s = 0; s < size; ++s) {
+                for (int64_t i = 0; i < inner; ++i) {
+                    Acc x = static_cast<Acc>(in[s * inner + i]);
+                    res[s * inner + i] = castValue<T>(isLog ? x - sum[i] : std::exp(x - maxValue[i]) * sum[i]);
+                }
+            }
+        }
+    });
+}
+
+template <bool isLog>
+diopiError_t softmax(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, int64_t dim) {
+    DiopiTensor outTensor(out);
+    DiopiTensor castInput;
+    DiopiTensor inputTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), castInput));
+    DIOPI_CALL(makeContiguous(ctx, castInput, inputTensor));
+    const int64_t ndim = inputTensor.dim();
+    if (dim < 0) {
+        dim += ndim;
+    }
+    DIOPI_CHECK(ndim == 0 || (dim >= 0 && dim < ndim), "dim %ld is out of range for a tensor of %ld dims", dim, ndim);
+    int64_t outer = 1;
+    int64_t size = 1;
+    int64_t inner = 1;
+    for (int64_t d = 0; d < ndim; ++d) {
+        (d < dim ? outer : d == dim ? size : inner) *= inputTensor.shape()[d];
+    }
+    DiopiTensor result = outTensor;
+    if (!outTensor.isContiguous()) {
+        DIOPI_CALL(requireTensor(ctx, outTensor.shape(), outTensor.dtype(), outTensor, result));
+    }
+    DIOPI_CALL(dispatchFloatingTypes(outTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        softmaxKernel<T, isLog>(result.data<T>(), inputTensor.data<T>(), outer, size, inner);
+        return diopiSuccess;
+    }));
+    if (result.data<void>() != outTensor.data<void>()) {
+        DIOPI_CALL(diopiCopyInp(ctx, result.tensorHandle(), out));
+    }
+    return diopiSuccess;
+}
+
+}  // namespace
+
+diopiError_t diopiSoftmax(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, int64_t dim) {
+    return softmax<false>(ctx, out, input, dim);
+}
+
+diopiError_t diopiLogSoftmax(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, int64_t dim) {
+    return softmax<true>(ctx, out, input, dim);
+}
+
+}  // namespace cpu
+}  // namespace impl
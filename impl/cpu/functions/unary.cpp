@@ -0,0 +1,144 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "../tensor_iterator.hpp"
+
+namespace impl {
+namespace cpu {
+
+// Each op is a function object returning the elementwise op for the dtype it is given, a generic lambda that
+// cpuKernelVec calls with ComputeType values or with Vec registers of them
+
+struct NegOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) { return -x; };
+    }
+};
+
+struct AbsOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) { return vec::abs(x); };
+    }
+};
+
+struct ReluOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        // NaN is kept, like the reference
+        return [](auto x) { return vec::max(x, decltype(x)(0)); };
+    }
+};
+
+struct ExpOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) { return vec::exp(x); };
+    }
+};
+
+struct LogOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) { return vec::log(x); };
+    }
+};
+
+struct SqrtOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) { return vec::sqrt(x); };
+    }
+};
+
+struct RsqrtOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) { return decltype(x)(1) / vec::sqrt(x); };
+    }
+};
+
+struct SigmoidOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) {
+            using V = decltype(x);
+            return V(1) / (V(1) + vec::exp(-x));
+        };
+    }
+};
+
+struct TanhOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) { return vec::tanh(x); };
+    }
+};
+
+struct SiluOp {
+    template <typename Tag>
+    auto operator()(Tag) const {
+        return [](auto x) { return x / (decltype(x)(1) + vec::exp(-x)); };
+    }
+};
+
+diopiError_t diopiNeg(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) { return unaryOp(ctx, out, input, NegOp()); }
+
+diopiError_t diopiNegInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return unaryOp(ctx, input, input, NegOp()); }
+
+diopiError_t diopiAbs(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) { return unaryOp(ctx, out, input, AbsOp()); }
+
+diopiError_t diopiAbsInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return unaryOp(ctx, input, input, AbsOp()); }
+
+diopiError_t diopiRelu(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) { return unaryOp(ctx, out, input, ReluOp()); }
+
+diopiError_t diopiReluInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return unaryOp(ctx, input, input, ReluOp()); }
+
+diopiError_t diopiExp(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    return floatingUnaryOp(ctx, out, input, ExpOp());
+}
+
+diopiError_t diopiExpInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return floatingUnaryOp(ctx, input, input, ExpOp()); }
+
+diopiError_t diopiLog(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    return floatingUnaryOp(ctx, out, input, LogOp());
+}
+
+diopiError_t diopiLogInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return floatingUnaryOp(ctx, input, input, LogOp()); }
+
+diopiError_t diopiSqrt(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    return floatingUnaryOp(ctx, out, input, SqrtOp());
+}
+
+diopiError_t diopiSqrtInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return floatingUnaryOp(ctx, input, input, SqrtOp()); }
+
+diopiError_t diopiRsqrt(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    return floatingUnaryOp(ctx, out, input, RsqrtOp());
+}
+
+diopiError_t diopiRsqrtInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return floatingUnaryOp(ctx, input, input, RsqrtOp()); }
+
+diopiError_t diopiSigmoid(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    return floatingUnaryOp(ctx, out, input, SigmoidOp());
+}
+
+diopiError_t diopiSigmoidInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return floatingUnaryOp(ctx, input, input, SigmoidOp()); }
+
+diopiError_t diopiTanh(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    return floatingUnaryOp(ctx, out, input, TanhOp());
+}
+
+diopiError_t diopiTanhInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return floatingUnaryOp(ctx, input, input, TanhOp()); }
+
+diopiError_t diopiSilu(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input) {
+    return floatingUnaryOp(ctx, out, input, SiluOp());
+}
+
+diopiError_t diopiSiluInp(diopiContextHandle_t ctx, diopiTensorHandle_t input) { return floatingUnaryOp(ctx, input, input, SiluOp()); }
+
+}  // namespace cpu
+}  // namespace impl
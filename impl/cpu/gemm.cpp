@@ -0,0 +1,348 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "gemm.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+#include "cpu_helper.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+// Cache blocking: a kc x nr sliver of b stays in L1 while a whole mc x kc block of a streams from L2, and the kc x nc
+// panel of b is shared by all threads from L3.
+constexpr int64_t kKc = 256;
+constexpr int64_t kMc = 144;
+constexpr int64_t kNc = 3072;
+constexpr int64_t kMaxTile = 512;
+
+// multiply-adds a product is worth splitting across the threads for
+constexpr int64_t kParallelWork = 1 << 18;
+
+int64_t ceilDiv(int64_t a, int64_t b) { return (a + b - 1) / b; }
+
+template <typename T>
+struct MatrixView {
+    T* data;
+    int64_t rowStride;
+    int64_t colStride;
+
+    T& operator()(int64_t i, int64_t j) const { return data[i * rowStride + j * colStride]; }
+};
+
+// rows x depth of a into slivers of mr rows, each stored column by column and zero padded to mr rows. The loops follow
+// whichever stride of a is 1, so a transposed a is read as efficiently as a plain one.
+template <typename Acc, typename T>
+void packA(const MatrixView<const T>& a, int64_t rows, int64_t depth, int64_t mr, Acc* packed) {
+    for (int64_t i0 = 0; i0 < rows; i0 += mr) {
+        const int64_t h = std::min(mr, rows - i0);
+        Acc* dst = packed + i0 * depth;
+        if (a.colStride == 1) {
+            for (int64_t i = 0; i < h; ++i) {
+                const T* src = &a(i0 + i, 0);
+                for (int64_t p = 0; p < depth; ++p) {
+                    dst[p * mr + i] = static_cast<Acc>(src[p]);
+                }
+            }
+        } else {
+            for (int64_t p = 0; p < depth; ++p) {
+                for (int64_t i = 0; i < h; ++i) {
+                    dst[p * mr + i] = static_cast<Acc>(a(i0 + i, p));
+                }
+            }
+        }
+        for (int64_t p = 0; p < depth && h < mr; ++p) {
+            std::fill(dst + p * mr + h, dst + (p + 1) * mr, Acc(0));
+        }
+    }
+}
+
+// depth x cols of b into slivers of nr columns, each stored row by row and zero padded to nr columns
+template <typename Acc, typename T>
+void packB(const MatrixView<const T>& b, int64_t depth, int64_t cols, int64_t nr, Acc* packed) {
+    for (int64_t j0 = 0; j0 < cols; j0 += nr) {
+        const int64_t w = std::min(nr, cols - j0);
+        Acc* dst = packed + j0 * depth;
+        if (b.rowStride == 1 && b.colStride != 1) {
+            for (int64_t j = 0; j < w; ++j) {
+                const T* src = &b(0, j0 + j);
+                for (int64_t p = 0; p < depth; ++p) {
+                    dst[p * nr + j] = static_cast<Acc>(src[p]);
+                }
+            }
+        } else {
+            for (int64_t p = 0; p < depth; ++p) {
+                for (int64_t j = 0; j < w; ++j) {
+                    dst[p * nr + j] = static_cast<Acc>(b(p, j0 + j));
+                }
+            }
+        }
+        for (int64_t p = 0; p < depth && w < nr; ++p) {
+            std::fill(dst + p * nr + w, dst + (p + 1) * nr, Acc(0));
+        }
+    }
+}
+
+// Epilogue of a tile: the first block of k writes alpha * tile + beta * addend, the later ones accumulate alpha * tile
+template <typename Acc>
+void storeTile(const Acc* tile, int64_t nr, int64_t h, int64_t w, const MatrixView<Acc>& c, const MatrixView<const Acc>& addend, Acc alpha, Acc beta,
+               bool first) {
+    for (int64_t i = 0; i < h; ++i) {
+        Acc* dst = &c(i, 0);
+        const Acc* src = tile + i * nr;
+        if (!first) {
+            for (int64_t j = 0; j < w; ++j) {
+                dst[j * c.colStride] += alpha * src[j];
+            }
+        } else if (addend.data != nullptr) {
+            const Acc* add = &addend(i, 0);
+            for (int64_t j = 0; j < w; ++j) {
+                dst[j * c.colStride] = alpha * src[j] + beta * add[j * addend.colStride];
+            }
+        } else {
+            for (int64_t j = 0; j < w; ++j) {
+                dst[j * c.colStride] = alpha * src[j];
+            }
+        }
+    }
+}
+
+/**
+ * One m x n x k product computed in Acc, a and b converted to Acc as they are packed. The n dimension is walked in
+ * panels of nc and k in blocks of kc; for each pair the panel of b is packed once, then the tasks, blocks of mc rows
+ * times a range of nr slivers, each pack their block of a and run the micro-kernel over it.
+ */
+template <typename T, typename Acc>
+void gemmMatrix(int64_t m, int64_t n, int64_t k, const MatrixView<const T>& a, const MatrixView<const T>& b, const MatrixView<Acc>& c,
+                const MatrixView<const Acc>& addend, Acc alpha, Acc beta, bool parallel) {
+    if (k == 0) {
+        for (int64_t i = 0; i < m; ++i) {
+            for (int64_t j = 0; j < n; ++j) {
+                c(i, j) = addend.data != nullptr ? beta * addend(i, j) : Acc(0);
+            }
+        }
+        return;
+    }
+    const GemmKernel<Acc>& kernel = gemmKernel<Acc>();
+    const int64_t mr = kernel.mr;
+    const int64_t nr = kernel.nr;
+    const int64_t mc = kMc / mr * mr;
+    const int64_t nc = kNc / nr * nr;
+    static thread_local std::vector<Acc> packedB;
+    packedB.resize(std::min(kKc, k) * ceilDiv(std::min(nc, n), nr) * nr);
+    Acc* panel = packedB.data();
+
+    for (int64_t jc = 0; jc < n; jc += nc) {
+        const int64_t ncur = std::min(nc, n - jc);
+        const int64_t nSlivers = ceilDiv(ncur, nr);
+        for (int64_t pc = 0; pc < k; pc += kKc) {
+            const int64_t kcur = std::min(kKc, k - pc);
+            auto packPanel = [&](int64_t begin, int64_t end) {
+                const MatrixView<const T> block{&b(pc, jc + begin * nr), b.rowStride, b.colStride};
+                packB(block, kcur, std::min(ncur, end * nr) - begin * nr, nr, panel + begin * nr * kcur);
+            };
+            // enough slivers per task to split the panel only when it is large
+            const int64_t packGrain = std::max<int64_t>(1, kGrainSize / (nr * kcur));
+            if (parallel) {
+                parallelFor(nSlivers, packGrain, packPanel);
+            } else {
+                packPanel(0, nSlivers);
+            }
+
+            const int64_t mBlocks = ceilDiv(m, mc);
+            const int64_t nChunks = parallel ? std::min(nSlivers, ceilDiv(2 * ThreadPool::instance().numThreads(), mBlocks)) : 1;
+            const int64_t sliversPerChunk = ceilDiv(nSlivers, nChunks);
+            auto compute = [&](int64_t begin, int64_t end) {
+                static thread_local std::vector<Acc> packedA;
+                packedA.resize(mc * kcur);
+                alignas(64) Acc tile[kMaxTile];
+                int64_t packedBlock = -1;
+                for (int64_t task = begin; task < end; ++task) {
+                    const int64_t mb = task / nChunks;
+                    const int64_t ic = mb * mc;
+                    const int64_t mcur = std::min(mc, m - ic);
+                    if (mb != packedBlock) {
+                        packA(MatrixView<const T>{&a(ic, pc), a.rowStride, a.colStride}, mcur, kcur, mr, packedA.data());
+                        packedBlock = mb;
+                    }
+                    const int64_t chunk = task % nChunks;
+                    const int64_t sliverEnd = std::min(nSlivers, (chunk + 1) * sliversPerChunk);
+                    for (int64_t js = chunk * sliversPerChunk; js < sliverEnd; ++js) {
+                        const int64_t j = jc + js * nr;
+                        const int64_t w = std::min(nr, ncur - js * nr);
+                        for (int64_t ir = 0; ir < mcur; ir += mr) {
+                            const int64_t i = ic + ir;
+                            kernel.run(kcur, packedA.data() + ir * kcur, panel + js * nr * kcur, tile);
+                            const MatrixView<Acc> cTile{&c(i, j), c.rowStride, c.colStride};
+                            const MatrixView<const Acc> addTile{addend.data != nullptr ? &addend(i, j) : nullptr, addend.rowStride, addend.colStride};
+                            storeTile(tile, nr, std::min(mr, mcur - ir), w, cTile, addTile, alpha, beta, pc == 0);
+                        }
+                    }
+                }
+            };
+            if (parallel) {
+                parallelFor(mBlocks * nChunks, 1, compute);
+            } else {
+                compute(0, mBlocks * nChunks);
+            }
+        }
+    }
+}
+
+template <typename T>
+MatrixView<T> view(const GemmOperand& operand, int64_t offset) {
+    return MatrixView<T>{static_cast<T*>(operand.data) + offset, operand.rowStride, operand.colStride};
+}
+
+// T computed as it is, c and addend are used in place
+template <typename T>
+void gemmOne(const GemmDesc& desc, const int64_t* offsets, bool parallel, std::true_type) {
+    MatrixView<const T> addend{nullptr, 0, 0};
+    if (desc.addend.data != nullptr && desc.beta != 0.0) {
+        addend = view<const T>(desc.addend, offsets[3]);
+    }
+    gemmMatrix<T, T>(desc.m, desc.n, desc.k, view<const T>(desc.a, offsets[0]), view<const T>(desc.b, offsets[1]), view<T>(desc.c, offsets[2]), addend,
+                     static_cast<T>(desc.alpha), static_cast<T>(desc.beta), parallel);
+}
+
+// T computed in a wider type: the product is accumulated in a buffer of it and rounded to T once, with addend
+template <typename T>
+void gemmOne(const GemmDesc& desc, const int64_t* offsets, bool parallel, std::false_type) {
+    using Acc = typename ComputeType<T>::type;
+    const int64_t m = desc.m;
+    const int64_t n = desc.n;
+    static thread_local std::vector<Acc> buffer;
+    buffer.resize(m * n);
+    const MatrixView<Acc> acc{buffer.data(), n, 1};
+    gemmMatrix<T, Acc>(m, n, desc.k, view<const T>(desc.a, offsets[0]), view<const T>(desc.b, offsets[1]), acc, MatrixView<const Acc>{nullptr, 0, 0},
+                       static_cast<Acc>(desc.alpha), Acc(0), parallel);
+    const MatrixView<T> c = view<T>(desc.c, offsets[2]);
+    const bool hasAddend = desc.addend.data != nullptr && desc.beta != 0.0;
+    const MatrixView<const T> addend = hasAddend ? view<const T>(desc.addend, offsets[3]) : MatrixView<const T>{nullptr, 0, 0};
+    const Acc beta = static_cast<Acc>(desc.beta);
+    auto round = [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            for (int64_t j = 0; j < n; ++j) {
+                c(i, j) = static_cast<T>(hasAddend ? acc(i, j) + beta * static_cast<Acc>(addend(i, j)) : acc(i, j));
+            }
+        }
+    };
+    if (parallel) {
+        parallelFor(m, std::max<int64_t>(1, kGrainSize / std::max<int64_t>(1, n)), round);
+    } else {
+        round(0, m);
+    }
+}
+
+}  // namespace
+
+/**
+ * Batches run one after another with the threads inside each product, unless there are enough of them, or they are
+ * small enough, for a batch per task to keep the threads busy.
+ */
+template <typename T>
+void gemm(const GemmDesc& desc) {
+    int64_t batch = 1;
+    for (auto size : desc.batchShape) {
+        batch *= size;
+    }
+    if (batch == 0 || desc.m == 0 || desc.n == 0) {
+        return;
+    }
+    const GemmOperand* operands[4] = {&desc.a, &desc.b, &desc.c, &desc.addend};
+    const int64_t nbatchDims = static_cast<int64_t>(desc.batchShape.size());
+    auto run = [&](int64_t index, bool parallel) {
+        int64_t offsets[4] = {0, 0, 0, 0};
+        for (int64_t d = nbatchDims - 1; d >= 0; --d) {
+            const int64_t i = index % desc.batchShape[d];
+            index /= desc.batchShape[d];
+            for (int64_t o = 0; o < 4; ++o) {
+                if (!operands[o]->batchStrides.empty()) {
+                    offsets[o] += i * operands[o]->batchStrides[d];
+                }
+            }
+        }
+        gemmOne<T>(desc, offsets, parallel, std::is_same<T, typename ComputeType<T>::type>());
+    };
+
+    const int64_t work = desc.m * desc.n * std::max<int64_t>(1, desc.k);
+    if (batch > 1 && (batch >= ThreadPool::instance().numThreads() || work < kParallelWork)) {
+        parallelFor(batch, std::max<int64_t>(1, kParallelWork / work), [&](int64_t begin, int64_t end) {
+            for (int64_t index = begin; index < end; ++index) {
+                run(index, false);
+            }
+        });
+        return;
+    }
+    for (int64_t index = 0; index < batch; ++index) {
+        run(index, work >= kParallelWork);
+    }
+}
+
+template void gemm<half>(const GemmDesc& desc);
+template void gemm<float>(const GemmDesc& desc);
+template void gemm<double>(const GemmDesc& desc);
+
+diopiError_t gemm(diopiDtype_t dtype, const GemmDesc& desc) {
+    return dispatchFloatingTypes(dtype, [&](auto tag) {
+        gemm<typename decltype(tag)::type>(desc);
+        return diopiSuccess;
+    });
+}
+
+MatrixLayout MatrixLayout::transposed() const {
+    MatrixLayout result = *this;
+    const size_t nd = shape.size();
+    std::swap(result.shape[nd - 2], result.shape[nd - 1]);
+    std::swap(result.stride[nd - 2], result.stride[nd - 1]);
+    return result;
+}
+
+bool MatrixLayout::foldBatch() {
+    const int64_t nd = static_cast<int64_t>(shape.size());
+    // the dims of size 1 are free to skip, each other dim must step over the whole of the next one
+    int64_t rows = 1;
+    int64_t rowStride = 0;
+    int64_t innerSize = 1;
+    int64_t innerStride = 0;
+    for (int64_t d = nd - 2; d >= 0; --d) {
+        if (shape[d] == 1) {
+            continue;
+        }
+        if (rows == 1) {
+            rowStride = stride[d];
+        } else if (stride[d] != innerStride * innerSize) {
+            return false;
+        }
+        rows *= shape[d];
+        innerSize = shape[d];
+        innerStride = stride[d];
+    }
+    shape = {rows, shape[nd - 1]};
+    stride = {rowStride, stride[nd - 1]};
+    return true;
+}
+
+GemmOperand MatrixLayout::operand(const std::vector<int64_t>& batchShape) const {
+    const int64_t nd = static_cast<int64_t>(shape.size());
+    auto broadcast = [&](int64_t d) { return d < 0 || shape[d] == 1 ? 0 : stride[d]; };
+    GemmOperand result;
+    result.data = data;
+    result.rowStride = broadcast(nd - 2);
+    result.colStride = broadcast(nd - 1);
+    const int64_t lead = static_cast<int64_t>(batchShape.size()) - (nd - 2);
+    for (int64_t d = 0; d < static_cast<int64_t>(batchShape.size()); ++d) {
+        result.batchStrides.push_back(broadcast(d - lead));
+    }
+    return result;
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CPU_GEMM_HPP_
+#define IMPL_CPU_GEMM_HPP_
+
+#include <diopi/diopirt.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace impl {
+namespace cpu {
+
+// One operand of a batched GEMM, strides in elements. Element (i, j) of matrix b sits at data + offset(b) + i * rowStride
+// + j * colStride, where offset sums the index of b along the batch dims times batchStrides, so a transposed or
+// broadcast operand is described without a copy.
+struct GemmOperand {
+    void* data = nullptr;
+    int64_t rowStride = 0;
+    int64_t colStride = 0;
+    std::vector<int64_t> batchStrides;
+};
+
+// A batch of matrices in memory, the last two dims of shape being the rows and the columns, strides in elements
+struct MatrixLayout {
+    void* data = nullptr;
+    std::vector<int64_t> shape;
+    std::vector<int64_t> stride;
+
+    MatrixLayout transposed() const;
+
+    // Merges the batch dims into the rows when the strides allow it, returns whether they could be
+    bool foldBatch();
+
+    // The layout as an operand of a product over batchShape, with its dims of size 1 broadcast
+    GemmOperand operand(const std::vector<int64_t>& batchShape) const;
+};
+
+/**
+ * c = alpha * a @ b + beta * addend for each matrix of batchShape, a is m x k, b is k x n and c is m x n. Without
+ * addend, or with beta 0, addend is not read. addend may be c itself, or a bias seen with a zero row stride.
+ */
+struct GemmDesc {
+    int64_t m = 0;
+    int64_t n = 0;
+    int64_t k = 0;
+    std::vector<int64_t> batchShape;
+    GemmOperand a;
+    GemmOperand b;
+    GemmOperand c;
+    GemmOperand addend;
+    double alpha = 1.0;
+    double beta = 0.0;
+};
+
+// Runs desc on T = half, float or double, half being computed in float
+template <typename T>
+void gemm(const GemmDesc& desc);
+
+// gemm on the C++ type of dtype, which has to be a floating one
+diopiError_t gemm(diopiDtype_t dtype, const GemmDesc& desc);
+
+/**
+ * Micro-kernel of the GEMM: c[mr][nr] = a * b over kc steps, a packed as kc columns of mr values and b as kc rows of nr
+ * values. The kernel for cpuIsa() is picked at runtime.
+ */
+template <typename T>
+struct GemmKernel {
+    const char* isa;
+    int64_t mr;
+    int64_t nr;
+    void (*run)(int64_t kc, const T* a, const T* b, T* c);
+};
+
+template <typename T>
+const GemmKernel<T>& gemmKernel();
+
+}  // namespace cpu
+}  // namespace impl
+
+#endif  // IMPL_CPU_GEMM_HPP_
@@ -0,0 +1,119 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <cstring>
+
+#include "cpu_helper.hpp"
+#include "gemm.hpp"
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+// MR rows of a against NV vectors of b, all MR * NV accumulators held in registers over the kc steps. The body is
+// inlined into one wrapper per instruction set below, each of which lowers the vector extension to its own registers;
+// the file is built with -ffp-contract=fast so that the multiply-adds become FMA where the target has it.
+template <typename T, int64_t Bytes, int64_t MR, int64_t NV>
+inline __attribute__((always_inline)) void microKernel(int64_t kc, const T* a, const T* b, T* c) {
+    typedef T V __attribute__((vector_size(Bytes)));
+    constexpr int64_t kLanes = Bytes / sizeof(T);
+    V acc[MR][NV];
+    for (int64_t i = 0; i < MR; ++i) {
+        for (int64_t v = 0; v < NV; ++v) {
+            acc[i][v] = V{};
+        }
+    }
+    for (int64_t p = 0; p < kc; ++p) {
+        V bv[NV];
+        for (int64_t v = 0; v < NV; ++v) {
+            std::memcpy(&bv[v], b + v * kLanes, sizeof(V));
+        }
+        for (int64_t i = 0; i < MR; ++i) {
+            // a - 0 folds to a plain broadcast, 0 + a does not since it has to turn -0 into +0
+            const V ai = a[i] - V{};
+            for (int64_t v = 0; v < NV; ++v) {
+                acc[i][v] = acc[i][v] + ai * bv[v];
+            }
+        }
+        a += MR;
+        b += NV * kLanes;
+    }
+    for (int64_t i = 0; i < MR; ++i) {
+        for (int64_t v = 0; v < NV; ++v) {
+            std::memcpy(c + (i * NV + v) * kLanes, &acc[i][v], sizeof(V));
+        }
+    }
+}
+
+// 128-bit vectors, SSE2 on x86-64 and NEON on aarch64, which has 32 of them
+#if defined(__aarch64__)
+constexpr int64_t kGenericRows = 8;
+#else
+constexpr int64_t kGenericRows = 4;
+#endif
+
+void genericF32(int64_t kc, const float* a, const float* b, float* c) { microKernel<float, 16, kGenericRows, 2>(kc, a, b, c); }
+void genericF64(int64_t kc, const double* a, const double* b, double* c) { microKernel<double, 16, kGenericRows, 2>(kc, a, b, c); }
+
+#if defined(__x86_64__)
+// 16 ymm registers: 12 accumulators, 2 rows of b and the broadcast of a
+__attribute__((target("avx2,fma"))) void avx2F32(int64_t kc, const float* a, const float* b, float* c) { microKernel<float, 32, 6, 2>(kc, a, b, c); }
+__attribute__((target("avx2,fma"))) void avx2F64(int64_t kc, const double* a, const double* b, double* c) {
+    microKernel<double, 32, 6, 2>(kc, a, b, c);
+}
+
+// 32 zmm registers: 24 accumulators, 2 rows of b and the broadcast of a
+__attribute__((target("avx512f"))) void avx512F32(int64_t kc, const float* a, const float* b, float* c) { microKernel<float, 64, 12, 2>(kc, a, b, c); }
+__attribute__((target("avx512f"))) void avx512F64(int64_t kc, const double* a, const double* b, double* c) {
+    microKernel<double, 64, 12, 2>(kc, a, b, c);
+}
+#endif
+
+#if defined(__aarch64__)
+constexpr const char* kGenericName = "neon";
+#else
+constexpr const char* kGenericName = "generic";
+#endif
+
+}  // namespace
+
+template <>
+const GemmKernel<float>& gemmKernel<float>() {
+    static const GemmKernel<float> kernel = []() {
+        switch (cpuIsa()) {
+#if defined(__x86_64__)
+            case CpuIsa::kAvx512:
+                return GemmKernel<float>{"avx512", 12, 32, avx512F32};
+            case CpuIsa::kAvx2:
+                return GemmKernel<float>{"avx2", 6, 16, avx2F32};
+#endif
+            default:
+                return GemmKernel<float>{kGenericName, kGenericRows, 8, genericF32};
+        }
+    }();
+    return kernel;
+}
+
+template <>
+const GemmKernel<double>& gemmKernel<double>() {
+    static const GemmKernel<double> kernel = []() {
+        switch (cpuIsa()) {
+#if defined(__x86_64__)
+            case CpuIsa::kAvx512:
+                return GemmKernel<double>{"avx512", 12, 16, avx512F64};
+            case CpuIsa::kAvx2:
+                return GemmKernel<double>{"avx2", 6, 8, avx2F64};
+#endif
+            default:
+                return GemmKernel<double>{kGenericName, kGenericRows, 4, genericF64};
+        }
+    }();
+    return kernel;
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "tensor_iterator.hpp"
+
+namespace impl {
+namespace cpu {
+
+TensorIterator& TensorIterator::addOutput(const DiopiTensor& tensor) {
+    operands_.insert(operands_.begin() + noutputs_, tensor);
+    ++noutputs_;
+    return *this;
+}
+
+TensorIterator& TensorIterator::addInput(const DiopiTensor& tensor) {
+    operands_.push_back(tensor);
+    return *this;
+}
+
+diopiError_t TensorIterator::build() {
+    DIOPI_CHECK(noutputs_ > 0, "TensorIterator requires an output");
+    const int64_t nt = static_cast<int64_t>(operands_.size());
+    DIOPI_CHECK(nt <= kMaxOperands, "TensorIterator takes at most %ld operands, got %ld", kMaxOperands, nt);
+    const std::vector<int64_t>& shape = operands_[0].shape();
+    DIOPI_CHECK(static_cast<int64_t>(shape.size()) <= kMaxDims, "TensorIterator takes at most %ld dims", kMaxDims);
+    for (int64_t k = 0; k < nt; ++k) {
+        const DiopiTensor& operand = operands_[k];
+        DIOPI_CHECK(operand.defined(), "operand %ld of TensorIterator is undefined", k);
+        if (k < noutputs_) {
+            DIOPI_CHECK(operand.shape() == shape, "the outputs of TensorIterator must have the same shape");
+        } else {
+            DIOPI_CHECK(broadcastShape(operand.shape(), shape) == shape, "input %ld can not be broadcast to the shape of the output", k - noutputs_);
+        }
+    }
+
+    data_.clear();
+    std::vector<std::vector<int64_t>> strides;
+    for (const auto& operand : operands_) {
+        data_.push_back(operand.data<char>());
+        std::vector<int64_t> operandStrides = broadcastStrides(operand, shape);
+        for (auto& stride : operandStrides) {
+            stride *= operand.elemsize();
+        }
+        strides.push_back(operandStrides);
+    }
+
+    // Order the dims from the outermost to the innermost in memory, deciding by the first operand that is not
+    // broadcast along the two dims. Insertion sort keeps the given order of the dims that tie.
+    const int64_t nd = static_cast<int64_t>(shape.size());
+    auto outerThan = [&](int64_t a, int64_t b) {
+        for (int64_t k = 0; k < nt; ++k) {
+            const int64_t sa = strides[k][a];
+            const int64_t sb = strides[k][b];
+            if (sa != 0 && sb != 0 && sa != sb) {
+                return sa > sb;
+            }
+        }
+        return false;
+    };
+    std::vector<int64_t> perm;
+    for (int64_t d = 0; d < nd; ++d) {
+        if (shape[d] == 1) {
+            continue;
+        }
+        perm.push_back(d);
+        for (int64_t i = static_cast<int64_t>(perm.size()) - 1; i > 0 && outerThan(perm[i], perm[i - 1]); --i) {
+            std::swap(perm[i], perm[i - 1]);
+        }
+    }
+
+    // Merge a dim into the next inner one when every operand steps over the inner dim in one stride of the outer
+    shape_.clear();
+    strides_.clear();
+    numel_ = 1;
+    for (auto d : shape) {
+        numel_ *= d;
+    }
+    for (auto d : perm) {
+        bool mergeable = !shape_.empty();
+        for (int64_t k = 0; k < nt && mergeable; ++k) {
+            mergeable = strides[k][d] * shape[d] == strides_[(shape_.size() - 1) * nt + k];
+        }
+        if (mergeable) {
+            shape_.back() *= shape[d];
+            for (int64_t k = 0; k < nt; ++k) {
+                strides_[(shape_.size() - 1) * nt + k] = strides[k][d];
+            }
+            continue;
+        }
+        shape_.push_back(shape[d]);
+        for (int64_t k = 0; k < nt; ++k) {
+            strides_.push_back(strides[k][d]);
+        }
+    }
+    if (shape_.empty()) {
+        shape_.push_back(numel_);
+        strides_.assign(nt, 0);
+    }
+    return diopiSuccess;
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,337 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CPU_TENSOR_ITERATOR_HPP_
+#define IMPL_CPU_TENSOR_ITERATOR_HPP_
+
+#include <utility>
+#include <vector>
+
+#include "cpu_helper.hpp"
+#include "vec.hpp"
+
+namespace impl {
+namespace cpu {
+
+// bytes of operand data a task of an elementwise kernel works on, kept well below the L2 cache of a core
+constexpr int64_t kCacheChunkBytes = 128 * 1024;
+
+/**
+ * Walks the elements of a set of operands, outputs first, with the inputs broadcast to the shape of the outputs.
+ * build() orders the dimensions by the memory layout of the first output and merges the ones all operands walk
+ * without a jump, so that most tensors end up as one long innermost run. Kernels see the elements as runs along the
+ * innermost dimension: loop(data, strides, n) gets a pointer per operand and its stride in bytes.
+ */
+class TensorIterator {
+public:
+    static constexpr int64_t kMaxOperands = 8;
+    static constexpr int64_t kMaxDims = 64;
+
+    TensorIterator& addOutput(const DiopiTensor& tensor);
+    TensorIterator& addInput(const DiopiTensor& tensor);
+
+    diopiError_t build();
+
+    int64_t ntensors() const { return static_cast<int64_t>(data_.size()); }
+    int64_t noutputs() const { return noutputs_; }
+    int64_t numel() const { return numel_; }
+    int64_t ndim() const { return static_cast<int64_t>(shape_.size()); }
+    const std::vector<int64_t>& shape() const { return shape_; }
+    int64_t stride(int64_t operand, int64_t dim) const { return strides_[dim * ntensors() + operand]; }
+
+    // Calls loop on the runs covering the elements [begin, end) in the order of the merged dimensions
+    template <typename Loop>
+    void serialFor(int64_t begin, int64_t end, Loop&& loop) const;
+
+    // Calls loop on the runs covering all the elements, split across the threads in chunks of about kCacheChunkBytes
+    template <typename Loop>
+    void forEach(Loop&& loop) const;
+
+private:
+    std::vector<DiopiTensor> operands_;
+    std::vector<char*> data_;
+    int64_t noutputs_ = 0;
+    int64_t numel_ = 0;
+    std::vector<int64_t> shape_;
+    // strides in bytes, strides_[dim * ntensors() + operand]
+    std::vector<int64_t> strides_;
+};
+
+template <typename Loop>
+void TensorIterator::serialFor(int64_t begin, int64_t end, Loop&& loop) const {
+    const int64_t nt = ntensors();
+    const int64_t nd = ndim();
+    int64_t index[kMaxDims];
+    int64_t rest = begin;
+    for (int64_t d = nd - 1; d >= 0; --d) {
+        index[d] = rest % shape_[d];
+        rest /= shape_[d];
+    }
+    const int64_t* innerStrides = &strides_[(nd - 1) * nt];
+    char* ptrs[kMaxOperands];
+    int64_t pos = begin;
+    while (pos < end) {
+        for (int64_t k = 0; k < nt; ++k) {
+            ptrs[k] = data_[k];
+            for (int64_t d = 0; d < nd; ++d) {
+                ptrs[k] += index[d] * strides_[d * nt + k];
+            }
+        }
+        const int64_t len = std::min(shape_[nd - 1] - index[nd - 1], end - pos);
+        loop(ptrs, innerStrides, len);
+        pos += len;
+        index[nd - 1] += len;
+        for (int64_t d = nd - 1; d > 0 && index[d] == shape_[d]; --d) {
+            index[d] = 0;
+            ++index[d - 1];
+        }
+    }
+}
+
+template <typename Loop>
+void TensorIterator::forEach(Loop&& loop) const {
+    if (numel_ == 0) {
+        return;
+    }
+    int64_t bytesPerElement = 0;
+    for (const auto& operand : operands_) {
+        bytesPerElement += operand.elemsize();
+    }
+    // chunks start on cache line boundaries of every operand, so threads never write to the same line
+    constexpr int64_t kLine = 64;
+    const int64_t chunk = std::max<int64_t>(1, kCacheChunkBytes / bytesPerElement / kLine) * kLine;
+    const int64_t numChunks = (numel_ + chunk - 1) / chunk;
+    if (numel_ <= kGrainSize || numChunks == 1) {
+        serialFor(0, numel_, loop);
+        return;
+    }
+    parallelFor(numChunks, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t c = begin; c < end; ++c) {
+            serialFor(c * chunk, std::min(numel_, (c + 1) * chunk), loop);
+        }
+    });
+}
+
+/********************************* inner loops ****************************/
+
+namespace detail {
+
+template <typename T>
+inline T& at(char* data, int64_t stride, int64_t i) {
+    return *reinterpret_cast<T*>(data + i * stride);
+}
+
+// Elementwise loop over n elements of every operand. The contiguous case is its own instantiation with the strides
+// known at compile time, which the compiler vectorizes for the simple ops.
+template <typename TOut, typename... TIn, typename Op, size_t... I>
+inline void basicLoop(char** data, const int64_t* strides, int64_t n, Op& op, std::index_sequence<I...>) {
+    bool contiguous = strides[0] == sizeof(TOut);
+    (void)std::initializer_list<bool>{(contiguous = contiguous && strides[I + 1] == sizeof(TIn))...};
+    if (contiguous) {
+        TOut* out = reinterpret_cast<TOut*>(data[0]);
+        for (int64_t i = 0; i < n; ++i) {
+            out[i] = op(reinterpret_cast<const TIn*>(data[I + 1])[i]...);
+        }
+        return;
+    }
+    for (int64_t i = 0; i < n; ++i) {
+        at<TOut>(data[0], strides[0], i) = op(at<TIn>(data[I + 1], strides[I + 1], i)...);
+    }
+}
+
+// Input I of a vectorized loop, a broadcast register when it is the scalar operand S (inputs count from 1)
+template <typename T, int64_t S, size_t I, int64_t Bytes>
+inline Vec<typename ComputeType<T>::type, Bytes> loadInput(const T* data, int64_t i, const Vec<typename ComputeType<T>::type, Bytes>& scalar) {
+    return S == static_cast<int64_t>(I) + 1 ? scalar : VecIO<T, Bytes>::load(data + i);
+}
+
+// Contiguous loop over n elements with two registers of Bytes per operand in flight; input S, if any, has stride 0.
+// Always inlined, so that it and op are compiled for the instruction set of the wrapper below that calls it.
+template <typename T, int64_t S, int64_t Bytes, typename Op, size_t... I>
+inline __attribute__((always_inline)) void vectorizedLoop(char** data, int64_t n, Op& op, std::index_sequence<I...>) {
+    using C = typename ComputeType<T>::type;
+    using V = Vec<C, Bytes>;
+    T* out = reinterpret_cast<T*>(data[0]);
+    const T* in[sizeof...(I) + 1] = {reinterpret_cast<const T*>(data[I + 1])...};
+    const V scalar = S > 0 ? V(static_cast<C>(*in[S > 0 && S <= static_cast<int64_t>(sizeof...(I)) ? S - 1 : 0])) : V(C(0));
+    int64_t i = 0;
+    for (; i + 2 * V::size <= n; i += 2 * V::size) {
+        const V first = op(loadInput<T, S, I, Bytes>(in[I], i, scalar)...);
+        const V second = op(loadInput<T, S, I, Bytes>(in[I], i + V::size, scalar)...);
+        VecIO<T, Bytes>::store(out + i, first);
+        VecIO<T, Bytes>::store(out + i + V::size, second);
+    }
+    for (; i < n; ++i) {
+        out[i] = castValue<T>(op(static_cast<C>(in[I][S == static_cast<int64_t>(I) + 1 ? 0 : i])...));
+    }
+}
+
+// vectorizedLoop built for each instruction set, like the GEMM micro-kernels; the one for cpuIsa() runs. The AVX2 one
+// is flattened so that op and the half conversions are compiled for AVX2 too. There is no 512-bit loop: the comparisons
+// of the generic code keep the vector masks of the narrower sets, which GCC lowers lane by lane for AVX-512, so CPUs
+// with AVX-512 run the AVX2 loop.
+template <typename T, int64_t S, typename Op, typename Seq>
+void genericLoop(char** data, int64_t n, Op& op, Seq seq) {
+    vectorizedLoop<T, S, kGenericVecBytes>(data, n, op, seq);
+}
+
+#if defined(__x86_64__)
+template <typename T, int64_t S, typename Op, typename Seq>
+__attribute__((flatten, target("avx2,fma,f16c"))) void avx2Loop(char** data, int64_t n, Op& op, Seq seq) {
+    vectorizedLoop<T, S, kAvx2VecBytes>(data, n, op, seq);
+}
+#endif
+
+template <typename T, int64_t S, typename Op, typename Seq>
+inline void dispatchLoop(char** data, int64_t n, Op& op, Seq seq) {
+    switch (cpuIsa()) {
+#if defined(__x86_64__)
+        case CpuIsa::kAvx512:
+        case CpuIsa::kAvx2:
+            return avx2Loop<T, S>(data, n, op, seq);
+#endif
+        default:
+            return genericLoop<T, S>(data, n, op, seq);
+    }
+}
+
+// Element by element loop computing in ComputeType<T>, for any strides
+template <typename T, typename Op, size_t... I>
+inline void elementLoop(char** data, const int64_t* strides, int64_t n, Op& op, std::index_sequence<I...>) {
+    using C = typename ComputeType<T>::type;
+    for (int64_t i = 0; i < n; ++i) {
+        at<T>(data[0], strides[0], i) = castValue<T>(op(static_cast<C>(at<T>(data[I + 1], strides[I + 1], i))...));
+    }
+}
+
+template <typename T, size_t N, typename Op>
+inline void vectorizedRun(char** data, const int64_t* strides, int64_t n, Op& op, std::true_type /*hasVec*/) {
+    // the output and all inputs but at most one stride 0 input are contiguous
+    int64_t scalarInput = 0;
+    bool vectorizable = strides[0] == sizeof(T);
+    for (size_t k = 1; k <= N && vectorizable; ++k) {
+        if (strides[k] == 0 && scalarInput == 0) {
+            scalarInput = static_cast<int64_t>(k);
+        } else {
+            vectorizable = strides[k] == sizeof(T);
+        }
+    }
+    if (!vectorizable) {
+        elementLoop<T>(data, strides, n, op, std::make_index_sequence<N>());
+    } else if (scalarInput == 0) {
+        dispatchLoop<T, 0>(data, n, op, std::make_index_sequence<N>());
+    } else if (scalarInput == 1) {
+        dispatchLoop<T, 1>(data, n, op, std::make_index_sequence<N>());
+    } else if (scalarInput == 2) {
+        dispatchLoop<T, 2>(data, n, op, std::make_index_sequence<N>());
+    } else {
+        dispatchLoop<T, 3>(data, n, op, std::make_index_sequence<N>());
+    }
+}
+
+template <typename T, size_t N, typename Op>
+inline void vectorizedRun(char** data, const int64_t* strides, int64_t n, Op& op, std::false_type /*hasVec*/) {
+    elementLoop<T>(data, strides, n, op, std::make_index_sequence<N>());
+}
+
+}  // namespace detail
+
+/**
+ * out = op(in...) over the elements of iter, the operands having the C++ types TOut and TIn. op converts the result
+ * to TOut itself.
+ */
+template <typename TOut, typename... TIn, typename Op>
+void cpuKernel(const TensorIterator& iter, Op op) {
+    iter.forEach(
+        [&](char** data, const int64_t* strides, int64_t n) { detail::basicLoop<TOut, TIn...>(data, strides, n, op, std::index_sequence_for<TIn...>()); });
+}
+
+/**
+ * out = op(in...) over the elements of iter with N inputs, all operands of type T. op is generic: it is called with
+ * values of ComputeType<T> or with Vec registers of them and uses the functions of namespace vec for anything but the
+ * arithmetic and comparison operators. Runs with a contiguous output and inputs that are contiguous, or one of them
+ * broadcast, take the Vec loop of the widest instruction set the CPU supports; the other runs compute element by
+ * element.
+ */
+template <typename T, size_t N, typename Op>
+void cpuKernelVec(const TensorIterator& iter, Op op) {
+    static_assert(N <= 3, "the vectorized loops take up to three inputs");
+    iter.forEach([&](char** data, const int64_t* strides, int64_t n) { detail::vectorizedRun<T, N>(data, strides, n, op, HasVec<T>()); });
+}
+
+/********************************* elementwise ops ****************************/
+
+// out = op(input) computed in the dtype of out, makeOp(TypeTag<T>()) returns the generic op for that dtype
+template <typename MakeOp>
+diopiError_t unaryOp(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, MakeOp makeOp) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(outTensor).addInput(inputTensor).build());
+    return dispatchNumericTypes(outTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        cpuKernelVec<T, 1>(iter, makeOp(tag));
+        return diopiSuccess;
+    });
+}
+
+// unaryOp for the ops only defined on floating dtypes
+template <typename MakeOp>
+diopiError_t floatingUnaryOp(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, MakeOp makeOp) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(outTensor).addInput(inputTensor).build());
+    return dispatchFloatingTypes(outTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        cpuKernelVec<T, 1>(iter, makeOp(tag));
+        return diopiSuccess;
+    });
+}
+
+// out = op(input, other) computed in the dtype of out, input and other broadcast to its shape
+template <typename MakeOp>
+diopiError_t binaryOp(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other, MakeOp makeOp) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DiopiTensor otherTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(other), outTensor.dtype(), otherTensor));
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(outTensor).addInput(inputTensor).addInput(otherTensor).build());
+    return dispatchAllTypes(outTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        cpuKernelVec<T, 2>(iter, makeOp(tag));
+        return diopiSuccess;
+    });
+}
+
+// out = op(input, a, b) computed in the dtype of out, the inputs broadcast to its shape
+template <typename MakeOp>
+diopiError_t ternaryOp(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t a,
+                       diopiConstTensorHandle_t b, MakeOp makeOp) {
+    DiopiTensor outTensor(out);
+    DiopiTensor inputTensor;
+    DiopiTensor aTensor;
+    DiopiTensor bTensor;
+    DIOPI_CALL(castTo(ctx, DiopiTensor(input), outTensor.dtype(), inputTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(a), outTensor.dtype(), aTensor));
+    DIOPI_CALL(castTo(ctx, DiopiTensor(b), outTensor.dtype(), bTensor));
+    TensorIterator iter;
+    DIOPI_CALL(iter.addOutput(outTensor).addInput(inputTensor).addInput(aTensor).addInput(bTensor).build());
+    return dispatchNumericTypes(outTensor.dtype(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        cpuKernelVec<T, 3>(iter, makeOp(tag));
+        return diopiSuccess;
+    });
+}
+
+}  // namespace cpu
+}  // namespace impl
+
+#endif  // IMPL_CPU_TENSOR_ITERATOR_HPP_
@@ -0,0 +1,63 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <diopi/diopirt.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "litert.hpp"
+
+extern "C" {
+
+// the device memory of the cpu backend is host memory and the streams carry no work
+void* device_malloc(uint64_t bytes) { return malloc(bytes); }
+
+void device_free(void* ptr) { free(ptr); }
+
+diopiError_t device_make_stream(diopiStreamHandle_t* stream_handle_ptr) {
+    *stream_handle_ptr = (diopiStreamHandle_t) new char;
+    return diopiSuccess;
+}
+
+diopiError_t device_destroy_stream(diopiStreamHandle_t stream_handle) {
+    delete (char*)stream_handle;
+    return diopiSuccess;
+}
+
+diopiError_t device_synchronize_stream(diopiStreamHandle_t stream_handle) { return diopiSuccess; }
+
+diopiError_t device_memcpy_h2d_async(diopiStreamHandle_t stream_handle, void* dst, const void* src, uint64_t bytes) {
+    memcpy(dst, src, bytes);
+    return diopiSuccess;
+}
+
+diopiError_t device_memcpy_d2h_async(diopiStreamHandle_t stream_handle, void* dst, const void* src, uint64_t bytes) {
+    memcpy(dst, src, bytes);
+    return diopiSuccess;
+}
+
+diopiError_t device_memcpy_d2d_async(diopiStreamHandle_t stream_handle, void* dst, const void* src, uint64_t bytes) {
+    memcpy(dst, src, bytes);
+    return diopiSuccess;
+}
+
+diopiError_t initLibrary() { return diopiSuccess; }
+
+diopiError_t finalizeLibrary() { return diopiSuccess; }
+
+diopiError_t buildGeneratorState(diopiContextHandle_t ctx, diopiTensorHandle_t out) {
+    std::vector<int64_t> vec{808};
+    diopiSize_t size{vec.data(), static_cast<int64_t>(vec.size())};
+    diopiTensorHandle_t tensor = nullptr;
+    diopiRequireTensor(ctx, &tensor, &size, nullptr, diopi_dtype_uint8, diopi_host);
+    *out = *tensor;
+    return diopiSuccess;
+}
+
+}  // extern "C"
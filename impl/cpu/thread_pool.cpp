@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace impl {
+namespace cpu {
+
+namespace {
+
+thread_local bool inParallelRegion = false;
+
+int64_t threadsFromEnv() {
+    const char* env = std::getenv("DIOPI_CPU_THREADS");
+    if (env != nullptr && std::atoi(env) > 0) {
+        return std::atoi(env);
+    }
+    return std::max<int64_t>(1, std::thread::hardware_concurrency());
+}
+
+}  // namespace
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(threadsFromEnv());
+    return pool;
+}
+
+ThreadPool::ThreadPool(int64_t numThreads) {
+    for (int64_t i = 1; i < numThreads; ++i) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(int64_t n, int64_t grain, const std::function<void(int64_t, int64_t)>& fn) {
+    std::unique_lock<std::mutex> submit(submitMutex_, std::defer_lock);
+    if (workers_.empty() || inParallelRegion || !submit.try_lock()) {
+        fn(0, n);
+        return;
+    }
+    // a few chunks per thread so that uneven chunks still balance
+    int64_t chunk = std::max<int64_t>(grain, (n + numThreads() * 4 - 1) / (numThreads() * 4));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = &fn;
+        n_ = n;
+        chunk_ = chunk;
+        next_.store(0);
+        busy_ = static_cast<int64_t>(workers_.size());
+        ++generation_;
+    }
+    wake_.notify_all();
+    runChunks();
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return busy_ == 0; });
+    fn_ = nullptr;
+}
+
+void ThreadPool::runChunks() {
+    inParallelRegion = true;
+    for (int64_t begin = next_.fetch_add(chunk_); begin < n_; begin = next_.fetch_add(chunk_)) {
+        (*fn_)(begin, std::min(begin + chunk_, n_));
+    }
+    inParallelRegion = false;
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+        runChunks();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busy_;
+        }
+        done_.notify_one();
+    }
+}
+
+}  // namespace cpu
+}  // namespace impl
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CPU_THREAD_POOL_HPP_
+#define IMPL_CPU_THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace impl {
+namespace cpu {
+
+// Fork-join pool shared by all kernels of the backend. The size is taken from DIOPI_CPU_THREADS, the number of
+// hardware threads otherwise. One parallelFor runs at a time; a parallelFor issued from inside a task, or while
+// another thread owns the pool, runs on the calling thread.
+class ThreadPool {
+public:
+    static ThreadPool& instance();
+
+    ~ThreadPool();
+
+    int64_t numThreads() const { return static_cast<int64_t>(workers_.size()) + 1; }
+
+    // Calls fn(begin, end) on disjoint chunks covering [0, n), each chunk at least grain long except the last one.
+    // The calling thread takes chunks too and returns once all of them are done.
+    void parallelFor(int64_t n, int64_t grain, const std::function<void(int64_t, int64_t)>& fn);
+
+private:
+    explicit ThreadPool(int64_t numThreads);
+
+    void workerLoop();
+    void runChunks();
+
+    std::vector<std::thread> workers_;
+    std::mutex submitMutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stop_ = false;
+    uint64_t generation_ = 0;
+    int64_t busy_ = 0;
+
+    const std::function<void(int64_t, int64_t)>* fn_ = nullptr;
+    int64_t n_ = 0;
+    int64_t chunk_ = 0;
+    std::atomic<int64_t> next_{0};
+};
+
+template <typename F>
+inline void parallelFor(int64_t n, int64_t grain, F&& fn) {
+    if (n <= grain) {
+        if (n > 0) {
+            fn(0, n);
+        }
+        return;
+    }
+    ThreadPool::instance().parallelFor(n, grain, std::function<void(int64_t, int64_t)>(std::forward<F>(fn)));
+}
+
+// elements an elementwise task is worth splitting into
+constexpr int64_t kGrainSize = 32768;
+
+}  // namespace cpu
+}  // namespace impl
+
+#endif  // IMPL_CPU_THREAD_POOL_HPP_
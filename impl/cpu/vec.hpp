@@ -0,0 +1,338 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CPU_VEC_HPP_
+#define IMPL_CPU_VEC_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <half.hpp>
+#include <limits>
+#include <type_traits>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace impl {
+namespace cpu {
+
+using half = half_float::half;
+
+// Register widths of the instruction sets the vectorized loops are built for: 128-bit for SSE2 and NEON, 256-bit for
+// AVX2. The loops of both widths are compiled into the library and picked at runtime.
+constexpr int64_t kGenericVecBytes = 16;
+constexpr int64_t kAvx2VecBytes = 32;
+
+// Type the elementwise kernels compute T in. half is widened to float, the other types are computed as they are.
+template <typename T>
+struct ComputeType {
+    using type = T;
+};
+template <>
+struct ComputeType<half> {
+    using type = float;
+};
+
+// signed integer as wide as T, the lane type of comparison results
+template <size_t Bytes>
+struct SignedInt;
+template <>
+struct SignedInt<1> {
+    using type = int8_t;
+};
+template <>
+struct SignedInt<2> {
+    using type = int16_t;
+};
+template <>
+struct SignedInt<4> {
+    using type = int32_t;
+};
+template <>
+struct SignedInt<8> {
+    using type = int64_t;
+};
+
+template <typename T>
+using MaskType = typename SignedInt<sizeof(T)>::type;
+
+// One SIMD register of Bytes bytes of T on top of the GCC vector extension, which lowers the operators to the
+// instructions of the function they are inlined into. The operators are friends so that a scalar operand is broadcast
+// implicitly.
+template <typename T, int64_t Bytes>
+struct Vec {
+    typedef T Native __attribute__((vector_size(Bytes)));
+    typedef MaskType<T> NativeMask __attribute__((vector_size(Bytes)));
+
+    static constexpr int64_t size = Bytes / sizeof(T);
+
+    // lanes of all ones or all zeros, the result of a comparison
+    struct Mask {
+        NativeMask value;
+
+        friend Mask operator&(const Mask& a, const Mask& b) { return Mask{a.value & b.value}; }
+        friend Mask operator|(const Mask& a, const Mask& b) { return Mask{a.value | b.value}; }
+        friend Mask operator!(const Mask& a) { return Mask{~a.value}; }
+    };
+
+    Native value;
+
+    Vec() = default;
+    Vec(T x) : value(Native{} + x) {}  // NOLINT
+
+    static Vec wrap(const Native& native) {
+        Vec result;
+        result.value = native;
+        return result;
+    }
+
+    static Vec load(const T* data) {
+        Vec result;
+        std::memcpy(&result.value, data, sizeof(Native));
+        return result;
+    }
+
+    void store(T* data) const { std::memcpy(data, &value, sizeof(Native)); }
+
+    T operator[](int64_t i) const { return value[i]; }
+
+    friend Vec operator+(const Vec& a, const Vec& b) { return wrap(a.value + b.value); }
+    friend Vec operator-(const Vec& a, const Vec& b) { return wrap(a.value - b.value); }
+    friend Vec operator*(const Vec& a, const Vec& b) { return wrap(a.value * b.value); }
+    friend Vec operator/(const Vec& a, const Vec& b) { return wrap(a.value / b.value); }
+    friend Vec operator-(const Vec& a) { return wrap(-a.value); }
+
+    friend Mask operator==(const Vec& a, const Vec& b) { return Mask{a.value == b.value}; }
+    friend Mask operator!=(const Vec& a, const Vec& b) { return Mask{a.value != b.value}; }
+    friend Mask operator<(const Vec& a, const Vec& b) { return Mask{a.value < b.value}; }
+    friend Mask operator<=(const Vec& a, const Vec& b) { return Mask{a.value <= b.value}; }
+    friend Mask operator>(const Vec& a, const Vec& b) { return Mask{a.value > b.value}; }
+    friend Mask operator>=(const Vec& a, const Vec& b) { return Mask{a.value >= b.value}; }
+};
+
+template <typename T>
+struct IsVec : std::false_type {};
+template <typename T, int64_t Bytes>
+struct IsVec<Vec<T, Bytes>> : std::true_type {};
+
+// Types the kernels run Vec loops for; bool is computed lane by lane
+template <typename T>
+struct HasVec : std::integral_constant<bool, std::is_arithmetic<typename ComputeType<T>::type>::value && !std::is_same<T, bool>::value> {};
+
+/********************************* load and store ****************************/
+
+// Reads and writes Vec<ComputeType<T>, Bytes>::size elements of T, converting half from and to float
+template <typename T, int64_t Bytes>
+struct VecIO {
+    using V = Vec<typename ComputeType<T>::type, Bytes>;
+
+    static V load(const T* data) { return V::load(data); }
+    static void store(T* data, const V& value) { value.store(data); }
+};
+
+template <int64_t Bytes>
+struct VecIO<half, Bytes> {
+    using V = Vec<float, Bytes>;
+
+    static V load(const half* data) {
+        V result;
+        for (int64_t i = 0; i < V::size; ++i) {
+            result.value[i] = static_cast<float>(data[i]);
+        }
+        return result;
+    }
+
+    static void store(half* data, const V& value) {
+        for (int64_t i = 0; i < V::size; ++i) {
+            data[i] = static_cast<half>(value.value[i]);
+        }
+    }
+};
+
+#if defined(__x86_64__)
+// Only the AVX2 loops use this width, and every CPU with AVX2 has F16C. Not always_inline, which would inline them into
+// the generic code of vectorizedLoop; the loops flattened for AVX2 take them in.
+template <>
+struct VecIO<half, kAvx2VecBytes> {
+    using V = Vec<float, kAvx2VecBytes>;
+
+    __attribute__((target("avx,f16c"))) static inline V load(const half* data) {
+        return V::wrap(reinterpret_cast<typename V::Native>(_mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)))));
+    }
+
+    __attribute__((target("avx,f16c"))) static inline void store(half* data, const V& value) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data), _mm256_cvtps_ph(reinterpret_cast<__m256>(value.value), _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+#endif
+
+/********************************* math ****************************/
+
+// The functions below take either scalars or Vec, so that one generic lambda serves both the scalar and the
+// vectorized loops of an op.
+namespace vec {
+
+template <typename T>
+inline T select(bool cond, T a, T b) {
+    return cond ? a : b;
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> select(const typename Vec<T, Bytes>::Mask& cond, const Vec<T, Bytes>& a, const Vec<T, Bytes>& b) {
+    return Vec<T, Bytes>::wrap(cond.value ? a.value : b.value);
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> select(const typename Vec<T, Bytes>::Mask& cond, T a, const Vec<T, Bytes>& b) {
+    return select(cond, Vec<T, Bytes>(a), b);
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> select(const typename Vec<T, Bytes>::Mask& cond, const Vec<T, Bytes>& a, T b) {
+    return select(cond, a, Vec<T, Bytes>(b));
+}
+
+// Applies the scalar f lane by lane, for the ops without a vector formula
+template <typename F, typename T, typename... Ts>
+inline typename std::enable_if<!IsVec<T>::value, T>::type map(F f, T x, Ts... rest) {
+    return f(x, rest...);
+}
+
+template <typename F, typename T, int64_t Bytes, typename... Ts>
+inline Vec<T, Bytes> map(F f, const Vec<T, Bytes>& x, const Ts&... rest) {
+    Vec<T, Bytes> result;
+    for (int64_t i = 0; i < Vec<T, Bytes>::size; ++i) {
+        result.value[i] = f(x.value[i], rest.value[i]...);
+    }
+    return result;
+}
+
+template <typename T>
+inline bool isnan(T x) {
+    return x != x;
+}
+
+template <typename T, int64_t Bytes>
+inline typename Vec<T, Bytes>::Mask isnan(const Vec<T, Bytes>& x) {
+    return x != x;
+}
+
+// Maximum and minimum propagating a NaN on either side
+template <typename T>
+inline auto max(const T& a, const T& b) {
+    return select(isnan(b), b, select(isnan(a), a, select(a < b, b, a)));
+}
+
+template <typename T>
+inline auto min(const T& a, const T& b) {
+    return select(isnan(b), b, select(isnan(a), a, select(b < a, b, a)));
+}
+
+template <typename T>
+inline auto abs(const T& x) {
+    return select(x < T(0), T(-x), x);
+}
+
+template <typename T>
+inline T exp(T x) {
+    return std::exp(x);
+}
+
+template <typename T>
+inline T log(T x) {
+    return std::log(x);
+}
+
+template <typename T>
+inline T sqrt(T x) {
+    return std::sqrt(x);
+}
+
+template <typename T>
+inline T tanh(T x) {
+    return std::tanh(x);
+}
+
+template <typename T>
+inline T trunc(T x) {
+    return std::trunc(x);
+}
+
+template <typename T>
+inline T floor(T x) {
+    return std::floor(x);
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> exp(const Vec<T, Bytes>& x) {
+    return map([](T v) { return std::exp(v); }, x);
+}
+
+// Range reduction to exp(r) * 2^n with |r| <= ln2/2 and the cephes polynomial for exp(r), within 2 ulp of expf
+template <int64_t Bytes>
+inline Vec<float, Bytes> exp(const Vec<float, Bytes>& x) {
+    using V = Vec<float, Bytes>;
+    typedef int32_t NativeInt __attribute__((vector_size(Bytes)));
+    const V clamped = min(max(x, V(-103.972076416015625f)), V(88.72283935546875f));
+    V n = clamped * 1.44269504088896341f + 0.5f;
+    // floor by truncation, corrected for the negative values
+    V truncated = V::wrap(__builtin_convertvector(__builtin_convertvector(n.value, NativeInt), typename V::Native));
+    n = select(truncated > n, truncated - 1.0f, truncated);
+    const V r = clamped - n * 0.693359375f + n * 2.12194440e-4f;
+    V p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.0f;
+    // 2^n in two factors, n reaches 128 at the top of the range and its exponent field would overflow
+    const NativeInt n1 = __builtin_convertvector(n.value, NativeInt) >> 1;
+    const NativeInt n2 = __builtin_convertvector(n.value, NativeInt) - n1;
+    const NativeInt bits1 = (n1 + 127) << 23;
+    const NativeInt bits2 = (n2 + 127) << 23;
+    V scale1;
+    V scale2;
+    std::memcpy(&scale1.value, &bits1, sizeof(bits1));
+    std::memcpy(&scale2.value, &bits2, sizeof(bits2));
+    V result = p * scale1 * scale2;
+    result = select(x > 88.72283935546875f, std::numeric_limits<float>::infinity(), result);
+    result = select(x < -103.972076416015625f, 0.0f, result);
+    return select(isnan(x), x, result);
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> log(const Vec<T, Bytes>& x) {
+    return map([](T v) { return std::log(v); }, x);
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> sqrt(const Vec<T, Bytes>& x) {
+    return map([](T v) { return std::sqrt(v); }, x);
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> tanh(const Vec<T, Bytes>& x) {
+    return map([](T v) { return std::tanh(v); }, x);
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> trunc(const Vec<T, Bytes>& x) {
+    return map([](T v) { return std::trunc(v); }, x);
+}
+
+template <typename T, int64_t Bytes>
+inline Vec<T, Bytes> floor(const Vec<T, Bytes>& x) {
+    return map([](T v) { return std::floor(v); }, x);
+}
+
+}  // namespace vec
+
+}  // namespace cpu
+}  // namespace impl
+
+#endif  // IMPL_CPU_VEC_HPP_
@@ -28,6 +28,14 @@ void* device_malloc(uint64_t bytes) {
 
 void device_free(void* ptr) { CALL_CUDA(cudaFree(ptr)); }
 
+void* device_malloc_host(uint64_t bytes) {
+    void* ptr;
+    CALL_CUDA(cudaMallocHost(&ptr, bytes));
+    return ptr;
+}
+
+void device_free_host(void* ptr) { CALL_CUDA(cudaFreeHost(ptr)); }
+
 diopiError_t device_make_stream(diopiStreamHandle_t* stream_handle_ptr) {
     cudaStream_t phStream;
     CALL_CUDA(cudaStreamCreate(&phStream));
@@ -47,6 +55,48 @@ diopiError_t device_synchronize_stream(diopiStreamHandle_t stream_handle) {
     return diopiSuccess;
 }
 
+diopiError_t device_make_event(void** event, diopiEventFlags_t flags) {
+    cudaEvent_t phEvent;
+    CALL_CUDA(cudaEventCreateWithFlags(&phEvent, (flags & diopiEventDisableTiming) ? cudaEventDisableTiming : cudaEventDefault));
+    *event = (void*)phEvent;
+    return diopiSuccess;
+}
+
+diopiError_t device_destroy_event(void* event) {
+    CALL_CUDA(cudaEventDestroy((cudaEvent_t)event));
+    return diopiSuccess;
+}
+
+diopiError_t device_record_event(void* event, diopiStreamHandle_t stream_handle) {
+    CALL_CUDA(cudaEventRecord((cudaEvent_t)event, (cudaStream_t)stream_handle));
+    return diopiSuccess;
+}
+
+diopiError_t device_stream_wait_event(diopiStreamHandle_t stream_handle, void* event) {
+    CALL_CUDA(cudaStreamWaitEvent((cudaStream_t)stream_handle, (cudaEvent_t)event, 0));
+    return diopiSuccess;
+}
+
+diopiError_t device_query_event(void* event, int32_t* is_completed) {
+    cudaError_t ret = cudaEventQuery((cudaEvent_t)event);
+    if (ret != cudaSuccess && ret != cudaErrorNotReady) {
+        printf("call a cudart function (cudaEventQuery) failed. return code=%d", ret);
+        return diopiErrorOccurred;
+    }
+    *is_completed = ret == cudaSuccess;
+    return diopiSuccess;
+}
+
+diopiError_t device_synchronize_event(void* event) {
+    CALL_CUDA(cudaEventSynchronize((cudaEvent_t)event));
+    return diopiSuccess;
+}
+
+diopiError_t device_event_elapsed_time(void* start, void* end, float* ms) {
+    CALL_CUDA(cudaEventElapsedTime(ms, (cudaEvent_t)start, (cudaEvent_t)end));
+    return diopiSuccess;
+}
+
 diopiError_t device_memcpy_h2d_async(diopiStreamHandle_t stream_handle, void* dst, const void* src, uint64_t bytes) {
     cudaStream_t phStream = (cudaStream_t)stream_handle;
     CALL_CUDA(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyHostToDevice, phStream));
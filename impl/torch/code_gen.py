@@ -9,12 +9,18 @@ import os
 #                                 diopiConstTensorHandle_t input, diopiConstTensorHandle_t mat2) {
 #     diopiError_t (*func) (diopiContextHandle_t, diopiTensorHandle_t,
 #         diopiConstTensorHandle_t, diopiConstTensorHandle_t);
-#     func = dlsym(handle, "diopiBmm");
-#     return (*func)(ctx, out, input, mat2);
+#     func = reinterpret_cast<decltype(func)>(lookup_func(0));
+#     if (func != NULL) {
+#         return (*func)(ctx, out, input, mat2);
+#     }
+#     ...
 # }
+#
+# where lookup_func(0) reads slot 0 of a dispatch table that diopi_init fills with dlsym once.
 
+func_names = []
 new_content = []
-new_content.append('/**\n\
+head_content = '/**\n\
  * @file\n\
  * @author DeepLink\n\
  * @copyright  (c) 2023, DeepLink.\n\
@@ -25,8 +31,18 @@ new_content.append('/**\n\
 #include <stdio.h>\n\
 #include <dlfcn.h>\n\
 \n\
+#include <atomic>\n\
+\n\
 static void* handle;\n\
 \n\
+'
+table_content = '\n\
+// func_names ends with a NULL entry, so neither array is empty when no function is wrapped\n\
+static const int kNumFuncs = sizeof(func_names) / sizeof(func_names[0]) - 1;\n\
+// a slot stays NULL until the symbol is resolved, kMissingFunc marks symbols known to be absent\n\
+static void* const kMissingFunc = reinterpret_cast<void*>(-1);\n\
+static std::atomic<void*> func_table[kNumFuncs + 1];\n\
+\n\
 static void\n\
 __attribute__ ((constructor))\n\
 diopi_init(void) {\n\
@@ -34,16 +50,44 @@ diopi_init(void) {\n\
     printf("diopi dyload init\\n");\n\
     if (!handle) {\n\
         fprintf (stderr, "%s ", dlerror());\n\
+        return;\n\
+    }\n\
+    for (int i = 0; i < kNumFuncs; ++i) {\n\
+        func_table[i].store(dlsym(handle, func_names[i]), std::memory_order_release);\n\
     }\n\
 }\n\
 \n\
 static void\n\
 __attribute__ ((destructor))\n\
-diopi_fini(void)\n\
-{\n\
-dlclose(handle);\n\
+diopi_fini(void) {\n\
+    if (handle) {\n\
+        dlclose(handle);\n\
+    }\n\
 }\n\
-\n')
+\n\
+// resolves a slot missed by diopi_init on its first use, a symbol that is still absent is reported once\n\
+static void* lookup_func_slow(int idx) {\n\
+    void* func = handle ? dlsym(handle, func_names[idx]) : NULL;\n\
+    void* expected = NULL;\n\
+    if (func != NULL) {\n\
+        func_table[idx].store(func, std::memory_order_release);\n\
+        return func;\n\
+    }\n\
+    if (func_table[idx].compare_exchange_strong(expected, kMissingFunc)) {\n\
+        printf("[wrap_func] %s not implemented!\\n", func_names[idx]);\n\
+    }\n\
+    return NULL;\n\
+}\n\
+\n\
+static inline void* lookup_func(int idx) {\n\
+    void* func = func_table[idx].load(std::memory_order_acquire);\n\
+    if (func == kMissingFunc) {\n\
+        return NULL;\n\
+    }\n\
+    return func != NULL ? func : lookup_func_slow(idx);\n\
+}\n\
+\n\
+'
 
 
 def get_func_arg(content):
@@ -96,7 +140,9 @@ def gen_wrapper_func(content):
                 temp_content.append(row1.lstrip())
                 idx += 1
 
-            if row.startswith("DIOPI_RT_API"):
+            # the runtime string getters take no argument, the other runtime functions forward like the ops
+            string_getter = row.startswith("DIOPI_RT_API") and "const char*" in row[:idx0]
+            if string_getter:
                 arg_type = ["    const char* (*func)();\n"]
                 arg = "()"
             else:
@@ -105,12 +151,12 @@ def gen_wrapper_func(content):
             for args in arg_type:
                 new_content.append(args)
 
-            new_content.append("    " + 'func = reinterpret_cast<decltype(func)>(dlsym(handle, "' + func_name + '"));\n')
+            new_content.append("    " + 'func = reinterpret_cast<decltype(func)>(lookup_func(' + str(len(func_names)) + '));  // ' + func_name + '\n')
+            func_names.append(func_name)
             new_content.append("    " + "if (func != NULL) {\n")
             new_content.append("    " + "    return (*func)" + arg + ";\n")
             new_content.append("    " + "} else {\n")
-            new_content.append("    " + "    printf(\"[wrap_func] %s not implemented!\\n\", \"" + func_name + "\");\n")
-            if row.startswith("DIOPI_RT_API"):
+            if string_getter:
                 new_content.append("    " + "    return \"" + func_name + " not implemented!\";\n")
             else:
                 new_content.append("    " + "    return diopiErrorOccurred;\n")
@@ -118,6 +164,19 @@ def gen_wrapper_func(content):
             new_content.append("}\n")
             new_content.append("\n")
 
+def write_wrapper_file(path):
+    with open(path, 'w') as f:
+        f.write(head_content)
+        f.write("static const char* const func_names[] = {\n")
+        for func_name in func_names:
+            f.write('    "' + func_name + '",\n')
+        f.write("    NULL,\n")
+        f.write("};\n")
+        f.write(table_content)
+        for row in new_content:
+            f.write(row)
+
+
 if __name__ == '__main__':
     print("open functions.h")
     _cur_dir = os.path.dirname(os.path.abspath(__file__))
@@ -136,7 +195,5 @@ if __name__ == '__main__':
     gen_wrapper_func(content_ext)
     os.system("rm -f wrap_func.cpp")
     print("generate wrap_func.cpp")
-    with open('wrap_func.cpp', 'w') as f:
-        for row in new_content:
-            f.write(row)
+    write_wrapper_file('wrap_func.cpp')
     print("finish codegen")
@@ -91,6 +91,47 @@ typedef enum { ReductionNone, ReductionMean, ReductionSum, ReductionEND } diopiR
 
 typedef enum { RoundModeNone, RoundModeTrunc, RoundModeFloor, RoundModeEND } diopiRoundMode_t;
 
+typedef enum { diopiEventDefault = 0, diopiEventDisableTiming = 1 } diopiEventFlags_t;
+
+/**
+ * Statistics of the memory the runtime manages for one device, in bytes unless noted otherwise
+ **/
+typedef struct {
+    int64_t allocated_bytes;       // held by live tensors and buffers, as requested
+    int64_t peak_allocated_bytes;  // high-water mark of allocated_bytes since the last reset
+    int64_t reserved_bytes;        // obtained from the device allocator, either in use or cached
+    int64_t peak_reserved_bytes;   // high-water mark of reserved_bytes since the last reset
+    int64_t cached_bytes;          // freed blocks kept for reuse
+    int64_t fragmented_bytes;      // rounding waste of the blocks in use
+    int64_t num_allocs;            // number of allocations, cumulative
+    int64_t num_device_allocs;     // number of those that reached the device allocator
+} diopiMemoryStats_t;
+
+/**
+ * Metadata of a tensor filled by one diopiGetTensorMeta call, shape and stride point into the tensor
+ * and stay valid as long as it is alive
+ **/
+typedef struct {
+    diopiSize_t shape;
+    diopiSize_t stride;
+    diopiDtype_t dtype;
+    diopiDevice_t device;
+    int64_t storage_offset;  // in elements of dtype
+    int64_t itemsize;        // in bytes
+    int64_t numel;
+} diopiTensorMeta_t;
+
+/**
+ * What a backend supports for one op, reported by diopiGetOpCapabilities so that callers can skip
+ * conversions the op does not need. Bit i of a mask stands for the enum value i.
+ **/
+typedef struct {
+    uint64_t dtypes;          // diopiDtype_t the kernel takes natively
+    uint64_t memory_formats;  // diopiMemoryFormat_t the kernel takes natively, 0 when any layout is accepted
+    uint8_t inplace_safe;     // outputs may alias inputs
+    int64_t workspace_bytes;  // scratch the op requires per call, 0 when none or unknown
+} diopiOpCapabilities_t;
+
 /**
  * Opaque structure holding Context and Tensor
  **/
@@ -110,6 +151,11 @@ typedef const struct diopiGenerator* diopiConstGeneratorHandle_t;
  **/
 typedef void* diopiStreamHandle_t;
 
+/**
+ * Opaque pointer of Event
+ **/
+typedef void* diopiEventHandle_t;
+
 /**
  * get the version of the Device-Independent Operator Inetrface
  */
@@ -131,17 +177,93 @@ extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGetTensorStoragePtr(diopiC
 extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGetTensorStorageOffset(diopiConstTensorHandle_t th, int64_t* pOffset);
 extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGetTensorStorageNbytes(diopiConstTensorHandle_t th, size_t* pNbytes);
 extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGetTensorDeviceIndex(diopiConstTensorHandle_t th, diopiDeviceIndex_t* pDevIndex);
+/**
+ * get shape, stride, dtype, device, storage offset, itemsize and numel of a tensor at once, instead of one getter call each
+ **/
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGetTensorMeta(diopiConstTensorHandle_t th, diopiTensorMeta_t* meta);
 
 /**
  * operations to require Stream and Tensor instances from a Context handle
  **/
 extern DIOPI_RT_API diopiError_t diopiGetStream(diopiContextHandle_t ctx, diopiStreamHandle_t* stream);
+/**
+ * get an auxiliary stream of the context, the streams are taken round-robin from a small per-context pool.
+ * memory required from the context is associated with the stream of diopiGetStream, work on an auxiliary stream
+ * that uses it should be ordered with that stream through events.
+ **/
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGetStreamFromPool(diopiContextHandle_t ctx, diopiStreamHandle_t* stream);
 
 extern DIOPI_RT_API diopiError_t diopiRequireTensor(diopiContextHandle_t ctx, diopiTensorHandle_t* tensor, const diopiSize_t* size, const diopiSize_t* stride,
                                                     const diopiDtype_t dtype, const diopiDevice_t device);
 extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiRequireBuffer(diopiContextHandle_t ctx, diopiTensorHandle_t* tensor, int64_t num_bytes,
                                                                     diopiDevice_t device);
 
+/**
+ * require a view of src that shares its storage, the view starts at storage_offset (counted in elements of src's dtype)
+ * and addresses its elements by size and stride, a nullptr stride means contiguous. the view may address the elements
+ * src spans only, or, when src is a view itself, those of the tensor src was made from.
+ **/
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiRequireTensorView(diopiContextHandle_t ctx, diopiTensorHandle_t* tensor, diopiConstTensorHandle_t src,
+                                                                        const diopiSize_t* size, const diopiSize_t* stride, int64_t storage_offset);
+
+/**
+ * re-point a view required by diopiRequireTensorView to another window of the tensor it was made from, size, stride and
+ * storage_offset mean the same as there. the handle stays the same, so a loop over the tiles of a tensor needs one view instead of one per tile.
+ **/
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorResetView(diopiTensorHandle_t tensor, const diopiSize_t* size, const diopiSize_t* stride,
+                                                                      int64_t storage_offset);
+
+/**
+ * make dst take over the storage, storage offset and strides of src, the two tensors must have the same shape, dtype and device.
+ * it fails without touching dst when either storage is shared, e.g. dst is a view, src lives in a context arena or the memory of dst
+ * was exported to the host side of the runtime and is still referenced there, so the caller can fall back to copying src into dst.
+ **/
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorAdoptLayout(diopiTensorHandle_t dst, diopiConstTensorHandle_t src);
+
+/**
+ * query the memory statistics of a device, the runtime pools memory process-wide, so the statistics cover every context.
+ * diopiResetPeakMemoryStats sets the peaks to the current values, the allocation counts are cumulative and keep counting.
+ **/
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGetMemoryStats(diopiContextHandle_t ctx, diopiDevice_t device, diopiMemoryStats_t* stats);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiResetPeakMemoryStats(diopiContextHandle_t ctx, diopiDevice_t device);
+
+/**
+ * operations to manipulate Event objects, an event marks a point in the work queued on a stream.
+ * events are owned by the context they are created from, diopiEventElapsedTime reports milliseconds between two recorded events
+ * and refuses events created with diopiEventDisableTiming. Without device event support a timed event synchronizes the stream
+ * when it is recorded, so that it is stamped once the work before it has completed, while recording an event with
+ * diopiEventDisableTiming never blocks, but querying it then waits for its stream and reports it completed.
+ **/
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiEventCreate(diopiContextHandle_t ctx, diopiEventHandle_t* event);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiEventCreateWithFlags(diopiContextHandle_t ctx, diopiEventHandle_t* event, diopiEventFlags_t flags);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiEventDestroy(diopiContextHandle_t ctx, diopiEventHandle_t event);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiEventRecord(diopiEventHandle_t event, diopiStreamHandle_t stream);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiStreamWaitEvent(diopiStreamHandle_t stream, diopiEventHandle_t event);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiEventQuery(diopiEventHandle_t event, int32_t* is_completed);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiEventSynchronize(diopiEventHandle_t event);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiEventElapsedTime(diopiEventHandle_t start, diopiEventHandle_t end, float* ms);
+
+/**
+ * operations to copy between Tensor objects and host buffers. The synchronous calls return once the copy has completed.
+ * The Async calls only enqueue the copies on stream, the stream of the context when it is nullptr, and record event after
+ * them when it is not nullptr. Copies on a stream of diopiGetStreamFromPool overlap the kernels on the stream of the
+ * context, which waits for them through diopiStreamWaitEvent on event, an event created with diopiEventDisableTiming keeps
+ * recording it from waiting for the copies. The host buffers have to stay valid and unmodified until the event has completed
+ * or the stream has been synchronized.
+ **/
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorCopyFromBuffer(diopiContextHandle_t ctx, const void* src, diopiTensorHandle_t tensor);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorCopyToBuffer(diopiContextHandle_t ctx, diopiConstTensorHandle_t tensor, void* dst);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorCopyFromBufferAsync(diopiContextHandle_t ctx, const void* src, diopiTensorHandle_t tensor,
+                                                                                diopiStreamHandle_t stream, diopiEventHandle_t event);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorCopyToBufferAsync(diopiContextHandle_t ctx, diopiConstTensorHandle_t tensor, void* dst,
+                                                                              diopiStreamHandle_t stream, diopiEventHandle_t event);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorsCopyFromBuffersAsync(diopiContextHandle_t ctx, const void* const* srcs,
+                                                                                  const diopiTensorHandle_t* tensors, int64_t num, diopiStreamHandle_t stream,
+                                                                                  diopiEventHandle_t event);
+extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiTensorsCopyToBuffersAsync(diopiContextHandle_t ctx, const diopiConstTensorHandle_t* tensors,
+                                                                                void* const* dsts, int64_t num, diopiStreamHandle_t stream,
+                                                                                diopiEventHandle_t event);
+
 extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGeneratorGetState(diopiContextHandle_t ctx, diopiConstGeneratorHandle_t th, diopiTensorHandle_t* data);
 extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGeneratorSetState(diopiGeneratorHandle_t th, diopiConstTensorHandle_t state);
 
@@ -152,6 +274,21 @@ extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGeneratorSetState(diopiGen
 extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiRecordStart(const char* record_name, void** record);
 extern DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiRecordEnd(void** record);
 
+/**
+ * timing of the adaptor scopes, collected when DIOPI_ENABLE_TIMING is set.
+ * diopiAdaptorTimingDump writes the report to fileName, or to DIOPI_TIMING_FILE when fileName is NULL, and returns
+ * diopiNotInited when timing is off. diopiAdaptorTimingReset drops what was collected so far.
+ **/
+extern DIOPI_API diopiError_t diopiAdaptorTimingDump(const char* fileName);
+extern DIOPI_API diopiError_t diopiAdaptorTimingReset();
+
+/**
+ * calls, failures, time and bytes copied of the ops the adaptor ran in the host library of DIOPI_FALLBACK_LIB.
+ * diopiAdaptorFallbackDump writes the report to fileName, or to stdout when fileName is NULL, and returns
+ * diopiNotInited when no fallback library is loaded. The report is also printed at exit when an op fell back.
+ **/
+extern DIOPI_API diopiError_t diopiAdaptorFallbackDump(const char* fileName);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -20,6 +20,12 @@ DIOPI_RT_API DIOPI_ATTR_WEEK const char* diopiGetVendorName();
 DIOPI_RT_API DIOPI_ATTR_WEEK const char* diopiGetImplVersion();
 DIOPI_RT_API DIOPI_ATTR_WEEK const char* diopiGetLastErrorString();
 
+/**
+ * \brief get what the backend supports for an op, e.g. "diopiAdd". Returns diopiNoImplement for ops it does not report,
+ * callers then keep their own assumptions.
+ */
+DIOPI_RT_API DIOPI_ATTR_WEEK diopiError_t diopiGetOpCapabilities(const char* opName, diopiOpCapabilities_t* caps);
+
 /**
  * @brief Applies a 2D convolution over an input image composed of several input planes.
  * @param[in] ctx Context environment.